@@ -21,6 +21,7 @@ extern "C" {
 #include <stdbool.h>
 
 #include "mpu6050_def.h"
+#include "mpu6050_ring.h"
 
 #define MPU6050_WHO_AM_I_DEFAULT 0x68U /*! Who Am I default value */
 
@@ -46,27 +47,245 @@ typedef enum {
 
 } mpu6050_accelconfig_fs_t;
 
-mpu6050_status_t mpu6050_init(void);
-mpu6050_status_t mpu6050_sanity_check(void);
-mpu6050_status_t mpu6050_read_pwrmgmt(uint8_t *ppwrmgmt);
-mpu6050_status_t mpu6050_reset_pwrmgmt(void);
-mpu6050_status_t mpu6050_gyro_read_config(uint8_t *pgyroconfig);
-mpu6050_status_t mpu6050_accel_read_config(uint8_t *paccelconfig);
-mpu6050_status_t mpu6050_gyro_set_fullscale(mpu6050_gyroconfig_fs_t gyro_fullscale);
-mpu6050_status_t mpu6050_accel_set_fullscale(mpu6050_accelconfig_fs_t accel_fullscale);
-mpu6050_status_t mpu6050_gyro_read_raw(uint16_t *pgyrox, uint16_t *pgyroy, uint16_t *pgyroz);
-mpu6050_status_t mpu6050_gyro_fetch(void);
-mpu6050_status_t mpu6050_gyro_read_from_buffer(uint16_t *pgyrox, uint16_t *pgyroy,
+/**
+ * @brief MPU6050 Digital Low Pass Filter, named by accel bandwidth
+ */
+typedef enum {
+  MPU6050_DLPF_260HZ = 0x00U, /*!< Gyro 256 Hz, gyro output rate 8 kHz */
+  MPU6050_DLPF_184HZ = 0x01U, /*!< Gyro 188 Hz */
+  MPU6050_DLPF_94HZ = 0x02U,  /*!< Gyro 98 Hz */
+  MPU6050_DLPF_44HZ = 0x03U,  /*!< Gyro 42 Hz */
+  MPU6050_DLPF_21HZ = 0x04U,  /*!< Gyro 20 Hz */
+  MPU6050_DLPF_10HZ = 0x05U,  /*!< Gyro 10 Hz */
+  MPU6050_DLPF_5HZ = 0x06U,   /*!< Gyro 5 Hz */
+
+} mpu6050_dlpf_t;
+
+/**
+ * @brief MPU6050 accel only low power wake-up rate
+ */
+typedef enum {
+  MPU6050_LP_WAKE_1_25HZ = 0x00U,
+  MPU6050_LP_WAKE_5HZ = 0x01U,
+  MPU6050_LP_WAKE_20HZ = 0x02U,
+  MPU6050_LP_WAKE_40HZ = 0x03U,
+
+} mpu6050_lp_wake_t;
+
+/**
+ * @brief MPU6050 standby axes, bitmask of PWR_MGMT_2
+ */
+typedef enum {
+  MPU6050_STBY_ZG = 1U << 0,
+  MPU6050_STBY_YG = 1U << 1,
+  MPU6050_STBY_XG = 1U << 2,
+  MPU6050_STBY_ZA = 1U << 3,
+  MPU6050_STBY_YA = 1U << 4,
+  MPU6050_STBY_XA = 1U << 5,
+  MPU6050_STBY_GYRO = (1U << 2) | (1U << 1) | (1U << 0),
+  MPU6050_STBY_ACCEL = (1U << 5) | (1U << 4) | (1U << 3),
+
+} mpu6050_standby_t;
+
+/**
+ * @brief MPU6050 FIFO sensor selection, bitmask of the measurements loaded into the FIFO
+ */
+typedef enum {
+  MPU6050_FIFO_SEL_TEMP = 1U << 7,
+  MPU6050_FIFO_SEL_GYRO_X = 1U << 6,
+  MPU6050_FIFO_SEL_GYRO_Y = 1U << 5,
+  MPU6050_FIFO_SEL_GYRO_Z = 1U << 4,
+  MPU6050_FIFO_SEL_ACCEL = 1U << 3,
+  MPU6050_FIFO_SEL_GYRO = (1U << 6) | (1U << 5) | (1U << 4),
+  MPU6050_FIFO_SEL_ALL = (1U << 7) | (1U << 6) | (1U << 5) | (1U << 4) | (1U << 3),
+  MPU6050_FIFO_SEL_SLV2 = 1U << 2,
+  MPU6050_FIFO_SEL_SLV1 = 1U << 1,
+  MPU6050_FIFO_SEL_SLV0 = 1U << 0,
+  MPU6050_FIFO_SEL_SLV = (1U << 2) | (1U << 1) | (1U << 0),
+
+} mpu6050_fifo_sel_t;
+
+/**
+ * @brief MPU6050 interrupt sources, bitmask of INT_ENABLE and INT_STATUS
+ */
+typedef enum {
+  MPU6050_INT_DATA_RDY = 1U << 0,
+  MPU6050_INT_FIFO_OFLOW = 1U << 4,
+  MPU6050_INT_MOTION = 1U << 6,
+
+} mpu6050_int_t;
+
+/**
+ * @brief MPU6050 INT pin configuration
+ */
+typedef struct {
+  bool active_low;    /*!< INT pin is active low */
+  bool open_drain;    /*!< INT pin is open drain */
+  bool latch;         /*!< INT pin is held until the interrupt is cleared */
+  bool clear_on_read; /*!< Interrupt is cleared by any read, not only INT_STATUS */
+
+} mpu6050_int_config_t;
+
+/**
+ * @brief MPU6050 auxiliary I2C master clock, I2C_MST_CLK values
+ */
+typedef enum {
+  MPU6050_AUX_CLOCK_258KHZ = 0x08U,
+  MPU6050_AUX_CLOCK_348KHZ = 0x00U,
+  MPU6050_AUX_CLOCK_400KHZ = 0x0DU,
+  MPU6050_AUX_CLOCK_500KHZ = 0x09U,
+
+} mpu6050_aux_clock_t;
+
+/**
+ * @brief MPU6050 auxiliary I2C slave, transferred by the MPU6050 on every sample
+ */
+typedef struct {
+  uint8_t address;     /*!< 7-bit I2C address of the aux sensor */
+  uint8_t reg_address; /*!< First register to read, or register to write */
+  uint8_t length;      /*!< Bytes read on every sample, up to 15, 0 writes data_out instead */
+  uint8_t data_out;    /*!< Byte written on every sample when length is 0 */
+  bool byte_swap;      /*!< Swap the bytes of 16-bit words, for little endian sensors */
+
+} mpu6050_aux_slave_t;
+
+/**
+ * @brief MPU6050 init table step
+ */
+typedef enum {
+  MPU6050_INIT_WRITE = 0x00U,      /*!< Register write, contiguous writes go in a single burst */
+  MPU6050_INIT_WAIT_RESET = 0x01U, /*!< Wait for the device reset to complete */
+  MPU6050_INIT_WAIT_DATA = 0x02U,  /*!< Wait for the first sample after wake-up */
+
+} mpu6050_init_op_t;
+
+/**
+ * @brief MPU6050 init table entry
+ */
+typedef struct {
+  mpu6050_init_op_t op; /*!< Step */
+  uint8_t reg_address;  /*!< Register to write */
+  uint8_t value;        /*!< Value to write */
+
+} mpu6050_init_step_t;
+
+#define MPU6050_INIT_REG(reg, value) {MPU6050_INIT_WRITE, (reg), (value)} /*! Register write */
+#define MPU6050_INIT_WAIT(op) {(op), 0x00U, 0x00U}                        /*! Wait step */
+
+#ifndef MPU6050_INIT_BURST_MAX
+#define MPU6050_INIT_BURST_MAX 8U /*! Registers of an init table burst write */
+#endif
+
+#ifndef MPU6050_INIT_TIMEOUT_US
+#define MPU6050_INIT_TIMEOUT_US 200000U /*! Time limit of an init table wait step */
+#endif
+
+mpu6050_status_t mpu6050_init(mpu6050_t *hmpu, void *bus, mpu6050_i2c_address_t address);
+mpu6050_status_t mpu6050_init_table(mpu6050_t *hmpu, const mpu6050_init_step_t *psteps,
+                                    uint8_t count, uint32_t timeout_us);
+mpu6050_status_t mpu6050_start(mpu6050_t *hmpu, mpu6050_gyroconfig_fs_t gyro_fs,
+                               mpu6050_accelconfig_fs_t accel_fs, mpu6050_dlpf_t dlpf,
+                               uint8_t divider);
+mpu6050_status_t mpu6050_shadow_resync(mpu6050_t *hmpu);
+mpu6050_status_t mpu6050_sanity_check(mpu6050_t *hmpu);
+mpu6050_status_t mpu6050_read_pwrmgmt(mpu6050_t *hmpu, uint8_t *ppwrmgmt);
+mpu6050_status_t mpu6050_reset_pwrmgmt(mpu6050_t *hmpu);
+mpu6050_status_t mpu6050_set_standby(mpu6050_t *hmpu, uint8_t standby);
+mpu6050_status_t mpu6050_cycle_start(mpu6050_t *hmpu, mpu6050_lp_wake_t wake);
+mpu6050_status_t mpu6050_cycle_stop(mpu6050_t *hmpu);
+mpu6050_status_t mpu6050_motion_config(mpu6050_t *hmpu, uint16_t threshold_mg,
+                                       uint8_t duration_ms);
+mpu6050_status_t mpu6050_motion_wake_start(mpu6050_t *hmpu, uint32_t int_line,
+                                           mpu6050_lp_wake_t wake);
+mpu6050_status_t mpu6050_motion_wake_stop(mpu6050_t *hmpu);
+bool mpu6050_is_motion_detected(mpu6050_t *hmpu);
+mpu6050_status_t mpu6050_gyro_read_config(mpu6050_t *hmpu, uint8_t *pgyroconfig);
+mpu6050_status_t mpu6050_accel_read_config(mpu6050_t *hmpu, uint8_t *paccelconfig);
+mpu6050_status_t mpu6050_gyro_set_fullscale(mpu6050_t *hmpu,
+                                            mpu6050_gyroconfig_fs_t gyro_fullscale);
+mpu6050_status_t mpu6050_accel_set_fullscale(mpu6050_t *hmpu,
+                                             mpu6050_accelconfig_fs_t accel_fullscale);
+mpu6050_status_t mpu6050_set_dlpf(mpu6050_t *hmpu, mpu6050_dlpf_t dlpf);
+mpu6050_status_t mpu6050_set_sample_divider(mpu6050_t *hmpu, uint8_t divider);
+mpu6050_status_t mpu6050_read_sample_rate(mpu6050_t *hmpu, float *prate_hz);
+mpu6050_status_t mpu6050_set_odr(mpu6050_t *hmpu, float odr_hz, float bandwidth_hz,
+                                 float *pachieved_hz);
+mpu6050_status_t mpu6050_gyro_read_offsets(mpu6050_t *hmpu, int16_t *poffsets);
+mpu6050_status_t mpu6050_gyro_write_offsets(mpu6050_t *hmpu, const int16_t *poffsets);
+mpu6050_status_t mpu6050_accel_read_offsets(mpu6050_t *hmpu, int16_t *poffsets);
+mpu6050_status_t mpu6050_accel_write_offsets(mpu6050_t *hmpu, const int16_t *poffsets);
+mpu6050_status_t mpu6050_gyro_read_raw(mpu6050_t *hmpu, uint16_t *pgyrox, uint16_t *pgyroy,
+                                       uint16_t *pgyroz);
+mpu6050_status_t mpu6050_gyro_fetch(mpu6050_t *hmpu);
+mpu6050_status_t mpu6050_gyro_read_from_buffer(mpu6050_t *hmpu, uint16_t *pgyrox, uint16_t *pgyroy,
                                                uint16_t *pgyroz);
-mpu6050_status_t mpu6050_accel_read_raw(uint16_t *paccelx, uint16_t *paccely, uint16_t *paccelz);
-mpu6050_status_t mpu6050_accel_fetch(void);
-mpu6050_status_t mpu6050_accel_read_from_buffer(uint16_t *paccelx, uint16_t *paccely,
-                                                uint16_t *paccelz);
-mpu6050_status_t mpu6050_temp_read_raw(uint16_t *ptemp);
-mpu6050_status_t mpu6050_temp_fetch(void);
-mpu6050_status_t mpu6050_temp_read_from_buffer(uint16_t *ptemp);
-void mpu6050_rxcallback(void);
-bool mpu6050_is_data_ready(void);
+mpu6050_status_t mpu6050_accel_read_raw(mpu6050_t *hmpu, uint16_t *paccelx, uint16_t *paccely,
+                                        uint16_t *paccelz);
+mpu6050_status_t mpu6050_accel_fetch(mpu6050_t *hmpu);
+mpu6050_status_t mpu6050_accel_read_from_buffer(mpu6050_t *hmpu, uint16_t *paccelx,
+                                                uint16_t *paccely, uint16_t *paccelz);
+mpu6050_status_t mpu6050_temp_read_raw(mpu6050_t *hmpu, uint16_t *ptemp);
+mpu6050_status_t mpu6050_temp_fetch(mpu6050_t *hmpu);
+mpu6050_status_t mpu6050_temp_read_from_buffer(mpu6050_t *hmpu, uint16_t *ptemp);
+mpu6050_status_t mpu6050_read_all_raw(mpu6050_t *hmpu, mpu6050_sample_t *psample);
+mpu6050_status_t mpu6050_fetch_all(mpu6050_t *hmpu);
+mpu6050_status_t mpu6050_read_all_from_buffer(mpu6050_t *hmpu, mpu6050_sample_t *psample);
+mpu6050_status_t mpu6050_aux_master_enable(mpu6050_t *hmpu, mpu6050_aux_clock_t clock);
+mpu6050_status_t mpu6050_aux_master_disable(mpu6050_t *hmpu);
+mpu6050_status_t mpu6050_aux_bypass(mpu6050_t *hmpu, bool enable);
+mpu6050_status_t mpu6050_aux_slave_config(mpu6050_t *hmpu, uint8_t slave,
+                                          const mpu6050_aux_slave_t *pslave);
+mpu6050_status_t mpu6050_aux_slave_disable(mpu6050_t *hmpu, uint8_t slave);
+mpu6050_status_t mpu6050_aux_read(mpu6050_t *hmpu, uint8_t address, uint8_t reg_address,
+                                  uint8_t *pdata);
+mpu6050_status_t mpu6050_aux_write(mpu6050_t *hmpu, uint8_t address, uint8_t reg_address,
+                                   uint8_t data);
+uint8_t mpu6050_aux_ext_len(mpu6050_t *hmpu);
+uint8_t mpu6050_aux_slave_offset(mpu6050_t *hmpu, uint8_t slave);
+mpu6050_status_t mpu6050_read_all_ext(mpu6050_t *hmpu, mpu6050_sample_t *psample, uint8_t *pext);
+mpu6050_status_t mpu6050_read_ext_from_buffer(mpu6050_t *hmpu, uint8_t *pext);
+mpu6050_status_t mpu6050_fifo_enable(mpu6050_t *hmpu, uint8_t sel);
+mpu6050_status_t mpu6050_fifo_disable(mpu6050_t *hmpu);
+mpu6050_status_t mpu6050_fifo_reset(mpu6050_t *hmpu);
+mpu6050_status_t mpu6050_fifo_read_count(mpu6050_t *hmpu, uint16_t *pcount);
+mpu6050_status_t mpu6050_fifo_drain(mpu6050_t *hmpu, uint8_t *pbuffer, uint16_t buffer_size,
+                                    uint16_t *pframes);
+mpu6050_status_t mpu6050_fifo_fetch(mpu6050_t *hmpu, uint8_t *pbuffer, uint16_t buffer_size,
+                                    uint16_t *pframes);
+mpu6050_status_t mpu6050_fifo_parse_frame(mpu6050_t *hmpu, const uint8_t *pframe,
+                                          mpu6050_sample_t *psample);
+mpu6050_status_t mpu6050_fifo_parse_ext(mpu6050_t *hmpu, const uint8_t *pframe, uint8_t *pext);
+uint16_t mpu6050_fifo_frame_size(mpu6050_t *hmpu);
+uint32_t mpu6050_fifo_overflow_count(mpu6050_t *hmpu);
+mpu6050_status_t mpu6050_fifo_timestamps(mpu6050_t *hmpu, uint16_t frames, uint64_t *ptimestamps);
+uint32_t mpu6050_fifo_period_ns(mpu6050_t *hmpu);
+mpu6050_status_t mpu6050_stream_start(mpu6050_t *hmpu, mpu6050_ring_t *pring);
+void mpu6050_stream_stop(mpu6050_t *hmpu);
+bool mpu6050_is_streaming(mpu6050_t *hmpu);
+void mpu6050_sched_init(mpu6050_sched_t *psched);
+mpu6050_status_t mpu6050_sched_add(mpu6050_sched_t *psched, mpu6050_t *hmpu);
+mpu6050_status_t mpu6050_sched_start(mpu6050_sched_t *psched);
+void mpu6050_sched_stop(mpu6050_sched_t *psched);
+mpu6050_status_t mpu6050_int_config(mpu6050_t *hmpu, const mpu6050_int_config_t *pconfig);
+mpu6050_status_t mpu6050_int_enable(mpu6050_t *hmpu, uint8_t int_mask);
+mpu6050_status_t mpu6050_int_read_status(mpu6050_t *hmpu, uint8_t *pstatus);
+mpu6050_status_t mpu6050_drdy_start(mpu6050_t *hmpu, uint32_t int_line, mpu6050_ring_t *pring);
+mpu6050_status_t mpu6050_drdy_stop(mpu6050_t *hmpu);
+void mpu6050_int_callback(mpu6050_t *hmpu);
+void mpu6050_rxcallback(mpu6050_t *hmpu);
+bool mpu6050_is_data_ready(mpu6050_t *hmpu);
+uint64_t mpu6050_read_timestamp(mpu6050_t *hmpu);
+void mpu6050_timing_read(mpu6050_t *hmpu, mpu6050_timing_t *ptiming);
+void mpu6050_timing_reset(mpu6050_t *hmpu);
+void mpu6050_set_retry_budget(mpu6050_t *hmpu, uint32_t budget_us);
+mpu6050_status_t mpu6050_recover(mpu6050_t *hmpu);
+void mpu6050_recovery_read(mpu6050_t *hmpu, mpu6050_recovery_t *precovery);
+void mpu6050_recovery_reset(mpu6050_t *hmpu);
+void mpu6050_stats_set_counter(mpu6050_t *hmpu, mpu6050_counter_t counter);
+mpu6050_status_t mpu6050_stats_snapshot(mpu6050_t *hmpu, mpu6050_stats_t *pstats);
+void mpu6050_stats_reset(mpu6050_t *hmpu);
+uint32_t mpu6050_stats_percentile(const mpu6050_stats_t *pstats, mpu6050_xfer_kind_t kind,
+                                  float percent);
 
 #ifdef __cplusplus
 }
@@ -0,0 +1,244 @@
+/**
+ ******************************************************************************
+ * @file           : mpu6050.hpp
+ * @author         : Gonzalo Gabriel Fernandez
+ * @brief          : MPU6050 Driver C++17 header-only wrapper
+ ******************************************************************************
+ * @attention
+ *
+ * Compile-time configured device over the C driver. Address, full scales and
+ * bus handle type are template parameters, the register values and scale
+ * factors are constexpr, and raw samples convert inline into typed samples.
+ * Bus policies only name the port bus handle, so the calls go straight to
+ * the C implementation.
+ *
+ ******************************************************************************
+ */
+
+#ifndef __MPU6050_HPP
+#define __MPU6050_HPP
+
+#include <array>
+#include <cstdint>
+
+#include "mpu6050.h"
+#include "mpu6050_registers.h"
+
+#if defined(STM32F103xB)
+#include "stm32f1xx_hal.h"
+#elif defined(STM32F429xx)
+#include "stm32f4xx_hal.h"
+#else
+#include "port_i2c_sim.h"
+#if defined(__linux__)
+#include "port_i2c_linux.h"
+#endif
+#endif
+
+namespace mpu6050 {
+
+/**
+ * @brief I2C slave address, by the AD0 pin level
+ */
+enum class Address : uint8_t {
+  Ad0Low = MPU6050_I2C_ADDRESS_1,
+  Ad0High = MPU6050_I2C_ADDRESS_2,
+};
+
+/**
+ * @brief Gyro Full Scale Select
+ */
+enum class GyroFs : uint8_t {
+  Dps250 = MPU6050_GYRO_CONFIG_250DPS,
+  Dps500 = MPU6050_GYRO_CONFIG_500DPS,
+  Dps1000 = MPU6050_GYRO_CONFIG_1000DPS,
+  Dps2000 = MPU6050_GYRO_CONFIG_2000DPS,
+};
+
+/**
+ * @brief Accel Full Scale Select
+ */
+enum class AccelFs : uint8_t {
+  G2 = MPU6050_ACCEL_CONFIG_2G,
+  G4 = MPU6050_ACCEL_CONFIG_4G,
+  G8 = MPU6050_ACCEL_CONFIG_8G,
+  G16 = MPU6050_ACCEL_CONFIG_16G,
+};
+
+constexpr float kStandardGravity = 9.80665f;       /*!< Standard gravity in m/s^2 */
+constexpr float kDegToRad = 0.017453292519943295f; /*!< Degrees to radians */
+constexpr float kTempScale = 1.0f / 340.0f;        /*!< Temperature sensitivity */
+constexpr float kTempOffset = 36.53f;              /*!< Temperature offset in Celsius */
+
+/**
+ * @brief   Accel scale factor, full scale doubles with each setting from 2g
+ * @param   fs: Accel Full Scale
+ * @retval  m/s^2 per LSB
+ */
+constexpr float accel_scale(AccelFs fs) {
+  return static_cast<float>(2U << static_cast<uint8_t>(fs)) * kStandardGravity / 32768.0f;
+}
+
+/**
+ * @brief   Gyro scale factor, full scale doubles with each setting from 250 dps
+ * @param   fs: Gyro Full Scale
+ * @retval  rad/s per LSB
+ */
+constexpr float gyro_scale(GyroFs fs) {
+  return static_cast<float>(250U << static_cast<uint8_t>(fs)) * kDegToRad / 32768.0f;
+}
+
+/**
+ * @brief Physical quantity tagged with its unit, same layout as a float
+ */
+template <typename Unit> struct Quantity {
+  float value; /*!< Value in the unit */
+
+  constexpr float operator()() const { return value; }
+};
+
+struct MetersPerSecond2 {};
+struct RadiansPerSecond {};
+struct Celsius {};
+
+using Acceleration = Quantity<MetersPerSecond2>;
+using AngularRate = Quantity<RadiansPerSecond>;
+using Temperature = Quantity<Celsius>;
+
+/**
+ * @brief Measurements of one sample in SI units
+ */
+struct Sample {
+  std::array<Acceleration, 3> accel; /*!< Accel X, Y, Z */
+  Temperature temp;                  /*!< Die temperature */
+  std::array<AngularRate, 3> gyro;   /*!< Gyro X, Y, Z */
+};
+
+#if defined(STM32F103xB) || defined(STM32F429xx)
+/**
+ * @brief STM32 HAL bus policy, the bus handle is the I2C peripheral handle
+ */
+struct HalBus {
+  using handle_type = I2C_HandleTypeDef;
+};
+#else
+/**
+ * @brief Simulated bus policy
+ */
+struct SimBus {
+  using handle_type = i2c_sim_bus_t;
+};
+#if defined(__linux__)
+/**
+ * @brief Linux i2c-dev bus policy
+ */
+struct LinuxBus {
+  using handle_type = i2c_linux_bus_t;
+};
+#endif
+#endif
+
+/**
+ * @brief MPU6050 device with compile-time address and full scales
+ * @note  The full scales are written by init and must not be changed through the C handle.
+ */
+template <typename Bus, Address Addr, GyroFs Gfs = GyroFs::Dps250, AccelFs Afs = AccelFs::G2>
+class Mpu6050 {
+public:
+  using bus_type = typename Bus::handle_type;
+
+  static constexpr mpu6050_i2c_address_t address = static_cast<mpu6050_i2c_address_t>(Addr);
+  static constexpr uint8_t gyro_config = static_cast<uint8_t>(Gfs) << MPU6050_GYRO_FS_SEL_OFFSET;
+  static constexpr uint8_t accel_config = static_cast<uint8_t>(Afs)
+                                          << MPU6050_ACCEL_FS_SEL_OFFSET;
+  static constexpr float accel_lsb = accel_scale(Afs); /*!< m/s^2 per LSB */
+  static constexpr float gyro_lsb = gyro_scale(Gfs);   /*!< rad/s per LSB */
+
+  explicit Mpu6050(bus_type &bus) : bus_(bus), handle_() {}
+
+  /**
+   * @brief   Device initialization, wake up and full scale configuration
+   * @retval  mpu6050_status_t, the status of the first C call that failed
+   */
+  mpu6050_status_t init() {
+    mpu6050_status_t status = mpu6050_init(&handle_, &bus_, address);
+    if (status != MPU6050_OK)
+      return status;
+    status = mpu6050_reset_pwrmgmt(&handle_);
+    if (status != MPU6050_OK)
+      return status;
+    status = mpu6050_gyro_set_fullscale(&handle_, static_cast<mpu6050_gyroconfig_fs_t>(Gfs));
+    if (status != MPU6050_OK)
+      return status;
+    return mpu6050_accel_set_fullscale(&handle_, static_cast<mpu6050_accelconfig_fs_t>(Afs));
+  }
+
+  /**
+   * @brief   Convert a raw sample with the compile-time scale factors
+   * @param   raw: Raw sample
+   * @retval  Sample in SI units
+   */
+  static constexpr Sample convert(const mpu6050_sample_t &raw) {
+    return Sample{
+        {{{static_cast<int16_t>(raw.accel[0]) * accel_lsb},
+          {static_cast<int16_t>(raw.accel[1]) * accel_lsb},
+          {static_cast<int16_t>(raw.accel[2]) * accel_lsb}}},
+        {static_cast<int16_t>(raw.temp) * kTempScale + kTempOffset},
+        {{{static_cast<int16_t>(raw.gyro[0]) * gyro_lsb},
+          {static_cast<int16_t>(raw.gyro[1]) * gyro_lsb},
+          {static_cast<int16_t>(raw.gyro[2]) * gyro_lsb}}},
+    };
+  }
+
+  /**
+   * @brief   Blocking burst read of all measurements
+   * @param   sample: Sample where measurements will be stored
+   * @retval  mpu6050_status_t
+   */
+  mpu6050_status_t read(Sample &sample) {
+    mpu6050_sample_t raw;
+    mpu6050_status_t status = mpu6050_read_all_raw(&handle_, &raw);
+    if (status == MPU6050_OK)
+      sample = convert(raw);
+    return status;
+  }
+
+  /**
+   * @brief   Non-blocking burst read of all measurements
+   * @retval  mpu6050_status_t
+   */
+  mpu6050_status_t fetch() { return mpu6050_fetch_all(&handle_); }
+
+  /**
+   * @brief   Check for a completed non-blocking read
+   * @retval  bool
+   */
+  bool is_data_ready() { return mpu6050_is_data_ready(&handle_); }
+
+  /**
+   * @brief   Measurements of the last non-blocking read
+   * @param   sample: Sample where measurements will be stored
+   * @retval  mpu6050_status_t
+   */
+  mpu6050_status_t read_from_buffer(Sample &sample) {
+    mpu6050_sample_t raw;
+    mpu6050_status_t status = mpu6050_read_all_from_buffer(&handle_, &raw);
+    if (status == MPU6050_OK)
+      sample = convert(raw);
+    return status;
+  }
+
+  /**
+   * @brief   C handle, for the rest of the C API
+   * @retval  Pointer to MPU6050 handle
+   */
+  mpu6050_t *handle() { return &handle_; }
+
+private:
+  bus_type &bus_;
+  mpu6050_t handle_;
+};
+
+} // namespace mpu6050
+
+#endif /* __MPU6050_HPP */
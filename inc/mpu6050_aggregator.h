@@ -0,0 +1,117 @@
+/**
+ ******************************************************************************
+ * @file           : mpu6050_aggregator.h
+ * @author         : Gonzalo Gabriel Fernandez
+ * @brief          : MPU6050 multi-bus aggregator headers
+ ******************************************************************************
+ * @attention
+ *
+ * Time-ordered merge of the sample rings of several devices. Every device
+ * has its own single-producer/single-consumer ring, the merger is the
+ * consumer of all of them and emits the oldest head sample. A sample is
+ * emitted once every ring holds a sample, or once it is older than the
+ * latency bound, so a stalled bus delays the stream by at most the bound.
+ * On Linux the aggregator runs one reader thread per bus, pinned to a core,
+ * as the producer of the rings of the devices on that bus.
+ *
+ ******************************************************************************
+ */
+
+#ifndef __MPU6050_AGGREGATOR_H
+#define __MPU6050_AGGREGATOR_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#if defined(__linux__)
+#include <pthread.h>
+#endif
+
+#include "mpu6050.h"
+
+#ifndef MPU6050_MERGER_MAX_STREAMS
+#define MPU6050_MERGER_MAX_STREAMS 32U /*! Maximum amount of rings merged */
+#endif
+
+#ifndef MPU6050_AGGREGATOR_MAX_BUSES
+#define MPU6050_AGGREGATOR_MAX_BUSES 16U /*! Maximum amount of buses, one reader thread each */
+#endif
+
+#define MPU6050_AGGREGATOR_BUS_DEVICES 2U /*! Devices per bus, AD0 low and high */
+
+/**
+ * @brief MPU6050 merged sample
+ */
+typedef struct {
+  mpu6050_sample_t sample; /*!< Decoded sample */
+  uint64_t timestamp_ns;   /*!< Time of the sample */
+  uint8_t stream;          /*!< Ring of the sample, in order of addition */
+
+} mpu6050_merged_t;
+
+/**
+ * @brief MPU6050 merger structure definition
+ * @note  Timestamps of all the rings must share a timebase and be increasing within a ring.
+ */
+typedef struct {
+  mpu6050_ring_t *prings[MPU6050_MERGER_MAX_STREAMS]; /*!< Rings merged */
+  uint8_t count;                                      /*!< Amount of rings */
+  uint64_t latency_ns;                                /*!< Latency bound of a sample */
+  uint64_t last_ns;                                   /*!< Timestamp of the last sample emitted */
+  uint32_t merged;                                    /*!< Samples emitted */
+  uint32_t late;                                      /*!< Samples older than the last emitted */
+
+} mpu6050_merger_t;
+
+void mpu6050_merger_init(mpu6050_merger_t *pmerger, uint64_t latency_ns);
+mpu6050_status_t mpu6050_merger_add(mpu6050_merger_t *pmerger, mpu6050_ring_t *pring);
+bool mpu6050_merger_next(mpu6050_merger_t *pmerger, uint64_t now_ns, mpu6050_merged_t *pout);
+
+#if defined(__linux__)
+/**
+ * @brief MPU6050 aggregator bus, reader thread and its devices
+ */
+typedef struct {
+  void *bus;                                              /*!< Port bus handle */
+  mpu6050_t *pdevices[MPU6050_AGGREGATOR_BUS_DEVICES];    /*!< Devices on the bus */
+  mpu6050_ring_t *prings[MPU6050_AGGREGATOR_BUS_DEVICES]; /*!< Ring of every device */
+  uint8_t count;                                          /*!< Amount of devices */
+  int cpu;                                                /*!< Core of the thread, -1 for any */
+  uint64_t period_ns;                                     /*!< Read period, 0 for back to back */
+  pthread_t thread;                                       /*!< Reader thread */
+  volatile bool running;                                  /*!< Reader thread keeps reading */
+  volatile uint32_t reads;                                /*!< Samples read */
+  volatile uint32_t errors;                               /*!< Reads failed */
+
+} mpu6050_aggregator_bus_t;
+
+/**
+ * @brief MPU6050 aggregator structure definition
+ */
+typedef struct {
+  mpu6050_aggregator_bus_t buses[MPU6050_AGGREGATOR_MAX_BUSES]; /*!< Buses */
+  uint8_t bus_count;                                            /*!< Amount of buses */
+  uint64_t period_ns;                                           /*!< Read period of the buses */
+  bool running;                                                 /*!< Reader threads started */
+  mpu6050_merger_t merger;                                      /*!< Merger of the device rings */
+
+} mpu6050_aggregator_t;
+
+void mpu6050_aggregator_init(mpu6050_aggregator_t *pagg, uint64_t period_ns, uint64_t latency_ns);
+mpu6050_status_t mpu6050_aggregator_add(mpu6050_aggregator_t *pagg, mpu6050_t *hmpu,
+                                        mpu6050_ring_t *pring, int cpu);
+mpu6050_status_t mpu6050_aggregator_start(mpu6050_aggregator_t *pagg);
+void mpu6050_aggregator_stop(mpu6050_aggregator_t *pagg);
+bool mpu6050_aggregator_next(mpu6050_aggregator_t *pagg, mpu6050_merged_t *pout);
+uint64_t mpu6050_aggregator_now_ns(void);
+#endif
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* __MPU6050_AGGREGATOR_H */
@@ -0,0 +1,69 @@
+/**
+ ******************************************************************************
+ * @file           : mpu6050_calib.h
+ * @author         : Gonzalo Gabriel Fernandez
+ * @brief          : MPU6050 calibration headers
+ ******************************************************************************
+ * @attention
+ *
+ * Bias calibration at rest into the on-chip offset registers, so every later
+ * measurement has the bias removed by the device. Samples are accumulated in
+ * constant memory, the resulting offsets can be saved and restored at boot.
+ *
+ ******************************************************************************
+ */
+
+#ifndef __MPU6050_CALIB_H
+#define __MPU6050_CALIB_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stdint.h>
+
+#include "mpu6050.h"
+
+#define MPU6050_CALIB_MAGIC 0x4D504331UL /*! Calibration blob marker, "MPC1" */
+
+/**
+ * @brief MPU6050 calibration channels, accel X, Y, Z then gyro X, Y, Z
+ */
+#define MPU6050_CALIB_CHANNELS 6U
+
+/**
+ * @brief MPU6050 streaming mean and variance accumulator (Welford)
+ */
+typedef struct {
+  uint32_t count;                     /*!< Amount of accumulated samples */
+  float mean[MPU6050_CALIB_CHANNELS]; /*!< Mean in raw counts */
+  float m2[MPU6050_CALIB_CHANNELS];   /*!< Sum of squared differences from the mean */
+
+} mpu6050_calib_acc_t;
+
+/**
+ * @brief MPU6050 calibration blob, offset registers content
+ */
+typedef struct {
+  uint32_t magic;          /*!< MPU6050_CALIB_MAGIC */
+  int16_t accel_offset[3]; /*!< Accel offsets, +-16g full scale counts */
+  int16_t gyro_offset[3];  /*!< Gyro offsets, +-1000 dps full scale counts */
+  uint16_t checksum;       /*!< Fletcher-16 of the offsets */
+
+} mpu6050_calib_t;
+
+void mpu6050_calib_acc_init(mpu6050_calib_acc_t *pacc);
+void mpu6050_calib_acc_add(mpu6050_calib_acc_t *pacc, const mpu6050_sample_t *psample);
+void mpu6050_calib_acc_variance(const mpu6050_calib_acc_t *pacc, float *pvariance);
+mpu6050_status_t mpu6050_calib_apply(mpu6050_t *hmpu, const mpu6050_calib_acc_t *pacc,
+                                     mpu6050_calib_t *pcalib);
+mpu6050_status_t mpu6050_calib_run(mpu6050_t *hmpu, uint32_t count, mpu6050_calib_acc_t *pacc,
+                                   mpu6050_calib_t *pcalib);
+mpu6050_status_t mpu6050_calib_save(mpu6050_t *hmpu, mpu6050_calib_t *pcalib);
+mpu6050_status_t mpu6050_calib_restore(mpu6050_t *hmpu, const mpu6050_calib_t *pcalib);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* __MPU6050_CALIB_H */
@@ -0,0 +1,136 @@
+/**
+ ******************************************************************************
+ * @file           : mpu6050_capture.h
+ * @author         : Gonzalo Gabriel Fernandez
+ * @brief          : MPU6050 binary capture headers
+ ******************************************************************************
+ * @attention
+ *
+ * Compact capture of raw samples for offline analysis. A capture is a header
+ * block with the device configuration followed by fixed-size data blocks,
+ * sized for SD card sectors or flash pages. Each data block stands alone: it
+ * holds its start time and the samples as zigzag varint deltas of the
+ * previous sample, timestamps as delta of the previous interval. The reader
+ * decodes straight from memory, a file mapping on Linux or memory-mapped
+ * flash on the MCU, and seeks by time over the block start times.
+ *
+ ******************************************************************************
+ */
+
+#ifndef __MPU6050_CAPTURE_H
+#define __MPU6050_CAPTURE_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#include "mpu6050.h"
+
+#define MPU6050_CAPTURE_MAGIC 0x4350504DUL       /*! Header block marker, "MPPC" */
+#define MPU6050_CAPTURE_BLOCK_MAGIC 0x4250504DUL /*! Data block marker, "MPPB" */
+#define MPU6050_CAPTURE_VERSION 1U               /*! Format version */
+
+#define MPU6050_CAPTURE_CHANNELS 7U           /*! Accel X, Y, Z, temperature, gyro X, Y, Z */
+#define MPU6050_CAPTURE_HEADER_SIZE 24U       /*! Bytes of the header block content */
+#define MPU6050_CAPTURE_BLOCK_HEADER_SIZE 24U /*! Bytes of a data block header */
+#define MPU6050_CAPTURE_SAMPLE_MAX 31U        /*! Worst case bytes of an encoded sample */
+
+#ifndef MPU6050_CAPTURE_BLOCK_SIZE
+#define MPU6050_CAPTURE_BLOCK_SIZE 512U /*! Default block size, one SD card sector */
+#endif
+
+/**
+ * @brief MPU6050 capture configuration, stored in the header block
+ */
+typedef struct {
+  uint8_t gyro_fs;           /*!< mpu6050_gyroconfig_fs_t */
+  uint8_t accel_fs;          /*!< mpu6050_accelconfig_fs_t */
+  uint8_t dlpf;              /*!< mpu6050_dlpf_t */
+  uint8_t sample_divider;    /*!< SMPLRT_DIV */
+  uint32_t sample_period_ns; /*!< Nominal sample period */
+  uint32_t source;           /*!< Application tag of the captured device */
+
+} mpu6050_capture_config_t;
+
+/**
+ * @brief Block sink, writes one block to the storage
+ * @note Called with block_size bytes, the header block first.
+ */
+typedef mpu6050_status_t (*mpu6050_capture_sink_t)(void *pcontext, const uint8_t *pblock,
+                                                   uint16_t size);
+
+/**
+ * @brief MPU6050 capture writer
+ */
+typedef struct {
+  uint8_t *pblock;                        /*!< Block buffer of block_size bytes */
+  uint16_t block_size;                    /*!< Bytes of every block */
+  uint16_t used;                          /*!< Bytes of the block in progress */
+  uint16_t count;                         /*!< Samples of the block in progress */
+  uint32_t seq;                           /*!< Sequence number of the block in progress */
+  int16_t prev[MPU6050_CAPTURE_CHANNELS]; /*!< Previous sample of the block */
+  uint64_t prev_ns;                       /*!< Timestamp of the previous sample */
+  int64_t prev_delta_ns;                  /*!< Previous sample interval */
+  mpu6050_capture_sink_t sink;            /*!< Block sink */
+  void *pcontext;                         /*!< Context given to the sink */
+  uint32_t samples;                       /*!< Samples written */
+  uint32_t blocks_lost;                   /*!< Blocks the sink failed to write */
+
+} mpu6050_capture_t;
+
+/**
+ * @brief MPU6050 capture decoding position
+ */
+typedef struct {
+  uint32_t block;                          /*!< Data block, from 0 */
+  const uint8_t *pnext;                    /*!< Next encoded sample */
+  uint16_t remaining;                      /*!< Samples left in the block */
+  int16_t value[MPU6050_CAPTURE_CHANNELS]; /*!< Last decoded sample */
+  uint64_t timestamp_ns;                   /*!< Last decoded timestamp */
+  int64_t delta_ns;                        /*!< Last decoded interval */
+
+} mpu6050_capture_cursor_t;
+
+/**
+ * @brief MPU6050 capture reader, over a capture in memory
+ */
+typedef struct {
+  const uint8_t *pdata;            /*!< Capture, header block first */
+  size_t size;                     /*!< Bytes of the capture */
+  mpu6050_capture_config_t config; /*!< Configuration of the header block */
+  uint16_t block_size;             /*!< Bytes of every block */
+  uint32_t blocks;                 /*!< Complete data blocks */
+  uint32_t blocks_bad;             /*!< Data blocks skipped, bad marker or checksum */
+  mpu6050_capture_cursor_t cursor; /*!< Decoding position */
+
+} mpu6050_capture_reader_t;
+
+mpu6050_status_t mpu6050_capture_config_read(mpu6050_t *hmpu, mpu6050_capture_config_t *pconfig);
+mpu6050_status_t mpu6050_capture_init(mpu6050_capture_t *pcap, uint8_t *pblock, uint16_t block_size,
+                                      mpu6050_capture_sink_t sink, void *pcontext);
+mpu6050_status_t mpu6050_capture_start(mpu6050_capture_t *pcap,
+                                       const mpu6050_capture_config_t *pconfig);
+mpu6050_status_t mpu6050_capture_add(mpu6050_capture_t *pcap, const mpu6050_sample_t *psample,
+                                     uint64_t timestamp_ns);
+mpu6050_status_t mpu6050_capture_flush(mpu6050_capture_t *pcap);
+mpu6050_status_t mpu6050_capture_open(mpu6050_capture_reader_t *preader, const void *pdata,
+                                      size_t size);
+bool mpu6050_capture_next(mpu6050_capture_reader_t *preader, mpu6050_sample_t *psample,
+                          uint64_t *ptimestamp_ns);
+mpu6050_status_t mpu6050_capture_seek(mpu6050_capture_reader_t *preader, uint64_t time_ns);
+void mpu6050_capture_rewind(mpu6050_capture_reader_t *preader);
+
+#if defined(__linux__)
+mpu6050_status_t mpu6050_capture_map(mpu6050_capture_reader_t *preader, const char *path);
+void mpu6050_capture_unmap(mpu6050_capture_reader_t *preader);
+#endif
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* __MPU6050_CAPTURE_H */
@@ -0,0 +1,80 @@
+/**
+ ******************************************************************************
+ * @file           : mpu6050_convert.h
+ * @author         : Gonzalo Gabriel Fernandez
+ * @brief          : MPU6050 raw to SI conversion headers
+ ******************************************************************************
+ * @attention
+ *
+ * Batch conversion of raw measurements into signed counts, SI units or Q16.16
+ * fixed-point. Frames are the output registers as read from the device, 14
+ * big-endian bytes from ACCEL_XOUT_H, as in ring slots or FIFO frames of all
+ * measurements. Samples are mpu6050_sample_t already decoded by the driver.
+ *
+ ******************************************************************************
+ */
+
+#ifndef __MPU6050_CONVERT_H
+#define __MPU6050_CONVERT_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stdint.h>
+
+#include "mpu6050.h"
+
+#define MPU6050_CONVERT_CHANNELS 7U /*! Accel X, Y, Z, Temperature, Gyro X, Y, Z */
+
+/**
+ * @brief MPU6050 conversion scale factors for the current full scale settings
+ */
+typedef struct {
+  float scale[MPU6050_CONVERT_CHANNELS];        /*!< SI units per LSB */
+  float offset[MPU6050_CONVERT_CHANNELS];       /*!< SI units offset */
+  int32_t scale_q32[MPU6050_CONVERT_CHANNELS];  /*!< Units per LSB, scaled by 2^32 */
+  int32_t offset_q16[MPU6050_CONVERT_CHANNELS]; /*!< Units offset, Q16.16 */
+
+} mpu6050_convert_scale_t;
+
+/**
+ * @brief MPU6050 sample in SI units
+ */
+typedef struct {
+  float accel[3]; /*!< Acceleration in m/s^2 */
+  float temp;     /*!< Temperature in degrees Celsius */
+  float gyro[3];  /*!< Angular rate in rad/s */
+
+} mpu6050_si_sample_t;
+
+/**
+ * @brief MPU6050 sample in Q16.16 fixed-point
+ */
+typedef struct {
+  int32_t accel[3]; /*!< Acceleration in m/s^2, Q16.16 */
+  int32_t temp;     /*!< Temperature in degrees Celsius, Q16.16 */
+  int32_t gyro[3];  /*!< Angular rate in rad/s, Q16.16 */
+
+} mpu6050_q16_sample_t;
+
+void mpu6050_convert_scale(mpu6050_gyroconfig_fs_t gyro_fullscale,
+                           mpu6050_accelconfig_fs_t accel_fullscale,
+                           mpu6050_convert_scale_t *pscale);
+mpu6050_status_t mpu6050_convert_scale_read(mpu6050_t *hmpu, mpu6050_convert_scale_t *pscale);
+void mpu6050_convert_frames_int16(const uint8_t *pframes, uint32_t count, int16_t *pout);
+void mpu6050_convert_frames_si(const uint8_t *pframes, uint32_t count,
+                               const mpu6050_convert_scale_t *pscale, mpu6050_si_sample_t *pout);
+void mpu6050_convert_frames_q16(const uint8_t *pframes, uint32_t count,
+                                const mpu6050_convert_scale_t *pscale, mpu6050_q16_sample_t *pout);
+void mpu6050_convert_samples_si(const mpu6050_sample_t *psamples, uint32_t count,
+                                const mpu6050_convert_scale_t *pscale, mpu6050_si_sample_t *pout);
+void mpu6050_convert_samples_q16(const mpu6050_sample_t *psamples, uint32_t count,
+                                 const mpu6050_convert_scale_t *pscale,
+                                 mpu6050_q16_sample_t *pout);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* __MPU6050_CONVERT_H */
@@ -0,0 +1,85 @@
+/**
+ ******************************************************************************
+ * @file           : mpu6050_decim.h
+ * @author         : Gonzalo Gabriel Fernandez
+ * @brief          : MPU6050 anti-alias decimation headers
+ ******************************************************************************
+ * @attention
+ *
+ * Streaming FIR decimation of raw samples, e.g. gyro at 8 kHz down to 1 kHz
+ * for a control loop, without folding the content above the output Nyquist
+ * frequency into its band. Polyphase: the filter only runs at the output
+ * instants, taps / ratio multiply-adds per input sample and channel.
+ *
+ * Fixed-point throughout: raw counts in, Q15 coefficients, 32-bit
+ * accumulation and rounded saturated raw counts out, the format of the
+ * CMSIS-DSP arm_fir_decimate_fast_q15, so the same coefficients serve both.
+ * Results are bit-exact on every path: SSE2/AVX2/NEON on host, SMLAD on
+ * Cortex-M4/M7, scalar elsewhere.
+ *
+ ******************************************************************************
+ */
+
+#ifndef __MPU6050_DECIM_H
+#define __MPU6050_DECIM_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stdint.h>
+
+#include "mpu6050.h"
+
+#define MPU6050_DECIM_CHANNELS 7U /*! Accel X, Y, Z, Temperature, Gyro X, Y, Z */
+#define MPU6050_DECIM_BLOCK 16U   /*! Taps are padded to a multiple of the vector block */
+
+#ifndef MPU6050_DECIM_MAX_TAPS
+#define MPU6050_DECIM_MAX_TAPS 128U /*! Maximum filter length, a multiple of the vector block */
+#endif
+
+#define MPU6050_DECIM_HISTORY (2U * MPU6050_DECIM_MAX_TAPS) /*! Delay line length */
+
+#if (MPU6050_DECIM_MAX_TAPS % MPU6050_DECIM_BLOCK) != 0
+#error "MPU6050_DECIM_MAX_TAPS must be a multiple of MPU6050_DECIM_BLOCK"
+#endif
+
+/**
+ * @brief MPU6050 decimated channel selection, in sample order
+ */
+typedef enum {
+  MPU6050_DECIM_SEL_ACCEL = 0x07U, /*!< Accel X, Y, Z */
+  MPU6050_DECIM_SEL_TEMP = 0x08U,  /*!< Temperature */
+  MPU6050_DECIM_SEL_GYRO = 0x70U,  /*!< Gyro X, Y, Z */
+  MPU6050_DECIM_SEL_ALL = 0x7FU,   /*!< All measurements */
+
+} mpu6050_decim_sel_t;
+
+/**
+ * @brief MPU6050 decimator structure definition
+ * @note  Every delay line holds its samples twice, so the filter window is contiguous whatever
+ * the position.
+ */
+typedef struct {
+  int16_t coeffs[MPU6050_DECIM_MAX_TAPS];                         /*!< Q15, oldest sample first */
+  int16_t history[MPU6050_DECIM_CHANNELS][MPU6050_DECIM_HISTORY]; /*!< Delay lines */
+  uint16_t taps;                                                  /*!< Filter length, padded */
+  uint16_t pos;                                                   /*!< Oldest delay line sample */
+  uint8_t ratio;                                                  /*!< Input samples per output */
+  uint8_t phase;                                                  /*!< Inputs since last output */
+  uint8_t sel;                                                    /*!< Channels filtered */
+
+} mpu6050_decim_t;
+
+void mpu6050_decim_design(int16_t *pcoeffs, uint16_t taps, uint8_t ratio);
+mpu6050_status_t mpu6050_decim_init(mpu6050_decim_t *pdecim, uint8_t ratio,
+                                    const int16_t *pcoeffs, uint16_t taps, uint8_t sel);
+void mpu6050_decim_reset(mpu6050_decim_t *pdecim);
+uint32_t mpu6050_decim_process(mpu6050_decim_t *pdecim, const mpu6050_sample_t *psamples,
+                               uint32_t count, mpu6050_sample_t *pout);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* __MPU6050_DECIM_H */
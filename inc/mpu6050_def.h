@@ -18,14 +18,25 @@
 extern "C" {
 #endif
 
+#include <stdbool.h>
 #include <stdint.h>
 
+#include "mpu6050_registers.h"
+
 /**
  * @brief MPU6050 Status structure definition
+ * @note  Ports report the detailed error codes when the bus tells them apart, MPU6050_ERROR
+ * otherwise. Any status other than MPU6050_OK is a failure.
  */
 typedef enum {
-  MPU6050_OK = 0x00U,
-  MPU6050_ERROR = 0x01U
+  MPU6050_OK = 0x00U,            /*!< Success */
+  MPU6050_ERROR = 0x01U,         /*!< Generic error */
+  MPU6050_ERROR_NACK = 0x02U,    /*!< Address or data not acknowledged */
+  MPU6050_ERROR_TIMEOUT = 0x03U, /*!< Transaction timed out */
+  MPU6050_ERROR_BUS = 0x04U,     /*!< Bus error or arbitration lost */
+  MPU6050_ERROR_OVERRUN = 0x05U, /*!< Peripheral or DMA overrun */
+  MPU6050_ERROR_BUSY = 0x06U,    /*!< Bus or transaction queue busy */
+  MPU6050_STATUS_CODES = 0x07U,  /*!< Amount of status codes */
 
 } mpu6050_status_t;
 
@@ -40,15 +51,211 @@ typedef enum {
 
 } mpu6050_i2c_address_t;
 
+/**
+ * @brief MPU6050 combined measurements sample
+ * @note  Fields follow the register map order from ACCEL_XOUT_H (0x3B) to GYRO_ZOUT_L (0x48), so
+ * a single burst read of the output registers decodes into this structure in one pass.
+ */
+typedef struct {
+  uint16_t accel[3]; /*!< Raw Accel X, Y, Z measurements */
+  uint16_t temp;     /*!< Raw Temperature measurement */
+  uint16_t gyro[3];  /*!< Raw Gyro X, Y, Z measurements */
+
+} mpu6050_sample_t;
+
+/**
+ * @brief MPU6050 shadow of the writable configuration registers
+ * @note  Write-through: populated from the device at init, updated on every successful write.
+ */
+typedef struct {
+  uint8_t smplrt_div;   /*!< SMPLRT_DIV */
+  uint8_t config;       /*!< CONFIG */
+  uint8_t gyro_config;  /*!< GYRO_CONFIG */
+  uint8_t accel_config; /*!< ACCEL_CONFIG */
+  uint8_t fifo_en;      /*!< FIFO_EN */
+  uint8_t int_pin_cfg;  /*!< INT_PIN_CFG */
+  uint8_t int_enable;   /*!< INT_ENABLE */
+  uint8_t user_ctrl;    /*!< USER_CTRL, auto clear bits excluded */
+  uint8_t pwr_mgmt_1;   /*!< PWR_MGMT_1 */
+  uint8_t pwr_mgmt_2;   /*!< PWR_MGMT_2 */
+  bool valid;           /*!< Shadow matches the device */
+
+} mpu6050_shadow_t;
+
+/**
+ * @brief MPU6050 sample interval statistics
+ * @note  Running means are exponentially weighted, 1 / 2^MPU6050_TIMING_EWMA_SHIFT per sample.
+ */
+typedef struct {
+  uint32_t samples;   /*!< Timestamped samples */
+  uint64_t last_ns;   /*!< Timestamp of the last sample */
+  uint32_t mean_ns;   /*!< Running mean interval */
+  uint32_t jitter_ns; /*!< Running mean absolute deviation of the interval */
+  uint32_t min_ns;    /*!< Shortest interval */
+  uint32_t max_ns;    /*!< Longest interval */
+
+} mpu6050_timing_t;
+
+/**
+ * @brief MPU6050 fault recovery statistics
+ */
+typedef struct {
+  uint32_t retries;    /*!< Register accesses retried */
+  uint32_t recoveries; /*!< Bus recoveries run by the driver */
+  uint32_t restores;   /*!< Configurations restored from the shadow after a device reset */
+  uint32_t failures;   /*!< Register accesses failed with the retries spent */
+  uint64_t time_ns;    /*!< Time spent in retries and recoveries */
+  uint32_t max_ns;     /*!< Longest retry sequence or recovery */
+
+} mpu6050_recovery_t;
+
+/**
+ * @brief MPU6050 FIFO frame clock
+ * @note  Frame times are back-computed from the drain time with the period estimated over all
+ *        the frames produced since the anchor drain, which tracks the device clock drift.
+ */
+typedef struct {
+  uint32_t period_ns;  /*!< Estimated frame period */
+  uint32_t nominal_ns; /*!< Frame period from the configured sample rate */
+  bool anchored;       /*!< Anchor drain taken */
+  uint64_t anchor_ns;  /*!< Time of the anchor drain */
+  uint32_t anchor_seq; /*!< Frames produced at the anchor drain */
+  uint32_t drained;    /*!< Frames drained since the anchor */
+  uint64_t drain_ns;   /*!< Time of the last drain */
+  uint16_t backlog;    /*!< Frames in the FIFO at the last drain */
+
+} mpu6050_fifo_clock_t;
+
+/**
+ * @brief MPU6050 transaction kinds of the statistics
+ */
+typedef enum {
+  MPU6050_XFER_REG_READ = 0x00U,    /*!< Register reads */
+  MPU6050_XFER_BURST_READ = 0x01U,  /*!< Blocking burst reads */
+  MPU6050_XFER_REG_WRITE = 0x02U,   /*!< Register writes */
+  MPU6050_XFER_NONBLOCKING = 0x03U, /*!< Non-blocking reads */
+  MPU6050_XFER_KINDS = 0x04U,       /*!< Amount of transaction kinds */
+
+} mpu6050_xfer_kind_t;
+
+#ifndef MPU6050_STATS_BUCKETS
+#define MPU6050_STATS_BUCKETS 24U /*! Latency histogram buckets, the last one saturates */
+#endif
+
+/**
+ * @brief Latency counter, free-running ticks that wrap at 32 bits
+ */
+typedef uint32_t (*mpu6050_counter_t)(void);
+
+/**
+ * @brief MPU6050 transaction statistics
+ * @note  Latency bucket 0 counts 0 ticks, bucket n counts 2^(n-1) to 2^n - 1 ticks. Errors are
+ *        indexed by mpu6050_status_t, index MPU6050_OK is unused.
+ */
+typedef struct {
+  uint32_t transactions[MPU6050_XFER_KINDS];                   /*!< Transactions, by kind */
+  uint32_t bytes[MPU6050_XFER_KINDS];                          /*!< Bytes transferred, by kind */
+  uint32_t errors[MPU6050_STATUS_CODES];                       /*!< Failures, by status */
+  uint32_t shadow_hits;                                        /*!< Reads served by the shadow */
+  uint32_t latency_max[MPU6050_XFER_KINDS];                    /*!< Longest latency in ticks */
+  uint32_t latency[MPU6050_XFER_KINDS][MPU6050_STATS_BUCKETS]; /*!< Latency log2 histogram */
+
+} mpu6050_stats_t;
+
+/**
+ * @brief Non-blocking read buffer length, measurements followed by external sensor data
+ */
+#define MPU6050_RXBUFFER_LEN (MPU6050_SENSOR_DATA_LEN + MPU6050_EXT_SENS_DATA_LEN)
+
+typedef struct mpu6050_ring_s mpu6050_ring_t;
+typedef struct mpu6050_ring_slot_s mpu6050_ring_slot_t;
+typedef struct mpu6050_sched_s mpu6050_sched_t;
+
 /**
  * @brief MPU6050 handle structure definition
  */
 typedef struct {
-  mpu6050_i2c_address_t address; /*!< I2C slave address  */
-  uint32_t i2c_timeout;          /*!< I2C timeout        */
+  void *bus;                                       /*!< Port I2C bus handle */
+  mpu6050_i2c_address_t address;                   /*!< I2C slave address */
+  uint32_t i2c_timeout;                            /*!< Retry budget of a register access in us */
+  uint8_t rxbuffer[MPU6050_RXBUFFER_LEN];          /*!< Non-blocking read buffer */
+  volatile bool data_ready;                        /*!< Non-blocking read completed */
+  uint8_t fifo_sel;                                /*!< Measurements loaded into FIFO */
+  uint32_t fifo_overflows;                         /*!< FIFO overflows recovered */
+  mpu6050_ring_t *pstream_ring;                    /*!< Ring of streamed samples */
+  mpu6050_ring_slot_t *pstream_slot;               /*!< Ring slot of the read in flight */
+  uint8_t stream_scratch[MPU6050_SENSOR_DATA_LEN]; /*!< Read target when ring is full */
+  volatile bool stream_active;                     /*!< Streaming re-arms the next read */
+  mpu6050_sched_t *psched;                         /*!< Bus scheduler, NULL if none */
+  mpu6050_shadow_t shadow;                         /*!< Configuration registers shadow */
+  volatile bool read_in_flight;                    /*!< Non-blocking read started, not completed */
+  volatile bool drdy_active;                       /*!< Reads started by DATA_RDY interrupt */
+  uint32_t drdy_int_line;                          /*!< Port interrupt line wired to the INT pin */
+  volatile uint32_t drdy_edges;                    /*!< DATA_RDY interrupts received */
+  volatile uint32_t drdy_missed;                   /*!< DATA_RDY interrupts without read */
+  volatile bool motion_active;                     /*!< INT pin signals motion wake-up */
+  uint32_t motion_int_line;                        /*!< Port interrupt line of motion wake-up */
+  volatile bool motion_detected;                   /*!< Motion interrupt received */
+  volatile uint32_t motion_events;                 /*!< Motion interrupts received */
+  uint8_t motion_int_enable;                       /*!< INT_ENABLE before motion wake-up */
+  bool cycle_active;                               /*!< Low power cycle mode started */
+  uint8_t cycle_pwr_mgmt[2];                       /*!< PWR_MGMT_1 and 2 before cycle mode */
+  uint8_t aux_len[MPU6050_I2C_SLAVES];             /*!< External sensor data bytes per aux slave */
+  volatile uint64_t timestamp_ns;                  /*!< Port time of the last sample */
+  mpu6050_timing_t timing;                         /*!< Sample interval statistics */
+  mpu6050_fifo_clock_t fifo_clock;                 /*!< FIFO frame clock */
+  mpu6050_recovery_t recovery;                     /*!< Fault recovery statistics */
+  bool recovering;                                 /*!< Retry or recovery running */
+#ifdef MPU6050_STATS
+  mpu6050_stats_t stats;                           /*!< Transaction statistics */
+  volatile uint32_t stats_seq;                     /*!< Stats update sequence, odd while updating */
+  mpu6050_counter_t stats_counter;                 /*!< Latency counter, NULL for port timestamp */
+  uint32_t stats_start;                            /*!< Counter at the non-blocking read start */
+  uint16_t stats_bytes;                            /*!< Bytes of the non-blocking read in flight */
+#endif
 
 } mpu6050_t;
 
+#ifndef MPU6050_TIMING_EWMA_SHIFT
+#define MPU6050_TIMING_EWMA_SHIFT 4U /*! Timing running means weight, 1 / 2^shift */
+#endif
+
+#ifndef MPU6050_FIFO_CLOCK_MIN_FRAMES
+#define MPU6050_FIFO_CLOCK_MIN_FRAMES 256U /*! Frames before the FIFO period estimate is used */
+#endif
+
+#ifndef MPU6050_FIFO_CLOCK_MAX_FRAMES
+#define MPU6050_FIFO_CLOCK_MAX_FRAMES 65536U /*! Frames after which the FIFO clock anchor slides */
+#endif
+
+#ifndef MPU6050_AUX_SLV4_PERIODS
+#define MPU6050_AUX_SLV4_PERIODS 2U /*! Sample periods before an aux transfer times out */
+#endif
+
+#ifndef MPU6050_RETRY_BUDGET_US
+#define MPU6050_RETRY_BUDGET_US 2000U /*! Default time budget of the retries of a register access */
+#endif
+
+#ifndef MPU6050_RETRIES
+#define MPU6050_RETRIES 3U /*! Attempts of a register access, first one included */
+#endif
+
+#ifndef MPU6050_SCHED_MAX_DEVICES
+#define MPU6050_SCHED_MAX_DEVICES 8U /*! Maximum amount of devices on a bus scheduler */
+#endif
+
+/**
+ * @brief MPU6050 bus scheduler structure definition
+ * @note  Chains non-blocking reads of all the devices sharing a bus from the completion callback.
+ */
+struct mpu6050_sched_s {
+  mpu6050_t *pdevices[MPU6050_SCHED_MAX_DEVICES]; /*!< Devices on the bus */
+  uint8_t count;                                  /*!< Amount of devices */
+  volatile uint8_t current;                       /*!< Device with read in flight */
+  volatile bool active;                           /*!< Scheduler chains reads */
+  volatile uint32_t rounds;                       /*!< Completed round-robin loops */
+};
+
 #ifdef __cplusplus
 }
 #endif
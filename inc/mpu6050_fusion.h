@@ -0,0 +1,91 @@
+/**
+ ******************************************************************************
+ * @file           : mpu6050_fusion.h
+ * @author         : Gonzalo Gabriel Fernandez
+ * @brief          : MPU6050 orientation fusion headers
+ ******************************************************************************
+ * @attention
+ *
+ * Attitude estimation from the driver samples with Madgwick or Mahony filters.
+ * Float on parts with FPU, fixed-point on parts without it (Cortex-M3). The
+ * arithmetic is selected at build time: MPU6050_FUSION_FIXED or
+ * MPU6050_FUSION_FLOAT, by default fixed-point on ARM targets without FPU.
+ *
+ * Fixed-point formats: quaternion, gains and sample period Q2.30, integral
+ * term, angles and acceleration Q16.16, scales as in mpu6050_convert_scale_t.
+ *
+ ******************************************************************************
+ */
+
+#ifndef __MPU6050_FUSION_H
+#define __MPU6050_FUSION_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stdint.h>
+
+#include "mpu6050.h"
+#include "mpu6050_convert.h"
+
+#if !defined(MPU6050_FUSION_FIXED) && !defined(MPU6050_FUSION_FLOAT)
+#if defined(__arm__) && !defined(__ARM_FP)
+#define MPU6050_FUSION_FIXED
+#endif
+#endif
+
+#ifdef MPU6050_FUSION_FIXED
+typedef int32_t mpu6050_fusion_real_t;
+#else
+typedef float mpu6050_fusion_real_t;
+#endif
+
+/**
+ * @brief MPU6050 fusion filter selection
+ */
+typedef enum {
+  MPU6050_FUSION_MADGWICK = 0x00U, /*!< Gradient descent, single gain beta */
+  MPU6050_FUSION_MAHONY = 0x01U,   /*!< Complementary PI controller, gains kp and ki */
+
+} mpu6050_fusion_algo_t;
+
+/**
+ * @brief MPU6050 fusion state, one per device
+ */
+typedef struct {
+  mpu6050_fusion_algo_t algo;          /*!< Filter selection */
+  mpu6050_fusion_real_t q[4];          /*!< Attitude quaternion w, x, y, z */
+  mpu6050_fusion_real_t gain;          /*!< Madgwick beta or Mahony kp */
+  mpu6050_fusion_real_t integral_gain; /*!< Mahony ki, unused by Madgwick */
+  mpu6050_fusion_real_t integral[3];   /*!< Mahony integral term in rad/s */
+  mpu6050_fusion_real_t dt;            /*!< Sample period in s */
+  mpu6050_fusion_real_t gyro_scale;    /*!< Gyro rad/s per LSB */
+  mpu6050_fusion_real_t accel_scale;   /*!< Accel m/s^2 per LSB */
+  int16_t accel[3];                    /*!< Last accel sample, for linear acceleration */
+
+} mpu6050_fusion_t;
+
+/**
+ * @brief MPU6050 fusion output
+ */
+typedef struct {
+  mpu6050_fusion_real_t q[4];      /*!< Attitude quaternion w, x, y, z */
+  mpu6050_fusion_real_t euler[3];  /*!< Roll, pitch and yaw in rad */
+  mpu6050_fusion_real_t linear[3]; /*!< Gravity-free acceleration in m/s^2, sensor frame */
+
+} mpu6050_fusion_output_t;
+
+void mpu6050_fusion_init(mpu6050_fusion_t *pfusion, mpu6050_fusion_algo_t algo,
+                         const mpu6050_convert_scale_t *pscale, uint32_t sample_rate_hz);
+void mpu6050_fusion_set_gains(mpu6050_fusion_t *pfusion, float gain, float integral_gain);
+void mpu6050_fusion_update(mpu6050_fusion_t *pfusion, const mpu6050_sample_t *psample);
+void mpu6050_fusion_update_batch(mpu6050_fusion_t *pfusion, const mpu6050_sample_t *psamples,
+                                 uint32_t count);
+void mpu6050_fusion_output(const mpu6050_fusion_t *pfusion, mpu6050_fusion_output_t *pout);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* __MPU6050_FUSION_H */
@@ -0,0 +1,68 @@
+/**
+ ******************************************************************************
+ * @file           : mpu6050_plan.h
+ * @author         : Gonzalo Gabriel Fernandez
+ * @brief          : MPU6050 bus budget planner headers
+ ******************************************************************************
+ * @attention
+ *
+ * Bus occupancy of an acquisition configuration, computed from the I2C frame
+ * cost of the transactions issued by the driver for each read mode.
+ *
+ ******************************************************************************
+ */
+
+#ifndef __MPU6050_PLAN_H
+#define __MPU6050_PLAN_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stdint.h>
+
+#include "mpu6050.h"
+
+/**
+ * @brief MPU6050 read mode
+ */
+typedef enum {
+  MPU6050_PLAN_PER_SENSOR = 0x00U, /*!< Accel, temperature and gyro reads, three transactions */
+  MPU6050_PLAN_BURST = 0x01U,      /*!< Combined burst read of all measurements */
+  MPU6050_PLAN_FIFO = 0x02U,       /*!< FIFO drains of a batch of frames */
+
+} mpu6050_plan_mode_t;
+
+/**
+ * @brief MPU6050 acquisition configuration to plan
+ */
+typedef struct {
+  uint32_t bus_hz;          /*!< I2C SCL frequency */
+  mpu6050_plan_mode_t mode; /*!< Read mode */
+  uint8_t devices;          /*!< Amount of devices sharing the bus */
+  float odr_hz;             /*!< Output data rate of each device */
+  uint8_t fifo_sel;         /*!< FIFO sensor selection, mpu6050_fifo_sel_t mask */
+  uint16_t fifo_batch;      /*!< Frames per FIFO drain */
+  float max_occupancy;      /*!< Bus occupancy limit, fraction of time, 0 for 0.8 */
+
+} mpu6050_plan_config_t;
+
+/**
+ * @brief MPU6050 acquisition plan
+ */
+typedef struct {
+  uint32_t bits_per_sample; /*!< SCL cycles per sample and device */
+  float bus_us_per_sample;  /*!< Bus time per sample and device */
+  float transactions_per_s; /*!< Transactions per second, all devices */
+  float occupancy;          /*!< Bus occupancy, fraction of time */
+  float max_odr_hz;         /*!< Highest output data rate within the occupancy limit */
+
+} mpu6050_plan_t;
+
+mpu6050_status_t mpu6050_plan(const mpu6050_plan_config_t *pconfig, mpu6050_plan_t *pplan);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* __MPU6050_PLAN_H */
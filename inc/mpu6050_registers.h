@@ -19,16 +19,61 @@
 extern "C" {
 #endif
 
+/**
+ * @brief Accelerometer Offsets, factory trimmed, bit 0 of the low byte is reserved
+ */
+#define MPU6050_XA_OFFS_H 0x06U
+#define MPU6050_XA_OFFS_L 0x07U
+#define MPU6050_YA_OFFS_H 0x08U
+#define MPU6050_YA_OFFS_L 0x09U
+#define MPU6050_ZA_OFFS_H 0x0AU
+#define MPU6050_ZA_OFFS_L 0x0BU
+
 #define MPU6050_SELF_TEST_X 0x0DU
 #define MPU6050_SELF_TEST_Y 0x0EU
 #define MPU6050_SELF_TEST_Z 0x0FU
 #define MPU6050_SELF_TEST_A 0x10U
 
+/**
+ * @brief Gyroscope User Offsets
+ */
+#define MPU6050_XG_OFFS_USRH 0x13U
+#define MPU6050_XG_OFFS_USRL 0x14U
+#define MPU6050_YG_OFFS_USRH 0x15U
+#define MPU6050_YG_OFFS_USRL 0x16U
+#define MPU6050_ZG_OFFS_USRH 0x17U
+#define MPU6050_ZG_OFFS_USRL 0x18U
+
+#define MPU6050_SMPLRT_DIV 0x19U /*!< Sample Rate Divider */
 #define MPU6050_CONFIG 0x1AU
 #define MPU6050_GYRO_CONFIG 0x1BU
 #define MPU6050_ACCEL_CONFIG 0x1CU
+#define MPU6050_MOT_THR 0x1FU /*!< Motion Detection Threshold */
+#define MPU6050_MOT_DUR 0x20U /*!< Motion Detection Duration */
+
+#define MPU6050_FIFO_EN 0x23U /*!< FIFO Enable */
+
+/**
+ * @brief Auxiliary I2C master control and slaves 0 to 3, slave n registers at 3 * n offset
+ */
+#define MPU6050_I2C_MST_CTRL 0x24U
+#define MPU6050_I2C_SLV0_ADDR 0x25U
+#define MPU6050_I2C_SLV0_REG 0x26U
+#define MPU6050_I2C_SLV0_CTRL 0x27U
+
+/**
+ * @brief Auxiliary I2C slave 4, single transfers
+ */
+#define MPU6050_I2C_SLV4_ADDR 0x31U
+#define MPU6050_I2C_SLV4_REG 0x32U
+#define MPU6050_I2C_SLV4_DO 0x33U
+#define MPU6050_I2C_SLV4_CTRL 0x34U
+#define MPU6050_I2C_SLV4_DI 0x35U
+#define MPU6050_I2C_MST_STATUS 0x36U
 
 #define MPU6050_INT_PIN_CFG 0x37U /*!< INT Pin/Bypass Enable Configuration */
+#define MPU6050_INT_ENABLE 0x38U  /*!< Interrupt Enable */
+#define MPU6050_INT_STATUS 0x3AU  /*!< Interrupt Status */
 
 /**
  * @brief Accelerometer Measurements
@@ -56,11 +101,32 @@ extern "C" {
 #define MPU6050_GYRO_ZOUT_H 0x47U
 #define MPU6050_GYRO_ZOUT_L 0x48U
 
+/**
+ * @brief Amount of output registers from ACCEL_XOUT_H to GYRO_ZOUT_L
+ */
+#define MPU6050_SENSOR_DATA_LEN 14U
+
+/**
+ * @brief External sensor data read by the auxiliary I2C master, right after GYRO_ZOUT_L
+ */
+#define MPU6050_EXT_SENS_DATA_00 0x49U
+#define MPU6050_EXT_SENS_DATA_LEN 24U
+
+#define MPU6050_I2C_SLV0_DO 0x63U        /*!< Slave 0 data out, slave n at n offset */
+#define MPU6050_I2C_MST_DELAY_CTRL 0x67U /*!< Auxiliary I2C master delay control */
+
 #define MPU6050_USER_CTRL 0x6AU /*!< MPU6050 User Control */
 
 #define MPU6050_PWR_MGMT_1 0x6BU /*!< MPU6050 Power Management 1 */
 #define MPU6050_PWR_MGMT_2 0x6CU /*!< MPU6050 Power Management 2 */
 
+/**
+ * @brief FIFO Count and Read Write
+ */
+#define MPU6050_FIFO_COUNTH 0x72U
+#define MPU6050_FIFO_COUNTL 0x73U
+#define MPU6050_FIFO_R_W 0x74U
+
 /**
  * @brief This register is used to verify the identity of the device.
  * The contents of WHO_AM_I is an 8-bit device ID.
@@ -68,6 +134,17 @@ extern "C" {
  */
 #define MPU6050_WHO_AM_I 0x75U
 
+/**
+ * @brief Digital Low Pass Filter, CONFIG DLPF_CFG bits:
+ * 0 = accel 260 Hz, gyro 256 Hz bandwidth, gyro output rate 8 kHz
+ * 1 to 6 = accel 184 to 5 Hz, gyro 188 to 5 Hz bandwidth, gyro output rate 1 kHz
+ * The sample rate is the gyro output rate / (1 + SMPLRT_DIV), accel output rate is 1 kHz.
+ */
+#define MPU6050_DLPF_CFG_OFFSET 0
+#define MPU6050_DLPF_CFG_MASK 0x07U
+#define MPU6050_GYRO_RATE_DLPF_OFF 8000U /*!< Gyro output rate with DLPF_CFG 0 or 7, Hz */
+#define MPU6050_GYRO_RATE_DLPF_ON 1000U  /*!< Gyro output rate with DLPF enabled, Hz */
+
 /**
  * @brief Gyro Full Scale Select:
  * 00 = +250 dps
@@ -86,6 +163,20 @@ extern "C" {
  */
 #define MPU6050_ACCEL_FS_SEL_OFFSET 3
 
+/**
+ * @brief Accel Digital High Pass Filter of the motion detector, ACCEL_CONFIG ACCEL_HPF bits:
+ * 0 = reset, 1 = 5 Hz, 2 = 2.5 Hz, 3 = 1.25 Hz, 4 = 0.63 Hz, 7 = hold.
+ * Output registers are not filtered.
+ */
+#define MPU6050_ACCEL_HPF_OFFSET 0
+#define MPU6050_ACCEL_HPF_MASK 0x07U
+#define MPU6050_ACCEL_HPF_5HZ 0x01U
+
+/**
+ * @brief Motion detection units: MOT_THR 2 mg per LSB, MOT_DUR 1 ms per LSB
+ */
+#define MPU6050_MOT_THR_MG_PER_LSB 2U
+
 /**
  * @brief When asserted the i2c_master interface pins will go into bypass mode when the i2c master
  * interface is disabled The pins will float high due to the internal pull-up if not enabled and the
@@ -93,11 +184,109 @@ extern "C" {
  */
 #define MPU6050_BYPASS_EN_OFFSET 1
 
+/**
+ * @brief INT Pin Configuration bits:
+ * INT_LEVEL 0 = active high, 1 = active low.
+ * INT_OPEN 0 = push-pull, 1 = open drain.
+ * LATCH_INT_EN 0 = 50 us pulse, 1 = held until cleared.
+ * INT_RD_CLEAR 0 = cleared reading INT_STATUS, 1 = cleared on any read.
+ */
+#define MPU6050_INT_LEVEL_OFFSET 7
+#define MPU6050_INT_OPEN_OFFSET 6
+#define MPU6050_LATCH_INT_EN_OFFSET 5
+#define MPU6050_INT_RD_CLEAR_OFFSET 4
+
 /**
  * @brief Enable (1) and disable (0) I2C Master I/F module
  */
 #define MPU6050_I2C_MST_EN 5
 
+/**
+ * @brief Auxiliary I2C master bits:
+ * I2C_MST_CTRL WAIT_FOR_ES delays DATA_RDY until external sensor data is loaded, I2C_MST_CLK
+ * selects the aux bus clock.
+ * I2C_SLVn_ADDR RW bit, 1 = read. I2C_SLVn_CTRL EN, BYTE_SW swaps bytes of 16-bit words and
+ * LEN is the amount of bytes to read, up to 15.
+ * I2C_MST_STATUS SLV4_DONE is set when a slave 4 transfer completes, SLV4_NACK and SLV0_NACK to
+ * SLV3_NACK are set on a nack of the slave.
+ * I2C_MST_DELAY_CTRL DELAY_ES_SHADOW holds the external sensor data until all of it is loaded.
+ */
+#define MPU6050_I2C_MST_WAIT_FOR_ES_OFFSET 6
+#define MPU6050_I2C_MST_CLK_MASK 0x0FU
+#define MPU6050_I2C_SLV_RW_OFFSET 7
+#define MPU6050_I2C_SLV_EN_OFFSET 7
+#define MPU6050_I2C_SLV_BYTE_SW_OFFSET 6
+#define MPU6050_I2C_SLV_LEN_MASK 0x0FU
+#define MPU6050_I2C_SLV4_DONE_OFFSET 6
+#define MPU6050_I2C_SLV4_NACK_OFFSET 4
+#define MPU6050_I2C_MST_DELAY_ES_SHADOW_OFFSET 7
+#define MPU6050_I2C_SLAVES 4U /*!< Slaves sampled with every measurement */
+
+/**
+ * @brief FIFO Enable bits, which sensor measurements are loaded into the FIFO buffer
+ */
+#define MPU6050_TEMP_FIFO_EN_OFFSET 7
+#define MPU6050_XG_FIFO_EN_OFFSET 6
+#define MPU6050_YG_FIFO_EN_OFFSET 5
+#define MPU6050_ZG_FIFO_EN_OFFSET 4
+#define MPU6050_ACCEL_FIFO_EN_OFFSET 3
+#define MPU6050_SLV2_FIFO_EN_OFFSET 2
+#define MPU6050_SLV1_FIFO_EN_OFFSET 1
+#define MPU6050_SLV0_FIFO_EN_OFFSET 0
+
+/**
+ * @brief User Control FIFO bits:
+ * FIFO_EN enables FIFO operations.
+ * FIFO_RESET resets the FIFO buffer when FIFO_EN is 0, the bit auto clears.
+ * I2C_MST_RESET resets the auxiliary I2C master, the bit auto clears.
+ */
+#define MPU6050_USER_CTRL_FIFO_EN_OFFSET 6
+#define MPU6050_USER_CTRL_FIFO_RESET_OFFSET 2
+#define MPU6050_USER_CTRL_I2C_MST_RESET_OFFSET 1
+
+/**
+ * @brief User Control bits that auto clear: FIFO_RESET, I2C_MST_RESET and SIG_COND_RESET
+ */
+#define MPU6050_USER_CTRL_RESET_MASK 0x07U
+
+/**
+ * @brief Power Management 1 bits:
+ * DEVICE_RESET resets all internal registers to their default values, the bit auto clears.
+ * SLEEP puts the device into sleep mode.
+ * CYCLE, with SLEEP cleared, wakes the device at LP_WAKE_CTRL rate for a single accel sample.
+ * TEMP_DIS disables the temperature sensor.
+ * CLKSEL selects the clock source, 0 = internal 8 MHz oscillator, 1 = PLL with X gyro reference.
+ */
+#define MPU6050_PWR1_DEVICE_RESET_OFFSET 7
+#define MPU6050_PWR1_SLEEP_OFFSET 6
+#define MPU6050_PWR1_CYCLE_OFFSET 5
+#define MPU6050_PWR1_TEMP_DIS_OFFSET 3
+#define MPU6050_PWR1_CLKSEL_MASK 0x07U
+#define MPU6050_PWR1_CLKSEL_PLL_XGYRO 0x01U
+
+/**
+ * @brief Power Management 2 bits:
+ * LP_WAKE_CTRL accel only low power wake-up rate: 0 = 1.25 Hz, 1 = 5 Hz, 2 = 20 Hz, 3 = 40 Hz.
+ * STBY_XA, STBY_YA, STBY_ZA, STBY_XG, STBY_YG and STBY_ZG put each axis into standby.
+ */
+#define MPU6050_PWR2_LP_WAKE_CTRL_OFFSET 6
+#define MPU6050_PWR2_LP_WAKE_CTRL_MASK 0xC0U
+#define MPU6050_PWR2_STBY_MASK 0x3FU
+#define MPU6050_PWR2_STBY_XA_OFFSET 5
+#define MPU6050_PWR2_STBY_XG_OFFSET 2
+
+/**
+ * @brief Interrupt Enable and Status bits
+ */
+#define MPU6050_INT_MOT_OFFSET 6
+#define MPU6050_INT_FIFO_OFLOW_OFFSET 4
+#define MPU6050_INT_DATA_RDY_OFFSET 0
+
+/**
+ * @brief FIFO buffer size in bytes
+ */
+#define MPU6050_FIFO_SIZE 1024U
+
 #ifdef __cplusplus
 }
 #endif
@@ -0,0 +1,71 @@
+/**
+ ******************************************************************************
+ * @file           : mpu6050_ring.h
+ * @author         : Gonzalo Gabriel Fernandez
+ * @brief          : MPU6050 sample ring headers
+ ******************************************************************************
+ * @attention
+ *
+ * Lock-free single-producer/single-consumer ring of samples. The producer is
+ * the DMA completion callback, the consumer is the application main loop.
+ *
+ ******************************************************************************
+ */
+
+#ifndef __MPU6050_RING_H
+#define __MPU6050_RING_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "mpu6050_def.h"
+#include "mpu6050_registers.h"
+
+#ifndef MPU6050_RING_SIZE
+#define MPU6050_RING_SIZE 8U /*! Amount of ring slots, must be a power of two */
+#endif
+
+#if (MPU6050_RING_SIZE & (MPU6050_RING_SIZE - 1U)) != 0
+#error "MPU6050_RING_SIZE must be a power of two"
+#endif
+
+/**
+ * @brief MPU6050 ring slot, DMA target and decoded sample
+ */
+struct mpu6050_ring_slot_s {
+  uint8_t raw[MPU6050_SENSOR_DATA_LEN]; /*!< Output registers as received */
+  mpu6050_sample_t sample;              /*!< Decoded sample */
+  uint64_t timestamp_ns;                /*!< Port time of the sample */
+};
+
+/**
+ * @brief MPU6050 ring structure definition
+ * @note  head is only written by the producer and tail only by the consumer.
+ */
+struct mpu6050_ring_s {
+  mpu6050_ring_slot_t slots[MPU6050_RING_SIZE]; /*!< Ring slots */
+  volatile uint32_t head;                       /*!< Slots published by the producer */
+  volatile uint32_t tail;                       /*!< Slots released by the consumer */
+  volatile uint32_t overruns;                   /*!< Times the producer found ring full */
+  volatile uint32_t drops;                      /*!< Samples discarded by the producer */
+};
+
+void mpu6050_ring_init(mpu6050_ring_t *pring);
+mpu6050_ring_slot_t *mpu6050_ring_acquire(mpu6050_ring_t *pring);
+void mpu6050_ring_commit(mpu6050_ring_t *pring);
+void mpu6050_ring_drop(mpu6050_ring_t *pring);
+const mpu6050_sample_t *mpu6050_ring_peek(mpu6050_ring_t *pring);
+uint32_t mpu6050_ring_peek_batch(mpu6050_ring_t *pring, const mpu6050_ring_slot_t **pslots);
+void mpu6050_ring_release(mpu6050_ring_t *pring, uint32_t count);
+bool mpu6050_ring_pop(mpu6050_ring_t *pring, mpu6050_sample_t *psample);
+uint32_t mpu6050_ring_count(mpu6050_ring_t *pring);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* __MPU6050_RING_H */
@@ -0,0 +1,118 @@
+/**
+ ******************************************************************************
+ * @file           : mpu6050_vibration.h
+ * @author         : Gonzalo Gabriel Fernandez
+ * @brief          : MPU6050 vibration analyzer headers
+ ******************************************************************************
+ * @attention
+ *
+ * Condition monitoring features computed on the device from the raw accel
+ * samples, so only the features leave it instead of the samples. Samples go
+ * into overlapping windows of MPU6050_VIB_FFT_SIZE samples, every hop samples
+ * a window is analyzed per axis: RMS, peak, crest factor and kurtosis of the
+ * vibration around the mean, Goertzel amplitudes at a short list of target
+ * frequencies, and from a Hann windowed real FFT the amplitude spectrum and
+ * the RMS of a list of frequency bands.
+ *
+ * Float arithmetic, for parts with FPU (Cortex-M4F, M7). Every buffer is part
+ * of the analyzer structure, nothing is allocated.
+ *
+ ******************************************************************************
+ */
+
+#ifndef __MPU6050_VIBRATION_H
+#define __MPU6050_VIBRATION_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "mpu6050.h"
+#include "mpu6050_convert.h"
+
+#ifndef MPU6050_VIB_FFT_SIZE
+#define MPU6050_VIB_FFT_SIZE 256U /*! Window length, a power of two */
+#endif
+
+#ifndef MPU6050_VIB_MAX_BANDS
+#define MPU6050_VIB_MAX_BANDS 8U /*! Maximum amount of RMS bands */
+#endif
+
+#ifndef MPU6050_VIB_MAX_TONES
+#define MPU6050_VIB_MAX_TONES 8U /*! Maximum amount of Goertzel target frequencies */
+#endif
+
+#define MPU6050_VIB_AXES 3U                               /*! Accel X, Y, Z */
+#define MPU6050_VIB_BINS (MPU6050_VIB_FFT_SIZE / 2U + 1U) /*! Spectrum bins, DC to Nyquist */
+
+#if (MPU6050_VIB_FFT_SIZE < 16U) || (MPU6050_VIB_FFT_SIZE & (MPU6050_VIB_FFT_SIZE - 1U)) != 0
+#error "MPU6050_VIB_FFT_SIZE must be a power of two, 16 or more"
+#endif
+
+/**
+ * @brief MPU6050 vibration features of an axis, in m/s^2
+ */
+typedef struct {
+  float rms;                          /*!< RMS around the window mean */
+  float peak;                         /*!< Largest deviation from the window mean */
+  float crest;                        /*!< Peak over RMS */
+  float kurtosis;                     /*!< Fourth moment over squared variance, 3 for noise */
+  float bands[MPU6050_VIB_MAX_BANDS]; /*!< RMS of every band, in order of addition */
+  float tones[MPU6050_VIB_MAX_TONES]; /*!< Amplitude at every target, in order of addition */
+
+} mpu6050_vib_axis_t;
+
+/**
+ * @brief MPU6050 vibration features of a window
+ */
+typedef struct {
+  uint32_t window;                           /*!< Window number, from 0 */
+  mpu6050_vib_axis_t axis[MPU6050_VIB_AXES]; /*!< Features of accel X, Y, Z */
+
+} mpu6050_vib_features_t;
+
+/**
+ * @brief MPU6050 vibration analyzer structure definition
+ */
+typedef struct {
+  int16_t history[MPU6050_VIB_AXES][MPU6050_VIB_FFT_SIZE]; /*!< Last window of raw samples */
+  float window[MPU6050_VIB_FFT_SIZE];                      /*!< Hann window */
+  float twiddle[MPU6050_VIB_FFT_SIZE];                     /*!< exp(-2 pi i k / N), k < N / 2 */
+  float work[MPU6050_VIB_FFT_SIZE];                        /*!< Windowed axis, FFT in place */
+  uint16_t bitrev[MPU6050_VIB_FFT_SIZE / 2U];              /*!< Half size FFT bit reversal */
+  float spectrum[MPU6050_VIB_AXES][MPU6050_VIB_BINS];      /*!< Last amplitude spectrum */
+  uint16_t band_bins[MPU6050_VIB_MAX_BANDS][2];            /*!< First and last bin of a band */
+  float tone_coeffs[MPU6050_VIB_MAX_TONES];                /*!< Goertzel 2 cos(2 pi f / fs) */
+  float scale;                                             /*!< Accel m/s^2 per LSB */
+  float sample_rate_hz;                                    /*!< Sample rate */
+  float amplitude_norm;                                    /*!< Bin to sine amplitude */
+  float power_norm;                                        /*!< Bin power to mean square */
+  uint16_t hop;                                            /*!< Samples between windows */
+  uint16_t pos;                                            /*!< Oldest sample of the history */
+  uint16_t filled;                                         /*!< Samples in the history */
+  uint16_t since;                                          /*!< Samples since the last window */
+  uint8_t band_count;                                      /*!< Amount of bands */
+  uint8_t tone_count;                                      /*!< Amount of target frequencies */
+  bool spectrum_enabled;                                   /*!< Spectrum kept without bands */
+  uint32_t windows;                                        /*!< Windows analyzed */
+
+} mpu6050_vib_t;
+
+mpu6050_status_t mpu6050_vib_init(mpu6050_vib_t *pvib, const mpu6050_convert_scale_t *pscale,
+                                  float sample_rate_hz, uint16_t hop, bool spectrum);
+mpu6050_status_t mpu6050_vib_add_band(mpu6050_vib_t *pvib, float low_hz, float high_hz);
+mpu6050_status_t mpu6050_vib_add_tone(mpu6050_vib_t *pvib, float freq_hz);
+void mpu6050_vib_reset(mpu6050_vib_t *pvib);
+bool mpu6050_vib_push(mpu6050_vib_t *pvib, uint16_t accelx, uint16_t accely, uint16_t accelz,
+                      mpu6050_vib_features_t *pout);
+uint32_t mpu6050_vib_process(mpu6050_vib_t *pvib, const mpu6050_sample_t *psamples,
+                             uint32_t count, mpu6050_vib_features_t *pout);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* __MPU6050_VIBRATION_H */
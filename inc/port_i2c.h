@@ -6,7 +6,9 @@
  ******************************************************************************
  * @attention
  *
- * MPU6050 Driver I2C port header, hardware independant.
+ * MPU6050 Driver I2C port header, hardware independant. The blocking API is
+ * implemented over the transaction queue, ports provide the non-blocking
+ * start, the bus lock, the wait for completion and the bus recovery.
  *
  ******************************************************************************
  */
@@ -18,20 +20,31 @@
 extern "C" {
 #endif
 
+#include <stdbool.h>
 #include <stdint.h>
 
 #include "mpu6050_def.h"
-
-#define I2C_READ_TIMEOUT 100
-#define I2C_WRITE_TIMEOUT 100
-
-mpu6050_status_t i2c_init(void);
-mpu6050_status_t i2c_reg_read(uint16_t slave_address, uint8_t reg_address, uint8_t *pdata);
-mpu6050_status_t i2c_burst_read(uint16_t slave_address, uint8_t reg_address, uint8_t *pdata,
-                                uint16_t data_amont);
-mpu6050_status_t i2c_reg_write(uint16_t slave_address, uint8_t reg_address, uint8_t *pdata);
-mpu6050_status_t i2c_read_dma(uint16_t slave_address, uint8_t reg_address, uint8_t *pdata,
-                              uint16_t data_amount);
+#include "port_i2c_queue.h"
+
+mpu6050_status_t i2c_init(void *bus);
+mpu6050_status_t i2c_reg_read(void *bus, uint16_t slave_address, uint8_t reg_address,
+                              uint8_t *pdata);
+mpu6050_status_t i2c_burst_read(void *bus, uint16_t slave_address, uint8_t reg_address,
+                                uint8_t *pdata, uint16_t data_amont);
+mpu6050_status_t i2c_reg_write(void *bus, uint16_t slave_address, uint8_t reg_address,
+                               uint8_t *pdata);
+mpu6050_status_t i2c_burst_write(void *bus, uint16_t slave_address, uint8_t reg_address,
+                                 uint8_t *pdata, uint16_t data_amount);
+mpu6050_status_t i2c_start(void *bus, const i2c_transaction_t *ptransaction);
+i2c_queue_t *i2c_get_queue(void *bus);
+void i2c_lock(void *bus);
+void i2c_unlock(void *bus);
+mpu6050_status_t i2c_wait(void *bus, volatile bool *pdone, uint32_t timeout_us);
+mpu6050_status_t i2c_recover(void *bus);
+uint32_t i2c_speed_hz(void *bus);
+mpu6050_status_t i2c_int_attach(void *bus, uint32_t int_line, void *pcontext);
+mpu6050_status_t i2c_int_detach(void *bus, uint32_t int_line);
+uint64_t i2c_timestamp_ns(void *bus);
 
 #ifdef __cplusplus
 }
@@ -0,0 +1,113 @@
+/**
+ ******************************************************************************
+ * @file           : port_i2c_linux.h
+ * @author         : Gonzalo Gabriel Fernandez
+ * @brief          : MPU6050 Driver I2C port for Linux i2c-dev header
+ ******************************************************************************
+ * @attention
+ *
+ * Bus handle and batched transactions of the Linux i2c-dev port.
+ * The bus handle is the bus argument of the port_i2c.h interface.
+ *
+ ******************************************************************************
+ */
+
+#ifndef __PORT_I2C_LINUX_H
+#define __PORT_I2C_LINUX_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <linux/i2c.h>
+#include <pthread.h>
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "mpu6050_def.h"
+#include "port_i2c_queue.h"
+
+#ifndef I2C_LINUX_BATCH_MAX_MSGS
+#define I2C_LINUX_BATCH_MAX_MSGS 32U /*! Messages of a batch, kernel limit is 42 */
+#endif
+
+#ifndef I2C_LINUX_MAX_INT_LINES
+#define I2C_LINUX_MAX_INT_LINES 4U /*! GPIO lines wired to INT pins per bus */
+#endif
+
+#ifndef I2C_LINUX_WRITE_MAX
+#define I2C_LINUX_WRITE_MAX 32U /*! Data bytes of a queued write */
+#endif
+
+#ifndef I2C_LINUX_DEFAULT_SPEED
+#define I2C_LINUX_DEFAULT_SPEED 100000U /*! Bus clock speed when not set in the handle */
+#endif
+
+#ifndef I2C_LINUX_BATCH_POOL_SIZE
+#define I2C_LINUX_BATCH_POOL_SIZE 64U /*! Bytes for register addresses and written data */
+#endif
+
+/**
+ * @brief GPIO line event wired to a device INT pin
+ */
+typedef struct {
+  uint32_t line;         /*!< GPIO line offset on the chip */
+  int fd;                /*!< Line event file descriptor */
+  pthread_t thread;      /*!< Line event waiter */
+  volatile bool running; /*!< Waiter is running */
+  void *pcontext;        /*!< Context of the interrupt, MPU6050 handle */
+
+} i2c_linux_int_t;
+
+/**
+ * @brief Linux i2c-dev bus handle
+ * @note  Set device, and gpiochip and int_active_low if INT pins are wired, before i2c_init.
+ * speed_hz and adapter_timeout_ms are optional. The rest of the fields are owned by the port.
+ */
+typedef struct {
+  const char *device;                            /*!< i2c-dev device path, e.g. /dev/i2c-1 */
+  const char *gpiochip;                          /*!< INT lines GPIO chip, /dev/gpiochipN */
+  bool int_active_low;                           /*!< INT pins configured active low */
+  uint32_t speed_hz;                             /*!< Bus clock speed, 0 for 100 kHz */
+  uint32_t adapter_timeout_ms;                   /*!< Adapter timeout, 0 for the kernel one */
+  int fd;                                        /*!< i2c-dev file descriptor */
+  pthread_t worker;                              /*!< Queued transactions worker */
+  pthread_mutex_t lock;                          /*!< Protects the request and the queue */
+  pthread_cond_t cond;                           /*!< Signals a new request */
+  pthread_cond_t done_cond;                      /*!< Signals a completion */
+  bool running;                                  /*!< Worker is running */
+  bool pending;                                  /*!< Transaction requested */
+  bool completing;                               /*!< Worker completing a transaction */
+  bool aborted;                                  /*!< Requested transaction aborted */
+  i2c_transaction_t request;                     /*!< Requested transaction */
+  uint8_t write_buffer[I2C_LINUX_WRITE_MAX + 1]; /*!< Register address and written data */
+  i2c_queue_t queue;                             /*!< Transaction queue */
+  i2c_linux_int_t ints[I2C_LINUX_MAX_INT_LINES]; /*!< Attached INT lines */
+
+} i2c_linux_bus_t;
+
+/**
+ * @brief Batch of register reads and writes submitted with one I2C_RDWR ioctl
+ */
+typedef struct {
+  struct i2c_msg msgs[I2C_LINUX_BATCH_MAX_MSGS]; /*!< Messages of the combined transaction */
+  uint8_t pool[I2C_LINUX_BATCH_POOL_SIZE];       /*!< Storage of written bytes */
+  uint16_t nmsgs;                                /*!< Amount of messages */
+  uint16_t pool_used;                            /*!< Bytes of the pool in use */
+
+} i2c_linux_batch_t;
+
+mpu6050_status_t i2c_linux_deinit(i2c_linux_bus_t *pbus);
+void i2c_linux_batch_init(i2c_linux_batch_t *pbatch);
+mpu6050_status_t i2c_linux_batch_read(i2c_linux_batch_t *pbatch, uint16_t slave_address,
+                                      uint8_t reg_address, uint8_t *pdata, uint16_t data_amount);
+mpu6050_status_t i2c_linux_batch_write(i2c_linux_batch_t *pbatch, uint16_t slave_address,
+                                       uint8_t reg_address, const uint8_t *pdata,
+                                       uint16_t data_amount);
+mpu6050_status_t i2c_linux_batch_submit(i2c_linux_bus_t *pbus, i2c_linux_batch_t *pbatch);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* __PORT_I2C_LINUX_H */
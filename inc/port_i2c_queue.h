@@ -0,0 +1,125 @@
+/**
+ ******************************************************************************
+ * @file           : port_i2c_queue.h
+ * @author         : Gonzalo Gabriel Fernandez
+ * @brief          : MPU6050 Driver I2C transaction queue header
+ ******************************************************************************
+ * @attention
+ *
+ * Fixed-size transaction queue of a bus, hardware independant. Reads and
+ * writes are queued with a completion callback, and the next transaction is
+ * started by the port from the completion of the previous one, so queued
+ * transfers go back to back on the bus. Sample reads go ahead of housekeeping
+ * transactions. The blocking port API is built on top of the queue.
+ *
+ * Every transaction in flight has a timeout from its length and the bus
+ * speed. One that overruns it is aborted by a bus recovery of the port and
+ * completes with MPU6050_ERROR_TIMEOUT, so a stuck slave costs about a
+ * transfer time instead of a fixed stall.
+ *
+ ******************************************************************************
+ */
+
+#ifndef __PORT_I2C_QUEUE_H
+#define __PORT_I2C_QUEUE_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "mpu6050_def.h"
+
+#ifndef I2C_QUEUE_SIZE
+#define I2C_QUEUE_SIZE 8U /*! Transactions waiting per priority */
+#endif
+
+#ifndef I2C_TIMEOUT_MARGIN
+#define I2C_TIMEOUT_MARGIN 2U /*! Transaction timeout as a multiple of its transfer time */
+#endif
+
+#ifndef I2C_TIMEOUT_SLACK_US
+#define I2C_TIMEOUT_SLACK_US 200U /*! Timeout added for the start and completion latency */
+#endif
+
+/**
+ * @brief I2C transaction direction
+ */
+typedef enum {
+  I2C_QUEUE_READ = 0x00U,  /*!< Register address write and repeated start read */
+  I2C_QUEUE_WRITE = 0x01U, /*!< Register address and data write */
+
+} i2c_queue_op_t;
+
+/**
+ * @brief I2C transaction priority, lower values are dispatched first
+ */
+typedef enum {
+  I2C_QUEUE_PRIO_SAMPLE = 0x00U,       /*!< Sample reads */
+  I2C_QUEUE_PRIO_HOUSEKEEPING = 0x01U, /*!< Configuration and blocking transactions */
+  I2C_QUEUE_PRIOS,
+
+} i2c_queue_prio_t;
+
+/**
+ * @brief Transaction completion callback
+ * @note Called from the completion context of the port, interrupt or worker thread, with the
+ * next transaction already started.
+ */
+typedef void (*i2c_queue_callback_t)(void *pcontext, mpu6050_status_t status);
+
+/**
+ * @brief I2C transaction
+ * @note The data buffer is used until completion, also for writes.
+ */
+typedef struct {
+  i2c_queue_op_t op;             /*!< Transaction direction */
+  i2c_queue_prio_t priority;     /*!< Dispatch priority */
+  uint16_t slave_address;        /*!< I2C slave address, shifted as the port expects */
+  uint8_t reg_address;           /*!< First register */
+  uint8_t *pdata;                /*!< Data buffer */
+  uint16_t data_amount;          /*!< Amount of data */
+  i2c_queue_callback_t callback; /*!< Completion callback, NULL for none */
+  void *pcontext;                /*!< Context given to the callback */
+  uint64_t submitted_ns;         /*!< Port time of the submit, set by the queue */
+
+} i2c_transaction_t;
+
+/**
+ * @brief I2C transaction queue of a bus
+ * @note Owned by the port, one per bus.
+ */
+typedef struct {
+  void *bus;                                                /*!< Bus of the queue */
+  i2c_transaction_t slots[I2C_QUEUE_PRIOS][I2C_QUEUE_SIZE]; /*!< Waiting transactions */
+  uint8_t head[I2C_QUEUE_PRIOS];                            /*!< Oldest waiting transaction */
+  uint8_t count[I2C_QUEUE_PRIOS];                           /*!< Amount waiting */
+  i2c_transaction_t current;                                /*!< Transaction in flight */
+  volatile bool busy;                                       /*!< Transaction in flight */
+  uint32_t completed;                                       /*!< Transactions completed */
+  uint32_t errors;                                          /*!< Transactions failed */
+  uint32_t rejected;                                        /*!< Submits to a full queue */
+  uint32_t started;                                         /*!< Transactions started */
+  uint64_t started_ns;                                      /*!< Start time of the one in flight */
+  uint32_t timeouts;                                        /*!< Transactions aborted on timeout */
+  uint32_t recoveries;                                      /*!< Bus recoveries */
+  uint64_t recovery_ns;                                     /*!< Time spent in bus recoveries */
+  uint32_t recovery_max_ns;                                 /*!< Longest bus recovery */
+
+} i2c_queue_t;
+
+void i2c_queue_init(i2c_queue_t *pqueue, void *bus);
+mpu6050_status_t i2c_queue_submit(void *bus, const i2c_transaction_t *ptransaction);
+void i2c_queue_complete(i2c_queue_t *pqueue, mpu6050_status_t status);
+bool i2c_queue_is_idle(void *bus);
+uint32_t i2c_timeout_us(void *bus, uint16_t data_amount);
+bool i2c_queue_check(void *bus);
+mpu6050_status_t i2c_queue_recover(void *bus);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* __PORT_I2C_QUEUE_H */
@@ -0,0 +1,238 @@
+/**
+ ******************************************************************************
+ * @file           : port_i2c_sim.h
+ * @author         : Gonzalo Gabriel Fernandez
+ * @brief          : MPU6050 Driver simulated I2C port header
+ ******************************************************************************
+ * @attention
+ *
+ * In-process simulated I2C bus and MPU6050 devices. The bus handle is the bus
+ * argument of the port_i2c.h interface. Time is simulated, every transaction
+ * keeps the bus busy for its duration at the configured bus speed. Aux
+ * sensors behind a device are read by its I2C master, or reached from the
+ * bus in bypass mode.
+ *
+ ******************************************************************************
+ */
+
+#ifndef __PORT_I2C_SIM_H
+#define __PORT_I2C_SIM_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+
+#include "mpu6050_def.h"
+#include "mpu6050_registers.h"
+#include "port_i2c_queue.h"
+
+#ifndef I2C_SIM_MAX_DEVICES
+#define I2C_SIM_MAX_DEVICES 8U /*! Maximum amount of devices on a simulated bus */
+#endif
+
+#define I2C_SIM_REGISTERS 128U /*! Size of the device register file */
+
+#ifndef I2C_SIM_MAX_AUX
+#define I2C_SIM_MAX_AUX 4U /*! Maximum amount of sensors on the aux bus of a device */
+#endif
+
+#ifndef I2C_SIM_RESET_NS
+#define I2C_SIM_RESET_NS 5000000U /*! Device reset time, the device does not acknowledge */
+#endif
+
+#ifndef I2C_SIM_STARTUP_NS
+#define I2C_SIM_STARTUP_NS 30000000U /*! First sample after wake-up, gyro start-up time */
+#endif
+
+#ifndef I2C_SIM_REINIT_NS
+#define I2C_SIM_REINIT_NS 20000U /*! Time to re-initialize the I2C peripheral in a recovery */
+#endif
+
+#ifndef I2C_SIM_LATENCY_BUCKETS
+#define I2C_SIM_LATENCY_BUCKETS 4096U /*! Latency histogram buckets of 1 us, last one saturates */
+#endif
+
+/**
+ * @brief Simulated bus speeds
+ */
+typedef enum {
+  I2C_SIM_SPEED_100KHZ = 100000U,
+  I2C_SIM_SPEED_400KHZ = 400000U,
+  I2C_SIM_SPEED_1MHZ = 1000000U,
+
+} i2c_sim_speed_t;
+
+/**
+ * @brief Simulated bus faults
+ */
+typedef enum {
+  I2C_SIM_FAULT_NONE = 0, /*!< No fault */
+  I2C_SIM_FAULT_NACK,     /*!< Address not acknowledged */
+  I2C_SIM_FAULT_BUS,      /*!< Bus error, the transfer completes with MPU6050_ERROR_BUS */
+  I2C_SIM_FAULT_STUCK,    /*!< Slave holds SDA low, transfers hang until a bus recovery */
+  I2C_SIM_FAULT_RESET,    /*!< Device brown-out, not acknowledged and registers reset */
+
+} i2c_sim_fault_t;
+
+/**
+ * @brief Simulated signal channels, in output registers order
+ */
+typedef enum {
+  I2C_SIM_ACCEL_X = 0,
+  I2C_SIM_ACCEL_Y,
+  I2C_SIM_ACCEL_Z,
+  I2C_SIM_TEMP,
+  I2C_SIM_GYRO_X,
+  I2C_SIM_GYRO_Y,
+  I2C_SIM_GYRO_Z,
+  I2C_SIM_CHANNELS,
+
+} i2c_sim_channel_t;
+
+/**
+ * @brief Signal generator of a channel, offset + amplitude * sin(2 * pi * frequency * t)
+ */
+typedef struct {
+  float offset;    /*!< Raw counts */
+  float amplitude; /*!< Raw counts */
+  float frequency; /*!< Hz */
+
+} i2c_sim_signal_t;
+
+/**
+ * @brief Simulated aux sensor, a register file with auto increment
+ */
+typedef struct {
+  uint8_t address;   /*!< 7-bit I2C slave address */
+  uint8_t regs[256]; /*!< Register file */
+  uint32_t reads;    /*!< Read transfers */
+  uint32_t writes;   /*!< Write transfers */
+
+} i2c_sim_aux_t;
+
+/**
+ * @brief Simulated MPU6050 device
+ */
+typedef struct {
+  uint8_t address;                            /*!< 7-bit I2C slave address */
+  uint8_t regs[I2C_SIM_REGISTERS];            /*!< Register file */
+  uint8_t fifo[MPU6050_FIFO_SIZE];            /*!< FIFO buffer */
+  uint16_t fifo_head;                         /*!< FIFO read index */
+  uint16_t fifo_count;                        /*!< FIFO bytes stored */
+  i2c_sim_signal_t signals[I2C_SIM_CHANNELS]; /*!< Output registers signal generators */
+  uint64_t next_sample_ns;                    /*!< Time of the next sample */
+  int32_t clock_ppm;                          /*!< Sample clock error, faster when positive */
+  uint64_t reset_done_ns;                     /*!< End of the device reset */
+  uint64_t samples;                           /*!< Samples generated */
+  uint64_t fifo_bytes_lost;                   /*!< Bytes overwritten on FIFO overflow */
+  int16_t motion_ref[3];                      /*!< Previous accel sample, motion filter */
+  uint32_t motion_ms;                         /*!< Time over the motion threshold */
+  uint8_t int_raised;                         /*!< Interrupt sources raised by the last update */
+  bool int_held;                              /*!< INT pin held by a latched interrupt */
+  i2c_sim_aux_t *paux[I2C_SIM_MAX_AUX];       /*!< Sensors on the aux bus */
+  uint8_t aux_count;                          /*!< Amount of aux sensors */
+  void *int_context;                          /*!< INT pin interrupt context, NULL if not wired */
+
+} i2c_sim_device_t;
+
+/**
+ * @brief Simulated bus counters
+ * @note  Latency runs from i2c_queue_submit, the DATA_RDY edge with interrupt driven reads, to
+ * the completion of sample reads, the non-blocking ones. Blocking reads are not counted.
+ */
+typedef struct {
+  uint32_t transactions;                        /*!< Transactions started */
+  uint32_t bytes_read;                          /*!< Data bytes read from devices */
+  uint32_t bytes_written;                       /*!< Bytes written, register address included */
+  uint32_t naks;                                /*!< Transactions to an absent address */
+  uint32_t faults;                              /*!< Faults injected */
+  uint32_t recoveries;                          /*!< Bus recoveries */
+  uint64_t recovery_ns;                         /*!< Time spent in bus recoveries */
+  uint64_t busy_ns;                             /*!< Time the bus was busy */
+  uint64_t callback_cpu_ns;                     /*!< Host CPU time spent in completions */
+  uint64_t run_cpu_ns;                          /*!< Host CPU time in i2c_sim_run */
+  uint32_t runs;                                /*!< i2c_sim_run calls */
+  uint64_t driver_cpu_ns;                       /*!< Host CPU time in timed driver calls */
+  uint32_t completions;                         /*!< Queued transactions completed */
+  uint32_t sample_reads;                        /*!< Sample reads completed without error */
+  uint32_t latency_us[I2C_SIM_LATENCY_BUCKETS]; /*!< Sample read submit to completion */
+
+} i2c_sim_stats_t;
+
+/**
+ * @brief Simulated bus, the bus handle of the simulated port
+ */
+typedef struct {
+  uint32_t speed_hz;                               /*!< Bus clock speed */
+  uint64_t now_ns;                                 /*!< Simulated time */
+  i2c_sim_device_t *pdevices[I2C_SIM_MAX_DEVICES]; /*!< Devices on the bus */
+  uint8_t count;                                   /*!< Amount of devices */
+  bool dma_pending;                                /*!< Transaction in flight */
+  uint64_t dma_start_ns;                           /*!< Start time of the transaction in flight */
+  uint64_t dma_done_ns;                            /*!< Completion time of the transaction */
+  mpu6050_status_t dma_status;                     /*!< Completion status of the transaction */
+  i2c_sim_fault_t fault;                           /*!< Fault injected */
+  uint32_t fault_period;                           /*!< Transactions per fault, 0 for none */
+  uint32_t fault_countdown;                        /*!< Transactions before the next fault */
+  bool stuck;                                      /*!< SDA held low until a bus recovery */
+  bool realtime;                                   /*!< Simulated time paced by the host clock */
+  uint64_t realtime_origin_ns;                     /*!< Host time of simulated time 0 */
+  uint64_t cpu_clock_ns;                           /*!< Host CPU time of a CPU clock read */
+  uint64_t driver_start_ns;                        /*!< Host CPU time of the timed driver call */
+  uint64_t driver_run_ns;                          /*!< i2c_sim_run CPU time at its start */
+  uint32_t driver_runs;                            /*!< i2c_sim_run calls at its start */
+  i2c_queue_t queue;                               /*!< Transaction queue */
+  i2c_sim_stats_t stats;                           /*!< Bus counters */
+
+} i2c_sim_bus_t;
+
+/**
+ * @brief Acquisition report of a measurement window
+ */
+typedef struct {
+  const char *mode;                  /*!< Acquisition mode name */
+  uint32_t samples;                  /*!< Samples acquired in the window */
+  double samples_per_s;              /*!< Sustained sample rate, simulated time */
+  double bytes_per_sample;           /*!< Bus bytes per sample, both directions */
+  double transactions_per_sample;    /*!< Bus transactions per sample */
+  double bus_us_per_sample;          /*!< Bus busy time per sample */
+  double callback_cpu_ns_per_sample; /*!< Host CPU time in the completion callback per sample */
+  double driver_cpu_ns_per_sample;   /*!< Host CPU time in the driver per sample, callbacks too */
+  uint32_t latency_p50_us;           /*!< Sample read latency, median */
+  uint32_t latency_p99_us;           /*!< Sample read latency, 99th percentile */
+  uint32_t latency_p999_us;          /*!< Sample read latency, 99.9th percentile */
+
+} i2c_sim_report_t;
+
+void i2c_sim_bus_init(i2c_sim_bus_t *pbus, i2c_sim_speed_t speed);
+void i2c_sim_device_init(i2c_sim_device_t *pdev, uint8_t address);
+mpu6050_status_t i2c_sim_attach(i2c_sim_bus_t *pbus, i2c_sim_device_t *pdev);
+void i2c_sim_aux_init(i2c_sim_aux_t *paux, uint8_t address);
+mpu6050_status_t i2c_sim_aux_attach(i2c_sim_device_t *pdev, i2c_sim_aux_t *paux);
+void i2c_sim_set_signal(i2c_sim_device_t *pdev, i2c_sim_channel_t channel, float offset,
+                        float amplitude, float frequency);
+uint64_t i2c_sim_transfer_ns(const i2c_sim_bus_t *pbus, uint16_t write_bytes,
+                             uint16_t read_bytes);
+void i2c_sim_run(i2c_sim_bus_t *pbus, uint64_t duration_ns);
+void i2c_sim_fault_inject(i2c_sim_bus_t *pbus, i2c_sim_fault_t fault, uint32_t period);
+void i2c_sim_realtime(i2c_sim_bus_t *pbus, bool enable);
+uint64_t i2c_sim_now(const i2c_sim_bus_t *pbus);
+uint32_t i2c_sim_sample_rate(const i2c_sim_device_t *pdev);
+void i2c_sim_stats_reset(i2c_sim_bus_t *pbus);
+void i2c_sim_driver_begin(i2c_sim_bus_t *pbus);
+void i2c_sim_driver_end(i2c_sim_bus_t *pbus);
+uint32_t i2c_sim_latency_percentile(const i2c_sim_bus_t *pbus, float percentile);
+void i2c_sim_report(const i2c_sim_bus_t *pbus, const char *mode, uint32_t samples,
+                    uint64_t elapsed_ns, i2c_sim_report_t *preport);
+void i2c_sim_report_csv(FILE *pfile, const i2c_sim_report_t *preport, bool header);
+void i2c_sim_report_json(FILE *pfile, const i2c_sim_report_t *preport);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* __PORT_I2C_SIM_H */
@@ -0,0 +1,38 @@
+/**
+ ******************************************************************************
+ * @file           : port_i2c_stm32.h
+ * @author         : Gonzalo Gabriel Fernandez
+ * @brief          : MPU6050 Driver I2C port for STM32 header
+ ******************************************************************************
+ * @attention
+ *
+ * STM32 specific setup of the I2C port. The I2C peripheral handle is the bus
+ * argument of the port_i2c.h interface.
+ *
+ ******************************************************************************
+ */
+
+#ifndef __PORT_I2C_STM32_H
+#define __PORT_I2C_STM32_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#ifdef STM32F103xB
+#include "stm32f1xx_hal.h"
+#elif STM32F429xx
+#include "stm32f4xx_hal.h"
+#endif
+
+#include "mpu6050_def.h"
+
+mpu6050_status_t i2c_stm32_recovery_pins(I2C_HandleTypeDef *hi2c, GPIO_TypeDef *pscl_port,
+                                         uint16_t scl_pin, GPIO_TypeDef *psda_port,
+                                         uint16_t sda_pin);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* __PORT_I2C_STM32_H */
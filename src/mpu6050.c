@@ -17,305 +17,2481 @@
 
 #include <assert.h>
 #include <stdbool.h>
+#include <stddef.h>
+#include <string.h>
 
-static mpu6050_t hmpu1;              /*! MPU6050 data structure */
-static bool data_ready_flag = false; /*! Flag for data ready */
-static uint8_t rxbuffer[6];          /*! Buffer with data from non-blocking read */
+/**
+ * @brief   Shadow of a configuration register
+ * @param   hmpu: Pointer to MPU6050 handle
+ * @param   reg_address: Address of register
+ * @retval  Pointer to shadow value, NULL if the register is not shadowed
+ */
+static uint8_t *mpu6050_shadow_reg(mpu6050_t *hmpu, uint8_t reg_address) {
+  switch (reg_address) {
+  case MPU6050_SMPLRT_DIV:
+    return &hmpu->shadow.smplrt_div;
+  case MPU6050_CONFIG:
+    return &hmpu->shadow.config;
+  case MPU6050_GYRO_CONFIG:
+    return &hmpu->shadow.gyro_config;
+  case MPU6050_ACCEL_CONFIG:
+    return &hmpu->shadow.accel_config;
+  case MPU6050_FIFO_EN:
+    return &hmpu->shadow.fifo_en;
+  case MPU6050_INT_PIN_CFG:
+    return &hmpu->shadow.int_pin_cfg;
+  case MPU6050_INT_ENABLE:
+    return &hmpu->shadow.int_enable;
+  case MPU6050_USER_CTRL:
+    return &hmpu->shadow.user_ctrl;
+  case MPU6050_PWR_MGMT_1:
+    return &hmpu->shadow.pwr_mgmt_1;
+  case MPU6050_PWR_MGMT_2:
+    return &hmpu->shadow.pwr_mgmt_2;
+  default:
+    return NULL;
+  }
+}
+
+#ifdef MPU6050_STATS
+/**
+ * @brief   Latency counter ticks
+ * @param   hmpu: Pointer to MPU6050 handle
+ * @retval  Ticks of the counter set, port time in ns otherwise
+ */
+static uint32_t mpu6050_stats_ticks(mpu6050_t *hmpu) {
+  if (hmpu->stats_counter != NULL)
+    return hmpu->stats_counter();
+  return (uint32_t)i2c_timestamp_ns(hmpu->bus);
+}
+
+/**
+ * @brief   Open a statistics update
+ * @note    The bus lock keeps the blocking wrappers and the completion callback apart, the odd
+ * sequence tells snapshot readers to retry.
+ * @param   hmpu: Pointer to MPU6050 handle
+ */
+static void mpu6050_stats_begin(mpu6050_t *hmpu) {
+  i2c_lock(hmpu->bus);
+  __atomic_store_n(&hmpu->stats_seq, hmpu->stats_seq + 1U, __ATOMIC_RELAXED);
+  __atomic_thread_fence(__ATOMIC_RELEASE);
+}
+
+/**
+ * @brief   Close a statistics update
+ * @param   hmpu: Pointer to MPU6050 handle
+ */
+static void mpu6050_stats_end(mpu6050_t *hmpu) {
+  __atomic_store_n(&hmpu->stats_seq, hmpu->stats_seq + 1U, __ATOMIC_RELEASE);
+  i2c_unlock(hmpu->bus);
+}
+
+/**
+ * @brief   Account a register read served by the shadow
+ * @param   hmpu: Pointer to MPU6050 handle
+ */
+static void mpu6050_stats_shadow_hit(mpu6050_t *hmpu) {
+  mpu6050_stats_begin(hmpu);
+  hmpu->stats.shadow_hits++;
+  mpu6050_stats_end(hmpu);
+}
+
+/**
+ * @brief   Account a finished transaction
+ * @note    Failed transactions count as errors only, neither bytes nor latency.
+ * @param   hmpu: Pointer to MPU6050 handle
+ * @param   kind: Transaction kind
+ * @param   bytes: Bytes transferred
+ * @param   status: Completion status
+ * @param   start: Counter ticks at the transaction start
+ */
+static void mpu6050_stats_record(mpu6050_t *hmpu, mpu6050_xfer_kind_t kind, uint16_t bytes,
+                                 mpu6050_status_t status, uint32_t start) {
+  uint32_t latency = mpu6050_stats_ticks(hmpu) - start;
+  uint8_t bucket = 0;
+  if (latency != 0)
+    bucket = (uint8_t)(32 - __builtin_clz(latency));
+  if (bucket >= MPU6050_STATS_BUCKETS)
+    bucket = MPU6050_STATS_BUCKETS - 1U;
+
+  mpu6050_stats_begin(hmpu);
+  hmpu->stats.transactions[kind]++;
+  if (status != MPU6050_OK) {
+    hmpu->stats.errors[status < MPU6050_STATUS_CODES ? status : MPU6050_ERROR]++;
+  } else {
+    hmpu->stats.bytes[kind] += bytes;
+    hmpu->stats.latency[kind][bucket]++;
+    if (latency > hmpu->stats.latency_max[kind])
+      hmpu->stats.latency_max[kind] = latency;
+  }
+  mpu6050_stats_end(hmpu);
+}
+
+/**
+ * @brief   Start timing a non-blocking read
+ * @param   hmpu: Pointer to MPU6050 handle
+ * @param   bytes: Bytes to read
+ */
+static void mpu6050_stats_submit(mpu6050_t *hmpu, uint16_t bytes) {
+  hmpu->stats_bytes = bytes;
+  hmpu->stats_start = mpu6050_stats_ticks(hmpu);
+}
+
+/**
+ * @brief   Account the completion of a non-blocking read
+ * @param   hmpu: Pointer to MPU6050 handle
+ * @param   status: Completion status
+ */
+static void mpu6050_stats_complete(mpu6050_t *hmpu, mpu6050_status_t status) {
+  mpu6050_stats_record(hmpu, MPU6050_XFER_NONBLOCKING, hmpu->stats_bytes, status,
+                       hmpu->stats_start);
+}
+#else
+/* Statistics disabled, the accounting compiles out */
+static inline uint32_t mpu6050_stats_ticks(mpu6050_t *hmpu) {
+  (void)hmpu;
+  return 0;
+}
+static inline void mpu6050_stats_shadow_hit(mpu6050_t *hmpu) { (void)hmpu; }
+static inline void mpu6050_stats_record(mpu6050_t *hmpu, mpu6050_xfer_kind_t kind,
+                                        uint16_t bytes, mpu6050_status_t status, uint32_t start) {
+  (void)hmpu;
+  (void)kind;
+  (void)bytes;
+  (void)status;
+  (void)start;
+}
+static inline void mpu6050_stats_submit(mpu6050_t *hmpu, uint16_t bytes) {
+  (void)hmpu;
+  (void)bytes;
+}
+static inline void mpu6050_stats_complete(mpu6050_t *hmpu, mpu6050_status_t status) {
+  (void)hmpu;
+  (void)status;
+}
+#endif
+
+/**
+ * @brief   Single register access through the bus queue
+ * @param   hmpu: Pointer to MPU6050 handle
+ * @param   op: Transaction direction
+ * @param   reg_address: Address of first register
+ * @param   pdata: Pointer to data buffer
+ * @param   data_amount: Amount of data to read or write
+ * @retval  mpu6050_status_t
+ */
+static mpu6050_status_t mpu6050_transfer(mpu6050_t *hmpu, i2c_queue_op_t op, uint8_t reg_address,
+                                         uint8_t *pdata, uint16_t data_amount) {
+  uint16_t slave_address = (uint16_t)hmpu->address << 1;
+  if (op == I2C_QUEUE_WRITE)
+    return i2c_burst_write(hmpu->bus, slave_address, reg_address, pdata, data_amount);
+  return i2c_burst_read(hmpu->bus, slave_address, reg_address, pdata, data_amount);
+}
+
+/**
+ * @brief   Restore the device configuration from the shadow after a device reset
+ * @note    A device reset by a brown-out comes back asleep with the power-on configuration. It is
+ * told by PWR_MGMT_1 or the sampling configuration differing from the shadow, then the shadowed
+ * registers are written back, power management first.
+ * @param   hmpu: Pointer to MPU6050 handle
+ * @retval  mpu6050_status_t
+ */
+static mpu6050_status_t mpu6050_shadow_restore(mpu6050_t *hmpu) {
+  static const uint8_t restore_order[] = {MPU6050_PWR_MGMT_1,   MPU6050_PWR_MGMT_2,
+                                          MPU6050_SMPLRT_DIV,   MPU6050_CONFIG,
+                                          MPU6050_GYRO_CONFIG,  MPU6050_ACCEL_CONFIG,
+                                          MPU6050_FIFO_EN,      MPU6050_INT_PIN_CFG,
+                                          MPU6050_INT_ENABLE,   MPU6050_USER_CTRL};
+  if (!hmpu->shadow.valid)
+    return MPU6050_OK;
+
+  uint8_t reg_value[4];
+  uint8_t pwr_mgmt_1;
+  if (mpu6050_transfer(hmpu, I2C_QUEUE_READ, MPU6050_PWR_MGMT_1, &pwr_mgmt_1, 1) != MPU6050_OK ||
+      mpu6050_transfer(hmpu, I2C_QUEUE_READ, MPU6050_SMPLRT_DIV, reg_value, 4) != MPU6050_OK)
+    return MPU6050_ERROR;
+  if (pwr_mgmt_1 == hmpu->shadow.pwr_mgmt_1 && reg_value[0] == hmpu->shadow.smplrt_div &&
+      reg_value[1] == hmpu->shadow.config && reg_value[2] == hmpu->shadow.gyro_config &&
+      reg_value[3] == hmpu->shadow.accel_config)
+    return MPU6050_OK;
+
+  for (uint8_t i = 0; i < sizeof(restore_order); i++) {
+    uint8_t value = *mpu6050_shadow_reg(hmpu, restore_order[i]);
+    if (mpu6050_transfer(hmpu, I2C_QUEUE_WRITE, restore_order[i], &value, 1) != MPU6050_OK)
+      return MPU6050_ERROR;
+  }
+  hmpu->recovery.restores++;
+  return MPU6050_OK;
+}
+
+/**
+ * @brief   Account the time of a retry sequence or recovery
+ * @param   hmpu: Pointer to MPU6050 handle
+ * @param   start_ns: Port time at the start
+ */
+static void mpu6050_recovery_account(mpu6050_t *hmpu, uint64_t start_ns) {
+  uint64_t elapsed_ns = i2c_timestamp_ns(hmpu->bus) - start_ns;
+  hmpu->recovery.time_ns += elapsed_ns;
+  if (elapsed_ns > hmpu->recovery.max_ns)
+    hmpu->recovery.max_ns = (elapsed_ns > UINT32_MAX) ? UINT32_MAX : (uint32_t)elapsed_ns;
+}
+
+/**
+ * @brief   Retry a failed register access
+ * @note    Attempts are bounded by MPU6050_RETRIES and by the retry budget in i2c_timeout. A bus
+ * or peripheral error gets a bus recovery first, a timeout was already recovered by the queue.
+ * Failures but a full queue check the device configuration, a device that browns out stops
+ * acknowledging. The register accesses of a recovery are not retried themselves.
+ * @param   hmpu: Pointer to MPU6050 handle
+ * @param   op: Transaction direction
+ * @param   reg_address: Address of first register
+ * @param   pdata: Pointer to data buffer
+ * @param   data_amount: Amount of data to read
+ * @param   status: Status of the failed access
+ * @retval  mpu6050_status_t of the last attempt
+ */
+static mpu6050_status_t mpu6050_retry(mpu6050_t *hmpu, i2c_queue_op_t op, uint8_t reg_address,
+                                      uint8_t *pdata, uint16_t data_amount,
+                                      mpu6050_status_t status) {
+  if (hmpu->recovering)
+    return status;
+  uint64_t start_ns = i2c_timestamp_ns(hmpu->bus);
+  uint64_t budget_ns = (uint64_t)hmpu->i2c_timeout * 1000U;
+  hmpu->recovering = true;
+  for (uint8_t attempt = 1; attempt < MPU6050_RETRIES && status != MPU6050_OK; attempt++) {
+    if (i2c_timestamp_ns(hmpu->bus) - start_ns >= budget_ns)
+      break;
+    if (status == MPU6050_ERROR || status == MPU6050_ERROR_BUS ||
+        status == MPU6050_ERROR_OVERRUN) {
+      i2c_queue_recover(hmpu->bus);
+      hmpu->recovery.recoveries++;
+    }
+    if (status != MPU6050_ERROR_BUSY)
+      mpu6050_shadow_restore(hmpu);
+    hmpu->recovery.retries++;
+    status = mpu6050_transfer(hmpu, op, reg_address, pdata, data_amount);
+  }
+  hmpu->recovering = false;
+  if (status != MPU6050_OK)
+    hmpu->recovery.failures++;
+  mpu6050_recovery_account(hmpu, start_ns);
+  return status;
+}
+
+/**
+ * @brief   Read MPU9250 register
+ * @note    Configuration registers are served from the shadow while it is valid.
+ * @param   hmpu: Pointer to MPU6050 handle
+ * @param   reg_address: Address of register to read
+ * @param   pdata: Pointer to buffer where value will be stored
+ * @retval  mpu6050_status_t
+ */
+static mpu6050_status_t mpu6050_reg_read(mpu6050_t *hmpu, uint8_t reg_address, uint8_t *pdata) {
+  uint8_t *pshadow = mpu6050_shadow_reg(hmpu, reg_address);
+  if (hmpu->shadow.valid && pshadow != NULL) {
+    *pdata = *pshadow;
+    mpu6050_stats_shadow_hit(hmpu);
+    return MPU6050_OK;
+  }
+
+  /* MPU6050 register read wrapper */
+  uint32_t start = mpu6050_stats_ticks(hmpu);
+  mpu6050_status_t status = mpu6050_transfer(hmpu, I2C_QUEUE_READ, reg_address, pdata, 1);
+  if (status != MPU6050_OK)
+    status = mpu6050_retry(hmpu, I2C_QUEUE_READ, reg_address, pdata, 1, status);
+  mpu6050_stats_record(hmpu, MPU6050_XFER_REG_READ, 1, status, start);
+  return status;
+}
+
+/**
+ * @brief   Burst read MPU6050 registers
+ * @param   hmpu: Pointer to MPU6050 handle
+ * @param   reg_address: Address of first register to read
+ * @param   pdata: Pointer to buffer where data will be stored
+ * @param   data_amount: Amount of data to read
+ * @retval  mpu6050_status_t
+ */
+static mpu6050_status_t mpu6050_burst_read(mpu6050_t *hmpu, uint8_t reg_address, uint8_t *pdata,
+                                           uint16_t data_amount) {
+  /* MPU6050 register read wrapper */
+  uint32_t start = mpu6050_stats_ticks(hmpu);
+  mpu6050_status_t status =
+      mpu6050_transfer(hmpu, I2C_QUEUE_READ, reg_address, pdata, data_amount);
+  if (status != MPU6050_OK)
+    status = mpu6050_retry(hmpu, I2C_QUEUE_READ, reg_address, pdata, data_amount, status);
+  mpu6050_stats_record(hmpu, MPU6050_XFER_BURST_READ, data_amount, status, start);
+  return status;
+}
+
+/**
+ * @brief   Burst write MPU6050 registers
+ * @note    The shadow is updated when the write succeeds. A device reset invalidates it.
+ * @param   hmpu: Pointer to MPU6050 handle
+ * @param   reg_address: Address of first register to write
+ * @param   pdata: Pointer to buffer with values to write
+ * @param   data_amount: Amount of data to write
+ * @retval  mpu6050_status_t
+ */
+static mpu6050_status_t mpu6050_burst_write(mpu6050_t *hmpu, uint8_t reg_address, uint8_t *pdata,
+                                            uint16_t data_amount) {
+  /* MPU6050 register write wrapper */
+  uint32_t start = mpu6050_stats_ticks(hmpu);
+  mpu6050_status_t status =
+      mpu6050_transfer(hmpu, I2C_QUEUE_WRITE, reg_address, pdata, data_amount);
+  if (status != MPU6050_OK)
+    status = mpu6050_retry(hmpu, I2C_QUEUE_WRITE, reg_address, pdata, data_amount, status);
+  mpu6050_stats_record(hmpu, MPU6050_XFER_REG_WRITE, data_amount, status, start);
+  if (status != MPU6050_OK)
+    return status;
+
+  for (uint16_t i = 0; i < data_amount; i++) {
+    uint8_t address = (uint8_t)(reg_address + i);
+    uint8_t *pshadow = mpu6050_shadow_reg(hmpu, address);
+    if (pshadow == NULL)
+      continue;
+    *pshadow = pdata[i];
+    if (address == MPU6050_USER_CTRL)
+      *pshadow &= ~MPU6050_USER_CTRL_RESET_MASK;
+    if (address == MPU6050_PWR_MGMT_1 && (pdata[i] & (1U << MPU6050_PWR1_DEVICE_RESET_OFFSET)))
+      hmpu->shadow.valid = false;
+  }
+  return MPU6050_OK;
+}
+
+/**
+ * @brief   Write MPU6050 register
+ * @param   hmpu: Pointer to MPU6050 handle
+ * @param   reg_address: Address of register to write
+ * @param   pdata: Pointer to buffer with value to write
+ * @retval  mpu6050_status_t
+ */
+static mpu6050_status_t mpu6050_reg_write(mpu6050_t *hmpu, uint8_t reg_address, uint8_t *pdata) {
+  return mpu6050_burst_write(hmpu, reg_address, pdata, 1);
+}
+
+static void mpu6050_sched_next(mpu6050_sched_t *psched);
+
+/**
+ * @brief   Completion of a non-blocking read
+ * @note    A failed read while streaming is dropped as a sample with no free slot, and the
+ * acquisition goes on. Otherwise data ready is not signaled.
+ * @param   pcontext: Pointer to MPU6050 handle
+ * @param   status: Completion status
+ */
+static void mpu6050_read_complete(void *pcontext, mpu6050_status_t status) {
+  mpu6050_t *hmpu = pcontext;
+  mpu6050_stats_complete(hmpu, status);
+  if (status == MPU6050_OK || hmpu->pstream_ring != NULL) {
+    if (status != MPU6050_OK)
+      hmpu->pstream_slot = NULL;
+    mpu6050_rxcallback(hmpu);
+    return;
+  }
+  hmpu->read_in_flight = false;
+  if (hmpu->psched != NULL)
+    mpu6050_sched_next(hmpu->psched);
+}
+
+/**
+ * @brief   MPU-6050 Non-blocking burst read
+ * @note    Queued as a sample read, ahead of housekeeping transactions on the bus. The handle is
+ * given back to mpu6050_rxcallback on completion.
+ * @param   hmpu: Pointer to MPU6050 handle
+ * @param   reg_address: Address of first register to read
+ * @param   pdata: Pointer to buffer where received data will be stored
+ * @retval  mpu6050_status_t
+ */
+static mpu6050_status_t mpu6050_nonblocking_read(mpu6050_t *hmpu, uint8_t reg_address,
+                                                 uint8_t *pdata, uint16_t data_amount) {
+  /* MPU6050 non-blocking register read wrapper */
+  i2c_transaction_t transaction = {
+      .op = I2C_QUEUE_READ,
+      .priority = I2C_QUEUE_PRIO_SAMPLE,
+      .slave_address = (uint16_t)hmpu->address << 1,
+      .reg_address = reg_address,
+      .pdata = pdata,
+      .data_amount = data_amount,
+      .callback = mpu6050_read_complete,
+      .pcontext = hmpu,
+  };
+  hmpu->read_in_flight = true;
+  mpu6050_stats_submit(hmpu, data_amount);
+  mpu6050_status_t status = i2c_queue_submit(hmpu->bus, &transaction);
+  if (status != MPU6050_OK) {
+    hmpu->read_in_flight = false;
+    mpu6050_stats_complete(hmpu, status);
+    return status;
+  }
+  return MPU6050_OK;
+}
+
+/**
+ * @brief   Decode a burst of output registers into a sample
+ * @param   praw: Pointer to MPU6050_SENSOR_DATA_LEN bytes read from ACCEL_XOUT_H
+ * @param   psample: Pointer to sample where measurements will be stored
+ */
+static void mpu6050_decode_sample(const uint8_t *praw, mpu6050_sample_t *psample) {
+  psample->accel[0] = (praw[0] << 8) | praw[1];
+  psample->accel[1] = (praw[2] << 8) | praw[3];
+  psample->accel[2] = (praw[4] << 8) | praw[5];
+  psample->temp = (praw[6] << 8) | praw[7];
+  psample->gyro[0] = (praw[8] << 8) | praw[9];
+  psample->gyro[1] = (praw[10] << 8) | praw[11];
+  psample->gyro[2] = (praw[12] << 8) | praw[13];
+}
+
+/**
+ * @brief   Attach a timestamp to the last sample and update the interval statistics
+ * @param   hmpu: Pointer to MPU6050 handle
+ * @param   timestamp_ns: Port time of the sample
+ */
+static void mpu6050_timestamp_update(mpu6050_t *hmpu, uint64_t timestamp_ns) {
+  mpu6050_timing_t *ptiming = &hmpu->timing;
+  if (ptiming->samples > 0) {
+    uint64_t elapsed = timestamp_ns - ptiming->last_ns;
+    uint32_t interval = (elapsed > UINT32_MAX) ? UINT32_MAX : (uint32_t)elapsed;
+    if (ptiming->samples == 1) {
+      ptiming->mean_ns = interval;
+      ptiming->jitter_ns = 0;
+      ptiming->min_ns = interval;
+      ptiming->max_ns = interval;
+    } else {
+      int64_t deviation = (int64_t)interval - ptiming->mean_ns;
+      uint32_t abs_deviation = (uint32_t)((deviation < 0) ? -deviation : deviation);
+      ptiming->mean_ns = (uint32_t)(ptiming->mean_ns + (deviation >> MPU6050_TIMING_EWMA_SHIFT));
+      ptiming->jitter_ns = (uint32_t)(ptiming->jitter_ns +
+                                      (((int64_t)abs_deviation - ptiming->jitter_ns) >>
+                                       MPU6050_TIMING_EWMA_SHIFT));
+      if (interval < ptiming->min_ns)
+        ptiming->min_ns = interval;
+      if (interval > ptiming->max_ns)
+        ptiming->max_ns = interval;
+    }
+  }
+  ptiming->samples++;
+  ptiming->last_ns = timestamp_ns;
+  hmpu->timestamp_ns = timestamp_ns;
+}
+
+/**
+ * @brief   Offset in the non-blocking buffer of a measurement register
+ * @note    The buffer mirrors the output registers, so gyro, accel and temperature fetches do not
+ * overwrite each other.
+ */
+#define MPU6050_RXBUFFER_OFFSET(reg_address) ((reg_address)-MPU6050_ACCEL_XOUT_H)
+
+/**
+ * @brief   Start the streaming read of the next sample
+ * @note    When the ring is full the sample is read into a scratch buffer and dropped, so the
+ * acquisition keeps its pace.
+ * @param   hmpu: Pointer to MPU6050 handle
+ * @retval  mpu6050_status_t
+ */
+static mpu6050_status_t mpu6050_stream_arm(mpu6050_t *hmpu) {
+  hmpu->pstream_slot = mpu6050_ring_acquire(hmpu->pstream_ring);
+  uint8_t *ptarget = (hmpu->pstream_slot != NULL) ? hmpu->pstream_slot->raw : hmpu->stream_scratch;
+  return mpu6050_nonblocking_read(hmpu, MPU6050_ACCEL_XOUT_H, ptarget, MPU6050_SENSOR_DATA_LEN);
+}
+
+/**
+ * @brief   Detach the ring from a device
+ * @param   hmpu: Pointer to MPU6050 handle
+ */
+static void mpu6050_stream_detach(mpu6050_t *hmpu) {
+  hmpu->stream_active = false;
+  hmpu->pstream_slot = NULL;
+  hmpu->pstream_ring = NULL;
+}
+
+/**
+ * @brief   Start the scheduled read of a device
+ * @note    Devices with a ring attached read into their next ring slot, the others into their
+ * non-blocking buffer.
+ * @param   hmpu: Pointer to MPU6050 handle
+ * @retval  mpu6050_status_t
+ */
+static mpu6050_status_t mpu6050_sched_read(mpu6050_t *hmpu) {
+  if (hmpu->stream_active)
+    return mpu6050_stream_arm(hmpu);
+  return mpu6050_fetch_all(hmpu);
+}
+
+/**
+ * @brief   Chain the read of the next device on the bus
+ * @param   psched: Pointer to bus scheduler
+ */
+static void mpu6050_sched_next(mpu6050_sched_t *psched) {
+  if (!psched->active)
+    return;
+
+  /* A device that fails to start is skipped, so one faulty sensor does not stall the bus */
+  for (uint8_t attempt = 0; attempt < psched->count; attempt++) {
+    psched->current++;
+    if (psched->current >= psched->count) {
+      psched->current = 0;
+      psched->rounds++;
+    }
+    if (mpu6050_sched_read(psched->pdevices[psched->current]) == MPU6050_OK)
+      return;
+  }
+  psched->active = false;
+}
+
+/**
+ * @brief   MPU6050 callback for data ready
+ * @note    While streaming, the sample is published into the ring. The next read of the same
+ * device, or of the next scheduled device on the bus, is started from here.
+ * @param   hmpu: Pointer to MPU6050 handle of the completed read
+ */
+void mpu6050_rxcallback(mpu6050_t *hmpu) {
+  assert(hmpu);
+  /* With DATA_RDY acquisition the sample time was taken at the interrupt */
+  if (!hmpu->drdy_active)
+    mpu6050_timestamp_update(hmpu, i2c_timestamp_ns(hmpu->bus));
+  hmpu->read_in_flight = false;
+  if (hmpu->pstream_ring == NULL) {
+    hmpu->data_ready = true;
+  } else {
+    if (hmpu->pstream_slot != NULL) {
+      mpu6050_decode_sample(hmpu->pstream_slot->raw, &hmpu->pstream_slot->sample);
+      hmpu->pstream_slot->timestamp_ns = hmpu->timestamp_ns;
+      mpu6050_ring_commit(hmpu->pstream_ring);
+    } else {
+      mpu6050_ring_drop(hmpu->pstream_ring);
+    }
+    if (!hmpu->stream_active)
+      mpu6050_stream_detach(hmpu);
+  }
+
+  if (hmpu->psched != NULL) {
+    mpu6050_sched_next(hmpu->psched);
+    return;
+  }
+
+  /* With DATA_RDY acquisition the next read is started by the interrupt */
+  if (hmpu->drdy_active)
+    return;
+
+  if (hmpu->stream_active && mpu6050_stream_arm(hmpu) != MPU6050_OK)
+    mpu6050_stream_detach(hmpu);
+}
+
+/**
+ * @brief   MPU6050 callback for INT pin interrupt
+ * @note    Called by the port layer from the INT pin interrupt. With DATA_RDY acquisition active
+ * the burst read of the new sample is started right away, into the next ring slot or into the
+ * non-blocking buffer. An interrupt while the previous read is still in flight is counted as
+ * missed. With motion wake-up active the interrupt is only flagged as motion.
+ * @param   hmpu: Pointer to MPU6050 handle
+ */
+void mpu6050_int_callback(mpu6050_t *hmpu) {
+  assert(hmpu);
+  /* Motion wake-up only signals the event, the host decides what to read */
+  if (hmpu->motion_active) {
+    hmpu->motion_events++;
+    hmpu->motion_detected = true;
+    return;
+  }
+  if (!hmpu->drdy_active)
+    return;
+  uint64_t timestamp_ns = i2c_timestamp_ns(hmpu->bus);
+  hmpu->drdy_edges++;
+  if (hmpu->read_in_flight) {
+    hmpu->drdy_missed++;
+    return;
+  }
+
+  mpu6050_timestamp_update(hmpu, timestamp_ns);
+
+  mpu6050_status_t status;
+  if (hmpu->stream_active)
+    status = mpu6050_stream_arm(hmpu);
+  else
+    status = mpu6050_fetch_all(hmpu);
+  if (status != MPU6050_OK)
+    hmpu->drdy_missed++;
+}
+
+/**
+ * @brief   Configure the INT pin
+ * @param   hmpu: Pointer to MPU6050 handle
+ * @param   pconfig: Pointer to INT pin configuration
+ * @retval  mpu6050_status_t
+ */
+mpu6050_status_t mpu6050_int_config(mpu6050_t *hmpu, const mpu6050_int_config_t *pconfig) {
+  assert(pconfig);
+  uint8_t reg_value;
+  if (mpu6050_reg_read(hmpu, MPU6050_INT_PIN_CFG, &reg_value) != MPU6050_OK)
+    return MPU6050_ERROR;
+
+  reg_value &= ~((1U << MPU6050_INT_LEVEL_OFFSET) | (1U << MPU6050_INT_OPEN_OFFSET) |
+                 (1U << MPU6050_LATCH_INT_EN_OFFSET) | (1U << MPU6050_INT_RD_CLEAR_OFFSET));
+  reg_value |= (pconfig->active_low << MPU6050_INT_LEVEL_OFFSET);
+  reg_value |= (pconfig->open_drain << MPU6050_INT_OPEN_OFFSET);
+  reg_value |= (pconfig->latch << MPU6050_LATCH_INT_EN_OFFSET);
+  reg_value |= (pconfig->clear_on_read << MPU6050_INT_RD_CLEAR_OFFSET);
+  if (mpu6050_reg_write(hmpu, MPU6050_INT_PIN_CFG, &reg_value) != MPU6050_OK)
+    return MPU6050_ERROR;
+  return MPU6050_OK;
+}
+
+/**
+ * @brief   Enable interrupt sources
+ * @param   hmpu: Pointer to MPU6050 handle
+ * @param   int_mask: Bitmask of mpu6050_int_t with the sources to enable, the rest are disabled
+ * @retval  mpu6050_status_t
+ */
+mpu6050_status_t mpu6050_int_enable(mpu6050_t *hmpu, uint8_t int_mask) {
+  if (mpu6050_reg_write(hmpu, MPU6050_INT_ENABLE, &int_mask) != MPU6050_OK)
+    return MPU6050_ERROR;
+  return MPU6050_OK;
+}
+
+/**
+ * @brief   Read and clear interrupt status
+ * @param   hmpu: Pointer to MPU6050 handle
+ * @param   pstatus: Pointer to buffer where the bitmask of mpu6050_int_t will be stored
+ * @retval  mpu6050_status_t
+ */
+mpu6050_status_t mpu6050_int_read_status(mpu6050_t *hmpu, uint8_t *pstatus) {
+  assert(pstatus);
+  if (mpu6050_reg_read(hmpu, MPU6050_INT_STATUS, pstatus) != MPU6050_OK)
+    return MPU6050_ERROR;
+  return MPU6050_OK;
+}
+
+/**
+ * @brief   Start DATA_RDY interrupt driven acquisition
+ * @note    Each new sample is read once, right after its conversion. The INT pin must be
+ * configured with mpu6050_int_config. Samples go into the ring, or into the non-blocking buffer
+ * signaled through mpu6050_is_data_ready if no ring is given. A latched INT pin must be cleared
+ * on read: the sample burst does not read INT_STATUS, so the pin would stay asserted after the
+ * first sample.
+ * @param   hmpu: Pointer to MPU6050 handle
+ * @param   int_line: Port interrupt line wired to the INT pin
+ * @param   pring: Pointer to initialized ring, NULL to use the non-blocking buffer
+ * @retval  mpu6050_status_t
+ */
+mpu6050_status_t mpu6050_drdy_start(mpu6050_t *hmpu, uint32_t int_line, mpu6050_ring_t *pring) {
+  assert(hmpu);
+  if (hmpu->drdy_active || hmpu->motion_active || hmpu->pstream_ring != NULL ||
+      hmpu->psched != NULL)
+    return MPU6050_ERROR;
+
+  uint8_t int_pin_cfg;
+  uint8_t int_enable;
+  if (mpu6050_reg_read(hmpu, MPU6050_INT_PIN_CFG, &int_pin_cfg) != MPU6050_OK ||
+      mpu6050_reg_read(hmpu, MPU6050_INT_ENABLE, &int_enable) != MPU6050_OK)
+    return MPU6050_ERROR;
+  if ((int_pin_cfg & (1U << MPU6050_LATCH_INT_EN_OFFSET)) &&
+      !(int_pin_cfg & (1U << MPU6050_INT_RD_CLEAR_OFFSET)))
+    return MPU6050_ERROR;
+
+  hmpu->drdy_edges = 0;
+  hmpu->drdy_missed = 0;
+  if (pring != NULL) {
+    hmpu->pstream_ring = pring;
+    hmpu->stream_active = true;
+  }
+  hmpu->drdy_active = true;
+  if (i2c_int_attach(hmpu->bus, int_line, hmpu) != MPU6050_OK ||
+      mpu6050_int_enable(hmpu, int_enable | MPU6050_INT_DATA_RDY) != MPU6050_OK) {
+    hmpu->drdy_active = false;
+    mpu6050_stream_detach(hmpu);
+    return MPU6050_ERROR;
+  }
+  hmpu->drdy_int_line = int_line;
+  return MPU6050_OK;
+}
+
+/**
+ * @brief   Stop DATA_RDY interrupt driven acquisition
+ * @note    The read in flight is still completed.
+ * @param   hmpu: Pointer to MPU6050 handle
+ * @retval  mpu6050_status_t
+ */
+mpu6050_status_t mpu6050_drdy_stop(mpu6050_t *hmpu) {
+  assert(hmpu);
+  if (!hmpu->drdy_active)
+    return MPU6050_ERROR;
+  hmpu->drdy_active = false;
+  hmpu->stream_active = false;
+  i2c_int_detach(hmpu->bus, hmpu->drdy_int_line);
+  if (!hmpu->read_in_flight)
+    mpu6050_stream_detach(hmpu);
+  uint8_t int_enable;
+  if (mpu6050_reg_read(hmpu, MPU6050_INT_ENABLE, &int_enable) != MPU6050_OK ||
+      mpu6050_int_enable(hmpu, int_enable & ~MPU6050_INT_DATA_RDY) != MPU6050_OK)
+    return MPU6050_ERROR;
+  return MPU6050_OK;
+}
+
+/**
+ * @brief   Start continuous acquisition of combined samples into a ring
+ * @note    Each DMA completion publishes a slot and starts the next read, so the bus stays busy
+ * without CPU polling. mpu6050_is_data_ready is not signaled while streaming. For a scheduled
+ * device the ring is only attached, reads are chained by the bus scheduler.
+ * @param   hmpu: Pointer to MPU6050 handle
+ * @param   pring: Pointer to initialized ring where samples will be published
+ * @retval  mpu6050_status_t
+ */
+mpu6050_status_t mpu6050_stream_start(mpu6050_t *hmpu, mpu6050_ring_t *pring) {
+  assert(hmpu);
+  assert(pring);
+  if (hmpu->pstream_ring != NULL)
+    return MPU6050_ERROR;
+  hmpu->pstream_ring = pring;
+  hmpu->stream_active = true;
+  if (hmpu->psched != NULL)
+    return MPU6050_OK;
+
+  if (mpu6050_stream_arm(hmpu) != MPU6050_OK) {
+    mpu6050_stream_detach(hmpu);
+    return MPU6050_ERROR;
+  }
+  return MPU6050_OK;
+}
+
+/**
+ * @brief   Stop continuous acquisition
+ * @note    The read in flight is still published, no new read is started.
+ * @param   hmpu: Pointer to MPU6050 handle
+ */
+void mpu6050_stream_stop(mpu6050_t *hmpu) {
+  assert(hmpu);
+  hmpu->stream_active = false;
+  if (hmpu->psched != NULL)
+    mpu6050_stream_detach(hmpu);
+}
+
+/**
+ * @brief   MPU6050 check for streaming in progress
+ * @param   hmpu: Pointer to MPU6050 handle
+ * @retval  bool
+ */
+bool mpu6050_is_streaming(mpu6050_t *hmpu) { return hmpu->pstream_ring != NULL; }
+
+/**
+ * @brief   Initialize a bus scheduler
+ * @param   psched: Pointer to bus scheduler
+ */
+void mpu6050_sched_init(mpu6050_sched_t *psched) {
+  assert(psched);
+  psched->count = 0;
+  psched->current = 0;
+  psched->active = false;
+  psched->rounds = 0;
+}
+
+/**
+ * @brief   Add a device to a bus scheduler
+ * @note    All the devices of a scheduler must share the same bus.
+ * @param   psched: Pointer to bus scheduler
+ * @param   hmpu: Pointer to initialized MPU6050 handle
+ * @retval  mpu6050_status_t
+ */
+mpu6050_status_t mpu6050_sched_add(mpu6050_sched_t *psched, mpu6050_t *hmpu) {
+  assert(psched);
+  assert(hmpu);
+  if (psched->active || hmpu->psched != NULL)
+    return MPU6050_ERROR;
+  if (psched->count >= MPU6050_SCHED_MAX_DEVICES)
+    return MPU6050_ERROR;
+  if (psched->count > 0 && psched->pdevices[0]->bus != hmpu->bus)
+    return MPU6050_ERROR;
+  psched->pdevices[psched->count++] = hmpu;
+  hmpu->psched = psched;
+  return MPU6050_OK;
+}
+
+/**
+ * @brief   Start round-robin acquisition of all the devices on the bus
+ * @note    Each completion starts the read of the next device, so the devices are sampled
+ * back-to-back without CPU polling.
+ * @param   psched: Pointer to bus scheduler
+ * @retval  mpu6050_status_t
+ */
+mpu6050_status_t mpu6050_sched_start(mpu6050_sched_t *psched) {
+  assert(psched);
+  if (psched->active || psched->count == 0)
+    return MPU6050_ERROR;
+  psched->current = 0;
+  psched->active = true;
+  if (mpu6050_sched_read(psched->pdevices[0]) != MPU6050_OK) {
+    psched->active = false;
+    return MPU6050_ERROR;
+  }
+  return MPU6050_OK;
+}
+
+/**
+ * @brief   Stop round-robin acquisition
+ * @note    The read in flight completes, no new read is started.
+ * @param   psched: Pointer to bus scheduler
+ */
+void mpu6050_sched_stop(mpu6050_sched_t *psched) {
+  assert(psched);
+  psched->active = false;
+}
+
+/**
+ * @brief   MPU6050 check for data ready
+ * @param   hmpu: Pointer to MPU6050 handle
+ * @retval  bool
+ */
+bool mpu6050_is_data_ready(mpu6050_t *hmpu) {
+  if (hmpu->data_ready) {
+    hmpu->data_ready = false;
+    return true;
+  }
+  return false;
+}
+
+/**
+ * @brief   Port time of the last sample
+ * @note    Taken at the DATA_RDY interrupt, or at the read completion otherwise.
+ * @param   hmpu: Pointer to MPU6050 handle
+ * @retval  Time in ns
+ */
+uint64_t mpu6050_read_timestamp(mpu6050_t *hmpu) { return hmpu->timestamp_ns; }
+
+/**
+ * @brief   Sample interval statistics
+ * @param   hmpu: Pointer to MPU6050 handle
+ * @param   ptiming: Pointer to buffer where the statistics will be stored
+ */
+void mpu6050_timing_read(mpu6050_t *hmpu, mpu6050_timing_t *ptiming) {
+  assert(ptiming);
+  *ptiming = hmpu->timing;
+}
+
+/**
+ * @brief   Reset sample interval statistics
+ * @param   hmpu: Pointer to MPU6050 handle
+ */
+void mpu6050_timing_reset(mpu6050_t *hmpu) { hmpu->timing = (mpu6050_timing_t){0}; }
+
+/**
+ * @brief   Set the retry budget of register accesses
+ * @note    Retries and recoveries of a failed access stop once the budget is spent, bounding the
+ * stall of a loop on a faulty bus. 0 disables the retries.
+ * @param   hmpu: Pointer to MPU6050 handle
+ * @param   budget_us: Time budget in us
+ */
+void mpu6050_set_retry_budget(mpu6050_t *hmpu, uint32_t budget_us) {
+  assert(hmpu);
+  hmpu->i2c_timeout = budget_us;
+}
+
+/**
+ * @brief   Recover the bus and the device configuration
+ * @note    A transaction in flight is aborted, a slave holding SDA is clocked out, the port
+ * re-initializes the peripheral, and the shadowed configuration is written back if the device
+ * was reset. Must not be called from a completion callback.
+ * @param   hmpu: Pointer to MPU6050 handle
+ * @retval  mpu6050_status_t
+ */
+mpu6050_status_t mpu6050_recover(mpu6050_t *hmpu) {
+  assert(hmpu);
+  uint64_t start_ns = i2c_timestamp_ns(hmpu->bus);
+  hmpu->recovering = true;
+  mpu6050_status_t status = i2c_queue_recover(hmpu->bus);
+  hmpu->recovery.recoveries++;
+  if (status == MPU6050_OK)
+    status = mpu6050_shadow_restore(hmpu);
+  hmpu->recovering = false;
+  mpu6050_recovery_account(hmpu, start_ns);
+  return status;
+}
+
+/**
+ * @brief   Fault recovery statistics
+ * @param   hmpu: Pointer to MPU6050 handle
+ * @param   precovery: Pointer to buffer where the statistics will be stored
+ */
+void mpu6050_recovery_read(mpu6050_t *hmpu, mpu6050_recovery_t *precovery) {
+  assert(precovery);
+  *precovery = hmpu->recovery;
+}
+
+/**
+ * @brief   Reset fault recovery statistics
+ * @param   hmpu: Pointer to MPU6050 handle
+ */
+void mpu6050_recovery_reset(mpu6050_t *hmpu) { hmpu->recovery = (mpu6050_recovery_t){0}; }
+
+/**
+ * @brief   Set the latency counter of the transaction statistics
+ * @note    Call after mpu6050_init. A cycle counter gives the best resolution, NULL goes back to
+ * the port time in ns. Reset the statistics after a change of counter.
+ * @param   hmpu: Pointer to MPU6050 handle
+ * @param   counter: Free-running 32-bit counter, NULL for the port time
+ */
+void mpu6050_stats_set_counter(mpu6050_t *hmpu, mpu6050_counter_t counter) {
+  assert(hmpu);
+#ifdef MPU6050_STATS
+  hmpu->stats_counter = counter;
+#else
+  (void)counter;
+#endif
+}
+
+/**
+ * @brief   Consistent copy of the transaction statistics
+ * @note    Lock-free, safe from the main loop while the completion interrupt updates: the copy is
+ * retried until no update ran across it.
+ * @param   hmpu: Pointer to MPU6050 handle
+ * @param   pstats: Pointer to buffer where the statistics will be stored
+ * @retval  mpu6050_status_t, error if the driver is built without MPU6050_STATS
+ */
+mpu6050_status_t mpu6050_stats_snapshot(mpu6050_t *hmpu, mpu6050_stats_t *pstats) {
+  assert(hmpu);
+  assert(pstats);
+#ifdef MPU6050_STATS
+  for (;;) {
+    uint32_t seq = __atomic_load_n(&hmpu->stats_seq, __ATOMIC_ACQUIRE);
+    if (seq & 1U)
+      continue;
+    *pstats = hmpu->stats;
+    __atomic_thread_fence(__ATOMIC_ACQUIRE);
+    if (__atomic_load_n(&hmpu->stats_seq, __ATOMIC_RELAXED) == seq)
+      return MPU6050_OK;
+  }
+#else
+  *pstats = (mpu6050_stats_t){0};
+  return MPU6050_ERROR;
+#endif
+}
+
+/**
+ * @brief   Reset the transaction statistics
+ * @param   hmpu: Pointer to MPU6050 handle
+ */
+void mpu6050_stats_reset(mpu6050_t *hmpu) {
+  assert(hmpu);
+#ifdef MPU6050_STATS
+  mpu6050_stats_begin(hmpu);
+  hmpu->stats = (mpu6050_stats_t){0};
+  mpu6050_stats_end(hmpu);
+#endif
+}
+
+/**
+ * @brief   Latency percentile from the statistics histogram
+ * @param   pstats: Pointer to statistics
+ * @param   kind: Transaction kind
+ * @param   percent: Percentile, 0 to 100
+ * @retval  Upper bound in ticks of the bucket holding the percentile, capped to the longest
+ * latency, 0 if there is no sample
+ */
+uint32_t mpu6050_stats_percentile(const mpu6050_stats_t *pstats, mpu6050_xfer_kind_t kind,
+                                  float percent) {
+  assert(pstats);
+  assert(kind < MPU6050_XFER_KINDS);
+  uint64_t total = 0;
+  for (uint8_t i = 0; i < MPU6050_STATS_BUCKETS; i++)
+    total += pstats->latency[kind][i];
+  if (total == 0)
+    return 0;
+
+  uint64_t rank = (uint64_t)((float)total * percent / 100.0f);
+  uint64_t count = 0;
+  for (uint8_t i = 0; i < MPU6050_STATS_BUCKETS - 1U; i++) {
+    count += pstats->latency[kind][i];
+    uint32_t bound = (uint32_t)((1ULL << i) - 1U);
+    if (count > rank)
+      return (bound < pstats->latency_max[kind]) ? bound : pstats->latency_max[kind];
+  }
+  return pstats->latency_max[kind];
+}
+
+/**
+ * @brief   Initialize MPU9250 device
+ * @note    Initializes the port bus and reads the configuration registers into the shadow, so the
+ * device must answer at the address. It is not reset, woken up or configured, see mpu6050_start.
+ * @param   hmpu: Pointer to MPU6050 handle
+ * @param   bus: Port I2C bus handle where the device is connected
+ * @param   address: I2C slave address of the device
+ * @retval  mpu6050_status_t
+ */
+mpu6050_status_t mpu6050_init(mpu6050_t *hmpu, void *bus, mpu6050_i2c_address_t address) {
+  assert(hmpu);
+  *hmpu = (mpu6050_t){0};
+  hmpu->bus = bus;
+  hmpu->address = address;
+  hmpu->i2c_timeout = MPU6050_RETRY_BUDGET_US;
+
+  /* I2C initialization */
+  if (i2c_init(bus) != MPU6050_OK)
+    return MPU6050_ERROR;
+  if (mpu6050_shadow_resync(hmpu) != MPU6050_OK)
+    return MPU6050_ERROR;
+  return MPU6050_OK;
+}
+
+/**
+ * @brief   Read the configuration registers shadow from the device
+ * @note    Needed only if the device configuration was changed behind the driver, e.g. after a
+ * power cycle or a device reset.
+ * @param   hmpu: Pointer to MPU6050 handle
+ * @retval  mpu6050_status_t
+ */
+mpu6050_status_t mpu6050_shadow_resync(mpu6050_t *hmpu) {
+  assert(hmpu);
+  uint8_t reg_value[4];
+  hmpu->shadow.valid = false;
+
+  if (mpu6050_burst_read(hmpu, MPU6050_SMPLRT_DIV, reg_value, 4) != MPU6050_OK)
+    return MPU6050_ERROR;
+  hmpu->shadow.smplrt_div = reg_value[0];
+  hmpu->shadow.config = reg_value[1];
+  hmpu->shadow.gyro_config = reg_value[2];
+  hmpu->shadow.accel_config = reg_value[3];
+
+  if (mpu6050_burst_read(hmpu, MPU6050_FIFO_EN, reg_value, 1) != MPU6050_OK)
+    return MPU6050_ERROR;
+  hmpu->shadow.fifo_en = reg_value[0];
+
+  if (mpu6050_burst_read(hmpu, MPU6050_INT_PIN_CFG, reg_value, 2) != MPU6050_OK)
+    return MPU6050_ERROR;
+  hmpu->shadow.int_pin_cfg = reg_value[0];
+  hmpu->shadow.int_enable = reg_value[1];
+
+  if (mpu6050_burst_read(hmpu, MPU6050_USER_CTRL, reg_value, 3) != MPU6050_OK)
+    return MPU6050_ERROR;
+  hmpu->shadow.user_ctrl = reg_value[0] & ~MPU6050_USER_CTRL_RESET_MASK;
+  hmpu->shadow.pwr_mgmt_1 = reg_value[1];
+  hmpu->shadow.pwr_mgmt_2 = reg_value[2];
+
+  hmpu->shadow.valid = true;
+  return MPU6050_OK;
+}
+
+/**
+ * @brief   Load the shadow with the register values after a device reset
+ * @param   hmpu: Pointer to MPU6050 handle
+ * @param   pwr_mgmt_1: PWR_MGMT_1 value read after the reset
+ */
+static void mpu6050_shadow_default(mpu6050_t *hmpu, uint8_t pwr_mgmt_1) {
+  hmpu->shadow = (mpu6050_shadow_t){0};
+  hmpu->shadow.pwr_mgmt_1 = pwr_mgmt_1;
+  hmpu->shadow.valid = true;
+}
+
+/**
+ * @brief   Wait for the device reset to complete
+ * @note    The device does not acknowledge while it resets, the polls are not retried. The reset
+ * is complete once PWR_MGMT_1 reads back with DEVICE_RESET cleared.
+ * @param   hmpu: Pointer to MPU6050 handle
+ * @param   timeout_us: Time limit of the wait
+ * @retval  mpu6050_status_t, MPU6050_ERROR_TIMEOUT if the time limit expired
+ */
+static mpu6050_status_t mpu6050_wait_reset(mpu6050_t *hmpu, uint32_t timeout_us) {
+  uint64_t start_ns = i2c_timestamp_ns(hmpu->bus);
+  for (;;) {
+    uint8_t pwr_mgmt_1;
+    if (mpu6050_transfer(hmpu, I2C_QUEUE_READ, MPU6050_PWR_MGMT_1, &pwr_mgmt_1, 1) ==
+            MPU6050_OK &&
+        !(pwr_mgmt_1 & (1U << MPU6050_PWR1_DEVICE_RESET_OFFSET))) {
+      mpu6050_shadow_default(hmpu, pwr_mgmt_1);
+      return MPU6050_OK;
+    }
+    if (i2c_timestamp_ns(hmpu->bus) - start_ns >= (uint64_t)timeout_us * 1000U)
+      return MPU6050_ERROR_TIMEOUT;
+  }
+}
+
+/**
+ * @brief   Wait for the first sample after wake-up
+ * @note    Polls DATA_RDY in INT_STATUS, enabled for the wait if it is not. The output registers
+ * hold a valid sample once it is set, whatever the gyro start-up time of the part.
+ * @param   hmpu: Pointer to MPU6050 handle
+ * @param   timeout_us: Time limit of the wait
+ * @retval  mpu6050_status_t, MPU6050_ERROR_TIMEOUT if the time limit expired
+ */
+static mpu6050_status_t mpu6050_wait_data(mpu6050_t *hmpu, uint32_t timeout_us) {
+  uint8_t int_enable;
+  if (mpu6050_reg_read(hmpu, MPU6050_INT_ENABLE, &int_enable) != MPU6050_OK)
+    return MPU6050_ERROR;
+  uint8_t wait_enable = int_enable | MPU6050_INT_DATA_RDY;
+  if (wait_enable != int_enable &&
+      mpu6050_reg_write(hmpu, MPU6050_INT_ENABLE, &wait_enable) != MPU6050_OK)
+    return MPU6050_ERROR;
+
+  mpu6050_status_t status = MPU6050_ERROR_TIMEOUT;
+  uint64_t start_ns = i2c_timestamp_ns(hmpu->bus);
+  do {
+    uint8_t int_status;
+    if (mpu6050_reg_read(hmpu, MPU6050_INT_STATUS, &int_status) != MPU6050_OK) {
+      status = MPU6050_ERROR;
+      break;
+    }
+    if (int_status & MPU6050_INT_DATA_RDY) {
+      status = MPU6050_OK;
+      break;
+    }
+  } while (i2c_timestamp_ns(hmpu->bus) - start_ns < (uint64_t)timeout_us * 1000U);
+
+  if (wait_enable != int_enable &&
+      mpu6050_reg_write(hmpu, MPU6050_INT_ENABLE, &int_enable) != MPU6050_OK)
+    return MPU6050_ERROR;
+  return status;
+}
+
+/**
+ * @brief   Bring the device up from a table of register writes and waits
+ * @note    Runs of writes to consecutive registers, in table order, go in a single burst write of
+ * up to MPU6050_INIT_BURST_MAX registers. Waits poll the device for the condition they wait for
+ * instead of a fixed delay. A device reset in the table loads the shadow with the reset values.
+ * @param   hmpu: Pointer to MPU6050 handle
+ * @param   psteps: Pointer to init table
+ * @param   count: Amount of steps
+ * @param   timeout_us: Time limit of every wait step
+ * @retval  mpu6050_status_t, MPU6050_ERROR_TIMEOUT if a wait step expired
+ */
+mpu6050_status_t mpu6050_init_table(mpu6050_t *hmpu, const mpu6050_init_step_t *psteps,
+                                    uint8_t count, uint32_t timeout_us) {
+  assert(hmpu);
+  assert(psteps);
+  uint8_t i = 0;
+  while (i < count) {
+    mpu6050_status_t status;
+    if (psteps[i].op == MPU6050_INIT_WAIT_RESET) {
+      status = mpu6050_wait_reset(hmpu, timeout_us);
+      i++;
+    } else if (psteps[i].op == MPU6050_INIT_WAIT_DATA) {
+      status = mpu6050_wait_data(hmpu, timeout_us);
+      i++;
+    } else {
+      uint8_t burst[MPU6050_INIT_BURST_MAX];
+      uint8_t length = 0;
+      while (i + length < count && length < MPU6050_INIT_BURST_MAX &&
+             psteps[i + length].op == MPU6050_INIT_WRITE &&
+             psteps[i + length].reg_address == (uint8_t)(psteps[i].reg_address + length)) {
+        burst[length] = psteps[i + length].value;
+        length++;
+      }
+      status = mpu6050_burst_write(hmpu, psteps[i].reg_address, burst, length);
+      i += length;
+    }
+    if (status != MPU6050_OK)
+      return status;
+  }
+  return MPU6050_OK;
+}
+
+/**
+ * @brief   Reset the device and bring it up to its first valid sample
+ * @note    Device reset, sampling configuration in one burst write from SMPLRT_DIV to
+ * ACCEL_CONFIG, wake-up on the X gyro PLL, then wait for the first sample. Other registers keep
+ * their reset values.
+ * @param   hmpu: Pointer to MPU6050 handle
+ * @param   gyro_fs: Gyro Full Scale
+ * @param   accel_fs: Accel Full Scale
+ * @param   dlpf: Digital Low Pass Filter
+ * @param   divider: Sample rate divider
+ * @retval  mpu6050_status_t
+ */
+mpu6050_status_t mpu6050_start(mpu6050_t *hmpu, mpu6050_gyroconfig_fs_t gyro_fs,
+                               mpu6050_accelconfig_fs_t accel_fs, mpu6050_dlpf_t dlpf,
+                               uint8_t divider) {
+  const mpu6050_init_step_t steps[] = {
+      MPU6050_INIT_REG(MPU6050_PWR_MGMT_1, 1U << MPU6050_PWR1_DEVICE_RESET_OFFSET),
+      MPU6050_INIT_WAIT(MPU6050_INIT_WAIT_RESET),
+      MPU6050_INIT_REG(MPU6050_SMPLRT_DIV, divider),
+      MPU6050_INIT_REG(MPU6050_CONFIG, (uint8_t)(dlpf << MPU6050_DLPF_CFG_OFFSET)),
+      MPU6050_INIT_REG(MPU6050_GYRO_CONFIG, (uint8_t)(gyro_fs << MPU6050_GYRO_FS_SEL_OFFSET)),
+      MPU6050_INIT_REG(MPU6050_ACCEL_CONFIG, (uint8_t)(accel_fs << MPU6050_ACCEL_FS_SEL_OFFSET)),
+      MPU6050_INIT_REG(MPU6050_PWR_MGMT_1, MPU6050_PWR1_CLKSEL_PLL_XGYRO),
+      MPU6050_INIT_WAIT(MPU6050_INIT_WAIT_DATA),
+  };
+  return mpu6050_init_table(hmpu, steps, sizeof(steps) / sizeof(steps[0]),
+                            MPU6050_INIT_TIMEOUT_US);
+}
+
+/**
+ * @brief   Read MPU6050 Power Management 1
+ * @param   hmpu: Pointer to MPU6050 handle
+ * @param   ppwrmgmt: Pointer to buffer where configuration will be stored
+ * @retval  mpu6050_status_t
+ */
+mpu6050_status_t mpu6050_read_pwrmgmt(mpu6050_t *hmpu, uint8_t *ppwrmgmt) {
+  assert(ppwrmgmt);
+  if (mpu6050_reg_read(hmpu, MPU6050_PWR_MGMT_1, &ppwrmgmt[0]) != MPU6050_OK)
+    return MPU6050_ERROR;
+  if (mpu6050_reg_read(hmpu, MPU6050_PWR_MGMT_2, &ppwrmgmt[1]) != MPU6050_OK)
+    return MPU6050_ERROR;
+  return MPU6050_OK;
+}
+
+/**
+ * @brief   Read MPU6050 Reset Power Management 1
+ * @param   hmpu: Pointer to MPU6050 handle
+ * @retval  mpu6050_status_t
+ */
+mpu6050_status_t mpu6050_reset_pwrmgmt(mpu6050_t *hmpu) {
+  uint8_t reg_value = 0x00;
+  if (mpu6050_reg_write(hmpu, MPU6050_PWR_MGMT_1, &reg_value) != MPU6050_OK)
+    return MPU6050_ERROR;
+  return MPU6050_OK;
+}
+
+/**
+ * @brief   Put accel and gyro axes into standby
+ * @note    The low power wake-up rate is kept.
+ * @param   hmpu: Pointer to MPU6050 handle
+ * @param   standby: Bitmask of mpu6050_standby_t with the axes in standby, the rest are enabled
+ * @retval  mpu6050_status_t
+ */
+mpu6050_status_t mpu6050_set_standby(mpu6050_t *hmpu, uint8_t standby) {
+  uint8_t reg_value;
+  if (mpu6050_reg_read(hmpu, MPU6050_PWR_MGMT_2, &reg_value) != MPU6050_OK)
+    return MPU6050_ERROR;
+  reg_value &= ~MPU6050_PWR2_STBY_MASK;
+  reg_value |= standby & MPU6050_PWR2_STBY_MASK;
+  if (mpu6050_reg_write(hmpu, MPU6050_PWR_MGMT_2, &reg_value) != MPU6050_OK)
+    return MPU6050_ERROR;
+  return MPU6050_OK;
+}
+
+/**
+ * @brief   Start accel only low power cycle mode
+ * @note    The device sleeps between single accel samples taken at the wake-up rate. Gyro axes
+ * go into standby, the temperature sensor is disabled and the clock source is the internal
+ * oscillator. DATA_RDY interrupts come at the wake-up rate. The power management registers are
+ * saved for mpu6050_cycle_stop.
+ * @param   hmpu: Pointer to MPU6050 handle
+ * @param   wake: Wake-up rate
+ * @retval  mpu6050_status_t
+ */
+mpu6050_status_t mpu6050_cycle_start(mpu6050_t *hmpu, mpu6050_lp_wake_t wake) {
+  if (hmpu->cycle_active)
+    return MPU6050_ERROR;
+  if (mpu6050_reg_read(hmpu, MPU6050_PWR_MGMT_1, &hmpu->cycle_pwr_mgmt[0]) != MPU6050_OK)
+    return MPU6050_ERROR;
+  if (mpu6050_reg_read(hmpu, MPU6050_PWR_MGMT_2, &hmpu->cycle_pwr_mgmt[1]) != MPU6050_OK)
+    return MPU6050_ERROR;
+  hmpu->cycle_active = true;
+
+  uint8_t reg_value = (uint8_t)(wake << MPU6050_PWR2_LP_WAKE_CTRL_OFFSET) | MPU6050_STBY_GYRO;
+  if (mpu6050_reg_write(hmpu, MPU6050_PWR_MGMT_2, &reg_value) != MPU6050_OK)
+    return MPU6050_ERROR;
+
+  reg_value = hmpu->cycle_pwr_mgmt[0];
+  reg_value &= ~((1U << MPU6050_PWR1_SLEEP_OFFSET) | MPU6050_PWR1_CLKSEL_MASK);
+  reg_value |= (1U << MPU6050_PWR1_CYCLE_OFFSET) | (1U << MPU6050_PWR1_TEMP_DIS_OFFSET);
+  if (mpu6050_reg_write(hmpu, MPU6050_PWR_MGMT_1, &reg_value) != MPU6050_OK)
+    return MPU6050_ERROR;
+  return MPU6050_OK;
+}
+
+/**
+ * @brief   Stop low power cycle mode
+ * @note    The clock source, temperature sensor and axis standby saved by mpu6050_cycle_start
+ * are restored. Nothing is written if cycle mode was not started.
+ * @param   hmpu: Pointer to MPU6050 handle
+ * @retval  mpu6050_status_t
+ */
+mpu6050_status_t mpu6050_cycle_stop(mpu6050_t *hmpu) {
+  if (!hmpu->cycle_active)
+    return MPU6050_OK;
+  uint8_t reg_value = hmpu->cycle_pwr_mgmt[0] & ~(1U << MPU6050_PWR1_CYCLE_OFFSET);
+  if (mpu6050_reg_write(hmpu, MPU6050_PWR_MGMT_1, &reg_value) != MPU6050_OK)
+    return MPU6050_ERROR;
+  if (mpu6050_reg_write(hmpu, MPU6050_PWR_MGMT_2, &hmpu->cycle_pwr_mgmt[1]) != MPU6050_OK)
+    return MPU6050_ERROR;
+  hmpu->cycle_active = false;
+  return MPU6050_OK;
+}
+
+/**
+ * @brief   Configure the motion detector
+ * @note    Motion is an accel axis over the threshold after the 5 Hz high pass filter, for the
+ * given duration. Output registers are not filtered.
+ * @param   hmpu: Pointer to MPU6050 handle
+ * @param   threshold_mg: Threshold in mg, 2 mg resolution, saturates at 510 mg
+ * @param   duration_ms: Duration in ms
+ * @retval  mpu6050_status_t
+ */
+mpu6050_status_t mpu6050_motion_config(mpu6050_t *hmpu, uint16_t threshold_mg,
+                                       uint8_t duration_ms) {
+  uint16_t threshold = threshold_mg / MPU6050_MOT_THR_MG_PER_LSB;
+  uint8_t reg_value = (threshold > UINT8_MAX) ? UINT8_MAX : (uint8_t)threshold;
+  if (mpu6050_reg_write(hmpu, MPU6050_MOT_THR, &reg_value) != MPU6050_OK)
+    return MPU6050_ERROR;
+  if (mpu6050_reg_write(hmpu, MPU6050_MOT_DUR, &duration_ms) != MPU6050_OK)
+    return MPU6050_ERROR;
+
+  if (mpu6050_reg_read(hmpu, MPU6050_ACCEL_CONFIG, &reg_value) != MPU6050_OK)
+    return MPU6050_ERROR;
+  reg_value &= ~MPU6050_ACCEL_HPF_MASK;
+  reg_value |= MPU6050_ACCEL_HPF_5HZ << MPU6050_ACCEL_HPF_OFFSET;
+  if (mpu6050_reg_write(hmpu, MPU6050_ACCEL_CONFIG, &reg_value) != MPU6050_OK)
+    return MPU6050_ERROR;
+  return MPU6050_OK;
+}
+
+/**
+ * @brief   Sleep in accel only cycle mode until motion is detected
+ * @note    No bus transaction while idle: the motion interrupt on the INT pin is signaled through
+ * mpu6050_is_motion_detected, and can wake the host. The detector is configured with
+ * mpu6050_motion_config and the INT pin with mpu6050_int_config.
+ * @param   hmpu: Pointer to MPU6050 handle
+ * @param   int_line: Port interrupt line wired to the INT pin
+ * @param   wake: Wake-up rate, motion is checked on each sample
+ * @retval  mpu6050_status_t
+ */
+mpu6050_status_t mpu6050_motion_wake_start(mpu6050_t *hmpu, uint32_t int_line,
+                                           mpu6050_lp_wake_t wake) {
+  assert(hmpu);
+  if (hmpu->motion_active || hmpu->drdy_active)
+    return MPU6050_ERROR;
+
+  hmpu->motion_detected = false;
+  hmpu->motion_events = 0;
+  hmpu->motion_active = true;
+  if (i2c_int_attach(hmpu->bus, int_line, hmpu) != MPU6050_OK) {
+    hmpu->motion_active = false;
+    return MPU6050_ERROR;
+  }
+  hmpu->motion_int_line = int_line;
+  hmpu->motion_int_enable = 0;
+  if (mpu6050_reg_read(hmpu, MPU6050_INT_ENABLE, &hmpu->motion_int_enable) != MPU6050_OK ||
+      mpu6050_int_enable(hmpu, (hmpu->motion_int_enable & ~MPU6050_INT_DATA_RDY) |
+                                   MPU6050_INT_MOTION) != MPU6050_OK ||
+      mpu6050_cycle_start(hmpu, wake) != MPU6050_OK) {
+    mpu6050_motion_wake_stop(hmpu);
+    return MPU6050_ERROR;
+  }
+  return MPU6050_OK;
+}
+
+/**
+ * @brief   Stop motion wake-up, back to the power and interrupt configuration before it started
+ * @note    The DATA_RDY interrupt removed by mpu6050_motion_wake_start is enabled again.
+ * @param   hmpu: Pointer to MPU6050 handle
+ * @retval  mpu6050_status_t
+ */
+mpu6050_status_t mpu6050_motion_wake_stop(mpu6050_t *hmpu) {
+  assert(hmpu);
+  if (!hmpu->motion_active)
+    return MPU6050_ERROR;
+  hmpu->motion_active = false;
+  i2c_int_detach(hmpu->bus, hmpu->motion_int_line);
+  uint8_t int_mask;
+  if (mpu6050_reg_read(hmpu, MPU6050_INT_ENABLE, &int_mask) != MPU6050_OK)
+    return MPU6050_ERROR;
+  int_mask &= ~MPU6050_INT_MOTION;
+  int_mask |= hmpu->motion_int_enable & MPU6050_INT_DATA_RDY;
+  if (mpu6050_int_enable(hmpu, int_mask) != MPU6050_OK)
+    return MPU6050_ERROR;
+  return mpu6050_cycle_stop(hmpu);
+}
+
+/**
+ * @brief   MPU6050 check for motion detected while in motion wake-up
+ * @note    With a latched INT pin, INT_STATUS is read when the event is consumed so the pin is
+ * released for the next motion interrupt.
+ * @param   hmpu: Pointer to MPU6050 handle
+ * @retval  bool
+ */
+bool mpu6050_is_motion_detected(mpu6050_t *hmpu) {
+  if (!hmpu->motion_detected)
+    return false;
+  hmpu->motion_detected = false;
+
+  uint8_t reg_value;
+  if (mpu6050_reg_read(hmpu, MPU6050_INT_PIN_CFG, &reg_value) == MPU6050_OK &&
+      (reg_value & (1U << MPU6050_LATCH_INT_EN_OFFSET)))
+    mpu6050_reg_read(hmpu, MPU6050_INT_STATUS, &reg_value);
+  return true;
+}
+
+/**
+ * @brief   Read current Gyro configuration
+ * @param   hmpu: Pointer to MPU6050 handle
+ * @param   pgyroconfig: Pointer to buffer where configuration will be stored
+ * @retval  mpu6050_status_t
+ */
+mpu6050_status_t mpu6050_gyro_read_config(mpu6050_t *hmpu, uint8_t *pgyroconfig) {
+  assert(pgyroconfig);
+  if (mpu6050_reg_read(hmpu, MPU6050_GYRO_CONFIG, pgyroconfig) != MPU6050_OK)
+    return MPU6050_ERROR;
+  return MPU6050_OK;
+}
+
+/**
+ * @brief   Read current Accel configuration
+ * @param   hmpu: Pointer to MPU6050 handle
+ * @param   paccelconfig: Pointer to buffer where configuration will be stored
+ * @retval  mpu6050_status_t
+ */
+mpu6050_status_t mpu6050_accel_read_config(mpu6050_t *hmpu, uint8_t *paccelconfig) {
+  assert(paccelconfig);
+  if (mpu6050_reg_read(hmpu, MPU6050_ACCEL_CONFIG, paccelconfig) != MPU6050_OK)
+    return MPU6050_ERROR;
+  return MPU6050_OK;
+}
+
+/**
+ * @brief   Gyro Full Scale selection
+ * @param   hmpu: Pointer to MPU6050 handle
+ * @param   GyroFullScale: Gyro Full Scale to set
+ * @retval  mpu6050_status_t
+ */
+mpu6050_status_t mpu6050_gyro_set_fullscale(mpu6050_t *hmpu,
+                                            mpu6050_gyroconfig_fs_t gyro_fullscale) {
+  uint8_t reg_value;
+  if (mpu6050_gyro_read_config(hmpu, &reg_value) != MPU6050_OK)
+    return MPU6050_ERROR;
+
+  reg_value &= ~(0b11 << MPU6050_GYRO_FS_SEL_OFFSET);
+  reg_value |= (gyro_fullscale << MPU6050_GYRO_FS_SEL_OFFSET);
+  if (mpu6050_reg_write(hmpu, MPU6050_GYRO_CONFIG, &reg_value) != MPU6050_OK)
+    return MPU6050_ERROR;
+  return MPU6050_OK;
+}
+
+/**
+ * @brief   Accel Full Scale selection
+ * @param   hmpu: Pointer to MPU6050 handle
+ * @param   accel_fullscale: Accel Full Scale to set
+ * @retval  mpu6050_status_t
+ */
+mpu6050_status_t mpu6050_accel_set_fullscale(mpu6050_t *hmpu,
+                                             mpu6050_accelconfig_fs_t accel_fullscale) {
+  uint8_t reg_value;
+  if (mpu6050_accel_read_config(hmpu, &reg_value) != MPU6050_OK)
+    return MPU6050_ERROR;
+
+  reg_value &= ~(0b11 << MPU6050_ACCEL_FS_SEL_OFFSET);
+  reg_value |= (accel_fullscale << MPU6050_ACCEL_FS_SEL_OFFSET);
+  if (mpu6050_reg_write(hmpu, MPU6050_ACCEL_CONFIG, &reg_value) != MPU6050_OK)
+    return MPU6050_ERROR;
+  return MPU6050_OK;
+}
+
+/**
+ * @brief   Digital Low Pass Filter selection
+ * @note    Filters other than MPU6050_DLPF_260HZ lower the gyro output rate to 1 kHz.
+ * @param   hmpu: Pointer to MPU6050 handle
+ * @param   dlpf: Filter to set
+ * @retval  mpu6050_status_t
+ */
+mpu6050_status_t mpu6050_set_dlpf(mpu6050_t *hmpu, mpu6050_dlpf_t dlpf) {
+  uint8_t reg_value;
+  if (mpu6050_reg_read(hmpu, MPU6050_CONFIG, &reg_value) != MPU6050_OK)
+    return MPU6050_ERROR;
+
+  reg_value &= ~(MPU6050_DLPF_CFG_MASK << MPU6050_DLPF_CFG_OFFSET);
+  reg_value |= (dlpf << MPU6050_DLPF_CFG_OFFSET);
+  if (mpu6050_reg_write(hmpu, MPU6050_CONFIG, &reg_value) != MPU6050_OK)
+    return MPU6050_ERROR;
+  return MPU6050_OK;
+}
+
+/**
+ * @brief   Sample rate divider selection
+ * @param   hmpu: Pointer to MPU6050 handle
+ * @param   divider: Sample rate is the gyro output rate / (1 + divider)
+ * @retval  mpu6050_status_t
+ */
+mpu6050_status_t mpu6050_set_sample_divider(mpu6050_t *hmpu, uint8_t divider) {
+  if (mpu6050_reg_write(hmpu, MPU6050_SMPLRT_DIV, &divider) != MPU6050_OK)
+    return MPU6050_ERROR;
+  return MPU6050_OK;
+}
+
+/**
+ * @brief   Current sample rate
+ * @param   hmpu: Pointer to MPU6050 handle
+ * @param   prate_hz: Pointer to buffer where the sample rate in Hz will be stored
+ * @retval  mpu6050_status_t
+ */
+mpu6050_status_t mpu6050_read_sample_rate(mpu6050_t *hmpu, float *prate_hz) {
+  uint8_t config;
+  uint8_t divider;
+  assert(prate_hz);
+  if (mpu6050_reg_read(hmpu, MPU6050_CONFIG, &config) != MPU6050_OK)
+    return MPU6050_ERROR;
+  if (mpu6050_reg_read(hmpu, MPU6050_SMPLRT_DIV, &divider) != MPU6050_OK)
+    return MPU6050_ERROR;
+
+  uint8_t dlpf_cfg = (config >> MPU6050_DLPF_CFG_OFFSET) & MPU6050_DLPF_CFG_MASK;
+  uint32_t gyro_rate = (dlpf_cfg == 0 || dlpf_cfg == 7) ? MPU6050_GYRO_RATE_DLPF_OFF
+                                                        : MPU6050_GYRO_RATE_DLPF_ON;
+  *prate_hz = (float)gyro_rate / (float)(1U + divider);
+  return MPU6050_OK;
+}
+
+/**
+ * @brief   Output data rate and bandwidth selection
+ * @note    The narrowest filter that keeps the requested bandwidth is selected. With bandwidth 0
+ *          the widest filter below the Nyquist frequency of the requested rate is selected.
+ *          Rates above 1 kHz require the 8 kHz gyro output rate, where the filter is disabled and
+ *          accel samples are repeated.
+ * @param   hmpu: Pointer to MPU6050 handle
+ * @param   odr_hz: Requested output data rate in Hz
+ * @param   bandwidth_hz: Requested gyro bandwidth in Hz, 0 for automatic selection
+ * @param   pachieved_hz: Pointer to buffer where the achieved rate will be stored, can be NULL
+ * @retval  mpu6050_status_t
+ */
+mpu6050_status_t mpu6050_set_odr(mpu6050_t *hmpu, float odr_hz, float bandwidth_hz,
+                                 float *pachieved_hz) {
+  /* Gyro bandwidth of each DLPF_CFG, Hz */
+  static const uint16_t gyro_bandwidth[] = {256, 188, 98, 42, 20, 10, 5};
+  if (odr_hz <= 0.0f)
+    return MPU6050_ERROR;
+
+  mpu6050_dlpf_t dlpf = MPU6050_DLPF_260HZ;
+  if (odr_hz <= (float)MPU6050_GYRO_RATE_DLPF_ON) {
+    for (uint8_t cfg = MPU6050_DLPF_5HZ; cfg > MPU6050_DLPF_260HZ; cfg--) {
+      bool fits = (bandwidth_hz > 0.0f) ? (gyro_bandwidth[cfg] >= bandwidth_hz)
+                                         : (gyro_bandwidth[cfg - 1] > odr_hz / 2.0f);
+      if (fits) {
+        dlpf = (mpu6050_dlpf_t)cfg;
+        break;
+      }
+    }
+  }
+
+  uint32_t gyro_rate =
+      (dlpf == MPU6050_DLPF_260HZ) ? MPU6050_GYRO_RATE_DLPF_OFF : MPU6050_GYRO_RATE_DLPF_ON;
+  float divider = (float)gyro_rate / odr_hz - 0.5f;
+  if (divider < 0.0f)
+    divider = 0.0f;
+  if (divider > 255.0f)
+    divider = 255.0f;
+
+  if (mpu6050_set_dlpf(hmpu, dlpf) != MPU6050_OK)
+    return MPU6050_ERROR;
+  if (mpu6050_set_sample_divider(hmpu, (uint8_t)divider) != MPU6050_OK)
+    return MPU6050_ERROR;
+  if (pachieved_hz != NULL)
+    return mpu6050_read_sample_rate(hmpu, pachieved_hz);
+  return MPU6050_OK;
+}
+
+/**
+ * @brief   Read three consecutive 16-bit offset registers
+ * @param   hmpu: Pointer to MPU6050 handle
+ * @param   reg_address: Address of the X-axis high byte
+ * @param   poffsets: Pointer to buffer where X, Y and Z offsets will be stored
+ * @retval  mpu6050_status_t
+ */
+static mpu6050_status_t mpu6050_offsets_read(mpu6050_t *hmpu, uint8_t reg_address,
+                                             int16_t *poffsets) {
+  uint8_t buffer[6];
+  assert(poffsets);
+  if (mpu6050_burst_read(hmpu, reg_address, buffer, sizeof(buffer)) != MPU6050_OK)
+    return MPU6050_ERROR;
+  for (uint8_t axis = 0; axis < 3; axis++)
+    poffsets[axis] = (int16_t)(((uint16_t)buffer[2 * axis] << 8) | buffer[2 * axis + 1]);
+  return MPU6050_OK;
+}
+
+/**
+ * @brief   Write three consecutive 16-bit offset registers
+ * @note    One burst write, the X, Y and Z offsets are updated in a single transaction.
+ * @param   hmpu: Pointer to MPU6050 handle
+ * @param   reg_address: Address of the X-axis high byte
+ * @param   poffsets: Pointer to X, Y and Z offsets
+ * @retval  mpu6050_status_t
+ */
+static mpu6050_status_t mpu6050_offsets_write(mpu6050_t *hmpu, uint8_t reg_address,
+                                              const int16_t *poffsets) {
+  uint8_t buffer[6];
+  for (uint8_t axis = 0; axis < 3; axis++) {
+    buffer[2 * axis] = (uint16_t)poffsets[axis] >> 8;
+    buffer[2 * axis + 1] = (uint16_t)poffsets[axis] & 0xFFU;
+  }
+  if (mpu6050_burst_write(hmpu, reg_address, buffer, sizeof(buffer)) != MPU6050_OK)
+    return MPU6050_ERROR;
+  return MPU6050_OK;
+}
+
+/**
+ * @brief   Read Gyro user offsets
+ * @note    Offsets are in +-1000 dps full scale counts, added to every measurement.
+ * @param   hmpu: Pointer to MPU6050 handle
+ * @param   poffsets: Pointer to buffer where X, Y and Z offsets will be stored
+ * @retval  mpu6050_status_t
+ */
+mpu6050_status_t mpu6050_gyro_read_offsets(mpu6050_t *hmpu, int16_t *poffsets) {
+  return mpu6050_offsets_read(hmpu, MPU6050_XG_OFFS_USRH, poffsets);
+}
+
+/**
+ * @brief   Write Gyro user offsets
+ * @param   hmpu: Pointer to MPU6050 handle
+ * @param   poffsets: Pointer to X, Y and Z offsets, +-1000 dps full scale counts
+ * @retval  mpu6050_status_t
+ */
+mpu6050_status_t mpu6050_gyro_write_offsets(mpu6050_t *hmpu, const int16_t *poffsets) {
+  assert(poffsets);
+  return mpu6050_offsets_write(hmpu, MPU6050_XG_OFFS_USRH, poffsets);
+}
+
+/**
+ * @brief   Read Accel offsets
+ * @note    Offsets are factory trimmed, in +-16g full scale counts. Bit 0 is reserved.
+ * @param   hmpu: Pointer to MPU6050 handle
+ * @param   poffsets: Pointer to buffer where X, Y and Z offsets will be stored
+ * @retval  mpu6050_status_t
+ */
+mpu6050_status_t mpu6050_accel_read_offsets(mpu6050_t *hmpu, int16_t *poffsets) {
+  return mpu6050_offsets_read(hmpu, MPU6050_XA_OFFS_H, poffsets);
+}
+
+/**
+ * @brief   Write Accel offsets
+ * @note    Bit 0 of each offset is ignored, the reserved bit of the device is kept.
+ * @param   hmpu: Pointer to MPU6050 handle
+ * @param   poffsets: Pointer to X, Y and Z offsets, +-16g full scale counts
+ * @retval  mpu6050_status_t
+ */
+mpu6050_status_t mpu6050_accel_write_offsets(mpu6050_t *hmpu, const int16_t *poffsets) {
+  int16_t offsets[3];
+  assert(poffsets);
+  if (mpu6050_accel_read_offsets(hmpu, offsets) != MPU6050_OK)
+    return MPU6050_ERROR;
+  for (uint8_t axis = 0; axis < 3; axis++)
+    offsets[axis] = (int16_t)(((uint16_t)poffsets[axis] & ~1U) | ((uint16_t)offsets[axis] & 1U));
+  return mpu6050_offsets_write(hmpu, MPU6050_XA_OFFS_H, offsets);
+}
+
+/**
+ * @brief   Raw Gyroscope Measurements
+ * @param   hmpu: Pointer to MPU6050 handle
+ * @param   pgyrox: Pointer to buffer where Gyro X-axis measurement will be stored
+ * @param   pgyroy: Pointer to buffer where Gyro Y-axis measurement will be stored
+ * @param   pgyroz: Pointer to buffer where Gyro Z-axis measurement will be stored
+ * @retval  mpu6050_status_t
+ */
+mpu6050_status_t mpu6050_gyro_read_raw(mpu6050_t *hmpu, uint16_t *pgyrox, uint16_t *pgyroy,
+                                       uint16_t *pgyroz) {
+  uint8_t reg_value[6];
+  if (mpu6050_burst_read(hmpu, MPU6050_GYRO_XOUT_H, reg_value, 6) != MPU6050_OK)
+    return MPU6050_ERROR;
+
+  *pgyrox = (reg_value[0] << 8) | reg_value[1];
+  *pgyroy = (reg_value[2] << 8) | reg_value[3];
+  *pgyroz = (reg_value[4] << 8) | reg_value[5];
+
+  return MPU6050_OK;
+}
+
+/**
+ * @brief   Fetch Gyro Measurements and load it into buffer
+ * @param   hmpu: Pointer to MPU6050 handle
+ * @retval  mpu6050_status_t
+ */
+mpu6050_status_t mpu6050_gyro_fetch(mpu6050_t *hmpu) {
+  if (mpu6050_nonblocking_read(hmpu, MPU6050_GYRO_XOUT_H,
+                               &hmpu->rxbuffer[MPU6050_RXBUFFER_OFFSET(MPU6050_GYRO_XOUT_H)],
+                               6) != MPU6050_OK)
+    return MPU6050_ERROR;
+  return MPU6050_OK;
+}
+
+/**
+ * @brief   Raw Gyroscope Measurements from buffer
+ * @param   hmpu: Pointer to MPU6050 handle
+ * @param   pgyrox: Pointer to buffer where Gyro X-axis measurement will be stored
+ * @param   pgyroy: Pointer to buffer where Gyro Y-axis measurement will be stored
+ * @param   pgyroz: Pointer to buffer where Gyro Z-axis measurement will be stored
+ * @retval  mpu6050_status_t
+ */
+mpu6050_status_t mpu6050_gyro_read_from_buffer(mpu6050_t *hmpu, uint16_t *pgyrox, uint16_t *pgyroy,
+                                               uint16_t *pgyroz) {
+  const uint8_t *pbuffer = &hmpu->rxbuffer[MPU6050_RXBUFFER_OFFSET(MPU6050_GYRO_XOUT_H)];
+  *pgyrox = (pbuffer[0] << 8) | pbuffer[1];
+  *pgyroy = (pbuffer[2] << 8) | pbuffer[3];
+  *pgyroz = (pbuffer[4] << 8) | pbuffer[5];
+
+  return MPU6050_OK;
+}
+
+/**
+ * @brief   Raw Accelerometer Measurements
+ * @param   hmpu: Pointer to MPU6050 handle
+ * @param   paccelx: Pointer to buffer where Accel X-axis measurement will be stored
+ * @param   paccely: Pointer to buffer where Accel Y-axis measurement will be stored
+ * @param   paccelz: Pointer to buffer where Accel Z-axis measurement will be stored
+ * @retval  mpu6050_status_t
+ */
+mpu6050_status_t mpu6050_accel_read_raw(mpu6050_t *hmpu, uint16_t *paccelx, uint16_t *paccely,
+                                        uint16_t *paccelz) {
+  uint8_t reg_value[6];
+  if (mpu6050_burst_read(hmpu, MPU6050_ACCEL_XOUT_H, reg_value, 6) != MPU6050_OK)
+    return MPU6050_ERROR;
+
+  *paccelx = (reg_value[0] << 8) | reg_value[1];
+  *paccely = (reg_value[2] << 8) | reg_value[3];
+  *paccelz = (reg_value[4] << 8) | reg_value[5];
+
+  return MPU6050_OK;
+}
+
+/**
+ * @brief   Fetch Accelerometer Measurements and load it into buffer
+ * @param   hmpu: Pointer to MPU6050 handle
+ * @retval  mpu6050_status_t
+ */
+mpu6050_status_t mpu6050_accel_fetch(mpu6050_t *hmpu) {
+  if (mpu6050_nonblocking_read(hmpu, MPU6050_ACCEL_XOUT_H,
+                               &hmpu->rxbuffer[MPU6050_RXBUFFER_OFFSET(MPU6050_ACCEL_XOUT_H)],
+                               6) != MPU6050_OK)
+    return MPU6050_ERROR;
+  return MPU6050_OK;
+}
 
 /**
- * @brief   Read MPU9250 register
- * @param   reg_address: Address of register to read
- * @param   pdata: Pointer to buffer where value will be stored
+ * @brief   Raw Accelerometer Measurements from buffer
+ * @param   hmpu: Pointer to MPU6050 handle
+ * @param   paccelx: Pointer to buffer where Accel X-axis measurement will be stored
+ * @param   paccely: Pointer to buffer where Accel Y-axis measurement will be stored
+ * @param   paccelz: Pointer to buffer where Accel Z-axis measurement will be stored
  * @retval  mpu6050_status_t
  */
-static mpu6050_status_t mpu6050_reg_read(uint8_t reg_address, uint8_t *pdata) {
-  /* MPU6050 register read wrapper */
-  return i2c_reg_read((uint16_t)hmpu1.address << 1, reg_address, pdata);
+mpu6050_status_t mpu6050_accel_read_from_buffer(mpu6050_t *hmpu, uint16_t *paccelx,
+                                                uint16_t *paccely, uint16_t *paccelz) {
+  const uint8_t *pbuffer = &hmpu->rxbuffer[MPU6050_RXBUFFER_OFFSET(MPU6050_ACCEL_XOUT_H)];
+  *paccelx = (pbuffer[0] << 8) | pbuffer[1];
+  *paccely = (pbuffer[2] << 8) | pbuffer[3];
+  *paccelz = (pbuffer[4] << 8) | pbuffer[5];
+
+  return MPU6050_OK;
 }
 
 /**
- * @brief   Burst read MPU6050 registers
- * @param   reg_address: Address of first register to read
- * @param   pdata: Pointer to buffer where data will be stored
- * @param   data_amount: Amount of data to read
+ * @brief   Temperature Measurement
+ * @param   hmpu: Pointer to MPU6050 handle
+ * @param   ptemp: Pointer to buffer where temperature measurement will be stored
  * @retval  mpu6050_status_t
  */
-static mpu6050_status_t mpu6050_burst_read(uint8_t reg_address, uint8_t *pdata,
-                                           uint16_t data_amount) {
-  /* MPU6050 register read wrapper */
-  return i2c_burst_read((uint16_t)hmpu1.address << 1, reg_address, pdata, data_amount);
+mpu6050_status_t mpu6050_temp_read_raw(mpu6050_t *hmpu, uint16_t *ptemp) {
+  uint8_t reg_value[6];
+  if (mpu6050_burst_read(hmpu, MPU6050_TEMP_OUT_H, reg_value, 2) != MPU6050_OK)
+    return MPU6050_ERROR;
+
+  *ptemp = (reg_value[0] << 8) | reg_value[1];
+
+  return MPU6050_OK;
 }
 
 /**
- * @brief   Write MPU6050 register
- * @param   reg_address: Address of register to write
- * @param   pdata: Pointer to buffer with value to write
+ * @brief   Fetch Temperature Measurements and load it into buffer
+ * @param   hmpu: Pointer to MPU6050 handle
  * @retval  mpu6050_status_t
  */
-static mpu6050_status_t mpu6050_reg_write(uint8_t reg_address, uint8_t *pdata) {
-  /* MPU6050 register write wrapper */
-  return i2c_reg_write((uint16_t)hmpu1.address << 1, reg_address, pdata);
+mpu6050_status_t mpu6050_temp_fetch(mpu6050_t *hmpu) {
+  if (mpu6050_nonblocking_read(hmpu, MPU6050_TEMP_OUT_H,
+                               &hmpu->rxbuffer[MPU6050_RXBUFFER_OFFSET(MPU6050_TEMP_OUT_H)],
+                               2) != MPU6050_OK)
+    return MPU6050_ERROR;
+  return MPU6050_OK;
 }
 
 /**
- * @brief   MPU-6050 Non-blocking burst read
- * @param   reg_address: Address of first register to read
- * @param   pdata: Pointer to buffer where received data will be stored
+ * @brief   Raw Temperature Measurements from buffer
+ * @param   hmpu: Pointer to MPU6050 handle
+ * @param   ptemp: Pointer to buffer where Temperature measurement will be stored
  * @retval  mpu6050_status_t
  */
-static mpu6050_status_t mpu6050_nonblocking_read(uint8_t reg_address, uint8_t *pdata,
-                                                 uint16_t data_amount) {
-  /* MPU6050 non-blocking register read wrapper */
-  return i2c_read_dma((uint16_t)hmpu1.address << 1, reg_address, pdata, data_amount);
+mpu6050_status_t mpu6050_temp_read_from_buffer(mpu6050_t *hmpu, uint16_t *ptemp) {
+  const uint8_t *pbuffer = &hmpu->rxbuffer[MPU6050_RXBUFFER_OFFSET(MPU6050_TEMP_OUT_H)];
+  *ptemp = (pbuffer[0] << 8) | pbuffer[1];
+  return MPU6050_OK;
 }
 
 /**
- * @brief   MPU6050 callback for data ready
+ * @brief   Raw Accelerometer, Temperature and Gyroscope Measurements
+ * @note    All the output registers are read in a single burst, so the three measurements belong
+ * to the same sample and only one I2C transaction is needed.
+ * @param   hmpu: Pointer to MPU6050 handle
+ * @param   psample: Pointer to sample where measurements will be stored
+ * @retval  mpu6050_status_t
  */
-void mpu6050_rxcallback(void) { data_ready_flag = true; }
+mpu6050_status_t mpu6050_read_all_raw(mpu6050_t *hmpu, mpu6050_sample_t *psample) {
+  assert(psample);
+  uint8_t reg_value[MPU6050_SENSOR_DATA_LEN];
+  if (mpu6050_burst_read(hmpu, MPU6050_ACCEL_XOUT_H, reg_value, MPU6050_SENSOR_DATA_LEN) !=
+      MPU6050_OK)
+    return MPU6050_ERROR;
+
+  mpu6050_timestamp_update(hmpu, i2c_timestamp_ns(hmpu->bus));
+  mpu6050_decode_sample(reg_value, psample);
+
+  return MPU6050_OK;
+}
 
 /**
- * @brief   MPU6050 check for data ready
- * @retval  bool
+ * @brief   Fetch Accelerometer, Temperature and Gyroscope Measurements and load it into buffer
+ * @note    External sensor data of the aux slaves is fetched in the same burst.
+ * @param   hmpu: Pointer to MPU6050 handle
+ * @retval  mpu6050_status_t
  */
-bool mpu6050_is_data_ready(void) {
-  if (data_ready_flag) {
-    data_ready_flag = false;
-    return true;
-  }
-  return false;
+mpu6050_status_t mpu6050_fetch_all(mpu6050_t *hmpu) {
+  if (mpu6050_nonblocking_read(hmpu, MPU6050_ACCEL_XOUT_H, hmpu->rxbuffer,
+                               MPU6050_SENSOR_DATA_LEN + mpu6050_aux_ext_len(hmpu)) != MPU6050_OK)
+    return MPU6050_ERROR;
+  return MPU6050_OK;
 }
 
 /**
- * @brief   Initialize MPU9250 device
+ * @brief   Raw Accelerometer, Temperature and Gyroscope Measurements from buffer
+ * @param   hmpu: Pointer to MPU6050 handle
+ * @param   psample: Pointer to sample where measurements will be stored
  * @retval  mpu6050_status_t
  */
-mpu6050_status_t mpu6050_init(void) {
-  /* I2C initialization */
-  hmpu1.address = MPU6050_I2C_ADDRESS_1;
-  hmpu1.i2c_timeout = 100;
-  if (i2c_init() != MPU6050_OK)
+mpu6050_status_t mpu6050_read_all_from_buffer(mpu6050_t *hmpu, mpu6050_sample_t *psample) {
+  assert(psample);
+  mpu6050_decode_sample(hmpu->rxbuffer, psample);
+  return MPU6050_OK;
+}
+
+/**
+ * @brief   Enable the auxiliary I2C master
+ * @note    Bypass mode is disabled. The master reads the aux slaves on every sample, DATA_RDY
+ * waits for the external sensor data and the data is shadowed until all of it is loaded, so the
+ * output and external sensor registers of a burst belong to the same sample.
+ * @param   hmpu: Pointer to MPU6050 handle
+ * @param   clock: Aux bus clock
+ * @retval  mpu6050_status_t
+ */
+mpu6050_status_t mpu6050_aux_master_enable(mpu6050_t *hmpu, mpu6050_aux_clock_t clock) {
+  if (mpu6050_aux_bypass(hmpu, false) != MPU6050_OK)
+    return MPU6050_ERROR;
+
+  uint8_t reg_value =
+      (1U << MPU6050_I2C_MST_WAIT_FOR_ES_OFFSET) | (clock & MPU6050_I2C_MST_CLK_MASK);
+  if (mpu6050_reg_write(hmpu, MPU6050_I2C_MST_CTRL, &reg_value) != MPU6050_OK)
+    return MPU6050_ERROR;
+  reg_value = 1U << MPU6050_I2C_MST_DELAY_ES_SHADOW_OFFSET;
+  if (mpu6050_reg_write(hmpu, MPU6050_I2C_MST_DELAY_CTRL, &reg_value) != MPU6050_OK)
+    return MPU6050_ERROR;
+
+  if (mpu6050_reg_read(hmpu, MPU6050_USER_CTRL, &reg_value) != MPU6050_OK)
+    return MPU6050_ERROR;
+  reg_value |= (1U << MPU6050_I2C_MST_EN);
+  if (mpu6050_reg_write(hmpu, MPU6050_USER_CTRL, &reg_value) != MPU6050_OK)
     return MPU6050_ERROR;
   return MPU6050_OK;
 }
 
 /**
- * @brief   Read MPU6050 Power Management 1
- * @param   ppwrmgmt: Pointer to buffer where configuration will be stored
+ * @brief   Disable the auxiliary I2C master
+ * @note    Slave configuration is kept, external sensor data is no longer updated.
+ * @param   hmpu: Pointer to MPU6050 handle
  * @retval  mpu6050_status_t
  */
-mpu6050_status_t mpu6050_read_pwrmgmt(uint8_t *ppwrmgmt) {
-  assert(ppwrmgmt);
-  if (mpu6050_reg_read(MPU6050_PWR_MGMT_1, &ppwrmgmt[0]) != MPU6050_OK)
+mpu6050_status_t mpu6050_aux_master_disable(mpu6050_t *hmpu) {
+  uint8_t reg_value;
+  if (mpu6050_reg_read(hmpu, MPU6050_USER_CTRL, &reg_value) != MPU6050_OK)
     return MPU6050_ERROR;
-  if (mpu6050_reg_read(MPU6050_PWR_MGMT_2, &ppwrmgmt[1]) != MPU6050_OK)
+  reg_value &= ~(1U << MPU6050_I2C_MST_EN);
+  if (mpu6050_reg_write(hmpu, MPU6050_USER_CTRL, &reg_value) != MPU6050_OK)
     return MPU6050_ERROR;
   return MPU6050_OK;
 }
 
 /**
- * @brief   Read MPU6050 Reset Power Management 1
+ * @brief   Switch the aux bus into bypass mode
+ * @note    In bypass mode the aux sensors are connected to the host bus and read by the host,
+ * one transaction per sensor. Enabling bypass disables the auxiliary I2C master.
+ * @param   hmpu: Pointer to MPU6050 handle
+ * @param   enable: Connect the aux bus to the host bus
  * @retval  mpu6050_status_t
  */
-mpu6050_status_t mpu6050_reset_pwrmgmt(void) {
-  uint8_t reg_value = 0x00;
-  if (mpu6050_reg_write(MPU6050_PWR_MGMT_1, &reg_value) != MPU6050_OK)
+mpu6050_status_t mpu6050_aux_bypass(mpu6050_t *hmpu, bool enable) {
+  if (enable && mpu6050_aux_master_disable(hmpu) != MPU6050_OK)
+    return MPU6050_ERROR;
+
+  uint8_t reg_value;
+  if (mpu6050_reg_read(hmpu, MPU6050_INT_PIN_CFG, &reg_value) != MPU6050_OK)
+    return MPU6050_ERROR;
+  reg_value &= ~(1U << MPU6050_BYPASS_EN_OFFSET);
+  reg_value |= (enable << MPU6050_BYPASS_EN_OFFSET);
+  if (mpu6050_reg_write(hmpu, MPU6050_INT_PIN_CFG, &reg_value) != MPU6050_OK)
     return MPU6050_ERROR;
   return MPU6050_OK;
 }
 
 /**
- * @brief   Read current Gyro configuration
- * @param   pgyroconfig: Pointer to buffer where configuration will be stored
+ * @brief   Configure an aux slave transferred on every sample
+ * @note    Read slaves load their data into the external sensor registers in slave order, right
+ * after the output registers, up to MPU6050_EXT_SENS_DATA_LEN bytes for all the slaves.
+ * @param   hmpu: Pointer to MPU6050 handle
+ * @param   slave: Slave 0 to 3
+ * @param   pslave: Pointer to slave configuration
  * @retval  mpu6050_status_t
  */
-mpu6050_status_t mpu6050_gyro_read_config(uint8_t *pgyroconfig) {
-  if (mpu6050_reg_read(MPU6050_GYRO_CONFIG, pgyroconfig) != MPU6050_OK)
+mpu6050_status_t mpu6050_aux_slave_config(mpu6050_t *hmpu, uint8_t slave,
+                                          const mpu6050_aux_slave_t *pslave) {
+  assert(pslave);
+  if (slave >= MPU6050_I2C_SLAVES || pslave->length > MPU6050_I2C_SLV_LEN_MASK)
+    return MPU6050_ERROR;
+  uint16_t ext_len = (uint16_t)(mpu6050_aux_ext_len(hmpu) - hmpu->aux_len[slave]);
+  if (ext_len + pslave->length > MPU6050_EXT_SENS_DATA_LEN)
+    return MPU6050_ERROR;
+
+  /* Slave is disabled while its registers are rewritten */
+  if (mpu6050_aux_slave_disable(hmpu, slave) != MPU6050_OK)
     return MPU6050_ERROR;
+
+  bool read = pslave->length > 0;
+  uint8_t offset = (uint8_t)(3U * slave);
+  uint8_t reg_value = (pslave->address & 0x7FU) | (read << MPU6050_I2C_SLV_RW_OFFSET);
+  if (mpu6050_reg_write(hmpu, MPU6050_I2C_SLV0_ADDR + offset, &reg_value) != MPU6050_OK)
+    return MPU6050_ERROR;
+  reg_value = pslave->reg_address;
+  if (mpu6050_reg_write(hmpu, MPU6050_I2C_SLV0_REG + offset, &reg_value) != MPU6050_OK)
+    return MPU6050_ERROR;
+  if (!read) {
+    reg_value = pslave->data_out;
+    if (mpu6050_reg_write(hmpu, MPU6050_I2C_SLV0_DO + slave, &reg_value) != MPU6050_OK)
+      return MPU6050_ERROR;
+  }
+
+  reg_value = (1U << MPU6050_I2C_SLV_EN_OFFSET) | (read ? pslave->length : 1U);
+  reg_value |= (pslave->byte_swap << MPU6050_I2C_SLV_BYTE_SW_OFFSET);
+  if (mpu6050_reg_write(hmpu, MPU6050_I2C_SLV0_CTRL + offset, &reg_value) != MPU6050_OK)
+    return MPU6050_ERROR;
+  hmpu->aux_len[slave] = pslave->length;
   return MPU6050_OK;
 }
 
 /**
- * @brief   Read current Accel configuration
- * @param   paccelconfig: Pointer to buffer where configuration will be stored
+ * @brief   Disable an aux slave
+ * @param   hmpu: Pointer to MPU6050 handle
+ * @param   slave: Slave 0 to 3
  * @retval  mpu6050_status_t
  */
-mpu6050_status_t mpu6050_accel_read_config(uint8_t *paccelconfig) {
-  if (mpu6050_reg_read(MPU6050_ACCEL_CONFIG, paccelconfig) != MPU6050_OK)
+mpu6050_status_t mpu6050_aux_slave_disable(mpu6050_t *hmpu, uint8_t slave) {
+  if (slave >= MPU6050_I2C_SLAVES)
     return MPU6050_ERROR;
+  uint8_t reg_value = 0x00;
+  if (mpu6050_reg_write(hmpu, MPU6050_I2C_SLV0_CTRL + 3U * slave, &reg_value) != MPU6050_OK)
+    return MPU6050_ERROR;
+  hmpu->aux_len[slave] = 0;
   return MPU6050_OK;
 }
 
 /**
- * @brief   Gyro Full Scale selection
- * @param   GyroFullScale: Gyro Full Scale to set
+ * @brief   Time between two samples
+ * @note    In cycle mode samples come at the LP_WAKE_CTRL rate, otherwise at the sample rate.
+ * @param   hmpu: Pointer to MPU6050 handle
+ * @param   pperiod_ns: Pointer to buffer where the period will be stored
  * @retval  mpu6050_status_t
  */
-mpu6050_status_t mpu6050_gyro_set_fullscale(mpu6050_gyroconfig_fs_t gyro_fullscale) {
+static mpu6050_status_t mpu6050_sample_period_ns(mpu6050_t *hmpu, uint64_t *pperiod_ns) {
+  static const uint16_t wake_period_ms[] = {800U, 200U, 50U, 25U};
   uint8_t reg_value;
-  if (mpu6050_gyro_read_config(&reg_value) != MPU6050_OK)
+  if (mpu6050_reg_read(hmpu, MPU6050_PWR_MGMT_1, &reg_value) != MPU6050_OK)
     return MPU6050_ERROR;
+  if (reg_value & (1U << MPU6050_PWR1_CYCLE_OFFSET)) {
+    if (mpu6050_reg_read(hmpu, MPU6050_PWR_MGMT_2, &reg_value) != MPU6050_OK)
+      return MPU6050_ERROR;
+    *pperiod_ns = wake_period_ms[reg_value >> MPU6050_PWR2_LP_WAKE_CTRL_OFFSET] * 1000000ULL;
+    return MPU6050_OK;
+  }
 
-  reg_value &= ~(0b11 << MPU6050_GYRO_FS_SEL_OFFSET);
-  reg_value |= (gyro_fullscale << MPU6050_GYRO_FS_SEL_OFFSET);
-  if (mpu6050_reg_write(MPU6050_GYRO_CONFIG, &reg_value) != MPU6050_OK)
+  float rate_hz;
+  if (mpu6050_read_sample_rate(hmpu, &rate_hz) != MPU6050_OK)
     return MPU6050_ERROR;
+  *pperiod_ns = (uint64_t)(1e9f / rate_hz);
   return MPU6050_OK;
 }
 
 /**
- * @brief   Accel Full Scale selection
- * @param   accel_fullscale: Accel Full Scale to set
- * @retval  mpu6050_status_t
+ * @brief   Single byte aux transfer through slave 4
+ * @note    The transfer is done by the master at the next sample, I2C_MST_STATUS is polled until
+ * it completes or MPU6050_AUX_SLV4_PERIODS sample periods have passed, in cycle mode too.
+ * @param   hmpu: Pointer to MPU6050 handle
+ * @param   address: 7-bit I2C address of the aux sensor
+ * @param   reg_address: Address of register
+ * @param   data_out: Value to write, ignored for reads
+ * @param   read: Read the register instead of writing it
+ * @retval  mpu6050_status_t, MPU6050_ERROR_TIMEOUT if the transfer did not complete in time
  */
-mpu6050_status_t mpu6050_accel_set_fullscale(mpu6050_accelconfig_fs_t accel_fullscale) {
+static mpu6050_status_t mpu6050_aux_slv4_transfer(mpu6050_t *hmpu, uint8_t address,
+                                                  uint8_t reg_address, uint8_t data_out,
+                                                  bool read) {
   uint8_t reg_value;
-  if (mpu6050_accel_read_config(&reg_value) != MPU6050_OK)
+  if (mpu6050_reg_read(hmpu, MPU6050_USER_CTRL, &reg_value) != MPU6050_OK)
+    return MPU6050_ERROR;
+  if (!(reg_value & (1U << MPU6050_I2C_MST_EN)))
+    return MPU6050_ERROR;
+  uint64_t period_ns;
+  if (mpu6050_sample_period_ns(hmpu, &period_ns) != MPU6050_OK)
     return MPU6050_ERROR;
 
-  reg_value &= ~(0b11 << MPU6050_ACCEL_FS_SEL_OFFSET);
-  reg_value |= (accel_fullscale << MPU6050_ACCEL_FS_SEL_OFFSET);
-  if (mpu6050_reg_write(MPU6050_ACCEL_CONFIG, &reg_value) != MPU6050_OK)
+  reg_value = (address & 0x7FU) | (read << MPU6050_I2C_SLV_RW_OFFSET);
+  if (mpu6050_reg_write(hmpu, MPU6050_I2C_SLV4_ADDR, &reg_value) != MPU6050_OK)
     return MPU6050_ERROR;
-  return MPU6050_OK;
+  if (mpu6050_reg_write(hmpu, MPU6050_I2C_SLV4_REG, &reg_address) != MPU6050_OK)
+    return MPU6050_ERROR;
+  if (mpu6050_reg_write(hmpu, MPU6050_I2C_SLV4_DO, &data_out) != MPU6050_OK)
+    return MPU6050_ERROR;
+  reg_value = 1U << MPU6050_I2C_SLV_EN_OFFSET;
+  if (mpu6050_reg_write(hmpu, MPU6050_I2C_SLV4_CTRL, &reg_value) != MPU6050_OK)
+    return MPU6050_ERROR;
+
+  uint64_t start_ns = i2c_timestamp_ns(hmpu->bus);
+  for (;;) {
+    if (mpu6050_reg_read(hmpu, MPU6050_I2C_MST_STATUS, &reg_value) != MPU6050_OK)
+      return MPU6050_ERROR;
+    if (reg_value & (1U << MPU6050_I2C_SLV4_NACK_OFFSET))
+      return MPU6050_ERROR;
+    if (reg_value & (1U << MPU6050_I2C_SLV4_DONE_OFFSET))
+      return MPU6050_OK;
+    if (i2c_timestamp_ns(hmpu->bus) - start_ns >= MPU6050_AUX_SLV4_PERIODS * period_ns)
+      return MPU6050_ERROR_TIMEOUT;
+  }
 }
 
 /**
- * @brief   Raw Gyroscope Measurements
- * @param   pgyrox: Pointer to buffer where Gyro X-axis measurement will be stored
- * @param   pgyroy: Pointer to buffer where Gyro Y-axis measurement will be stored
- * @param   pgyroz: Pointer to buffer where Gyro Z-axis measurement will be stored
+ * @brief   Read an aux sensor register through the auxiliary I2C master
+ * @note    For configuration of the aux sensors, the master must be enabled.
+ * @param   hmpu: Pointer to MPU6050 handle
+ * @param   address: 7-bit I2C address of the aux sensor
+ * @param   reg_address: Address of register to read
+ * @param   pdata: Pointer to buffer where value will be stored
  * @retval  mpu6050_status_t
  */
-mpu6050_status_t mpu6050_gyro_read_raw(uint16_t *pgyrox, uint16_t *pgyroy, uint16_t *pgyroz) {
-  uint8_t reg_value[6];
-  if (mpu6050_burst_read(MPU6050_GYRO_XOUT_H, reg_value, 6) != MPU6050_OK)
+mpu6050_status_t mpu6050_aux_read(mpu6050_t *hmpu, uint8_t address, uint8_t reg_address,
+                                  uint8_t *pdata) {
+  assert(pdata);
+  if (mpu6050_aux_slv4_transfer(hmpu, address, reg_address, 0x00, true) != MPU6050_OK)
     return MPU6050_ERROR;
+  return mpu6050_reg_read(hmpu, MPU6050_I2C_SLV4_DI, pdata);
+}
 
-  *pgyrox = (reg_value[0] << 8) | reg_value[1];
-  *pgyroy = (reg_value[2] << 8) | reg_value[3];
-  *pgyroz = (reg_value[4] << 8) | reg_value[5];
+/**
+ * @brief   Write an aux sensor register through the auxiliary I2C master
+ * @note    For configuration of the aux sensors, the master must be enabled.
+ * @param   hmpu: Pointer to MPU6050 handle
+ * @param   address: 7-bit I2C address of the aux sensor
+ * @param   reg_address: Address of register to write
+ * @param   data: Value to write
+ * @retval  mpu6050_status_t
+ */
+mpu6050_status_t mpu6050_aux_write(mpu6050_t *hmpu, uint8_t address, uint8_t reg_address,
+                                   uint8_t data) {
+  return mpu6050_aux_slv4_transfer(hmpu, address, reg_address, data, false);
+}
 
-  return MPU6050_OK;
+/**
+ * @brief   Amount of external sensor data read on every sample
+ * @param   hmpu: Pointer to MPU6050 handle
+ * @retval  Bytes of all the aux read slaves
+ */
+uint8_t mpu6050_aux_ext_len(mpu6050_t *hmpu) {
+  return mpu6050_aux_slave_offset(hmpu, MPU6050_I2C_SLAVES);
 }
 
 /**
- * @brief   Fetch Gyro Measurements and load it into buffer
+ * @brief   Offset of the data of an aux slave in the external sensor data
+ * @param   hmpu: Pointer to MPU6050 handle
+ * @param   slave: Slave 0 to 3
+ * @retval  Bytes of the slaves before it
+ */
+uint8_t mpu6050_aux_slave_offset(mpu6050_t *hmpu, uint8_t slave) {
+  uint8_t offset = 0;
+  for (uint8_t previous = 0; previous < slave && previous < MPU6050_I2C_SLAVES; previous++)
+    offset += hmpu->aux_len[previous];
+  return offset;
+}
+
+/**
+ * @brief   Raw Measurements and external sensor data in a single burst
+ * @note    One I2C transaction for the MPU6050 and all the aux read slaves.
+ * @param   hmpu: Pointer to MPU6050 handle
+ * @param   psample: Pointer to sample where measurements will be stored
+ * @param   pext: Pointer to buffer of mpu6050_aux_ext_len bytes for the external sensor data
  * @retval  mpu6050_status_t
  */
-mpu6050_status_t mpu6050_gyro_fetch(void) {
-  if (mpu6050_nonblocking_read(MPU6050_GYRO_XOUT_H, rxbuffer, 6) != MPU6050_OK)
+mpu6050_status_t mpu6050_read_all_ext(mpu6050_t *hmpu, mpu6050_sample_t *psample, uint8_t *pext) {
+  assert(psample);
+  assert(pext);
+  uint8_t reg_value[MPU6050_RXBUFFER_LEN];
+  uint8_t ext_len = mpu6050_aux_ext_len(hmpu);
+  if (mpu6050_burst_read(hmpu, MPU6050_ACCEL_XOUT_H, reg_value,
+                         MPU6050_SENSOR_DATA_LEN + ext_len) != MPU6050_OK)
     return MPU6050_ERROR;
+
+  mpu6050_timestamp_update(hmpu, i2c_timestamp_ns(hmpu->bus));
+  mpu6050_decode_sample(reg_value, psample);
+  memcpy(pext, &reg_value[MPU6050_SENSOR_DATA_LEN], ext_len);
   return MPU6050_OK;
 }
 
 /**
- * @brief   Raw Gyroscope Measurements from buffer
- * @param   pgyrox: Pointer to buffer where Gyro X-axis measurement will be stored
- * @param   pgyroy: Pointer to buffer where Gyro Y-axis measurement will be stored
- * @param   pgyroz: Pointer to buffer where Gyro Z-axis measurement will be stored
+ * @brief   External sensor data from buffer, fetched with mpu6050_fetch_all
+ * @param   hmpu: Pointer to MPU6050 handle
+ * @param   pext: Pointer to buffer of mpu6050_aux_ext_len bytes for the external sensor data
  * @retval  mpu6050_status_t
  */
-mpu6050_status_t mpu6050_gyro_read_from_buffer(uint16_t *pgyrox, uint16_t *pgyroy,
-                                               uint16_t *pgyroz) {
-  *pgyrox = (rxbuffer[0] << 8) | rxbuffer[1];
-  *pgyroy = (rxbuffer[2] << 8) | rxbuffer[3];
-  *pgyroz = (rxbuffer[4] << 8) | rxbuffer[5];
+mpu6050_status_t mpu6050_read_ext_from_buffer(mpu6050_t *hmpu, uint8_t *pext) {
+  assert(pext);
+  memcpy(pext, &hmpu->rxbuffer[MPU6050_SENSOR_DATA_LEN], mpu6050_aux_ext_len(hmpu));
+  return MPU6050_OK;
+}
 
+/**
+ * @brief   MPU6050 Sanity Check
+ * @note    It performs a who am I to verify the I2C slave
+ * @param   hmpu: Pointer to MPU6050 handle
+ * @retval  mpu6050_status_t
+ */
+mpu6050_status_t mpu6050_sanity_check(mpu6050_t *hmpu) {
+  /* MPU-6050 Who Am I check */
+  uint8_t reg_value;
+  if (mpu6050_reg_read(hmpu, MPU6050_WHO_AM_I, &reg_value) != MPU6050_OK)
+    return MPU6050_ERROR;
+  if (reg_value != MPU6050_WHO_AM_I_DEFAULT)
+    return MPU6050_ERROR;
   return MPU6050_OK;
 }
 
 /**
- * @brief   Raw Accelerometer Measurements
- * @param   paccelx: Pointer to buffer where Accel X-axis measurement will be stored
- * @param   paccely: Pointer to buffer where Accel Y-axis measurement will be stored
- * @param   paccelz: Pointer to buffer where Accel Z-axis measurement will be stored
+ * @brief   Restart the FIFO frame clock, the next drain becomes the anchor
+ * @param   hmpu: Pointer to MPU6050 handle
+ */
+static void mpu6050_fifo_clock_restart(mpu6050_t *hmpu) {
+  hmpu->fifo_clock.anchored = false;
+  hmpu->fifo_clock.drained = 0;
+  hmpu->fifo_clock.backlog = 0;
+}
+
+/**
+ * @brief   Update the FIFO frame clock with a drain
+ * @note    The period is estimated over the frames produced since the anchor drain, the error of
+ * a drain time is below one period so the estimate improves with the span. The anchor slides
+ * forward once the span is long enough, to follow slow drift.
+ * @param   hmpu: Pointer to MPU6050 handle
+ * @param   drain_ns: Port time of the FIFO count read
+ * @param   backlog: Complete frames in the FIFO
+ * @param   frames: Frames drained
+ */
+static void mpu6050_fifo_clock_update(mpu6050_t *hmpu, uint64_t drain_ns, uint16_t backlog,
+                                      uint16_t frames) {
+  mpu6050_fifo_clock_t *pclock = &hmpu->fifo_clock;
+  /* Sequence number of the newest frame: frames drained so far plus the ones waiting */
+  uint32_t seq = pclock->drained + backlog;
+  uint32_t span = seq - pclock->anchor_seq;
+  if (!pclock->anchored || span >= MPU6050_FIFO_CLOCK_MAX_FRAMES) {
+    if (pclock->anchored)
+      pclock->period_ns = (uint32_t)((drain_ns - pclock->anchor_ns) / span);
+    pclock->anchored = true;
+    pclock->anchor_ns = drain_ns;
+    pclock->anchor_seq = seq;
+  } else if (span >= MPU6050_FIFO_CLOCK_MIN_FRAMES) {
+    pclock->period_ns = (uint32_t)((drain_ns - pclock->anchor_ns) / span);
+  }
+  pclock->drain_ns = drain_ns;
+  pclock->backlog = backlog;
+  pclock->drained += frames;
+}
+
+/**
+ * @brief   Enable FIFO streaming of the selected measurements
+ * @note    The FIFO is reset before streaming starts, so the first frame is aligned. Aux slaves
+ * are loaded with the length configured at enable, reconfigure them before enabling the FIFO.
+ * @param   hmpu: Pointer to MPU6050 handle
+ * @param   sel: Bitmask of mpu6050_fifo_sel_t with the measurements to load into the FIFO
  * @retval  mpu6050_status_t
  */
-mpu6050_status_t mpu6050_accel_read_raw(uint16_t *paccelx, uint16_t *paccely, uint16_t *paccelz) {
-  uint8_t reg_value[6];
-  if (mpu6050_burst_read(MPU6050_ACCEL_XOUT_H, reg_value, 6) != MPU6050_OK)
+mpu6050_status_t mpu6050_fifo_enable(mpu6050_t *hmpu, uint8_t sel) {
+  uint8_t reg_value = sel & (MPU6050_FIFO_SEL_ALL | MPU6050_FIFO_SEL_SLV);
+  if (reg_value == 0)
+    return MPU6050_ERROR;
+  if (mpu6050_fifo_disable(hmpu) != MPU6050_OK)
+    return MPU6050_ERROR;
+  if (mpu6050_reg_write(hmpu, MPU6050_FIFO_EN, &reg_value) != MPU6050_OK)
+    return MPU6050_ERROR;
+  hmpu->fifo_sel = reg_value;
+  if (mpu6050_fifo_reset(hmpu) != MPU6050_OK)
     return MPU6050_ERROR;
 
-  *paccelx = (reg_value[0] << 8) | reg_value[1];
-  *paccely = (reg_value[2] << 8) | reg_value[3];
-  *paccelz = (reg_value[4] << 8) | reg_value[5];
+  /* Overflow flag is clear on read, discard a stale one */
+  if (mpu6050_reg_read(hmpu, MPU6050_INT_STATUS, &reg_value) != MPU6050_OK)
+    return MPU6050_ERROR;
+
+  if (mpu6050_reg_read(hmpu, MPU6050_USER_CTRL, &reg_value) != MPU6050_OK)
+    return MPU6050_ERROR;
+  reg_value |= (1U << MPU6050_USER_CTRL_FIFO_EN_OFFSET);
+  if (mpu6050_reg_write(hmpu, MPU6050_USER_CTRL, &reg_value) != MPU6050_OK)
+    return MPU6050_ERROR;
 
+  float rate_hz;
+  if (mpu6050_read_sample_rate(hmpu, &rate_hz) != MPU6050_OK)
+    return MPU6050_ERROR;
+  hmpu->fifo_clock.nominal_ns = (uint32_t)(1e9f / rate_hz);
+  hmpu->fifo_clock.period_ns = hmpu->fifo_clock.nominal_ns;
   return MPU6050_OK;
 }
 
 /**
- * @brief   Fetch Accelerometer Measurements and load it into buffer
+ * @brief   Disable FIFO streaming
+ * @param   hmpu: Pointer to MPU6050 handle
  * @retval  mpu6050_status_t
  */
-mpu6050_status_t mpu6050_accel_fetch(void) {
-  if (mpu6050_nonblocking_read(MPU6050_ACCEL_XOUT_H, rxbuffer, 6) != MPU6050_OK)
+mpu6050_status_t mpu6050_fifo_disable(mpu6050_t *hmpu) {
+  uint8_t reg_value;
+  if (mpu6050_reg_read(hmpu, MPU6050_USER_CTRL, &reg_value) != MPU6050_OK)
+    return MPU6050_ERROR;
+  reg_value &= ~(1U << MPU6050_USER_CTRL_FIFO_EN_OFFSET);
+  if (mpu6050_reg_write(hmpu, MPU6050_USER_CTRL, &reg_value) != MPU6050_OK)
     return MPU6050_ERROR;
   return MPU6050_OK;
 }
 
 /**
- * @brief   Raw Accelerometer Measurements from buffer
- * @param   paccelx: Pointer to buffer where Accel X-axis measurement will be stored
- * @param   paccely: Pointer to buffer where Accel Y-axis measurement will be stored
- * @param   paccelz: Pointer to buffer where Accel Z-axis measurement will be stored
+ * @brief   Reset FIFO buffer
+ * @note    FIFO operations are stopped while the buffer is reset and restored afterwards.
+ * @param   hmpu: Pointer to MPU6050 handle
  * @retval  mpu6050_status_t
  */
-mpu6050_status_t mpu6050_accel_read_from_buffer(uint16_t *paccelx, uint16_t *paccely,
-                                                uint16_t *paccelz) {
-  *paccelx = (rxbuffer[0] << 8) | rxbuffer[1];
-  *paccely = (rxbuffer[2] << 8) | rxbuffer[3];
-  *paccelz = (rxbuffer[4] << 8) | rxbuffer[5];
+mpu6050_status_t mpu6050_fifo_reset(mpu6050_t *hmpu) {
+  uint8_t reg_value;
+  if (mpu6050_reg_read(hmpu, MPU6050_USER_CTRL, &reg_value) != MPU6050_OK)
+    return MPU6050_ERROR;
 
+  uint8_t reset_value = reg_value & ~(1U << MPU6050_USER_CTRL_FIFO_EN_OFFSET);
+  reset_value |= (1U << MPU6050_USER_CTRL_FIFO_RESET_OFFSET);
+  if (mpu6050_reg_write(hmpu, MPU6050_USER_CTRL, &reset_value) != MPU6050_OK)
+    return MPU6050_ERROR;
+
+  if (reg_value & (1U << MPU6050_USER_CTRL_FIFO_EN_OFFSET)) {
+    if (mpu6050_reg_write(hmpu, MPU6050_USER_CTRL, &reg_value) != MPU6050_OK)
+      return MPU6050_ERROR;
+  }
+  mpu6050_fifo_clock_restart(hmpu);
   return MPU6050_OK;
 }
 
 /**
- * @brief   Temperature Measurement
- * @param   ptemp: Pointer to buffer where temperature measurement will be stored
+ * @brief   Read amount of bytes stored in FIFO
+ * @param   hmpu: Pointer to MPU6050 handle
+ * @param   pcount: Pointer to buffer where the FIFO count will be stored
  * @retval  mpu6050_status_t
  */
-mpu6050_status_t mpu6050_temp_read_raw(uint16_t *ptemp) {
-  uint8_t reg_value[6];
-  if (mpu6050_burst_read(MPU6050_TEMP_OUT_H, reg_value, 2) != MPU6050_OK)
+mpu6050_status_t mpu6050_fifo_read_count(mpu6050_t *hmpu, uint16_t *pcount) {
+  assert(pcount);
+  uint8_t reg_value[2];
+  if (mpu6050_burst_read(hmpu, MPU6050_FIFO_COUNTH, reg_value, 2) != MPU6050_OK)
     return MPU6050_ERROR;
 
-  *ptemp = (reg_value[0] << 8) | reg_value[1];
+  *pcount = (reg_value[0] << 8) | reg_value[1];
 
   return MPU6050_OK;
 }
 
 /**
- * @brief   Fetch Temperature Measurements and load it into buffer
+ * @brief   External sensor data bytes of a FIFO frame
+ * @note    Only slaves 0 to 2 are loaded into the FIFO.
+ * @param   hmpu: Pointer to MPU6050 handle
+ * @retval  Bytes of the aux slaves selected for the FIFO
+ */
+static uint16_t mpu6050_fifo_ext_len(mpu6050_t *hmpu) {
+  uint16_t ext_len = 0;
+  for (uint8_t slave = 0; slave < MPU6050_I2C_SLAVES - 1U; slave++) {
+    if (hmpu->fifo_sel & (MPU6050_FIFO_SEL_SLV0 << slave))
+      ext_len += hmpu->aux_len[slave];
+  }
+  return ext_len;
+}
+
+/**
+ * @brief   Size of a FIFO frame with the current sensor selection
+ * @param   hmpu: Pointer to MPU6050 handle
+ * @retval  Frame size in bytes
+ */
+uint16_t mpu6050_fifo_frame_size(mpu6050_t *hmpu) {
+  uint16_t frame_size = 0;
+  if (hmpu->fifo_sel & MPU6050_FIFO_SEL_ACCEL)
+    frame_size += 6;
+  if (hmpu->fifo_sel & MPU6050_FIFO_SEL_TEMP)
+    frame_size += 2;
+  if (hmpu->fifo_sel & MPU6050_FIFO_SEL_GYRO_X)
+    frame_size += 2;
+  if (hmpu->fifo_sel & MPU6050_FIFO_SEL_GYRO_Y)
+    frame_size += 2;
+  if (hmpu->fifo_sel & MPU6050_FIFO_SEL_GYRO_Z)
+    frame_size += 2;
+  return frame_size + mpu6050_fifo_ext_len(hmpu);
+}
+
+/**
+ * @brief   Amount of FIFO overflows detected and recovered
+ * @param   hmpu: Pointer to MPU6050 handle
+ * @retval  Overflow count
+ */
+uint32_t mpu6050_fifo_overflow_count(mpu6050_t *hmpu) { return hmpu->fifo_overflows; }
+
+/**
+ * @brief   Timestamps of the frames of the last FIFO drain or fetch
+ * @note    Frames are back-computed from the drain time with the estimated frame period, the
+ * newest frame in the FIFO is taken at the drain time.
+ * @param   hmpu: Pointer to MPU6050 handle
+ * @param   frames: Amount of frames of the last drain
+ * @param   ptimestamps: Pointer to buffer where the port time of each frame will be stored
  * @retval  mpu6050_status_t
  */
-mpu6050_status_t mpu6050_temp_fetch(void) {
-  if (mpu6050_nonblocking_read(MPU6050_GYRO_XOUT_H, rxbuffer, 6) != MPU6050_OK)
+mpu6050_status_t mpu6050_fifo_timestamps(mpu6050_t *hmpu, uint16_t frames, uint64_t *ptimestamps) {
+  assert(ptimestamps);
+  const mpu6050_fifo_clock_t *pclock = &hmpu->fifo_clock;
+  if (frames > pclock->backlog)
     return MPU6050_ERROR;
+  for (uint16_t i = 0; i < frames; i++)
+    ptimestamps[i] =
+        pclock->drain_ns - (uint64_t)(pclock->backlog - 1U - i) * pclock->period_ns;
   return MPU6050_OK;
 }
 
 /**
- * @brief   Raw Temperature Measurements from buffer
- * @param   ptemp: Pointer to buffer where Temperature measurement will be stored
+ * @brief   Estimated FIFO frame period
+ * @note    The nominal period of the configured sample rate until enough frames are drained.
+ * @param   hmpu: Pointer to MPU6050 handle
+ * @retval  Frame period in ns
+ */
+uint32_t mpu6050_fifo_period_ns(mpu6050_t *hmpu) { return hmpu->fifo_clock.period_ns; }
+
+/**
+ * @brief   Check FIFO state before draining it
+ * @note    On overflow the FIFO is reset, since the frame boundaries are lost.
+ * @param   hmpu: Pointer to MPU6050 handle
+ * @param   buffer_size: Size of the buffer where frames will be stored
+ * @param   pframes: Pointer to buffer where the amount of frames to drain will be stored
+ * @retval  mpu6050_status_t
+ */
+static mpu6050_status_t mpu6050_fifo_prepare_drain(mpu6050_t *hmpu, uint16_t buffer_size,
+                                                   uint16_t *pframes) {
+  assert(pframes);
+  *pframes = 0;
+  uint16_t frame_size = mpu6050_fifo_frame_size(hmpu);
+  if (frame_size == 0)
+    return MPU6050_ERROR;
+
+  uint8_t int_status;
+  if (mpu6050_reg_read(hmpu, MPU6050_INT_STATUS, &int_status) != MPU6050_OK)
+    return MPU6050_ERROR;
+  if (int_status & (1U << MPU6050_INT_FIFO_OFLOW_OFFSET)) {
+    hmpu->fifo_overflows++;
+    mpu6050_fifo_reset(hmpu);
+    return MPU6050_ERROR;
+  }
+
+  uint16_t count;
+  if (mpu6050_fifo_read_count(hmpu, &count) != MPU6050_OK)
+    return MPU6050_ERROR;
+  uint64_t drain_ns = i2c_timestamp_ns(hmpu->bus);
+  uint16_t backlog = count / frame_size;
+  if (count > buffer_size)
+    count = buffer_size;
+
+  *pframes = count / frame_size;
+  mpu6050_fifo_clock_update(hmpu, drain_ns, backlog, *pframes);
+  return MPU6050_OK;
+}
+
+/**
+ * @brief   Drain complete frames from FIFO in a single burst
+ * @note    If the FIFO overflowed it is reset and MPU6050_ERROR is returned with no frames.
+ * @param   hmpu: Pointer to MPU6050 handle
+ * @param   pbuffer: Pointer to buffer where frames will be stored
+ * @param   buffer_size: Size of the buffer in bytes
+ * @param   pframes: Pointer to buffer where the amount of frames read will be stored
  * @retval  mpu6050_status_t
  */
-mpu6050_status_t mpu6050_temp_read_from_buffer(uint16_t *ptemp) {
-  *ptemp = (rxbuffer[0] << 8) | rxbuffer[1];
+mpu6050_status_t mpu6050_fifo_drain(mpu6050_t *hmpu, uint8_t *pbuffer, uint16_t buffer_size,
+                                    uint16_t *pframes) {
+  assert(pbuffer);
+  if (mpu6050_fifo_prepare_drain(hmpu, buffer_size, pframes) != MPU6050_OK)
+    return MPU6050_ERROR;
+  if (*pframes == 0)
+    return MPU6050_OK;
+
+  if (mpu6050_burst_read(hmpu, MPU6050_FIFO_R_W, pbuffer,
+                         *pframes * mpu6050_fifo_frame_size(hmpu)) != MPU6050_OK)
+    return MPU6050_ERROR;
   return MPU6050_OK;
 }
 
 /**
- * @brief   MPU6050 Sanity Check
- * @note    It performs a who am I to verify the I2C slave
+ * @brief   Fetch complete frames from FIFO and load them into buffer
+ * @note    FIFO count is read blocking, frames are transferred non-blocking. Data is ready once
+ * mpu6050_is_data_ready returns true.
+ * @param   hmpu: Pointer to MPU6050 handle
+ * @param   pbuffer: Pointer to buffer where frames will be stored
+ * @param   buffer_size: Size of the buffer in bytes
+ * @param   pframes: Pointer to buffer where the amount of frames fetched will be stored
  * @retval  mpu6050_status_t
  */
-mpu6050_status_t mpu6050_sanity_check(void) {
-  /* MPU-6050 Who Am I check */
-  uint8_t reg_value;
-  if (mpu6050_reg_read(MPU6050_WHO_AM_I, &reg_value) != MPU6050_OK)
+mpu6050_status_t mpu6050_fifo_fetch(mpu6050_t *hmpu, uint8_t *pbuffer, uint16_t buffer_size,
+                                    uint16_t *pframes) {
+  assert(pbuffer);
+  if (mpu6050_fifo_prepare_drain(hmpu, buffer_size, pframes) != MPU6050_OK)
     return MPU6050_ERROR;
-  if (reg_value != MPU6050_WHO_AM_I_DEFAULT)
+  if (*pframes == 0)
+    return MPU6050_OK;
+
+  if (mpu6050_nonblocking_read(hmpu, MPU6050_FIFO_R_W, pbuffer,
+                               *pframes * mpu6050_fifo_frame_size(hmpu)) != MPU6050_OK)
     return MPU6050_ERROR;
   return MPU6050_OK;
 }
+
+/**
+ * @brief   Parse a FIFO frame into a sample
+ * @note    Measurements not selected for the FIFO are set to zero.
+ * @param   hmpu: Pointer to MPU6050 handle
+ * @param   pframe: Pointer to the first byte of the frame
+ * @param   psample: Pointer to sample where measurements will be stored
+ * @retval  mpu6050_status_t
+ */
+mpu6050_status_t mpu6050_fifo_parse_frame(mpu6050_t *hmpu, const uint8_t *pframe,
+                                          mpu6050_sample_t *psample) {
+  assert(pframe);
+  assert(psample);
+  *psample = (mpu6050_sample_t){0};
+
+  /* Frame measurements are ordered by register address */
+  if (hmpu->fifo_sel & MPU6050_FIFO_SEL_ACCEL) {
+    psample->accel[0] = (pframe[0] << 8) | pframe[1];
+    psample->accel[1] = (pframe[2] << 8) | pframe[3];
+    psample->accel[2] = (pframe[4] << 8) | pframe[5];
+    pframe += 6;
+  }
+  if (hmpu->fifo_sel & MPU6050_FIFO_SEL_TEMP) {
+    psample->temp = (pframe[0] << 8) | pframe[1];
+    pframe += 2;
+  }
+  for (uint8_t axis = 0; axis < 3; axis++) {
+    if (hmpu->fifo_sel & (MPU6050_FIFO_SEL_GYRO_X >> axis)) {
+      psample->gyro[axis] = (pframe[0] << 8) | pframe[1];
+      pframe += 2;
+    }
+  }
+  return MPU6050_OK;
+}
+
+/**
+ * @brief   External sensor data of a FIFO frame
+ * @note    The data of the aux slaves selected for the FIFO follows the measurements, in slave
+ * order.
+ * @param   hmpu: Pointer to MPU6050 handle
+ * @param   pframe: Pointer to the first byte of the frame
+ * @param   pext: Pointer to buffer where the external sensor data will be stored
+ * @retval  mpu6050_status_t
+ */
+mpu6050_status_t mpu6050_fifo_parse_ext(mpu6050_t *hmpu, const uint8_t *pframe, uint8_t *pext) {
+  assert(pframe);
+  assert(pext);
+  uint16_t ext_len = mpu6050_fifo_ext_len(hmpu);
+  uint16_t offset = mpu6050_fifo_frame_size(hmpu) - ext_len;
+  memcpy(pext, &pframe[offset], ext_len);
+  return MPU6050_OK;
+}
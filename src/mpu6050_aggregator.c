@@ -0,0 +1,98 @@
+/**
+ ******************************************************************************
+ * @file           : mpu6050_aggregator.c
+ * @author         : Gonzalo Gabriel Fernandez
+ * @brief          : MPU6050 sample merger
+ ******************************************************************************
+ * @attention
+ *
+ * K-way merge of sample rings by timestamp. The merger only reads the heads
+ * of the rings and releases the slot it emits, it never blocks a producer.
+ *
+ ******************************************************************************
+ */
+
+#include "mpu6050_aggregator.h"
+
+#include <assert.h>
+#include <stddef.h>
+
+/**
+ * @brief Initialize a merger without rings
+ * @param pmerger: Pointer to merger
+ * @param latency_ns: Latency bound, age after which a sample is emitted without waiting for the
+ * rings that are empty
+ */
+void mpu6050_merger_init(mpu6050_merger_t *pmerger, uint64_t latency_ns) {
+  assert(pmerger);
+  pmerger->count = 0;
+  pmerger->latency_ns = latency_ns;
+  pmerger->last_ns = 0;
+  pmerger->merged = 0;
+  pmerger->late = 0;
+}
+
+/**
+ * @brief Add a ring to the merger
+ * @note Samples of the ring carry its number in order of addition, from 0.
+ * @param pmerger: Pointer to merger
+ * @param pring: Pointer to ring, the merger becomes its consumer
+ * @retval mpu6050_status_t
+ */
+mpu6050_status_t mpu6050_merger_add(mpu6050_merger_t *pmerger, mpu6050_ring_t *pring) {
+  assert(pmerger);
+  assert(pring);
+  if (pmerger->count >= MPU6050_MERGER_MAX_STREAMS)
+    return MPU6050_ERROR;
+  pmerger->prings[pmerger->count++] = pring;
+  return MPU6050_OK;
+}
+
+/**
+ * @brief Oldest sample of the merged rings
+ * @note A sample is emitted once every ring holds a sample, so no ring can produce an older one,
+ * or once its age reaches the latency bound. A sample older than the last one emitted, from a
+ * ring that stalled beyond the bound, is discarded and counted as late.
+ * @param pmerger: Pointer to merger
+ * @param now_ns: Current time, in the timebase of the sample timestamps
+ * @param pout: Pointer to merged sample where the oldest sample will be stored
+ * @retval true if a sample was stored, false if no sample is ready
+ */
+bool mpu6050_merger_next(mpu6050_merger_t *pmerger, uint64_t now_ns, mpu6050_merged_t *pout) {
+  assert(pmerger);
+  assert(pout);
+  for (;;) {
+    const mpu6050_ring_slot_t *poldest = NULL;
+    uint8_t oldest = 0;
+    bool complete = true;
+    for (uint8_t i = 0; i < pmerger->count; i++) {
+      const mpu6050_ring_slot_t *pslot;
+      if (mpu6050_ring_peek_batch(pmerger->prings[i], &pslot) == 0) {
+        complete = false;
+        continue;
+      }
+      if (poldest == NULL || pslot->timestamp_ns < poldest->timestamp_ns) {
+        poldest = pslot;
+        oldest = i;
+      }
+    }
+    if (poldest == NULL)
+      return false;
+    if (!complete && now_ns < poldest->timestamp_ns + pmerger->latency_ns)
+      return false;
+
+    bool late = poldest->timestamp_ns < pmerger->last_ns;
+    if (!late) {
+      pout->sample = poldest->sample;
+      pout->timestamp_ns = poldest->timestamp_ns;
+      pout->stream = oldest;
+      pmerger->last_ns = poldest->timestamp_ns;
+    }
+    mpu6050_ring_release(pmerger->prings[oldest], 1);
+    if (!late) {
+      pmerger->merged++;
+      return true;
+    }
+    pmerger->late++;
+  }
+}
@@ -0,0 +1,196 @@
+/**
+ ******************************************************************************
+ * @file           : mpu6050_aggregator_linux.c
+ * @author         : Gonzalo Gabriel Fernandez
+ * @brief          : MPU6050 multi-bus aggregator for Linux
+ ******************************************************************************
+ * @attention
+ *
+ * One reader thread per bus, pinned to its core, reads the devices of the
+ * bus with the blocking driver reads and publishes every sample into the
+ * ring of its device. Buses are read in parallel, so the aggregate sample
+ * rate grows with the amount of buses. Samples are timestamped with
+ * CLOCK_MONOTONIC_RAW at read completion, the timebase of the Linux port,
+ * so the merger compares samples of every bus whatever the port.
+ *
+ ******************************************************************************
+ */
+
+#define _GNU_SOURCE
+
+#include <assert.h>
+#include <errno.h>
+#include <sched.h>
+#include <string.h>
+#include <time.h>
+
+#include "mpu6050_aggregator.h"
+
+/**
+ * @brief Time of the aggregator clock
+ * @retval CLOCK_MONOTONIC_RAW time in ns
+ */
+uint64_t mpu6050_aggregator_now_ns(void) {
+  struct timespec now;
+  clock_gettime(CLOCK_MONOTONIC_RAW, &now);
+  return (uint64_t)now.tv_sec * 1000000000ULL + (uint64_t)now.tv_nsec;
+}
+
+/**
+ * @brief Reader thread of a bus
+ * @note A sample read while the ring of its device is full is dropped, reads keep their pace.
+ * @param pcontext: Pointer to aggregator bus
+ * @retval NULL
+ */
+static void *mpu6050_aggregator_worker(void *pcontext) {
+  mpu6050_aggregator_bus_t *pbus = pcontext;
+  struct timespec next;
+  clock_gettime(CLOCK_MONOTONIC, &next);
+  while (__atomic_load_n(&pbus->running, __ATOMIC_ACQUIRE)) {
+    for (uint8_t i = 0; i < pbus->count; i++) {
+      mpu6050_ring_slot_t *pslot = mpu6050_ring_acquire(pbus->prings[i]);
+      mpu6050_sample_t discarded;
+      if (mpu6050_read_all_raw(pbus->pdevices[i],
+                               (pslot != NULL) ? &pslot->sample : &discarded) != MPU6050_OK) {
+        pbus->errors++;
+        continue;
+      }
+      pbus->reads++;
+      if (pslot == NULL) {
+        mpu6050_ring_drop(pbus->prings[i]);
+        continue;
+      }
+      pslot->timestamp_ns = mpu6050_aggregator_now_ns();
+      mpu6050_ring_commit(pbus->prings[i]);
+    }
+    if (pbus->period_ns == 0)
+      continue;
+    uint64_t nsec = (uint64_t)next.tv_nsec + pbus->period_ns;
+    next.tv_sec += (time_t)(nsec / 1000000000ULL);
+    next.tv_nsec = (long)(nsec % 1000000000ULL);
+    while (clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &next, NULL) == EINTR)
+      ;
+  }
+  return NULL;
+}
+
+/**
+ * @brief Initialize an aggregator without buses
+ * @param pagg: Pointer to aggregator
+ * @param period_ns: Read period of every bus, 0 to read back to back
+ * @param latency_ns: Latency bound of the merged stream
+ */
+void mpu6050_aggregator_init(mpu6050_aggregator_t *pagg, uint64_t period_ns, uint64_t latency_ns) {
+  assert(pagg);
+  memset(pagg, 0, sizeof(*pagg));
+  pagg->period_ns = period_ns;
+  mpu6050_merger_init(&pagg->merger, latency_ns);
+}
+
+/**
+ * @brief Add a device to the aggregator
+ * @note Devices are grouped by bus handle, the first device of a bus selects the core of its
+ * reader thread. Merged samples of the device carry its number in order of addition.
+ * @param pagg: Pointer to aggregator
+ * @param hmpu: Pointer to MPU6050 handle, initialized and awake
+ * @param pring: Pointer to ring of the device
+ * @param cpu: Core of the reader thread of the bus, -1 for any
+ * @retval mpu6050_status_t
+ */
+mpu6050_status_t mpu6050_aggregator_add(mpu6050_aggregator_t *pagg, mpu6050_t *hmpu,
+                                        mpu6050_ring_t *pring, int cpu) {
+  assert(pagg);
+  assert(hmpu);
+  assert(pring);
+  if (pagg->running || cpu >= CPU_SETSIZE)
+    return MPU6050_ERROR;
+
+  mpu6050_aggregator_bus_t *pbus = NULL;
+  for (uint8_t i = 0; i < pagg->bus_count; i++) {
+    if (pagg->buses[i].bus == hmpu->bus)
+      pbus = &pagg->buses[i];
+  }
+  if (pbus == NULL) {
+    if (pagg->bus_count >= MPU6050_AGGREGATOR_MAX_BUSES)
+      return MPU6050_ERROR;
+    pbus = &pagg->buses[pagg->bus_count];
+    pbus->bus = hmpu->bus;
+    pbus->cpu = cpu;
+  }
+  if (pbus->count >= MPU6050_AGGREGATOR_BUS_DEVICES)
+    return MPU6050_ERROR;
+  if (mpu6050_merger_add(&pagg->merger, pring) != MPU6050_OK)
+    return MPU6050_ERROR;
+
+  if (pbus->count == 0)
+    pagg->bus_count++;
+  mpu6050_ring_init(pring);
+  pbus->pdevices[pbus->count] = hmpu;
+  pbus->prings[pbus->count] = pring;
+  pbus->count++;
+  return MPU6050_OK;
+}
+
+/**
+ * @brief Start the reader threads of every bus
+ * @param pagg: Pointer to aggregator
+ * @retval mpu6050_status_t, no thread is left running on error
+ */
+mpu6050_status_t mpu6050_aggregator_start(mpu6050_aggregator_t *pagg) {
+  assert(pagg);
+  if (pagg->running || pagg->bus_count == 0)
+    return MPU6050_ERROR;
+  for (uint8_t i = 0; i < pagg->bus_count; i++) {
+    mpu6050_aggregator_bus_t *pbus = &pagg->buses[i];
+    pthread_attr_t attr;
+    pthread_attr_init(&attr);
+    if (pbus->cpu >= 0) {
+      cpu_set_t cpus;
+      CPU_ZERO(&cpus);
+      CPU_SET(pbus->cpu, &cpus);
+      pthread_attr_setaffinity_np(&attr, sizeof(cpus), &cpus);
+    }
+    pbus->period_ns = pagg->period_ns;
+    pbus->running = true;
+    int result = pthread_create(&pbus->thread, &attr, mpu6050_aggregator_worker, pbus);
+    pthread_attr_destroy(&attr);
+    if (result != 0) {
+      pbus->running = false;
+      for (uint8_t j = 0; j < i; j++)
+        __atomic_store_n(&pagg->buses[j].running, false, __ATOMIC_RELEASE);
+      for (uint8_t j = 0; j < i; j++)
+        pthread_join(pagg->buses[j].thread, NULL);
+      return MPU6050_ERROR;
+    }
+  }
+  pagg->running = true;
+  return MPU6050_OK;
+}
+
+/**
+ * @brief Stop and join the reader threads
+ * @note Samples left in the rings can still be merged.
+ * @param pagg: Pointer to aggregator
+ */
+void mpu6050_aggregator_stop(mpu6050_aggregator_t *pagg) {
+  assert(pagg);
+  if (!pagg->running)
+    return;
+  for (uint8_t i = 0; i < pagg->bus_count; i++)
+    __atomic_store_n(&pagg->buses[i].running, false, __ATOMIC_RELEASE);
+  for (uint8_t i = 0; i < pagg->bus_count; i++)
+    pthread_join(pagg->buses[i].thread, NULL);
+  pagg->running = false;
+}
+
+/**
+ * @brief Next sample of the time-ordered stream of every device
+ * @note Non-blocking, to be polled at least every latency bound.
+ * @param pagg: Pointer to aggregator
+ * @param pout: Pointer to merged sample where the oldest sample will be stored
+ * @retval true if a sample was stored, false if no sample is ready
+ */
+bool mpu6050_aggregator_next(mpu6050_aggregator_t *pagg, mpu6050_merged_t *pout) {
+  assert(pagg);
+  return mpu6050_merger_next(&pagg->merger, mpu6050_aggregator_now_ns(), pout);
+}
@@ -0,0 +1,211 @@
+/**
+ ******************************************************************************
+ * @file           : mpu6050_calib.c
+ * @author         : Gonzalo Gabriel Fernandez
+ * @brief          : MPU6050 calibration
+ ******************************************************************************
+ * @attention
+ *
+ * The device must be at rest with the Z axis up during accumulation: accel X
+ * and Y are expected at 0 g, accel Z at +1 g and the gyro at 0 dps. The
+ * measured bias is folded into the current offset registers content, so a
+ * calibration can be repeated on top of a previous one.
+ *
+ ******************************************************************************
+ */
+
+#include "mpu6050_calib.h"
+#include "mpu6050_registers.h"
+
+#include <assert.h>
+#include <stddef.h>
+
+#define MPU6050_CALIB_ACCEL_1G_2G 16384 /*! Accel counts per g at +-2g full scale */
+
+/**
+ * @brief   Fletcher-16 of the offsets of a calibration blob
+ * @param   pcalib: Pointer to calibration blob
+ * @retval  Checksum
+ */
+static uint16_t mpu6050_calib_checksum(const mpu6050_calib_t *pcalib) {
+  uint16_t sum1 = 0;
+  uint16_t sum2 = 0;
+  const int16_t *poffsets[2] = {pcalib->accel_offset, pcalib->gyro_offset};
+  for (uint8_t sensor = 0; sensor < 2; sensor++) {
+    for (uint8_t axis = 0; axis < 3; axis++) {
+      uint16_t value = (uint16_t)poffsets[sensor][axis];
+      uint8_t bytes[2] = {value >> 8, value & 0xFFU};
+      for (uint8_t i = 0; i < 2; i++) {
+        sum1 = (sum1 + bytes[i]) % 255U;
+        sum2 = (sum2 + sum1) % 255U;
+      }
+    }
+  }
+  return (uint16_t)((sum2 << 8) | sum1);
+}
+
+/**
+ * @brief   Offset register value corrected by a bias
+ * @param   offset: Current offset register value
+ * @param   bias: Bias in offset register counts
+ * @retval  Corrected offset, saturated to the register range
+ */
+static int16_t mpu6050_calib_correct(int16_t offset, float bias) {
+  float value = (float)offset - bias;
+  value += (value >= 0.0f) ? 0.5f : -0.5f;
+  if (value > INT16_MAX)
+    return INT16_MAX;
+  if (value < INT16_MIN)
+    return INT16_MIN;
+  return (int16_t)value;
+}
+
+/**
+ * @brief   Initialize an empty accumulator
+ * @param   pacc: Pointer to accumulator
+ */
+void mpu6050_calib_acc_init(mpu6050_calib_acc_t *pacc) {
+  assert(pacc);
+  pacc->count = 0;
+  for (uint8_t ch = 0; ch < MPU6050_CALIB_CHANNELS; ch++) {
+    pacc->mean[ch] = 0.0f;
+    pacc->m2[ch] = 0.0f;
+  }
+}
+
+/**
+ * @brief   Accumulate a sample
+ * @param   pacc: Pointer to accumulator
+ * @param   psample: Pointer to sample
+ */
+void mpu6050_calib_acc_add(mpu6050_calib_acc_t *pacc, const mpu6050_sample_t *psample) {
+  assert(pacc);
+  assert(psample);
+  pacc->count++;
+  for (uint8_t ch = 0; ch < MPU6050_CALIB_CHANNELS; ch++) {
+    float value = (float)(int16_t)((ch < 3) ? psample->accel[ch] : psample->gyro[ch - 3]);
+    float delta = value - pacc->mean[ch];
+    pacc->mean[ch] += delta / (float)pacc->count;
+    pacc->m2[ch] += delta * (value - pacc->mean[ch]);
+  }
+}
+
+/**
+ * @brief   Sample variance of the accumulated samples
+ * @note    Useful to reject a calibration taken while the device was moving.
+ * @param   pacc: Pointer to accumulator
+ * @param   pvariance: Pointer to buffer where the variance of each channel will be stored
+ */
+void mpu6050_calib_acc_variance(const mpu6050_calib_acc_t *pacc, float *pvariance) {
+  assert(pacc);
+  assert(pvariance);
+  for (uint8_t ch = 0; ch < MPU6050_CALIB_CHANNELS; ch++)
+    pvariance[ch] = (pacc->count > 1) ? pacc->m2[ch] / (float)(pacc->count - 1) : 0.0f;
+}
+
+/**
+ * @brief   Write the accumulated bias into the offset registers
+ * @note    The bias is computed at the current full scale settings.
+ * @param   hmpu: Pointer to MPU6050 handle
+ * @param   pacc: Pointer to accumulator, at least one sample
+ * @param   pcalib: Pointer to calibration blob to fill with the new offsets, can be NULL
+ * @retval  mpu6050_status_t
+ */
+mpu6050_status_t mpu6050_calib_apply(mpu6050_t *hmpu, const mpu6050_calib_acc_t *pacc,
+                                     mpu6050_calib_t *pcalib) {
+  uint8_t gyro_config;
+  uint8_t accel_config;
+  int16_t accel_offset[3];
+  int16_t gyro_offset[3];
+  assert(pacc);
+  if (pacc->count == 0)
+    return MPU6050_ERROR;
+
+  if (mpu6050_gyro_read_config(hmpu, &gyro_config) != MPU6050_OK)
+    return MPU6050_ERROR;
+  if (mpu6050_accel_read_config(hmpu, &accel_config) != MPU6050_OK)
+    return MPU6050_ERROR;
+  if (mpu6050_accel_read_offsets(hmpu, accel_offset) != MPU6050_OK)
+    return MPU6050_ERROR;
+  if (mpu6050_gyro_read_offsets(hmpu, gyro_offset) != MPU6050_OK)
+    return MPU6050_ERROR;
+  uint8_t accel_fs = (accel_config >> MPU6050_ACCEL_FS_SEL_OFFSET) & 0b11;
+  uint8_t gyro_fs = (gyro_config >> MPU6050_GYRO_FS_SEL_OFFSET) & 0b11;
+
+  /* Offset registers are +-16g and +-1000 dps full scale counts */
+  float accel_ratio = (float)(1U << accel_fs) / 8.0f;
+  float gyro_ratio = (float)(1U << gyro_fs) / 4.0f;
+  float gravity = (float)(MPU6050_CALIB_ACCEL_1G_2G >> accel_fs);
+  for (uint8_t axis = 0; axis < 3; axis++) {
+    float accel_bias = pacc->mean[axis] - ((axis == 2) ? gravity : 0.0f);
+    accel_offset[axis] = mpu6050_calib_correct(accel_offset[axis], accel_bias * accel_ratio);
+    gyro_offset[axis] = mpu6050_calib_correct(gyro_offset[axis], pacc->mean[axis + 3] * gyro_ratio);
+  }
+
+  if (mpu6050_accel_write_offsets(hmpu, accel_offset) != MPU6050_OK)
+    return MPU6050_ERROR;
+  if (mpu6050_gyro_write_offsets(hmpu, gyro_offset) != MPU6050_OK)
+    return MPU6050_ERROR;
+  if (pcalib != NULL)
+    return mpu6050_calib_save(hmpu, pcalib);
+  return MPU6050_OK;
+}
+
+/**
+ * @brief   Blocking calibration at rest
+ * @note    Reads faster than the sample rate repeat samples, which only lowers the amount
+ *          of independent samples.
+ * @param   hmpu: Pointer to MPU6050 handle
+ * @param   count: Amount of samples to accumulate
+ * @param   pacc: Pointer to accumulator, holds mean and variance on return
+ * @param   pcalib: Pointer to calibration blob to fill with the new offsets, can be NULL
+ * @retval  mpu6050_status_t
+ */
+mpu6050_status_t mpu6050_calib_run(mpu6050_t *hmpu, uint32_t count, mpu6050_calib_acc_t *pacc,
+                                   mpu6050_calib_t *pcalib) {
+  mpu6050_sample_t sample;
+  mpu6050_calib_acc_init(pacc);
+  for (uint32_t i = 0; i < count; i++) {
+    if (mpu6050_read_all_raw(hmpu, &sample) != MPU6050_OK)
+      return MPU6050_ERROR;
+    mpu6050_calib_acc_add(pacc, &sample);
+  }
+  return mpu6050_calib_apply(hmpu, pacc, pcalib);
+}
+
+/**
+ * @brief   Save the offset registers content into a calibration blob
+ * @param   hmpu: Pointer to MPU6050 handle
+ * @param   pcalib: Pointer to calibration blob to fill
+ * @retval  mpu6050_status_t
+ */
+mpu6050_status_t mpu6050_calib_save(mpu6050_t *hmpu, mpu6050_calib_t *pcalib) {
+  assert(pcalib);
+  if (mpu6050_accel_read_offsets(hmpu, pcalib->accel_offset) != MPU6050_OK)
+    return MPU6050_ERROR;
+  if (mpu6050_gyro_read_offsets(hmpu, pcalib->gyro_offset) != MPU6050_OK)
+    return MPU6050_ERROR;
+  pcalib->magic = MPU6050_CALIB_MAGIC;
+  pcalib->checksum = mpu6050_calib_checksum(pcalib);
+  return MPU6050_OK;
+}
+
+/**
+ * @brief   Restore the offset registers from a calibration blob
+ * @note    Offset registers are volatile, restore after every power-up or device reset.
+ * @param   hmpu: Pointer to MPU6050 handle
+ * @param   pcalib: Pointer to calibration blob
+ * @retval  mpu6050_status_t, error if the blob is not valid
+ */
+mpu6050_status_t mpu6050_calib_restore(mpu6050_t *hmpu, const mpu6050_calib_t *pcalib) {
+  assert(pcalib);
+  if (pcalib->magic != MPU6050_CALIB_MAGIC)
+    return MPU6050_ERROR;
+  if (pcalib->checksum != mpu6050_calib_checksum(pcalib))
+    return MPU6050_ERROR;
+  if (mpu6050_accel_write_offsets(hmpu, pcalib->accel_offset) != MPU6050_OK)
+    return MPU6050_ERROR;
+  if (mpu6050_gyro_write_offsets(hmpu, pcalib->gyro_offset) != MPU6050_OK)
+    return MPU6050_ERROR;
+  return MPU6050_OK;
+}
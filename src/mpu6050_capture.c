@@ -0,0 +1,495 @@
+/**
+ ******************************************************************************
+ * @file           : mpu6050_capture.c
+ * @author         : Gonzalo Gabriel Fernandez
+ * @brief          : MPU6050 binary capture
+ ******************************************************************************
+ * @attention
+ *
+ * All fields are little endian. Header block: magic, version, block size,
+ * gyro and accel full scales, DLPF, sample divider, nominal period, source,
+ * channels and a Fletcher-16 of the previous fields. Data block: magic,
+ * sequence number, start time, samples, payload bytes and a Fletcher-16 of the
+ * block header and payload, then the payload, padded with 0xFF. A sample is
+ * the zigzag varint of the change of the sample interval, then the zigzag
+ * varint of the change of each channel. The first sample of a block is coded
+ * against a zero sample taken at the block start time.
+ *
+ ******************************************************************************
+ */
+
+#include "mpu6050_capture.h"
+
+#include <assert.h>
+#include <string.h>
+
+/**
+ * @brief   Block header field offsets
+ */
+#define MPU6050_CAPTURE_BLOCK_SEQ 4U
+#define MPU6050_CAPTURE_BLOCK_START 8U
+#define MPU6050_CAPTURE_BLOCK_COUNT 16U
+#define MPU6050_CAPTURE_BLOCK_LENGTH 18U
+#define MPU6050_CAPTURE_BLOCK_CHECKSUM 20U
+
+/**
+ * @brief   Header block field offsets
+ */
+#define MPU6050_CAPTURE_HEADER_VERSION 4U
+#define MPU6050_CAPTURE_HEADER_BLOCK_SIZE 6U
+#define MPU6050_CAPTURE_HEADER_CONFIG 8U
+#define MPU6050_CAPTURE_HEADER_PERIOD 12U
+#define MPU6050_CAPTURE_HEADER_SOURCE 16U
+#define MPU6050_CAPTURE_HEADER_CHANNELS 20U
+#define MPU6050_CAPTURE_HEADER_CHECKSUM 22U
+
+/**
+ * @brief   Little endian field access, byte by byte so blocks need no alignment
+ */
+static void mpu6050_capture_put16(uint8_t *p, uint16_t value) {
+  p[0] = value & 0xFFU;
+  p[1] = value >> 8;
+}
+
+static void mpu6050_capture_put32(uint8_t *p, uint32_t value) {
+  mpu6050_capture_put16(p, value & 0xFFFFU);
+  mpu6050_capture_put16(p + 2, value >> 16);
+}
+
+static void mpu6050_capture_put64(uint8_t *p, uint64_t value) {
+  mpu6050_capture_put32(p, value & 0xFFFFFFFFU);
+  mpu6050_capture_put32(p + 4, value >> 32);
+}
+
+static uint16_t mpu6050_capture_get16(const uint8_t *p) { return (uint16_t)(p[0] | (p[1] << 8)); }
+
+static uint32_t mpu6050_capture_get32(const uint8_t *p) {
+  return mpu6050_capture_get16(p) | ((uint32_t)mpu6050_capture_get16(p + 2) << 16);
+}
+
+static uint64_t mpu6050_capture_get64(const uint8_t *p) {
+  return mpu6050_capture_get32(p) | ((uint64_t)mpu6050_capture_get32(p + 4) << 32);
+}
+
+/**
+ * @brief   Fletcher-16 update
+ * @note    The sums are reduced every 256 bytes, they cannot overflow 32 bits before.
+ * @param   psums: Pointer to the two running sums
+ * @param   pdata: Pointer to data
+ * @param   size: Amount of data
+ */
+static void mpu6050_capture_fletcher(uint32_t *psums, const uint8_t *pdata, size_t size) {
+  while (size > 0) {
+    size_t chunk = (size > 256U) ? 256U : size;
+    size -= chunk;
+    while (chunk-- > 0) {
+      psums[0] += *pdata++;
+      psums[1] += psums[0];
+    }
+    psums[0] %= 255U;
+    psums[1] %= 255U;
+  }
+}
+
+/**
+ * @brief   Checksum of a data block, header without the checksum field and payload
+ * @param   pblock: Pointer to block
+ * @param   length: Payload bytes
+ * @retval  Fletcher-16
+ */
+static uint16_t mpu6050_capture_block_checksum(const uint8_t *pblock, uint16_t length) {
+  uint32_t sums[2] = {0, 0};
+  mpu6050_capture_fletcher(sums, pblock, MPU6050_CAPTURE_BLOCK_CHECKSUM);
+  mpu6050_capture_fletcher(sums, pblock + MPU6050_CAPTURE_BLOCK_HEADER_SIZE, length);
+  return (uint16_t)((sums[1] << 8) | sums[0]);
+}
+
+/**
+ * @brief   Append a zigzag varint
+ * @param   p: Pointer to output, at least 10 bytes available
+ * @param   value: Signed value
+ * @retval  Bytes written
+ */
+static uint8_t mpu6050_capture_put_varint(uint8_t *p, int64_t value) {
+  uint64_t zigzag = ((uint64_t)value << 1) ^ (uint64_t)(value >> 63);
+  uint8_t size = 0;
+  while (zigzag >= 0x80U) {
+    p[size++] = (uint8_t)(zigzag | 0x80U);
+    zigzag >>= 7;
+  }
+  p[size++] = (uint8_t)zigzag;
+  return size;
+}
+
+/**
+ * @brief   Decode a zigzag varint
+ * @param   pp: Pointer to input pointer, advanced past the varint
+ * @param   pend: End of the input
+ * @param   pvalue: Pointer where the signed value will be stored
+ * @retval  false if the varint runs past the end
+ */
+static bool mpu6050_capture_get_varint(const uint8_t **pp, const uint8_t *pend, int64_t *pvalue) {
+  const uint8_t *p = *pp;
+  uint64_t zigzag = 0;
+  for (uint8_t shift = 0; shift < 64; shift += 7) {
+    if (p == pend)
+      return false;
+    uint8_t byte = *p++;
+    zigzag |= (uint64_t)(byte & 0x7FU) << shift;
+    if (!(byte & 0x80U)) {
+      *pp = p;
+      *pvalue = (int64_t)(zigzag >> 1) ^ -(int64_t)(zigzag & 1U);
+      return true;
+    }
+  }
+  return false;
+}
+
+/**
+ * @brief   Read the capture configuration of a device
+ * @param   hmpu: Pointer to MPU6050 handle
+ * @param   pconfig: Pointer to configuration, source is left unchanged
+ * @retval  mpu6050_status_t
+ */
+mpu6050_status_t mpu6050_capture_config_read(mpu6050_t *hmpu, mpu6050_capture_config_t *pconfig) {
+  assert(hmpu);
+  assert(pconfig);
+  uint8_t reg_value;
+  if (mpu6050_gyro_read_config(hmpu, &reg_value) != MPU6050_OK)
+    return MPU6050_ERROR;
+  pconfig->gyro_fs = (reg_value >> MPU6050_GYRO_FS_SEL_OFFSET) & 0b11;
+  if (mpu6050_accel_read_config(hmpu, &reg_value) != MPU6050_OK)
+    return MPU6050_ERROR;
+  pconfig->accel_fs = (reg_value >> MPU6050_ACCEL_FS_SEL_OFFSET) & 0b11;
+  pconfig->dlpf = hmpu->shadow.config & MPU6050_DLPF_CFG_MASK;
+  pconfig->sample_divider = hmpu->shadow.smplrt_div;
+
+  float rate_hz;
+  if (mpu6050_read_sample_rate(hmpu, &rate_hz) != MPU6050_OK)
+    return MPU6050_ERROR;
+  pconfig->sample_period_ns = (uint32_t)(1e9f / rate_hz);
+  return MPU6050_OK;
+}
+
+/**
+ * @brief   Initialize a capture writer
+ * @param   pcap: Pointer to capture writer
+ * @param   pblock: Pointer to block buffer of block_size bytes
+ * @param   block_size: Bytes of every block, e.g. MPU6050_CAPTURE_BLOCK_SIZE
+ * @param   sink: Block sink
+ * @param   pcontext: Context given to the sink
+ * @retval  mpu6050_status_t, error if the block cannot hold a sample
+ */
+mpu6050_status_t mpu6050_capture_init(mpu6050_capture_t *pcap, uint8_t *pblock, uint16_t block_size,
+                                      mpu6050_capture_sink_t sink, void *pcontext) {
+  assert(pcap);
+  assert(pblock);
+  assert(sink);
+  if (block_size < MPU6050_CAPTURE_BLOCK_HEADER_SIZE + MPU6050_CAPTURE_SAMPLE_MAX)
+    return MPU6050_ERROR;
+  *pcap = (mpu6050_capture_t){0};
+  pcap->pblock = pblock;
+  pcap->block_size = block_size;
+  pcap->sink = sink;
+  pcap->pcontext = pcontext;
+  return MPU6050_OK;
+}
+
+/**
+ * @brief   Start a capture, writes the header block
+ * @param   pcap: Pointer to capture writer
+ * @param   pconfig: Pointer to device configuration
+ * @retval  mpu6050_status_t
+ */
+mpu6050_status_t mpu6050_capture_start(mpu6050_capture_t *pcap,
+                                       const mpu6050_capture_config_t *pconfig) {
+  assert(pcap);
+  assert(pconfig);
+  uint8_t *p = pcap->pblock;
+  memset(p, 0xFF, pcap->block_size);
+  mpu6050_capture_put32(p, MPU6050_CAPTURE_MAGIC);
+  mpu6050_capture_put16(p + MPU6050_CAPTURE_HEADER_VERSION, MPU6050_CAPTURE_VERSION);
+  mpu6050_capture_put16(p + MPU6050_CAPTURE_HEADER_BLOCK_SIZE, pcap->block_size);
+  p[MPU6050_CAPTURE_HEADER_CONFIG] = pconfig->gyro_fs;
+  p[MPU6050_CAPTURE_HEADER_CONFIG + 1] = pconfig->accel_fs;
+  p[MPU6050_CAPTURE_HEADER_CONFIG + 2] = pconfig->dlpf;
+  p[MPU6050_CAPTURE_HEADER_CONFIG + 3] = pconfig->sample_divider;
+  mpu6050_capture_put32(p + MPU6050_CAPTURE_HEADER_PERIOD, pconfig->sample_period_ns);
+  mpu6050_capture_put32(p + MPU6050_CAPTURE_HEADER_SOURCE, pconfig->source);
+  mpu6050_capture_put16(p + MPU6050_CAPTURE_HEADER_CHANNELS, MPU6050_CAPTURE_CHANNELS);
+  uint32_t sums[2] = {0, 0};
+  mpu6050_capture_fletcher(sums, p, MPU6050_CAPTURE_HEADER_CHECKSUM);
+  mpu6050_capture_put16(p + MPU6050_CAPTURE_HEADER_CHECKSUM, (uint16_t)((sums[1] << 8) | sums[0]));
+
+  pcap->used = 0;
+  pcap->count = 0;
+  pcap->seq = 0;
+  pcap->samples = 0;
+  pcap->blocks_lost = 0;
+  return pcap->sink(pcap->pcontext, p, pcap->block_size);
+}
+
+/**
+ * @brief   Append a sample to the capture
+ * @note    The block is written to the sink once the next sample may not fit. If the sink
+ * fails the block is lost and counted, the capture goes on with the next block.
+ * @param   pcap: Pointer to capture writer
+ * @param   psample: Pointer to raw sample
+ * @param   timestamp_ns: Port time of the sample
+ * @retval  mpu6050_status_t, error if a block was lost
+ */
+mpu6050_status_t mpu6050_capture_add(mpu6050_capture_t *pcap, const mpu6050_sample_t *psample,
+                                     uint64_t timestamp_ns) {
+  assert(pcap);
+  assert(psample);
+  if (pcap->count == 0) {
+    memset(pcap->pblock, 0xFF, pcap->block_size);
+    mpu6050_capture_put64(pcap->pblock + MPU6050_CAPTURE_BLOCK_START, timestamp_ns);
+    memset(pcap->prev, 0, sizeof(pcap->prev));
+    pcap->prev_ns = timestamp_ns;
+    pcap->prev_delta_ns = 0;
+    pcap->used = MPU6050_CAPTURE_BLOCK_HEADER_SIZE;
+  }
+
+  /* Channels follow the output registers order */
+  const uint16_t raw[MPU6050_CAPTURE_CHANNELS] = {
+      psample->accel[0], psample->accel[1], psample->accel[2], psample->temp,
+      psample->gyro[0],  psample->gyro[1],  psample->gyro[2],
+  };
+  uint8_t *p = pcap->pblock + pcap->used;
+  int64_t delta_ns = (int64_t)(timestamp_ns - pcap->prev_ns);
+  p += mpu6050_capture_put_varint(p, delta_ns - pcap->prev_delta_ns);
+  for (uint8_t channel = 0; channel < MPU6050_CAPTURE_CHANNELS; channel++) {
+    int16_t value = (int16_t)raw[channel];
+    p += mpu6050_capture_put_varint(p, (int32_t)value - pcap->prev[channel]);
+    pcap->prev[channel] = value;
+  }
+  pcap->prev_ns = timestamp_ns;
+  pcap->prev_delta_ns = delta_ns;
+  pcap->used = (uint16_t)(p - pcap->pblock);
+  pcap->count++;
+  pcap->samples++;
+
+  if (pcap->used + MPU6050_CAPTURE_SAMPLE_MAX > pcap->block_size)
+    return mpu6050_capture_flush(pcap);
+  return MPU6050_OK;
+}
+
+/**
+ * @brief   Write the block in progress, padded to the block size
+ * @note    Called at the end of a capture. Flushing often wastes the rest of each block.
+ * @param   pcap: Pointer to capture writer
+ * @retval  mpu6050_status_t
+ */
+mpu6050_status_t mpu6050_capture_flush(mpu6050_capture_t *pcap) {
+  assert(pcap);
+  if (pcap->count == 0)
+    return MPU6050_OK;
+
+  uint8_t *p = pcap->pblock;
+  uint16_t length = pcap->used - MPU6050_CAPTURE_BLOCK_HEADER_SIZE;
+  mpu6050_capture_put32(p, MPU6050_CAPTURE_BLOCK_MAGIC);
+  mpu6050_capture_put32(p + MPU6050_CAPTURE_BLOCK_SEQ, pcap->seq);
+  mpu6050_capture_put16(p + MPU6050_CAPTURE_BLOCK_COUNT, pcap->count);
+  mpu6050_capture_put16(p + MPU6050_CAPTURE_BLOCK_LENGTH, length);
+  mpu6050_capture_put16(p + MPU6050_CAPTURE_BLOCK_CHECKSUM,
+                        mpu6050_capture_block_checksum(p, length));
+  pcap->seq++;
+  pcap->count = 0;
+  if (pcap->sink(pcap->pcontext, p, pcap->block_size) != MPU6050_OK) {
+    pcap->blocks_lost++;
+    return MPU6050_ERROR;
+  }
+  return MPU6050_OK;
+}
+
+/**
+ * @brief   Data block of a capture
+ * @param   preader: Pointer to capture reader
+ * @param   block: Data block, from 0
+ * @retval  Pointer to block
+ */
+static const uint8_t *mpu6050_capture_block(const mpu6050_capture_reader_t *preader,
+                                            uint32_t block) {
+  return preader->pdata + (size_t)(block + 1U) * preader->block_size;
+}
+
+/**
+ * @brief   Move the cursor to the first valid data block from a block
+ * @note    Blocks with a bad marker or checksum, e.g. erased flash or a torn write, are skipped.
+ * @param   preader: Pointer to capture reader
+ * @param   block: First block to try
+ */
+static void mpu6050_capture_enter(mpu6050_capture_reader_t *preader, uint32_t block) {
+  mpu6050_capture_cursor_t *pcursor = &preader->cursor;
+  for (; block < preader->blocks; block++) {
+    const uint8_t *p = mpu6050_capture_block(preader, block);
+    uint16_t length = mpu6050_capture_get16(p + MPU6050_CAPTURE_BLOCK_LENGTH);
+    if (mpu6050_capture_get32(p) != MPU6050_CAPTURE_BLOCK_MAGIC ||
+        length > preader->block_size - MPU6050_CAPTURE_BLOCK_HEADER_SIZE ||
+        mpu6050_capture_get16(p + MPU6050_CAPTURE_BLOCK_CHECKSUM) !=
+            mpu6050_capture_block_checksum(p, length)) {
+      preader->blocks_bad++;
+      continue;
+    }
+    pcursor->block = block;
+    pcursor->pnext = p + MPU6050_CAPTURE_BLOCK_HEADER_SIZE;
+    pcursor->remaining = mpu6050_capture_get16(p + MPU6050_CAPTURE_BLOCK_COUNT);
+    memset(pcursor->value, 0, sizeof(pcursor->value));
+    pcursor->timestamp_ns = mpu6050_capture_get64(p + MPU6050_CAPTURE_BLOCK_START);
+    pcursor->delta_ns = 0;
+    return;
+  }
+  pcursor->block = preader->blocks;
+  pcursor->remaining = 0;
+}
+
+/**
+ * @brief   Open a capture in memory
+ * @note    The capture is decoded in place and must stay mapped while the reader is used. A
+ * trailing partial block is ignored.
+ * @param   preader: Pointer to capture reader
+ * @param   pdata: Pointer to capture, header block first
+ * @param   size: Bytes of the capture
+ * @retval  mpu6050_status_t, error if the header block is not valid
+ */
+mpu6050_status_t mpu6050_capture_open(mpu6050_capture_reader_t *preader, const void *pdata,
+                                      size_t size) {
+  assert(preader);
+  assert(pdata);
+  const uint8_t *p = pdata;
+  *preader = (mpu6050_capture_reader_t){0};
+  if (size < MPU6050_CAPTURE_HEADER_SIZE || mpu6050_capture_get32(p) != MPU6050_CAPTURE_MAGIC)
+    return MPU6050_ERROR;
+  uint32_t sums[2] = {0, 0};
+  mpu6050_capture_fletcher(sums, p, MPU6050_CAPTURE_HEADER_CHECKSUM);
+  if (mpu6050_capture_get16(p + MPU6050_CAPTURE_HEADER_CHECKSUM) !=
+      (uint16_t)((sums[1] << 8) | sums[0]))
+    return MPU6050_ERROR;
+  uint16_t block_size = mpu6050_capture_get16(p + MPU6050_CAPTURE_HEADER_BLOCK_SIZE);
+  if (mpu6050_capture_get16(p + MPU6050_CAPTURE_HEADER_VERSION) != MPU6050_CAPTURE_VERSION ||
+      mpu6050_capture_get16(p + MPU6050_CAPTURE_HEADER_CHANNELS) != MPU6050_CAPTURE_CHANNELS ||
+      block_size < MPU6050_CAPTURE_BLOCK_HEADER_SIZE + MPU6050_CAPTURE_SAMPLE_MAX ||
+      size < block_size)
+    return MPU6050_ERROR;
+
+  preader->pdata = p;
+  preader->size = size;
+  preader->block_size = block_size;
+  preader->blocks = (uint32_t)(size / block_size - 1U);
+  preader->config.gyro_fs = p[MPU6050_CAPTURE_HEADER_CONFIG];
+  preader->config.accel_fs = p[MPU6050_CAPTURE_HEADER_CONFIG + 1];
+  preader->config.dlpf = p[MPU6050_CAPTURE_HEADER_CONFIG + 2];
+  preader->config.sample_divider = p[MPU6050_CAPTURE_HEADER_CONFIG + 3];
+  preader->config.sample_period_ns = mpu6050_capture_get32(p + MPU6050_CAPTURE_HEADER_PERIOD);
+  preader->config.source = mpu6050_capture_get32(p + MPU6050_CAPTURE_HEADER_SOURCE);
+  mpu6050_capture_enter(preader, 0);
+  return MPU6050_OK;
+}
+
+/**
+ * @brief   Decode one sample at the cursor
+ * @param   pcursor: Pointer to decoding position
+ * @param   pend: End of the block
+ * @retval  false if the sample runs past the end of the block
+ */
+static bool mpu6050_capture_decode(mpu6050_capture_cursor_t *pcursor, const uint8_t *pend) {
+  const uint8_t *p = pcursor->pnext;
+  int64_t value;
+  if (!mpu6050_capture_get_varint(&p, pend, &value))
+    return false;
+  pcursor->delta_ns += value;
+  pcursor->timestamp_ns += (uint64_t)pcursor->delta_ns;
+  for (uint8_t channel = 0; channel < MPU6050_CAPTURE_CHANNELS; channel++) {
+    if (!mpu6050_capture_get_varint(&p, pend, &value))
+      return false;
+    pcursor->value[channel] = (int16_t)(pcursor->value[channel] + value);
+  }
+  pcursor->pnext = p;
+  pcursor->remaining--;
+  return true;
+}
+
+/**
+ * @brief   Decode the next sample of a capture
+ * @param   preader: Pointer to capture reader
+ * @param   psample: Pointer to sample where measurements will be stored
+ * @param   ptimestamp_ns: Pointer where the sample time will be stored, NULL if not needed
+ * @retval  false at the end of the capture
+ */
+bool mpu6050_capture_next(mpu6050_capture_reader_t *preader, mpu6050_sample_t *psample,
+                          uint64_t *ptimestamp_ns) {
+  assert(preader);
+  assert(psample);
+  mpu6050_capture_cursor_t *pcursor = &preader->cursor;
+  for (;;) {
+    while (pcursor->remaining == 0) {
+      if (pcursor->block >= preader->blocks)
+        return false;
+      mpu6050_capture_enter(preader, pcursor->block + 1U);
+    }
+    const uint8_t *pend = mpu6050_capture_block(preader, pcursor->block) + preader->block_size;
+    if (mpu6050_capture_decode(pcursor, pend))
+      break;
+    /* Only reachable with a corrupted block that passed the checksum */
+    preader->blocks_bad++;
+    pcursor->remaining = 0;
+  }
+
+  const int16_t *pvalue = pcursor->value;
+  psample->accel[0] = (uint16_t)pvalue[0];
+  psample->accel[1] = (uint16_t)pvalue[1];
+  psample->accel[2] = (uint16_t)pvalue[2];
+  psample->temp = (uint16_t)pvalue[3];
+  psample->gyro[0] = (uint16_t)pvalue[4];
+  psample->gyro[1] = (uint16_t)pvalue[5];
+  psample->gyro[2] = (uint16_t)pvalue[6];
+  if (ptimestamp_ns != NULL)
+    *ptimestamp_ns = pcursor->timestamp_ns;
+  return true;
+}
+
+/**
+ * @brief   Seek to the first sample at or after a time
+ * @note    Binary search over the start time of the fixed-size blocks, then the samples of one
+ * block are decoded. Timestamps are expected to increase along the capture.
+ * @param   preader: Pointer to capture reader
+ * @param   time_ns: Port time to seek to
+ * @retval  mpu6050_status_t, error if every sample is before the time
+ */
+mpu6050_status_t mpu6050_capture_seek(mpu6050_capture_reader_t *preader, uint64_t time_ns) {
+  assert(preader);
+  /* Last block starting at or before the time */
+  uint32_t low = 0;
+  uint32_t high = preader->blocks;
+  while (high - low > 1U) {
+    uint32_t mid = low + (high - low) / 2U;
+    const uint8_t *p = mpu6050_capture_block(preader, mid);
+    if (mpu6050_capture_get64(p + MPU6050_CAPTURE_BLOCK_START) <= time_ns)
+      low = mid;
+    else
+      high = mid;
+  }
+  mpu6050_capture_enter(preader, low);
+
+  mpu6050_sample_t sample;
+  uint64_t timestamp_ns;
+  for (;;) {
+    mpu6050_capture_cursor_t saved = preader->cursor;
+    if (!mpu6050_capture_next(preader, &sample, &timestamp_ns))
+      return MPU6050_ERROR;
+    if (timestamp_ns >= time_ns) {
+      preader->cursor = saved;
+      return MPU6050_OK;
+    }
+  }
+}
+
+/**
+ * @brief   Go back to the first sample of a capture
+ * @param   preader: Pointer to capture reader
+ */
+void mpu6050_capture_rewind(mpu6050_capture_reader_t *preader) {
+  assert(preader);
+  mpu6050_capture_enter(preader, 0);
+}
@@ -0,0 +1,70 @@
+/**
+ ******************************************************************************
+ * @file           : mpu6050_capture_linux.c
+ * @author         : Gonzalo Gabriel Fernandez
+ * @brief          : MPU6050 binary capture reader for Linux
+ ******************************************************************************
+ * @attention
+ *
+ * Capture files are mapped read-only and decoded in place by the capture
+ * reader, no sample is copied through a read buffer. Pages are loaded on
+ * demand, so a seek only touches the pages of the binary search.
+ *
+ ******************************************************************************
+ */
+
+#define _GNU_SOURCE
+
+#include <assert.h>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "mpu6050_capture.h"
+
+/**
+ * @brief Map a capture file and open it
+ * @param preader: Pointer to capture reader
+ * @param path: Path of the capture file
+ * @retval mpu6050_status_t
+ */
+mpu6050_status_t mpu6050_capture_map(mpu6050_capture_reader_t *preader, const char *path) {
+  assert(preader);
+  assert(path);
+  int fd = open(path, O_RDONLY | O_CLOEXEC);
+  if (fd < 0)
+    return MPU6050_ERROR;
+  struct stat st;
+  if (fstat(fd, &st) != 0 || st.st_size == 0) {
+    close(fd);
+    return MPU6050_ERROR;
+  }
+  void *pdata = mmap(NULL, (size_t)st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+  /* The mapping keeps its own reference to the file */
+  close(fd);
+  if (pdata == MAP_FAILED)
+    return MPU6050_ERROR;
+  madvise(pdata, (size_t)st.st_size, MADV_SEQUENTIAL);
+
+  if (mpu6050_capture_open(preader, pdata, (size_t)st.st_size) != MPU6050_OK) {
+    munmap(pdata, (size_t)st.st_size);
+    return MPU6050_ERROR;
+  }
+  return MPU6050_OK;
+}
+
+/**
+ * @brief Unmap a capture file opened with mpu6050_capture_map
+ * @param preader: Pointer to capture reader
+ */
+void mpu6050_capture_unmap(mpu6050_capture_reader_t *preader) {
+  assert(preader);
+  if (preader->pdata != NULL)
+    munmap((void *)preader->pdata, preader->size);
+  preader->pdata = NULL;
+  preader->size = 0;
+  preader->blocks = 0;
+  preader->cursor.block = 0;
+  preader->cursor.remaining = 0;
+}
@@ -0,0 +1,307 @@
+/**
+ ******************************************************************************
+ * @file           : mpu6050_convert.c
+ * @author         : Gonzalo Gabriel Fernandez
+ * @brief          : MPU6050 raw to SI conversion
+ ******************************************************************************
+ * @attention
+ *
+ * Measurements are handled as a flat stream of 16-bit values, seven per frame,
+ * so the SI kernels are a multiply-add with a per channel scale and offset.
+ * The vector paths process eight frames per block, where the channel pattern
+ * repeats on vector boundaries. Selected at compile time from the target
+ * instruction set, define MPU6050_CONVERT_NO_SIMD to force the scalar path.
+ *
+ ******************************************************************************
+ */
+
+#include "mpu6050_convert.h"
+#include "mpu6050_registers.h"
+
+#include <assert.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <string.h>
+
+#ifndef MPU6050_CONVERT_NO_SIMD
+#if defined(__AVX2__)
+#define MPU6050_CONVERT_AVX2
+#include <immintrin.h>
+#elif defined(__SSE2__)
+#define MPU6050_CONVERT_SSE2
+#include <emmintrin.h>
+#elif defined(__ARM_NEON)
+#define MPU6050_CONVERT_NEON
+#include <arm_neon.h>
+#endif
+#endif
+
+#define MPU6050_CONVERT_G 9.80665f                    /*! Standard gravity in m/s^2 */
+#define MPU6050_CONVERT_DEG2RAD 0.017453292519943295f /*! Degrees to radians */
+#define MPU6050_CONVERT_TEMP_SCALE (1.0f / 340.0f)    /*! Temperature sensitivity */
+#define MPU6050_CONVERT_TEMP_OFFSET 36.53f            /*! Temperature offset in Celsius */
+#define MPU6050_CONVERT_TEMP_CHANNEL 3U               /*! Temperature channel index */
+#define MPU6050_CONVERT_BLOCK_FRAMES 8U               /*! Frames per vector block */
+#define MPU6050_CONVERT_BLOCK_VALUES                                                               \
+  (MPU6050_CONVERT_BLOCK_FRAMES * MPU6050_CONVERT_CHANNELS) /*! Values per vector block */
+
+_Static_assert(sizeof(mpu6050_sample_t) == MPU6050_SENSOR_DATA_LEN,
+               "mpu6050_sample_t must be seven packed 16-bit values");
+_Static_assert(sizeof(mpu6050_si_sample_t) == MPU6050_CONVERT_CHANNELS * sizeof(float),
+               "mpu6050_si_sample_t must be seven packed floats");
+_Static_assert(sizeof(mpu6050_q16_sample_t) == MPU6050_CONVERT_CHANNELS * sizeof(int32_t),
+               "mpu6050_q16_sample_t must be seven packed 32-bit values");
+
+/**
+ * @brief   Load a 16-bit measurement
+ * @param   praw: Pointer to the measurement bytes
+ * @param   big_endian: Measurement is in device byte order instead of host order
+ * @retval  Signed measurement
+ */
+static inline int16_t mpu6050_convert_load(const uint8_t *praw, bool big_endian) {
+  if (big_endian)
+    return (int16_t)(((uint16_t)praw[0] << 8) | praw[1]);
+  int16_t value;
+  memcpy(&value, praw, sizeof(value));
+  return value;
+}
+
+/**
+ * @brief   Convert a value stream to SI units
+ * @param   praw: Pointer to the raw values, seven per frame
+ * @param   big_endian: Values are in device byte order instead of host order
+ * @param   count: Amount of frames
+ * @param   pscale: Pointer to scale factors
+ * @param   pout: Pointer to output, seven floats per frame
+ */
+static void mpu6050_convert_si(const uint8_t *praw, bool big_endian, uint32_t count,
+                               const mpu6050_convert_scale_t *pscale, float *pout) {
+  uint32_t frame = 0;
+
+#if defined(MPU6050_CONVERT_AVX2) || defined(MPU6050_CONVERT_SSE2) ||                              \
+    defined(MPU6050_CONVERT_NEON)
+  /* Channel pattern unrolled over a block, so each vector uses its own scale slice */
+  float scale[MPU6050_CONVERT_BLOCK_VALUES];
+  float offset[MPU6050_CONVERT_BLOCK_VALUES];
+  for (uint32_t i = 0; i < MPU6050_CONVERT_BLOCK_VALUES; i++) {
+    scale[i] = pscale->scale[i % MPU6050_CONVERT_CHANNELS];
+    offset[i] = pscale->offset[i % MPU6050_CONVERT_CHANNELS];
+  }
+
+  for (; frame + MPU6050_CONVERT_BLOCK_FRAMES <= count; frame += MPU6050_CONVERT_BLOCK_FRAMES) {
+    const uint8_t *pin = praw + frame * MPU6050_SENSOR_DATA_LEN;
+    float *pdst = pout + frame * MPU6050_CONVERT_CHANNELS;
+    for (uint32_t i = 0; i < MPU6050_CONVERT_BLOCK_VALUES; i += 8U) {
+#if defined(MPU6050_CONVERT_AVX2)
+      __m128i v = _mm_loadu_si128((const __m128i *)(pin + 2U * i));
+      if (big_endian)
+        v = _mm_or_si128(_mm_slli_epi16(v, 8), _mm_srli_epi16(v, 8));
+      __m256 f = _mm256_cvtepi32_ps(_mm256_cvtepi16_epi32(v));
+      f = _mm256_add_ps(_mm256_mul_ps(f, _mm256_loadu_ps(&scale[i])), _mm256_loadu_ps(&offset[i]));
+      _mm256_storeu_ps(pdst + i, f);
+#elif defined(MPU6050_CONVERT_SSE2)
+      __m128i v = _mm_loadu_si128((const __m128i *)(pin + 2U * i));
+      if (big_endian)
+        v = _mm_or_si128(_mm_slli_epi16(v, 8), _mm_srli_epi16(v, 8));
+      /* Sign extension: value into the upper half, arithmetic shift back down */
+      __m128 lo = _mm_cvtepi32_ps(_mm_srai_epi32(_mm_unpacklo_epi16(v, v), 16));
+      __m128 hi = _mm_cvtepi32_ps(_mm_srai_epi32(_mm_unpackhi_epi16(v, v), 16));
+      lo = _mm_add_ps(_mm_mul_ps(lo, _mm_loadu_ps(&scale[i])), _mm_loadu_ps(&offset[i]));
+      hi = _mm_add_ps(_mm_mul_ps(hi, _mm_loadu_ps(&scale[i + 4U])), _mm_loadu_ps(&offset[i + 4U]));
+      _mm_storeu_ps(pdst + i, lo);
+      _mm_storeu_ps(pdst + i + 4U, hi);
+#elif defined(MPU6050_CONVERT_NEON)
+      uint8x16_t bytes = vld1q_u8(pin + 2U * i);
+      if (big_endian)
+        bytes = vrev16q_u8(bytes);
+      int16x8_t v = vreinterpretq_s16_u8(bytes);
+      float32x4_t lo = vcvtq_f32_s32(vmovl_s16(vget_low_s16(v)));
+      float32x4_t hi = vcvtq_f32_s32(vmovl_s16(vget_high_s16(v)));
+      lo = vmlaq_f32(vld1q_f32(&offset[i]), lo, vld1q_f32(&scale[i]));
+      hi = vmlaq_f32(vld1q_f32(&offset[i + 4U]), hi, vld1q_f32(&scale[i + 4U]));
+      vst1q_f32(pdst + i, lo);
+      vst1q_f32(pdst + i + 4U, hi);
+#endif
+    }
+  }
+#endif
+
+  for (; frame < count; frame++) {
+    const uint8_t *pin = praw + frame * MPU6050_SENSOR_DATA_LEN;
+    float *pdst = pout + frame * MPU6050_CONVERT_CHANNELS;
+    for (uint32_t ch = 0; ch < MPU6050_CONVERT_CHANNELS; ch++)
+      pdst[ch] = (float)mpu6050_convert_load(pin + 2U * ch, big_endian) * pscale->scale[ch] +
+                 pscale->offset[ch];
+  }
+}
+
+/**
+ * @brief   Convert a value stream to Q16.16 fixed-point
+ * @note    Integer only, intended for targets without FPU.
+ * @param   praw: Pointer to the raw values, seven per frame
+ * @param   big_endian: Values are in device byte order instead of host order
+ * @param   count: Amount of frames
+ * @param   pscale: Pointer to scale factors
+ * @param   pout: Pointer to output, seven Q16.16 values per frame
+ */
+static void mpu6050_convert_q16(const uint8_t *praw, bool big_endian, uint32_t count,
+                                const mpu6050_convert_scale_t *pscale, int32_t *pout) {
+  for (uint32_t frame = 0; frame < count; frame++) {
+    const uint8_t *pin = praw + frame * MPU6050_SENSOR_DATA_LEN;
+    int32_t *pdst = pout + frame * MPU6050_CONVERT_CHANNELS;
+    for (uint32_t ch = 0; ch < MPU6050_CONVERT_CHANNELS; ch++) {
+      int64_t product = (int64_t)mpu6050_convert_load(pin + 2U * ch, big_endian) *
+                        pscale->scale_q32[ch];
+      pdst[ch] = (int32_t)((product + (1 << 15)) >> 16) + pscale->offset_q16[ch];
+    }
+  }
+}
+
+/**
+ * @brief   Scale factors for the given full scale settings
+ * @param   gyro_fullscale: Gyro Full Scale
+ * @param   accel_fullscale: Accel Full Scale
+ * @param   pscale: Pointer to scale factors to fill
+ */
+void mpu6050_convert_scale(mpu6050_gyroconfig_fs_t gyro_fullscale,
+                           mpu6050_accelconfig_fs_t accel_fullscale,
+                           mpu6050_convert_scale_t *pscale) {
+  assert(pscale);
+  /* Full scale doubles with each setting: 2g << FS_SEL, 250dps << FS_SEL */
+  float accel = (float)(2U << accel_fullscale) * MPU6050_CONVERT_G / 32768.0f;
+  float gyro = (float)(250U << gyro_fullscale) * MPU6050_CONVERT_DEG2RAD / 32768.0f;
+
+  for (uint32_t ch = 0; ch < MPU6050_CONVERT_CHANNELS; ch++) {
+    if (ch < MPU6050_CONVERT_TEMP_CHANNEL)
+      pscale->scale[ch] = accel;
+    else if (ch == MPU6050_CONVERT_TEMP_CHANNEL)
+      pscale->scale[ch] = MPU6050_CONVERT_TEMP_SCALE;
+    else
+      pscale->scale[ch] = gyro;
+    pscale->offset[ch] = (ch == MPU6050_CONVERT_TEMP_CHANNEL) ? MPU6050_CONVERT_TEMP_OFFSET : 0.0f;
+
+    pscale->scale_q32[ch] = (int32_t)((double)pscale->scale[ch] * 4294967296.0 + 0.5);
+    pscale->offset_q16[ch] = (int32_t)((double)pscale->offset[ch] * 65536.0 + 0.5);
+  }
+}
+
+/**
+ * @brief   Scale factors for the current device full scale settings
+ * @note    Served from the configuration shadow, no bus transaction while it is valid.
+ * @param   hmpu: Pointer to MPU6050 handle
+ * @param   pscale: Pointer to scale factors to fill
+ * @retval  mpu6050_status_t
+ */
+mpu6050_status_t mpu6050_convert_scale_read(mpu6050_t *hmpu, mpu6050_convert_scale_t *pscale) {
+  uint8_t gyro_config;
+  uint8_t accel_config;
+  if (mpu6050_gyro_read_config(hmpu, &gyro_config) != MPU6050_OK)
+    return MPU6050_ERROR;
+  if (mpu6050_accel_read_config(hmpu, &accel_config) != MPU6050_OK)
+    return MPU6050_ERROR;
+
+  gyro_config = (gyro_config >> MPU6050_GYRO_FS_SEL_OFFSET) & 0b11;
+  accel_config = (accel_config >> MPU6050_ACCEL_FS_SEL_OFFSET) & 0b11;
+  mpu6050_convert_scale((mpu6050_gyroconfig_fs_t)gyro_config,
+                        (mpu6050_accelconfig_fs_t)accel_config, pscale);
+  return MPU6050_OK;
+}
+
+/**
+ * @brief   Convert raw frames to signed counts in host byte order
+ * @note    Counts are Q15 fractions of the configured full scale.
+ * @param   pframes: Pointer to raw frames, 14 bytes each
+ * @param   count: Amount of frames
+ * @param   pout: Pointer to output, seven values per frame
+ */
+void mpu6050_convert_frames_int16(const uint8_t *pframes, uint32_t count, int16_t *pout) {
+  assert(pframes);
+  assert(pout);
+  uint32_t len = count * MPU6050_SENSOR_DATA_LEN;
+  uint32_t i = 0;
+
+#if defined(MPU6050_CONVERT_AVX2) || defined(MPU6050_CONVERT_SSE2) ||                              \
+    defined(MPU6050_CONVERT_NEON)
+  uint8_t *pdst = (uint8_t *)pout;
+#endif
+#if defined(MPU6050_CONVERT_AVX2)
+  for (; i + 32U <= len; i += 32U) {
+    __m256i v = _mm256_loadu_si256((const __m256i *)(pframes + i));
+    v = _mm256_or_si256(_mm256_slli_epi16(v, 8), _mm256_srli_epi16(v, 8));
+    _mm256_storeu_si256((__m256i *)(pdst + i), v);
+  }
+#elif defined(MPU6050_CONVERT_SSE2)
+  for (; i + 16U <= len; i += 16U) {
+    __m128i v = _mm_loadu_si128((const __m128i *)(pframes + i));
+    v = _mm_or_si128(_mm_slli_epi16(v, 8), _mm_srli_epi16(v, 8));
+    _mm_storeu_si128((__m128i *)(pdst + i), v);
+  }
+#elif defined(MPU6050_CONVERT_NEON)
+  for (; i + 16U <= len; i += 16U)
+    vst1q_u8(pdst + i, vrev16q_u8(vld1q_u8(pframes + i)));
+#endif
+
+  for (; i < len; i += 2U)
+    pout[i / 2U] = mpu6050_convert_load(pframes + i, true);
+}
+
+/**
+ * @brief   Convert raw frames to SI units
+ * @param   pframes: Pointer to raw frames, 14 bytes each
+ * @param   count: Amount of frames
+ * @param   pscale: Pointer to scale factors
+ * @param   pout: Pointer to output samples
+ */
+void mpu6050_convert_frames_si(const uint8_t *pframes, uint32_t count,
+                               const mpu6050_convert_scale_t *pscale, mpu6050_si_sample_t *pout) {
+  assert(pframes);
+  assert(pscale);
+  assert(pout);
+  mpu6050_convert_si(pframes, true, count, pscale, (float *)pout);
+}
+
+/**
+ * @brief   Convert raw frames to Q16.16 fixed-point
+ * @param   pframes: Pointer to raw frames, 14 bytes each
+ * @param   count: Amount of frames
+ * @param   pscale: Pointer to scale factors
+ * @param   pout: Pointer to output samples
+ */
+void mpu6050_convert_frames_q16(const uint8_t *pframes, uint32_t count,
+                                const mpu6050_convert_scale_t *pscale, mpu6050_q16_sample_t *pout) {
+  assert(pframes);
+  assert(pscale);
+  assert(pout);
+  mpu6050_convert_q16(pframes, true, count, pscale, (int32_t *)pout);
+}
+
+/**
+ * @brief   Convert decoded samples to SI units
+ * @param   psamples: Pointer to samples
+ * @param   count: Amount of samples
+ * @param   pscale: Pointer to scale factors
+ * @param   pout: Pointer to output samples
+ */
+void mpu6050_convert_samples_si(const mpu6050_sample_t *psamples, uint32_t count,
+                                const mpu6050_convert_scale_t *pscale, mpu6050_si_sample_t *pout) {
+  assert(psamples);
+  assert(pscale);
+  assert(pout);
+  mpu6050_convert_si((const uint8_t *)psamples, false, count, pscale, (float *)pout);
+}
+
+/**
+ * @brief   Convert decoded samples to Q16.16 fixed-point
+ * @param   psamples: Pointer to samples
+ * @param   count: Amount of samples
+ * @param   pscale: Pointer to scale factors
+ * @param   pout: Pointer to output samples
+ */
+void mpu6050_convert_samples_q16(const mpu6050_sample_t *psamples, uint32_t count,
+                                 const mpu6050_convert_scale_t *pscale,
+                                 mpu6050_q16_sample_t *pout) {
+  assert(psamples);
+  assert(pscale);
+  assert(pout);
+  mpu6050_convert_q16((const uint8_t *)psamples, false, count, pscale, (int32_t *)pout);
+}
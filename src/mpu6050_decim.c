@@ -0,0 +1,234 @@
+/**
+ ******************************************************************************
+ * @file           : mpu6050_decim.c
+ * @author         : Gonzalo Gabriel Fernandez
+ * @brief          : MPU6050 anti-alias decimation
+ ******************************************************************************
+ * @attention
+ *
+ * Input samples go into a delay line per filtered channel, and every ratio
+ * samples each line is reduced with a dot product against the coefficients.
+ * Products are accumulated in 32 bits, exact as long as the sum of the
+ * coefficient magnitudes stays below 2.0 in Q15, which holds for low-pass
+ * designs. The vector paths are selected at compile time from the target
+ * instruction set, define MPU6050_DECIM_NO_SIMD to force the scalar path.
+ *
+ ******************************************************************************
+ */
+
+#include "mpu6050_decim.h"
+
+#include <assert.h>
+#include <math.h>
+#include <string.h>
+
+#ifndef MPU6050_DECIM_NO_SIMD
+#if defined(__AVX2__)
+#define MPU6050_DECIM_AVX2
+#include <immintrin.h>
+#elif defined(__SSE2__)
+#define MPU6050_DECIM_SSE2
+#include <emmintrin.h>
+#elif defined(__ARM_NEON)
+#define MPU6050_DECIM_NEON
+#include <arm_neon.h>
+#elif defined(__ARM_FEATURE_DSP)
+#define MPU6050_DECIM_DSP
+#include <arm_acle.h>
+#endif
+#endif
+
+#define MPU6050_DECIM_PI 3.14159265358979f /*! Pi */
+#define MPU6050_DECIM_Q15_ONE 32767        /*! Unity gain in Q15 */
+
+_Static_assert(sizeof(mpu6050_sample_t) == MPU6050_DECIM_CHANNELS * sizeof(uint16_t),
+               "mpu6050_sample_t must be seven packed 16-bit values");
+
+/**
+ * @brief   Blackman windowed sinc tap
+ * @param   index: Tap index
+ * @param   taps: Filter length
+ * @param   cutoff: Cutoff frequency as a fraction of the sample rate
+ * @retval  Tap value
+ */
+static float mpu6050_decim_tap(uint16_t index, uint16_t taps, float cutoff) {
+  float m = (float)index - (float)(taps - 1U) * 0.5f;
+  float sinc = (m == 0.0f) ? 2.0f * cutoff
+                           : sinf(2.0f * MPU6050_DECIM_PI * cutoff * m) / (MPU6050_DECIM_PI * m);
+  if (taps == 1U)
+    return sinc;
+  float x = (float)index / (float)(taps - 1U);
+  return sinc * (0.42f - 0.5f * cosf(2.0f * MPU6050_DECIM_PI * x) +
+                 0.08f * cosf(4.0f * MPU6050_DECIM_PI * x));
+}
+
+/**
+ * @brief   Dot product of a delay line window and the coefficients
+ * @param   pwindow: Pointer to the oldest sample of the window
+ * @param   pcoeffs: Pointer to the coefficients, oldest sample first
+ * @param   taps: Window length, a multiple of MPU6050_DECIM_BLOCK
+ * @retval  Q15 accumulation
+ */
+static inline int32_t mpu6050_decim_dot(const int16_t *pwindow, const int16_t *pcoeffs,
+                                        uint16_t taps) {
+  int32_t acc = 0;
+  uint16_t i = 0;
+#if defined(MPU6050_DECIM_AVX2)
+  __m256i sum = _mm256_setzero_si256();
+  for (; i < taps; i += 16U) {
+    __m256i x = _mm256_loadu_si256((const __m256i *)&pwindow[i]);
+    __m256i h = _mm256_loadu_si256((const __m256i *)&pcoeffs[i]);
+    sum = _mm256_add_epi32(sum, _mm256_madd_epi16(x, h));
+  }
+  __m128i half = _mm_add_epi32(_mm256_castsi256_si128(sum), _mm256_extracti128_si256(sum, 1));
+  half = _mm_add_epi32(half, _mm_shuffle_epi32(half, _MM_SHUFFLE(1, 0, 3, 2)));
+  half = _mm_add_epi32(half, _mm_shuffle_epi32(half, _MM_SHUFFLE(2, 3, 0, 1)));
+  acc = _mm_cvtsi128_si32(half);
+#elif defined(MPU6050_DECIM_SSE2)
+  __m128i sum = _mm_setzero_si128();
+  for (; i < taps; i += 8U) {
+    __m128i x = _mm_loadu_si128((const __m128i *)&pwindow[i]);
+    __m128i h = _mm_loadu_si128((const __m128i *)&pcoeffs[i]);
+    sum = _mm_add_epi32(sum, _mm_madd_epi16(x, h));
+  }
+  sum = _mm_add_epi32(sum, _mm_shuffle_epi32(sum, _MM_SHUFFLE(1, 0, 3, 2)));
+  sum = _mm_add_epi32(sum, _mm_shuffle_epi32(sum, _MM_SHUFFLE(2, 3, 0, 1)));
+  acc = _mm_cvtsi128_si32(sum);
+#elif defined(MPU6050_DECIM_NEON)
+  int32x4_t sum = vdupq_n_s32(0);
+  for (; i < taps; i += 8U) {
+    int16x8_t x = vld1q_s16(&pwindow[i]);
+    int16x8_t h = vld1q_s16(&pcoeffs[i]);
+    sum = vmlal_s16(sum, vget_low_s16(x), vget_low_s16(h));
+    sum = vmlal_s16(sum, vget_high_s16(x), vget_high_s16(h));
+  }
+  int32x2_t pair = vadd_s32(vget_low_s32(sum), vget_high_s32(sum));
+  acc = vget_lane_s32(vpadd_s32(pair, pair), 0);
+#elif defined(MPU6050_DECIM_DSP)
+  /* Two 16-bit multiply-adds per SMLAD, as arm_fir_decimate_fast_q15 */
+  for (; i < taps; i += 2U) {
+    int32_t x;
+    int32_t h;
+    memcpy(&x, &pwindow[i], sizeof(x));
+    memcpy(&h, &pcoeffs[i], sizeof(h));
+    acc = __smlad(x, h, acc);
+  }
+#endif
+  for (; i < taps; i++)
+    acc += (int32_t)pwindow[i] * pcoeffs[i];
+  return acc;
+}
+
+/**
+ * @brief   Design an anti-alias low-pass filter for a decimation ratio
+ * @note    Blackman windowed sinc with the cutoff at the output Nyquist frequency and unity DC
+ * gain, stop band attenuation about 70 dB once in Q15. The transition band is about 5.5 / taps of
+ * the input sample rate, 64 taps keep 8 kHz to 1 kHz alias free up to 155 Hz, 128 taps up to
+ * 330 Hz. Floating point, to be run once at init or offline on parts without FPU.
+ * @param   pcoeffs: Pointer to buffer where the taps Q15 coefficients will be stored
+ * @param   taps: Filter length
+ * @param   ratio: Decimation ratio
+ */
+void mpu6050_decim_design(int16_t *pcoeffs, uint16_t taps, uint8_t ratio) {
+  assert(pcoeffs);
+  assert(taps > 0 && ratio > 0);
+  float cutoff = 0.5f / (float)ratio;
+  float sum = 0.0f;
+  for (uint16_t i = 0; i < taps; i++)
+    sum += mpu6050_decim_tap(i, taps, cutoff);
+
+  int32_t total = 0;
+  for (uint16_t i = 0; i < taps; i++) {
+    pcoeffs[i] = (int16_t)lroundf(mpu6050_decim_tap(i, taps, cutoff) * MPU6050_DECIM_Q15_ONE / sum);
+    total += pcoeffs[i];
+  }
+  /* Rounding error goes to the center tap, so DC passes unchanged */
+  pcoeffs[taps / 2U] = (int16_t)(pcoeffs[taps / 2U] + MPU6050_DECIM_Q15_ONE - total);
+}
+
+/**
+ * @brief   Initialize a decimator
+ * @note    The filter length is padded to a multiple of MPU6050_DECIM_BLOCK with zero
+ * coefficients, the group delay stays (taps - 1) / 2 input samples.
+ * @param   pdecim: Pointer to decimator
+ * @param   ratio: Input samples per output sample
+ * @param   pcoeffs: Pointer to Q15 coefficients, h[0] applied to the newest sample
+ * @param   taps: Amount of coefficients, up to MPU6050_DECIM_MAX_TAPS
+ * @param   sel: Channels filtered, mpu6050_decim_sel_t bitmask, the others are picked from the
+ * input sample of the output instant
+ * @retval  mpu6050_status_t
+ */
+mpu6050_status_t mpu6050_decim_init(mpu6050_decim_t *pdecim, uint8_t ratio,
+                                    const int16_t *pcoeffs, uint16_t taps, uint8_t sel) {
+  assert(pdecim);
+  assert(pcoeffs);
+  if (ratio == 0 || taps == 0 || taps > MPU6050_DECIM_MAX_TAPS)
+    return MPU6050_ERROR;
+  uint16_t padded = (uint16_t)((taps + MPU6050_DECIM_BLOCK - 1U) & ~(MPU6050_DECIM_BLOCK - 1U));
+  memset(pdecim->coeffs, 0, sizeof(pdecim->coeffs));
+  for (uint16_t i = 0; i < taps; i++)
+    pdecim->coeffs[padded - 1U - i] = pcoeffs[i];
+  pdecim->taps = padded;
+  pdecim->ratio = ratio;
+  pdecim->sel = sel & MPU6050_DECIM_SEL_ALL;
+  mpu6050_decim_reset(pdecim);
+  return MPU6050_OK;
+}
+
+/**
+ * @brief   Clear the delay lines, as after a gap in the input stream
+ * @param   pdecim: Pointer to decimator
+ */
+void mpu6050_decim_reset(mpu6050_decim_t *pdecim) {
+  assert(pdecim);
+  memset(pdecim->history, 0, sizeof(pdecim->history));
+  pdecim->pos = 0;
+  pdecim->phase = 0;
+}
+
+/**
+ * @brief   Decimate a block of samples
+ * @note    Blocks of any size, the filter state carries over from one call to the next. Output
+ * samples are produced on every ratio-th input sample.
+ * @param   pdecim: Pointer to decimator
+ * @param   psamples: Pointer to input samples
+ * @param   count: Amount of input samples
+ * @param   pout: Pointer to output buffer, room for count / ratio + 1 samples
+ * @retval  Amount of output samples
+ */
+uint32_t mpu6050_decim_process(mpu6050_decim_t *pdecim, const mpu6050_sample_t *psamples,
+                               uint32_t count, mpu6050_sample_t *pout) {
+  assert(pdecim);
+  assert(psamples || count == 0);
+  uint16_t taps = pdecim->taps;
+  uint32_t produced = 0;
+  for (uint32_t n = 0; n < count; n++) {
+    uint16_t value[MPU6050_DECIM_CHANNELS];
+    memcpy(value, &psamples[n], sizeof(value));
+    for (uint8_t ch = 0; ch < MPU6050_DECIM_CHANNELS; ch++) {
+      if (!(pdecim->sel & (1U << ch)))
+        continue;
+      pdecim->history[ch][pdecim->pos] = (int16_t)value[ch];
+      pdecim->history[ch][pdecim->pos + taps] = (int16_t)value[ch];
+    }
+    pdecim->pos = (pdecim->pos + 1U == taps) ? 0 : (uint16_t)(pdecim->pos + 1U);
+    if (++pdecim->phase < pdecim->ratio)
+      continue;
+    pdecim->phase = 0;
+
+    for (uint8_t ch = 0; ch < MPU6050_DECIM_CHANNELS; ch++) {
+      if (!(pdecim->sel & (1U << ch)))
+        continue;
+      int32_t acc =
+          mpu6050_decim_dot(&pdecim->history[ch][pdecim->pos], pdecim->coeffs, taps) + (1 << 14);
+      acc >>= 15;
+      if (acc > INT16_MAX)
+        acc = INT16_MAX;
+      if (acc < INT16_MIN)
+        acc = INT16_MIN;
+      value[ch] = (uint16_t)(int16_t)acc;
+    }
+    memcpy(&pout[produced++], value, sizeof(value));
+  }
+  return produced;
+}
@@ -0,0 +1,435 @@
+/**
+ ******************************************************************************
+ * @file           : mpu6050_fusion.c
+ * @author         : Gonzalo Gabriel Fernandez
+ * @brief          : MPU6050 orientation fusion
+ ******************************************************************************
+ * @attention
+ *
+ * Madgwick gradient descent and Mahony complementary filters, gyro and accel
+ * only. Both estimate gravity in the sensor frame from the quaternion and
+ * steer the gyro integration towards the measured acceleration direction.
+ *
+ ******************************************************************************
+ */
+
+#include "mpu6050_fusion.h"
+
+#include <assert.h>
+#include <stddef.h>
+
+#define MPU6050_FUSION_DEFAULT_BETA 0.1f /*! Madgwick default gain */
+#define MPU6050_FUSION_DEFAULT_KP 0.5f   /*! Mahony default proportional gain */
+#define MPU6050_FUSION_DEFAULT_KI 0.0f   /*! Mahony default integral gain */
+#define MPU6050_FUSION_G 9.80665f        /*! Standard gravity in m/s^2 */
+
+#ifdef MPU6050_FUSION_FIXED
+
+#define MPU6050_FUSION_ONE (1 << 30)                       /*! 1.0 in Q2.30 */
+#define MPU6050_FUSION_G_Q16 642689                        /*! Standard gravity, Q16.16 */
+#define MPU6050_FUSION_PI_2_Q16 102944                     /*! Pi / 2, Q16.16 */
+#define MPU6050_FUSION_CORDIC_STEPS 16U                    /*! CORDIC iterations */
+#define MPU6050_FUSION_MUL(a, b) ((int32_t)(((int64_t)(a) * (b)) >> 30)) /*! Q2.30 product */
+
+/*! CORDIC rotation angles atan(2^-i), Q16.16 rad */
+static const int32_t mpu6050_fusion_atan_table[MPU6050_FUSION_CORDIC_STEPS] = {
+    51472, 30386, 16055, 8150, 4091, 2047, 1024, 512, 256, 128, 64, 32, 16, 8, 4, 2};
+
+/**
+ * @brief   Integer square root
+ * @param   value: Radicand
+ * @retval  Floor of the square root
+ */
+static uint32_t mpu6050_fusion_isqrt(uint64_t value) {
+  uint64_t root = 0;
+  uint64_t bit = 1ULL << 62;
+  while (bit > value)
+    bit >>= 2;
+  while (bit) {
+    if (value >= root + bit) {
+      value -= root + bit;
+      root = (root >> 1) + bit;
+    } else {
+      root >>= 1;
+    }
+    bit >>= 2;
+  }
+  return (uint32_t)root;
+}
+
+/**
+ * @brief   Normalize a vector to unit length
+ * @note    Input in any format, output Q2.30. A null vector is left untouched.
+ * @param   pv: Pointer to vector
+ * @param   len: Amount of components, 3 or 4
+ */
+static void mpu6050_fusion_normalize(int32_t *pv, uint32_t len) {
+  uint64_t sum = 0;
+  for (uint32_t i = 0; i < len; i++)
+    sum += (uint64_t)((int64_t)pv[i] * pv[i]) >> 2;
+  /* Half of the norm, the quarter of each square keeps the sum in range */
+  uint32_t half_norm = mpu6050_fusion_isqrt(sum);
+  if (half_norm == 0)
+    return;
+  for (uint32_t i = 0; i < len; i++)
+    pv[i] = (int32_t)(((int64_t)pv[i] * (1 << 29)) / half_norm);
+}
+
+/**
+ * @brief   Four quadrant arctangent, CORDIC vectoring
+ * @param   y: Ordinate, Q2.30
+ * @param   x: Abscissa, Q2.30
+ * @retval  Angle in rad, Q16.16
+ */
+static int32_t mpu6050_fusion_atan2(int32_t y, int32_t x) {
+  int32_t angle = 0;
+  /* Headroom for the CORDIC gain */
+  y >>= 2;
+  x >>= 2;
+  if (x < 0) {
+    int32_t tmp = x;
+    if (y >= 0) {
+      x = y;
+      y = -tmp;
+      angle = MPU6050_FUSION_PI_2_Q16;
+    } else {
+      x = -y;
+      y = tmp;
+      angle = -MPU6050_FUSION_PI_2_Q16;
+    }
+  }
+  for (uint32_t i = 0; i < MPU6050_FUSION_CORDIC_STEPS; i++) {
+    int32_t dx = y >> i;
+    int32_t dy = x >> i;
+    if (y > 0) {
+      x += dx;
+      y -= dy;
+      angle += mpu6050_fusion_atan_table[i];
+    } else {
+      x -= dx;
+      y += dy;
+      angle -= mpu6050_fusion_atan_table[i];
+    }
+  }
+  return angle;
+}
+
+/**
+ * @brief   Filter update with one sample
+ * @param   pfusion: Pointer to fusion state
+ * @param   psample: Pointer to sample
+ */
+static void mpu6050_fusion_step(mpu6050_fusion_t *pfusion, const mpu6050_sample_t *psample) {
+  int32_t *q = pfusion->q;
+  int32_t g[3];
+  int32_t a[3];
+  for (uint32_t i = 0; i < 3; i++) {
+    g[i] = (int32_t)(((int64_t)(int16_t)psample->gyro[i] * pfusion->gyro_scale) >> 16);
+    a[i] = (int16_t)psample->accel[i];
+    pfusion->accel[i] = (int16_t)psample->accel[i];
+  }
+
+  int32_t s[4] = {0, 0, 0, 0};
+  bool correct = (a[0] != 0) || (a[1] != 0) || (a[2] != 0);
+  if (correct) {
+    mpu6050_fusion_normalize(a, 3);
+    /* Gravity direction estimated from the quaternion */
+    int32_t vx = 2 * (MPU6050_FUSION_MUL(q[1], q[3]) - MPU6050_FUSION_MUL(q[0], q[2]));
+    int32_t vy = 2 * (MPU6050_FUSION_MUL(q[0], q[1]) + MPU6050_FUSION_MUL(q[2], q[3]));
+    if (pfusion->algo == MPU6050_FUSION_MADGWICK) {
+      int32_t vz = MPU6050_FUSION_ONE -
+                   2 * (MPU6050_FUSION_MUL(q[1], q[1]) + MPU6050_FUSION_MUL(q[2], q[2]));
+      /* Objective function Q3.29, half gradient Q5.27 */
+      int32_t fx = (vx >> 1) - (a[0] >> 1);
+      int32_t fy = (vy >> 1) - (a[1] >> 1);
+      int32_t fz = (vz >> 1) - (a[2] >> 1);
+      s[0] = (int32_t)(((int64_t)-q[2] * fx + (int64_t)q[1] * fy) >> 32);
+      s[1] = (int32_t)(((int64_t)q[3] * fx + (int64_t)q[0] * fy - 2 * (int64_t)q[1] * fz) >> 32);
+      s[2] = (int32_t)(((int64_t)-q[0] * fx + (int64_t)q[3] * fy - 2 * (int64_t)q[2] * fz) >> 32);
+      s[3] = (int32_t)(((int64_t)q[1] * fx + (int64_t)q[2] * fy) >> 32);
+      mpu6050_fusion_normalize(s, 4);
+    } else {
+      int32_t vz = MPU6050_FUSION_MUL(q[0], q[0]) - MPU6050_FUSION_MUL(q[1], q[1]) -
+                   MPU6050_FUSION_MUL(q[2], q[2]) + MPU6050_FUSION_MUL(q[3], q[3]);
+      /* Error is the cross product of measured and estimated gravity */
+      int32_t e[3] = {
+          MPU6050_FUSION_MUL(a[1], vz) - MPU6050_FUSION_MUL(a[2], vy),
+          MPU6050_FUSION_MUL(a[2], vx) - MPU6050_FUSION_MUL(a[0], vz),
+          MPU6050_FUSION_MUL(a[0], vy) - MPU6050_FUSION_MUL(a[1], vx),
+      };
+      int32_t ki_dt = MPU6050_FUSION_MUL(pfusion->integral_gain, pfusion->dt);
+      for (uint32_t i = 0; i < 3; i++) {
+        if (ki_dt != 0)
+          pfusion->integral[i] += MPU6050_FUSION_MUL(ki_dt, e[i]) >> 14;
+        g[i] += pfusion->integral[i] + (MPU6050_FUSION_MUL(pfusion->gain, e[i]) >> 14);
+      }
+    }
+  }
+
+  /* Half rotation over the sample period, Q2.30 */
+  int32_t h[3];
+  for (uint32_t i = 0; i < 3; i++)
+    h[i] = (int32_t)(((int64_t)g[i] * pfusion->dt) >> 17);
+
+  int32_t dq[4] = {
+      -MPU6050_FUSION_MUL(q[1], h[0]) - MPU6050_FUSION_MUL(q[2], h[1]) -
+          MPU6050_FUSION_MUL(q[3], h[2]),
+      MPU6050_FUSION_MUL(q[0], h[0]) + MPU6050_FUSION_MUL(q[2], h[2]) -
+          MPU6050_FUSION_MUL(q[3], h[1]),
+      MPU6050_FUSION_MUL(q[0], h[1]) - MPU6050_FUSION_MUL(q[1], h[2]) +
+          MPU6050_FUSION_MUL(q[3], h[0]),
+      MPU6050_FUSION_MUL(q[0], h[2]) + MPU6050_FUSION_MUL(q[1], h[1]) -
+          MPU6050_FUSION_MUL(q[2], h[0]),
+  };
+  int32_t beta_dt = MPU6050_FUSION_MUL(pfusion->gain, pfusion->dt);
+  for (uint32_t i = 0; i < 4; i++) {
+    q[i] += dq[i];
+    if (correct && (pfusion->algo == MPU6050_FUSION_MADGWICK))
+      q[i] -= MPU6050_FUSION_MUL(beta_dt, s[i]);
+  }
+  mpu6050_fusion_normalize(q, 4);
+}
+
+/**
+ * @brief   Current attitude and linear acceleration
+ * @param   pfusion: Pointer to fusion state
+ * @param   pout: Pointer to output
+ */
+void mpu6050_fusion_output(const mpu6050_fusion_t *pfusion, mpu6050_fusion_output_t *pout) {
+  assert(pfusion);
+  assert(pout);
+  const int32_t *q = pfusion->q;
+  for (uint32_t i = 0; i < 4; i++)
+    pout->q[i] = q[i];
+
+  int32_t q11 = MPU6050_FUSION_MUL(q[1], q[1]);
+  int32_t q22 = MPU6050_FUSION_MUL(q[2], q[2]);
+  int32_t q33 = MPU6050_FUSION_MUL(q[3], q[3]);
+  int32_t sin_pitch = 2 * (MPU6050_FUSION_MUL(q[0], q[2]) - MPU6050_FUSION_MUL(q[1], q[3]));
+  if (sin_pitch > MPU6050_FUSION_ONE)
+    sin_pitch = MPU6050_FUSION_ONE;
+  if (sin_pitch < -MPU6050_FUSION_ONE)
+    sin_pitch = -MPU6050_FUSION_ONE;
+  int32_t cos_pitch = (int32_t)mpu6050_fusion_isqrt((1ULL << 60) -
+                                                    (uint64_t)((int64_t)sin_pitch * sin_pitch));
+
+  pout->euler[0] = mpu6050_fusion_atan2(
+      2 * (MPU6050_FUSION_MUL(q[0], q[1]) + MPU6050_FUSION_MUL(q[2], q[3])),
+      MPU6050_FUSION_ONE - 2 * (q11 + q22));
+  pout->euler[1] = mpu6050_fusion_atan2(sin_pitch, cos_pitch);
+  pout->euler[2] = mpu6050_fusion_atan2(
+      2 * (MPU6050_FUSION_MUL(q[0], q[3]) + MPU6050_FUSION_MUL(q[1], q[2])),
+      MPU6050_FUSION_ONE - 2 * (q22 + q33));
+
+  int32_t v[3] = {
+      2 * (MPU6050_FUSION_MUL(q[1], q[3]) - MPU6050_FUSION_MUL(q[0], q[2])),
+      2 * (MPU6050_FUSION_MUL(q[0], q[1]) + MPU6050_FUSION_MUL(q[2], q[3])),
+      MPU6050_FUSION_MUL(q[0], q[0]) - q11 - q22 + q33,
+  };
+  for (uint32_t i = 0; i < 3; i++)
+    pout->linear[i] = (int32_t)(((int64_t)pfusion->accel[i] * pfusion->accel_scale) >> 16) -
+                      MPU6050_FUSION_MUL(v[i], MPU6050_FUSION_G_Q16);
+}
+
+#else
+
+#include <math.h>
+
+/**
+ * @brief   Normalize a vector to unit length
+ * @note    A null vector is left untouched.
+ * @param   pv: Pointer to vector
+ * @param   len: Amount of components, 3 or 4
+ */
+static void mpu6050_fusion_normalize(float *pv, uint32_t len) {
+  float sum = 0.0f;
+  for (uint32_t i = 0; i < len; i++)
+    sum += pv[i] * pv[i];
+  if (sum <= 0.0f)
+    return;
+  float inv = 1.0f / sqrtf(sum);
+  for (uint32_t i = 0; i < len; i++)
+    pv[i] *= inv;
+}
+
+/**
+ * @brief   Filter update with one sample
+ * @param   pfusion: Pointer to fusion state
+ * @param   psample: Pointer to sample
+ */
+static void mpu6050_fusion_step(mpu6050_fusion_t *pfusion, const mpu6050_sample_t *psample) {
+  float *q = pfusion->q;
+  float g[3];
+  float a[3];
+  for (uint32_t i = 0; i < 3; i++) {
+    g[i] = (float)(int16_t)psample->gyro[i] * pfusion->gyro_scale;
+    a[i] = (float)(int16_t)psample->accel[i];
+    pfusion->accel[i] = (int16_t)psample->accel[i];
+  }
+
+  float s[4] = {0.0f, 0.0f, 0.0f, 0.0f};
+  bool correct = (a[0] != 0.0f) || (a[1] != 0.0f) || (a[2] != 0.0f);
+  if (correct) {
+    mpu6050_fusion_normalize(a, 3);
+    /* Gravity direction estimated from the quaternion */
+    float vx = 2.0f * (q[1] * q[3] - q[0] * q[2]);
+    float vy = 2.0f * (q[0] * q[1] + q[2] * q[3]);
+    if (pfusion->algo == MPU6050_FUSION_MADGWICK) {
+      float fx = vx - a[0];
+      float fy = vy - a[1];
+      float fz = 1.0f - 2.0f * (q[1] * q[1] + q[2] * q[2]) - a[2];
+      s[0] = -q[2] * fx + q[1] * fy;
+      s[1] = q[3] * fx + q[0] * fy - 2.0f * q[1] * fz;
+      s[2] = -q[0] * fx + q[3] * fy - 2.0f * q[2] * fz;
+      s[3] = q[1] * fx + q[2] * fy;
+      mpu6050_fusion_normalize(s, 4);
+    } else {
+      float vz = q[0] * q[0] - q[1] * q[1] - q[2] * q[2] + q[3] * q[3];
+      /* Error is the cross product of measured and estimated gravity */
+      float e[3] = {a[1] * vz - a[2] * vy, a[2] * vx - a[0] * vz, a[0] * vy - a[1] * vx};
+      for (uint32_t i = 0; i < 3; i++) {
+        if (pfusion->integral_gain > 0.0f)
+          pfusion->integral[i] += pfusion->integral_gain * e[i] * pfusion->dt;
+        g[i] += pfusion->integral[i] + pfusion->gain * e[i];
+      }
+    }
+  }
+
+  float h[3];
+  for (uint32_t i = 0; i < 3; i++)
+    h[i] = 0.5f * pfusion->dt * g[i];
+
+  float dq[4] = {
+      -q[1] * h[0] - q[2] * h[1] - q[3] * h[2],
+      q[0] * h[0] + q[2] * h[2] - q[3] * h[1],
+      q[0] * h[1] - q[1] * h[2] + q[3] * h[0],
+      q[0] * h[2] + q[1] * h[1] - q[2] * h[0],
+  };
+  float beta_dt = pfusion->gain * pfusion->dt;
+  for (uint32_t i = 0; i < 4; i++) {
+    q[i] += dq[i];
+    if (correct && (pfusion->algo == MPU6050_FUSION_MADGWICK))
+      q[i] -= beta_dt * s[i];
+  }
+  mpu6050_fusion_normalize(q, 4);
+}
+
+/**
+ * @brief   Current attitude and linear acceleration
+ * @param   pfusion: Pointer to fusion state
+ * @param   pout: Pointer to output
+ */
+void mpu6050_fusion_output(const mpu6050_fusion_t *pfusion, mpu6050_fusion_output_t *pout) {
+  assert(pfusion);
+  assert(pout);
+  const float *q = pfusion->q;
+  for (uint32_t i = 0; i < 4; i++)
+    pout->q[i] = q[i];
+
+  float sin_pitch = 2.0f * (q[0] * q[2] - q[1] * q[3]);
+  if (sin_pitch > 1.0f)
+    sin_pitch = 1.0f;
+  if (sin_pitch < -1.0f)
+    sin_pitch = -1.0f;
+  pout->euler[0] = atan2f(2.0f * (q[0] * q[1] + q[2] * q[3]),
+                          1.0f - 2.0f * (q[1] * q[1] + q[2] * q[2]));
+  pout->euler[1] = asinf(sin_pitch);
+  pout->euler[2] = atan2f(2.0f * (q[0] * q[3] + q[1] * q[2]),
+                          1.0f - 2.0f * (q[2] * q[2] + q[3] * q[3]));
+
+  float v[3] = {
+      2.0f * (q[1] * q[3] - q[0] * q[2]),
+      2.0f * (q[0] * q[1] + q[2] * q[3]),
+      q[0] * q[0] - q[1] * q[1] - q[2] * q[2] + q[3] * q[3],
+  };
+  for (uint32_t i = 0; i < 3; i++)
+    pout->linear[i] = (float)pfusion->accel[i] * pfusion->accel_scale - v[i] * MPU6050_FUSION_G;
+}
+
+#endif
+
+/**
+ * @brief   Convert a gain to the state arithmetic
+ * @param   value: Gain
+ * @retval  Gain as float or Q2.30
+ */
+static mpu6050_fusion_real_t mpu6050_fusion_real(float value) {
+#ifdef MPU6050_FUSION_FIXED
+  return (mpu6050_fusion_real_t)(value * (float)(1 << 30));
+#else
+  return value;
+#endif
+}
+
+/**
+ * @brief   Initialize fusion state at identity attitude
+ * @note    Default gains: Madgwick beta 0.1, Mahony kp 0.5 and ki 0.
+ * @param   pfusion: Pointer to fusion state
+ * @param   algo: Filter selection
+ * @param   pscale: Pointer to scale factors of the device full scale settings
+ * @param   sample_rate_hz: Sample rate of the updates
+ */
+void mpu6050_fusion_init(mpu6050_fusion_t *pfusion, mpu6050_fusion_algo_t algo,
+                         const mpu6050_convert_scale_t *pscale, uint32_t sample_rate_hz) {
+  assert(pfusion);
+  assert(pscale);
+  assert(sample_rate_hz > 0);
+  pfusion->algo = algo;
+  pfusion->q[0] = mpu6050_fusion_real(1.0f);
+  for (uint32_t i = 0; i < 3; i++) {
+    pfusion->q[i + 1] = 0;
+    pfusion->integral[i] = 0;
+    pfusion->accel[i] = 0;
+  }
+#ifdef MPU6050_FUSION_FIXED
+  pfusion->dt = (mpu6050_fusion_real_t)((1U << 30) / sample_rate_hz);
+  pfusion->gyro_scale = pscale->scale_q32[4];
+  pfusion->accel_scale = pscale->scale_q32[0];
+#else
+  pfusion->dt = 1.0f / (float)sample_rate_hz;
+  pfusion->gyro_scale = pscale->scale[4];
+  pfusion->accel_scale = pscale->scale[0];
+#endif
+  if (algo == MPU6050_FUSION_MADGWICK)
+    mpu6050_fusion_set_gains(pfusion, MPU6050_FUSION_DEFAULT_BETA, 0.0f);
+  else
+    mpu6050_fusion_set_gains(pfusion, MPU6050_FUSION_DEFAULT_KP, MPU6050_FUSION_DEFAULT_KI);
+}
+
+/**
+ * @brief   Set filter gains
+ * @note    In fixed-point builds gains must be below 2.
+ * @param   pfusion: Pointer to fusion state
+ * @param   gain: Madgwick beta or Mahony kp
+ * @param   integral_gain: Mahony ki, ignored by Madgwick
+ */
+void mpu6050_fusion_set_gains(mpu6050_fusion_t *pfusion, float gain, float integral_gain) {
+  assert(pfusion);
+  pfusion->gain = mpu6050_fusion_real(gain);
+  pfusion->integral_gain = mpu6050_fusion_real(integral_gain);
+}
+
+/**
+ * @brief   Filter update with one sample
+ * @param   pfusion: Pointer to fusion state
+ * @param   psample: Pointer to sample
+ */
+void mpu6050_fusion_update(mpu6050_fusion_t *pfusion, const mpu6050_sample_t *psample) {
+  assert(pfusion);
+  assert(psample);
+  mpu6050_fusion_step(pfusion, psample);
+}
+
+/**
+ * @brief   Filter update with a block of consecutive samples
+ * @param   pfusion: Pointer to fusion state
+ * @param   psamples: Pointer to samples, oldest first
+ * @param   count: Amount of samples
+ */
+void mpu6050_fusion_update_batch(mpu6050_fusion_t *pfusion, const mpu6050_sample_t *psamples,
+                                 uint32_t count) {
+  assert(pfusion);
+  assert(psamples);
+  for (uint32_t i = 0; i < count; i++)
+    mpu6050_fusion_step(pfusion, &psamples[i]);
+}
@@ -0,0 +1,111 @@
+/**
+ ******************************************************************************
+ * @file           : mpu6050_plan.c
+ * @author         : Gonzalo Gabriel Fernandez
+ * @brief          : MPU6050 bus budget planner
+ ******************************************************************************
+ * @attention
+ *
+ * A register read is START, address + write, register, repeated START,
+ * address + read, data bytes and STOP. Every byte costs 9 SCL cycles with
+ * the acknowledge, START, repeated START and STOP one cycle each.
+ *
+ ******************************************************************************
+ */
+
+#include "mpu6050_plan.h"
+#include "mpu6050_registers.h"
+
+#include <assert.h>
+#include <stddef.h>
+
+#define MPU6050_PLAN_BYTE_BITS 9U           /*! SCL cycles per byte with acknowledge */
+#define MPU6050_PLAN_READ_OVERHEAD_BITS 30U /*! START, 3 header bytes, repeated START, STOP */
+#define MPU6050_PLAN_DEFAULT_OCCUPANCY 0.8f /*! Default bus occupancy limit */
+
+/**
+ * @brief   SCL cycles of a register read transaction
+ * @param   data_amount: Amount of bytes read
+ * @retval  SCL cycles
+ */
+static uint32_t mpu6050_plan_read_bits(uint32_t data_amount) {
+  return MPU6050_PLAN_READ_OVERHEAD_BITS + MPU6050_PLAN_BYTE_BITS * data_amount;
+}
+
+/**
+ * @brief   Size of a FIFO frame
+ * @param   fifo_sel: FIFO sensor selection
+ * @retval  Frame size in bytes
+ */
+static uint32_t mpu6050_plan_frame_size(uint8_t fifo_sel) {
+  uint32_t frame_size = 0;
+  if (fifo_sel & MPU6050_FIFO_SEL_ACCEL)
+    frame_size += 6;
+  if (fifo_sel & MPU6050_FIFO_SEL_TEMP)
+    frame_size += 2;
+  if (fifo_sel & MPU6050_FIFO_SEL_GYRO_X)
+    frame_size += 2;
+  if (fifo_sel & MPU6050_FIFO_SEL_GYRO_Y)
+    frame_size += 2;
+  if (fifo_sel & MPU6050_FIFO_SEL_GYRO_Z)
+    frame_size += 2;
+  return frame_size;
+}
+
+/**
+ * @brief   Bus budget of an acquisition configuration
+ * @note    The plan is filled even when the configuration is rejected, max_odr_hz gives the
+ *          highest rate that fits.
+ * @param   pconfig: Pointer to acquisition configuration
+ * @param   pplan: Pointer to plan to fill
+ * @retval  mpu6050_status_t, error if the bus or the FIFO cannot keep up
+ */
+mpu6050_status_t mpu6050_plan(const mpu6050_plan_config_t *pconfig, mpu6050_plan_t *pplan) {
+  assert(pconfig);
+  assert(pplan);
+  if ((pconfig->bus_hz == 0) || (pconfig->devices == 0) || (pconfig->odr_hz <= 0.0f))
+    return MPU6050_ERROR;
+
+  float transactions;
+  uint32_t bits;
+  switch (pconfig->mode) {
+  case MPU6050_PLAN_PER_SENSOR:
+    transactions = 3.0f;
+    bits = mpu6050_plan_read_bits(6) + mpu6050_plan_read_bits(2) + mpu6050_plan_read_bits(6);
+    break;
+  case MPU6050_PLAN_BURST:
+    transactions = 1.0f;
+    bits = mpu6050_plan_read_bits(MPU6050_SENSOR_DATA_LEN);
+    break;
+  case MPU6050_PLAN_FIFO: {
+    uint32_t frame_size = mpu6050_plan_frame_size(pconfig->fifo_sel);
+    if ((frame_size == 0) || (pconfig->fifo_batch == 0))
+      return MPU6050_ERROR;
+    /* INT_STATUS, FIFO count and frames, spread over the batch */
+    uint32_t drain_bits = mpu6050_plan_read_bits(1) + mpu6050_plan_read_bits(2) +
+                          mpu6050_plan_read_bits(frame_size * pconfig->fifo_batch);
+    transactions = 3.0f / (float)pconfig->fifo_batch;
+    bits = (drain_bits + pconfig->fifo_batch - 1U) / pconfig->fifo_batch;
+    break;
+  }
+  default:
+    return MPU6050_ERROR;
+  }
+
+  float max_occupancy = (pconfig->max_occupancy > 0.0f) ? pconfig->max_occupancy
+                                                        : MPU6050_PLAN_DEFAULT_OCCUPANCY;
+  float samples_per_s = pconfig->odr_hz * (float)pconfig->devices;
+  pplan->bits_per_sample = bits;
+  pplan->bus_us_per_sample = (float)bits * 1e6f / (float)pconfig->bus_hz;
+  pplan->transactions_per_s = transactions * samples_per_s;
+  pplan->occupancy = (float)bits * samples_per_s / (float)pconfig->bus_hz;
+  pplan->max_odr_hz =
+      max_occupancy * (float)pconfig->bus_hz / ((float)bits * (float)pconfig->devices);
+
+  if (pplan->occupancy > max_occupancy)
+    return MPU6050_ERROR;
+  if ((pconfig->mode == MPU6050_PLAN_FIFO) &&
+      (mpu6050_plan_frame_size(pconfig->fifo_sel) * pconfig->fifo_batch > MPU6050_FIFO_SIZE))
+    return MPU6050_ERROR;
+  return MPU6050_OK;
+}
@@ -0,0 +1,131 @@
+/**
+ ******************************************************************************
+ * @file           : mpu6050_ring.c
+ * @author         : Gonzalo Gabriel Fernandez
+ * @brief          : MPU6050 sample ring
+ ******************************************************************************
+ * @attention
+ *
+ * Lock-free single-producer/single-consumer ring of samples.
+ * Indexes are free running, the slot is selected with the ring mask.
+ *
+ ******************************************************************************
+ */
+
+#include "mpu6050_ring.h"
+
+#include <assert.h>
+#include <stddef.h>
+
+#define MPU6050_RING_MASK (MPU6050_RING_SIZE - 1U)
+
+/**
+ * @brief   Initialize an empty ring
+ * @param   pring: Pointer to ring
+ */
+void mpu6050_ring_init(mpu6050_ring_t *pring) {
+  assert(pring);
+  pring->head = 0;
+  pring->tail = 0;
+  pring->overruns = 0;
+  pring->drops = 0;
+}
+
+/**
+ * @brief   Producer slot to fill
+ * @note    The slot is not visible to the consumer until mpu6050_ring_commit is called.
+ * @param   pring: Pointer to ring
+ * @retval  Pointer to free slot, NULL if the ring is full
+ */
+mpu6050_ring_slot_t *mpu6050_ring_acquire(mpu6050_ring_t *pring) {
+  uint32_t head = pring->head;
+  uint32_t tail = __atomic_load_n(&pring->tail, __ATOMIC_ACQUIRE);
+  if (head - tail >= MPU6050_RING_SIZE) {
+    pring->overruns++;
+    return NULL;
+  }
+  return &pring->slots[head & MPU6050_RING_MASK];
+}
+
+/**
+ * @brief   Publish the slot returned by mpu6050_ring_acquire
+ * @param   pring: Pointer to ring
+ */
+void mpu6050_ring_commit(mpu6050_ring_t *pring) {
+  __atomic_store_n(&pring->head, pring->head + 1U, __ATOMIC_RELEASE);
+}
+
+/**
+ * @brief   Account a sample discarded by the producer
+ * @param   pring: Pointer to ring
+ */
+void mpu6050_ring_drop(mpu6050_ring_t *pring) { pring->drops++; }
+
+/**
+ * @brief   Oldest sample in the ring, without removing it
+ * @param   pring: Pointer to ring
+ * @retval  Pointer to sample, NULL if the ring is empty
+ */
+const mpu6050_sample_t *mpu6050_ring_peek(mpu6050_ring_t *pring) {
+  uint32_t tail = pring->tail;
+  uint32_t head = __atomic_load_n(&pring->head, __ATOMIC_ACQUIRE);
+  if (head == tail)
+    return NULL;
+  return &pring->slots[tail & MPU6050_RING_MASK].sample;
+}
+
+/**
+ * @brief   Contiguous run of published slots, without removing them
+ * @note    The run stops at the end of the slot array, a second call after
+ * mpu6050_ring_release returns the wrapped part.
+ * @param   pring: Pointer to ring
+ * @param   pslots: Pointer to buffer where the first slot of the run will be stored
+ * @retval  Amount of slots in the run
+ */
+uint32_t mpu6050_ring_peek_batch(mpu6050_ring_t *pring, const mpu6050_ring_slot_t **pslots) {
+  assert(pslots);
+  uint32_t tail = pring->tail;
+  uint32_t head = __atomic_load_n(&pring->head, __ATOMIC_ACQUIRE);
+  uint32_t count = head - tail;
+  uint32_t until_wrap = MPU6050_RING_SIZE - (tail & MPU6050_RING_MASK);
+  if (count > until_wrap)
+    count = until_wrap;
+  *pslots = &pring->slots[tail & MPU6050_RING_MASK];
+  return count;
+}
+
+/**
+ * @brief   Give consumed slots back to the producer
+ * @param   pring: Pointer to ring
+ * @param   count: Amount of slots consumed
+ */
+void mpu6050_ring_release(mpu6050_ring_t *pring, uint32_t count) {
+  assert(count <= mpu6050_ring_count(pring));
+  __atomic_store_n(&pring->tail, pring->tail + count, __ATOMIC_RELEASE);
+}
+
+/**
+ * @brief   Copy and remove the oldest sample in the ring
+ * @param   pring: Pointer to ring
+ * @param   psample: Pointer to sample where measurements will be stored
+ * @retval  true if a sample was available
+ */
+bool mpu6050_ring_pop(mpu6050_ring_t *pring, mpu6050_sample_t *psample) {
+  assert(psample);
+  const mpu6050_sample_t *pnext = mpu6050_ring_peek(pring);
+  if (pnext == NULL)
+    return false;
+  *psample = *pnext;
+  mpu6050_ring_release(pring, 1);
+  return true;
+}
+
+/**
+ * @brief   Amount of published samples not yet released
+ * @param   pring: Pointer to ring
+ * @retval  Sample count
+ */
+uint32_t mpu6050_ring_count(mpu6050_ring_t *pring) {
+  return __atomic_load_n(&pring->head, __ATOMIC_ACQUIRE) -
+         __atomic_load_n(&pring->tail, __ATOMIC_ACQUIRE);
+}
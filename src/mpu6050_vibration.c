@@ -0,0 +1,321 @@
+/**
+ ******************************************************************************
+ * @file           : mpu6050_vibration.c
+ * @author         : Gonzalo Gabriel Fernandez
+ * @brief          : MPU6050 vibration analyzer
+ ******************************************************************************
+ * @attention
+ *
+ * The real FFT of a window runs as a half size complex FFT of the even and
+ * odd samples, radix-2 in place, followed by the split into the bins of the
+ * real input, as arm_rfft_fast_f32. Twiddles, window and bit reversal are
+ * tables filled at init, the analysis itself needs no trigonometry.
+ *
+ ******************************************************************************
+ */
+
+#include "mpu6050_vibration.h"
+
+#include <assert.h>
+#include <math.h>
+#include <stddef.h>
+#include <string.h>
+
+#define MPU6050_VIB_PI 3.14159265358979f             /*! Pi */
+#define MPU6050_VIB_SQRT2 1.41421356f                /*! Square root of 2 */
+#define MPU6050_VIB_HALF (MPU6050_VIB_FFT_SIZE / 2U) /*! Complex FFT length */
+
+/**
+ * @brief   Half size complex FFT of the work buffer, in place
+ * @param   pvib: Pointer to analyzer, work holds N / 2 interleaved complex values
+ */
+static void mpu6050_vib_fft(mpu6050_vib_t *pvib) {
+  float *px = pvib->work;
+  for (uint16_t i = 0; i < MPU6050_VIB_HALF; i++) {
+    uint16_t j = pvib->bitrev[i];
+    if (i < j) {
+      float re = px[2U * i];
+      float im = px[2U * i + 1U];
+      px[2U * i] = px[2U * j];
+      px[2U * i + 1U] = px[2U * j + 1U];
+      px[2U * j] = re;
+      px[2U * j + 1U] = im;
+    }
+  }
+  for (uint16_t size = 2; size <= MPU6050_VIB_HALF; size <<= 1) {
+    uint16_t half = size / 2U;
+    uint16_t step = (uint16_t)(MPU6050_VIB_FFT_SIZE / size);
+    for (uint16_t k = 0; k < half; k++) {
+      float wr = pvib->twiddle[2U * k * step];
+      float wi = pvib->twiddle[2U * k * step + 1U];
+      for (uint16_t a = k; a < MPU6050_VIB_HALF; a += size) {
+        uint16_t b = a + half;
+        float tr = wr * px[2U * b] - wi * px[2U * b + 1U];
+        float ti = wr * px[2U * b + 1U] + wi * px[2U * b];
+        px[2U * b] = px[2U * a] - tr;
+        px[2U * b + 1U] = px[2U * a + 1U] - ti;
+        px[2U * a] += tr;
+        px[2U * a + 1U] += ti;
+      }
+    }
+  }
+}
+
+/**
+ * @brief   Spectrum and band RMS of the windowed axis in the work buffer
+ * @param   pvib: Pointer to analyzer
+ * @param   axis: Axis index
+ * @param   paxis: Pointer to axis features where the band RMS will be stored
+ */
+static void mpu6050_vib_spectrum(mpu6050_vib_t *pvib, uint8_t axis, mpu6050_vib_axis_t *paxis) {
+  const float *pz = pvib->work;
+  float *ppower = pvib->spectrum[axis];
+  mpu6050_vib_fft(pvib);
+
+  /* Even and odd samples are the real and imaginary parts of the half size FFT */
+  ppower[0] = (pz[0] + pz[1]) * (pz[0] + pz[1]);
+  ppower[MPU6050_VIB_HALF] = (pz[0] - pz[1]) * (pz[0] - pz[1]);
+  for (uint16_t k = 1; k < MPU6050_VIB_HALF; k++) {
+    uint16_t m = MPU6050_VIB_HALF - k;
+    float even_re = 0.5f * (pz[2U * k] + pz[2U * m]);
+    float even_im = 0.5f * (pz[2U * k + 1U] - pz[2U * m + 1U]);
+    float odd_re = 0.5f * (pz[2U * k + 1U] + pz[2U * m + 1U]);
+    float odd_im = -0.5f * (pz[2U * k] - pz[2U * m]);
+    float wr = pvib->twiddle[2U * k];
+    float wi = pvib->twiddle[2U * k + 1U];
+    float xr = even_re + wr * odd_re - wi * odd_im;
+    float xi = even_im + wr * odd_im + wi * odd_re;
+    /* Both halves of the spectrum, the real input is symmetric */
+    ppower[k] = 2.0f * (xr * xr + xi * xi);
+  }
+
+  for (uint8_t b = 0; b < pvib->band_count; b++) {
+    float sum = 0.0f;
+    for (uint16_t k = pvib->band_bins[b][0]; k <= pvib->band_bins[b][1]; k++)
+      sum += ppower[k];
+    paxis->bands[b] = sqrtf(sum * pvib->power_norm);
+  }
+
+  /* Bin power to sine amplitude, half of it at DC and Nyquist */
+  for (uint16_t k = 0; k < MPU6050_VIB_BINS; k++)
+    ppower[k] = sqrtf(0.5f * ppower[k]) * pvib->amplitude_norm;
+  ppower[0] *= 0.5f * MPU6050_VIB_SQRT2;
+  ppower[MPU6050_VIB_HALF] *= 0.5f * MPU6050_VIB_SQRT2;
+}
+
+/**
+ * @brief   Analyze the window in the history
+ * @param   pvib: Pointer to analyzer
+ * @param   pout: Pointer to features where the window features will be stored
+ */
+static void mpu6050_vib_analyze(mpu6050_vib_t *pvib, mpu6050_vib_features_t *pout) {
+  memset(pout, 0, sizeof(*pout));
+  pout->window = pvib->windows++;
+  for (uint8_t axis = 0; axis < MPU6050_VIB_AXES; axis++) {
+    mpu6050_vib_axis_t *paxis = &pout->axis[axis];
+    const int16_t *phistory = pvib->history[axis];
+    float *pwork = pvib->work;
+
+    float sum = 0.0f;
+    for (uint16_t n = 0; n < MPU6050_VIB_FFT_SIZE; n++) {
+      uint16_t i = (uint16_t)((pvib->pos + n) & (MPU6050_VIB_FFT_SIZE - 1U));
+      pwork[n] = (float)phistory[i];
+      sum += pwork[n];
+    }
+    float mean = sum / (float)MPU6050_VIB_FFT_SIZE;
+
+    /* Moments of the deviation from the mean, the work buffer becomes the windowed axis */
+    float m2 = 0.0f;
+    float m4 = 0.0f;
+    float peak = 0.0f;
+    for (uint16_t n = 0; n < MPU6050_VIB_FFT_SIZE; n++) {
+      float d = pwork[n] - mean;
+      float d2 = d * d;
+      m2 += d2;
+      m4 += d2 * d2;
+      if (fabsf(d) > peak)
+        peak = fabsf(d);
+      pwork[n] = d * pvib->window[n] * pvib->scale;
+    }
+    paxis->rms = sqrtf(m2 / (float)MPU6050_VIB_FFT_SIZE) * pvib->scale;
+    paxis->peak = peak * pvib->scale;
+    if (m2 > 0.0f) {
+      paxis->crest = paxis->peak / paxis->rms;
+      paxis->kurtosis = (float)MPU6050_VIB_FFT_SIZE * m4 / (m2 * m2);
+    }
+
+    /* Goertzel recurrences of all the targets side by side, each one a serial chain */
+    float s1[MPU6050_VIB_MAX_TONES] = {0};
+    float s2[MPU6050_VIB_MAX_TONES] = {0};
+    for (uint16_t n = 0; n < MPU6050_VIB_FFT_SIZE && pvib->tone_count != 0; n++) {
+      for (uint8_t t = 0; t < pvib->tone_count; t++) {
+        float s = pwork[n] + pvib->tone_coeffs[t] * s1[t] - s2[t];
+        s2[t] = s1[t];
+        s1[t] = s;
+      }
+    }
+    for (uint8_t t = 0; t < pvib->tone_count; t++) {
+      float power = s1[t] * s1[t] + s2[t] * s2[t] - pvib->tone_coeffs[t] * s1[t] * s2[t];
+      paxis->tones[t] = sqrtf(fmaxf(power, 0.0f)) * pvib->amplitude_norm;
+    }
+
+    if (pvib->band_count != 0 || pvib->spectrum_enabled)
+      mpu6050_vib_spectrum(pvib, axis, paxis);
+  }
+}
+
+/**
+ * @brief   Initialize a vibration analyzer without bands or target frequencies
+ * @note    Fills the window, twiddle and bit reversal tables, the only trigonometry.
+ * @param   pvib: Pointer to analyzer
+ * @param   pscale: Pointer to scale factors of the accel full scale
+ * @param   sample_rate_hz: Accel sample rate
+ * @param   hop: Samples between windows, up to MPU6050_VIB_FFT_SIZE, half of it for 50% overlap
+ * @param   spectrum: Keep the amplitude spectrum of every window even without bands
+ * @retval  mpu6050_status_t
+ */
+mpu6050_status_t mpu6050_vib_init(mpu6050_vib_t *pvib, const mpu6050_convert_scale_t *pscale,
+                                  float sample_rate_hz, uint16_t hop, bool spectrum) {
+  assert(pvib);
+  assert(pscale);
+  if (hop == 0 || hop > MPU6050_VIB_FFT_SIZE || !(sample_rate_hz > 0.0f))
+    return MPU6050_ERROR;
+  memset(pvib, 0, sizeof(*pvib));
+
+  float sum = 0.0f;
+  float sum2 = 0.0f;
+  for (uint16_t n = 0; n < MPU6050_VIB_FFT_SIZE; n++) {
+    float w = 0.5f - 0.5f * cosf(2.0f * MPU6050_VIB_PI * (float)n / (float)MPU6050_VIB_FFT_SIZE);
+    pvib->window[n] = w;
+    sum += w;
+    sum2 += w * w;
+  }
+  for (uint16_t k = 0; k < MPU6050_VIB_HALF; k++) {
+    float angle = -2.0f * MPU6050_VIB_PI * (float)k / (float)MPU6050_VIB_FFT_SIZE;
+    pvib->twiddle[2U * k] = cosf(angle);
+    pvib->twiddle[2U * k + 1U] = sinf(angle);
+  }
+  for (uint16_t i = 0; i < MPU6050_VIB_HALF; i++) {
+    uint16_t reversed = 0;
+    for (uint16_t bit = 1; bit < MPU6050_VIB_HALF; bit <<= 1) {
+      reversed <<= 1;
+      if (i & bit)
+        reversed |= 1U;
+    }
+    pvib->bitrev[i] = reversed;
+  }
+
+  pvib->scale = pscale->scale[0];
+  pvib->sample_rate_hz = sample_rate_hz;
+  pvib->amplitude_norm = 2.0f / sum;
+  pvib->power_norm = 1.0f / ((float)MPU6050_VIB_FFT_SIZE * sum2);
+  pvib->hop = hop;
+  pvib->spectrum_enabled = spectrum;
+  return MPU6050_OK;
+}
+
+/**
+ * @brief   Add a band to the RMS features
+ * @note    The band covers the FFT bins from low_hz to high_hz, its resolution is the sample
+ * rate over MPU6050_VIB_FFT_SIZE.
+ * @param   pvib: Pointer to analyzer
+ * @param   low_hz: Lower edge
+ * @param   high_hz: Upper edge, up to half the sample rate
+ * @retval  mpu6050_status_t, MPU6050_ERROR if the band holds no bin or there is no room
+ */
+mpu6050_status_t mpu6050_vib_add_band(mpu6050_vib_t *pvib, float low_hz, float high_hz) {
+  assert(pvib);
+  if (pvib->band_count >= MPU6050_VIB_MAX_BANDS || low_hz < 0.0f ||
+      high_hz > 0.5f * pvib->sample_rate_hz)
+    return MPU6050_ERROR;
+  float resolution = pvib->sample_rate_hz / (float)MPU6050_VIB_FFT_SIZE;
+  uint16_t first = (uint16_t)ceilf(low_hz / resolution);
+  uint16_t last = (uint16_t)floorf(high_hz / resolution);
+  if (last > MPU6050_VIB_HALF)
+    last = MPU6050_VIB_HALF;
+  if (first > last)
+    return MPU6050_ERROR;
+  pvib->band_bins[pvib->band_count][0] = first;
+  pvib->band_bins[pvib->band_count][1] = last;
+  pvib->band_count++;
+  return MPU6050_OK;
+}
+
+/**
+ * @brief   Add a target frequency to the Goertzel features
+ * @note    Any frequency, not only FFT bins, e.g. shaft rate or a bearing defect frequency.
+ * N + 1 multiply-adds per target and axis, cheaper than the FFT for a few targets.
+ * @param   pvib: Pointer to analyzer
+ * @param   freq_hz: Target frequency, below half the sample rate
+ * @retval  mpu6050_status_t
+ */
+mpu6050_status_t mpu6050_vib_add_tone(mpu6050_vib_t *pvib, float freq_hz) {
+  assert(pvib);
+  if (pvib->tone_count >= MPU6050_VIB_MAX_TONES || freq_hz < 0.0f ||
+      freq_hz >= 0.5f * pvib->sample_rate_hz)
+    return MPU6050_ERROR;
+  pvib->tone_coeffs[pvib->tone_count++] =
+      2.0f * cosf(2.0f * MPU6050_VIB_PI * freq_hz / pvib->sample_rate_hz);
+  return MPU6050_OK;
+}
+
+/**
+ * @brief   Discard the samples of the current window, as after a gap in the input stream
+ * @param   pvib: Pointer to analyzer
+ */
+void mpu6050_vib_reset(mpu6050_vib_t *pvib) {
+  assert(pvib);
+  pvib->pos = 0;
+  pvib->filled = 0;
+  pvib->since = 0;
+}
+
+/**
+ * @brief   Add an accel sample, as read by mpu6050_accel_read_raw
+ * @note    The first window is analyzed after MPU6050_VIB_FFT_SIZE samples, the next ones every
+ * hop samples.
+ * @param   pvib: Pointer to analyzer
+ * @param   accelx: Raw Accel X measurement
+ * @param   accely: Raw Accel Y measurement
+ * @param   accelz: Raw Accel Z measurement
+ * @param   pout: Pointer to features where the window features will be stored
+ * @retval  true if a window was analyzed into pout
+ */
+bool mpu6050_vib_push(mpu6050_vib_t *pvib, uint16_t accelx, uint16_t accely, uint16_t accelz,
+                      mpu6050_vib_features_t *pout) {
+  assert(pvib);
+  assert(pout);
+  pvib->history[0][pvib->pos] = (int16_t)accelx;
+  pvib->history[1][pvib->pos] = (int16_t)accely;
+  pvib->history[2][pvib->pos] = (int16_t)accelz;
+  pvib->pos = (uint16_t)((pvib->pos + 1U) & (MPU6050_VIB_FFT_SIZE - 1U));
+  if (pvib->filled < MPU6050_VIB_FFT_SIZE)
+    pvib->filled++;
+  pvib->since++;
+  if (pvib->filled < MPU6050_VIB_FFT_SIZE || pvib->since < pvib->hop)
+    return false;
+  pvib->since = 0;
+  mpu6050_vib_analyze(pvib, pout);
+  return true;
+}
+
+/**
+ * @brief   Add a block of samples
+ * @param   pvib: Pointer to analyzer
+ * @param   psamples: Pointer to samples, only the accel is analyzed
+ * @param   count: Amount of samples
+ * @param   pout: Pointer to features buffer, room for count / hop + 1 windows
+ * @retval  Amount of windows analyzed
+ */
+uint32_t mpu6050_vib_process(mpu6050_vib_t *pvib, const mpu6050_sample_t *psamples,
+                             uint32_t count, mpu6050_vib_features_t *pout) {
+  assert(pvib);
+  assert(psamples || count == 0);
+  uint32_t produced = 0;
+  for (uint32_t n = 0; n < count; n++) {
+    const uint16_t *paccel = psamples[n].accel;
+    if (mpu6050_vib_push(pvib, paccel[0], paccel[1], paccel[2], &pout[produced]))
+      produced++;
+  }
+  return produced;
+}
@@ -14,85 +14,388 @@
 
 #include <assert.h>
 
-#ifdef STM32F103xB
-#include "stm32f1xx_hal.h"
-#elif STM32F429xx
-#include "stm32f4xx_hal.h"
-#endif
-
 #include "mpu6050.h"
 #include "port_i2c.h"
+#include "port_i2c_stm32.h"
+
+#include <stddef.h>
+
+#ifndef I2C_MAX_BUSES
+#define I2C_MAX_BUSES 3U /*! Maximum amount of I2C peripherals with DMA transactions */
+#endif
+
+#ifndef I2C_MAX_INT_LINES
+#define I2C_MAX_INT_LINES 4U /*! Maximum amount of EXTI lines wired to INT pins */
+#endif
+
+/**
+ * @brief Non-blocking transaction context of an I2C peripheral
+ */
+typedef struct {
+  I2C_HandleTypeDef *hi2c; /*!< I2C peripheral handle */
+  i2c_queue_t queue;       /*!< Transaction queue */
+  uint32_t primask;        /*!< Interrupt mask saved by the queue lock */
+  GPIO_TypeDef *pscl_port; /*!< SCL GPIO port for the bus recovery, NULL if not set */
+  uint16_t scl_pin;        /*!< SCL GPIO pin */
+  GPIO_TypeDef *psda_port; /*!< SDA GPIO port */
+  uint16_t sda_pin;        /*!< SDA GPIO pin */
+
+} i2c_dma_context_t;
 
-extern I2C_HandleTypeDef hi2c1;
+static i2c_dma_context_t dma_contexts[I2C_MAX_BUSES]; /*! Transaction queue of each peripheral */
+
+/**
+ * @brief EXTI line wired to a device INT pin
+ */
+typedef struct {
+  uint16_t gpio_pin; /*!< EXTI GPIO pin, 0 if free */
+  void *pcontext;    /*!< Context of the interrupt, MPU6050 handle */
+
+} i2c_int_context_t;
+
+static i2c_int_context_t int_contexts[I2C_MAX_INT_LINES]; /*! Attached EXTI lines */
+
+static uint32_t dwt_last_cycles; /*! DWT cycle counter at the previous timestamp */
+static uint64_t dwt_wraps;       /*! DWT cycle counter wraps, upper 32 bits */
+
+/**
+ * @brief Non-blocking transaction context of an I2C peripheral
+ * @param hi2c: I2C peripheral handle
+ * @retval Pointer to context, NULL if there is no free context
+ */
+static i2c_dma_context_t *i2c_dma_context(I2C_HandleTypeDef *hi2c) {
+  for (uint8_t i = 0; i < I2C_MAX_BUSES; i++) {
+    if (dma_contexts[i].hi2c == hi2c)
+      return &dma_contexts[i];
+  }
+  return NULL;
+}
 
 /**
  * @brief I2C init function
+ * @note The peripheral itself is initialized by the HAL, only the DMA context and its queue are
+ * registered.
+ * @param bus: I2C peripheral handle (I2C_HandleTypeDef)
  * @retval mpu6050_status_t
  */
-mpu6050_status_t i2c_init(void) { return MPU6050_OK; }
+mpu6050_status_t i2c_init(void *bus) {
+  assert(bus);
+  if (i2c_dma_context(bus) != NULL)
+    return MPU6050_OK;
+  i2c_dma_context_t *pfree = i2c_dma_context(NULL);
+  if (pfree == NULL)
+    return MPU6050_ERROR;
+  i2c_queue_init(&pfree->queue, bus);
+  pfree->hi2c = bus;
+  return MPU6050_OK;
+}
 
 /**
- * @brief I2C read register
- * @param slave_address: I2C slave address
- * @param reg_address: Address of register to read
- * @param pdata: Pointer to buffer where the register value will be stored
+ * @brief I2C non-blocking transaction start through DMA
+ * @note Completion is reported to the queue of the peripheral from the HAL callbacks.
+ * @param bus: I2C peripheral handle (I2C_HandleTypeDef)
+ * @param ptransaction: Pointer to transaction
  * @retval mpu6050_status_t
  */
-mpu6050_status_t i2c_reg_read(uint16_t slave_address, uint8_t reg_address, uint8_t *pdata) {
-  if (HAL_I2C_Mem_Read(&hi2c1, slave_address, reg_address, sizeof(uint8_t), pdata, sizeof(uint8_t),
-                       I2C_READ_TIMEOUT) != HAL_OK)
+mpu6050_status_t i2c_start(void *bus, const i2c_transaction_t *ptransaction) {
+  HAL_StatusTypeDef status;
+  if (ptransaction->op == I2C_QUEUE_WRITE)
+    status = HAL_I2C_Mem_Write_DMA(bus, ptransaction->slave_address, ptransaction->reg_address,
+                                   sizeof(uint8_t), ptransaction->pdata,
+                                   ptransaction->data_amount);
+  else
+    status = HAL_I2C_Mem_Read_DMA(bus, ptransaction->slave_address, ptransaction->reg_address,
+                                  sizeof(uint8_t), ptransaction->pdata, ptransaction->data_amount);
+  switch (status) {
+  case HAL_OK:
+    return MPU6050_OK;
+  case HAL_BUSY:
+    return MPU6050_ERROR_BUSY;
+  case HAL_TIMEOUT:
+    return MPU6050_ERROR_TIMEOUT;
+  default:
     return MPU6050_ERROR;
+  }
+}
+
+/**
+ * @brief Transaction queue of an I2C peripheral
+ * @param bus: I2C peripheral handle (I2C_HandleTypeDef)
+ * @retval Pointer to queue, NULL if the peripheral is not initialized
+ */
+i2c_queue_t *i2c_get_queue(void *bus) {
+  i2c_dma_context_t *pdma_context = i2c_dma_context(bus);
+  if (pdma_context == NULL)
+    return NULL;
+  return &pdma_context->queue;
+}
+
+/**
+ * @brief Lock the queue of an I2C peripheral against its completion interrupts
+ * @note Interrupts are masked, the lock is not nested.
+ * @param bus: I2C peripheral handle (I2C_HandleTypeDef)
+ */
+void i2c_lock(void *bus) {
+  uint32_t primask = __get_PRIMASK();
+  __disable_irq();
+  i2c_dma_context(bus)->primask = primask;
+}
+
+/**
+ * @brief Unlock the queue of an I2C peripheral
+ * @param bus: I2C peripheral handle (I2C_HandleTypeDef)
+ */
+void i2c_unlock(void *bus) { __set_PRIMASK(i2c_dma_context(bus)->primask); }
+
+/**
+ * @brief Wait for a transaction completion
+ * @note Completions come from the DMA and error interrupts, a bus error completes the
+ * transaction with an error.
+ * @param bus: I2C peripheral handle (I2C_HandleTypeDef)
+ * @param pdone: Pointer to completion flag
+ * @param timeout_us: Time limit of the wait
+ * @retval mpu6050_status_t, MPU6050_ERROR_TIMEOUT if the time limit expired
+ */
+mpu6050_status_t i2c_wait(void *bus, volatile bool *pdone, uint32_t timeout_us) {
+  uint64_t deadline_ns = i2c_timestamp_ns(bus) + (uint64_t)timeout_us * 1000U;
+  while (!*pdone) {
+    if (i2c_timestamp_ns(bus) >= deadline_ns)
+      return MPU6050_ERROR_TIMEOUT;
+  }
   return MPU6050_OK;
 }
 
 /**
- * @brief I2C burst read
- * @note Read multiple registers in burst mode with I2C
- * @param slave_address: I2C slave address
- * @param reg_address: Addres of first register to read
- * @param pdata: Pointer to buffer where the data received is stored
- * @param data_amount: Amount of data to read
+ * @brief Set the GPIO pins of an I2C peripheral for the bus recovery
+ * @note Without pins the recovery only resets and re-initializes the peripheral.
+ * @param hi2c: I2C peripheral handle, initialized with i2c_init
+ * @param pscl_port: SCL GPIO port
+ * @param scl_pin: SCL GPIO pin (GPIO_PIN_x)
+ * @param psda_port: SDA GPIO port
+ * @param sda_pin: SDA GPIO pin (GPIO_PIN_x)
  * @retval mpu6050_status_t
  */
-mpu6050_status_t i2c_burst_read(uint16_t slave_address, uint8_t reg_address, uint8_t *pdata,
-                                uint16_t data_amont) {
-  if (HAL_I2C_Mem_Read(&hi2c1, slave_address, reg_address, sizeof(uint8_t), pdata,
-                       sizeof(uint8_t) * data_amont, I2C_READ_TIMEOUT) != HAL_OK)
+mpu6050_status_t i2c_stm32_recovery_pins(I2C_HandleTypeDef *hi2c, GPIO_TypeDef *pscl_port,
+                                         uint16_t scl_pin, GPIO_TypeDef *psda_port,
+                                         uint16_t sda_pin) {
+  i2c_dma_context_t *pdma_context = i2c_dma_context(hi2c);
+  if (pdma_context == NULL || pscl_port == NULL || psda_port == NULL)
     return MPU6050_ERROR;
+  pdma_context->pscl_port = pscl_port;
+  pdma_context->scl_pin = scl_pin;
+  pdma_context->psda_port = psda_port;
+  pdma_context->sda_pin = sda_pin;
   return MPU6050_OK;
 }
 
 /**
- * @brief I2C write register
- * @param slave_address: I2C slave address
- * @param reg_address: Addres of register to write
- * @param pdata: Pointer to buffer with value to write
+ * @brief Busy wait of half an I2C clock period
+ * @param pdma_context: Pointer to context of the I2C peripheral
+ */
+static void i2c_half_clock(i2c_dma_context_t *pdma_context) {
+  uint64_t end_ns =
+      i2c_timestamp_ns(pdma_context->hi2c) + 500000000U / pdma_context->hi2c->Init.ClockSpeed + 1U;
+  while (i2c_timestamp_ns(pdma_context->hi2c) < end_ns) {
+  }
+}
+
+/**
+ * @brief Clock out a slave holding SDA low and release the bus with a STOP
+ * @note Up to nine SCL pulses finish the byte the slave is sending, then SDA rises while SCL is
+ * high. The pins are driven as open-drain outputs, the peripheral is de-initialized.
+ * @param pdma_context: Pointer to context of the I2C peripheral
+ */
+static void i2c_bus_clear(i2c_dma_context_t *pdma_context) {
+  GPIO_InitTypeDef gpio = {0};
+  gpio.Mode = GPIO_MODE_OUTPUT_OD;
+  gpio.Pull = GPIO_NOPULL;
+  gpio.Speed = GPIO_SPEED_FREQ_HIGH;
+  HAL_GPIO_WritePin(pdma_context->pscl_port, pdma_context->scl_pin, GPIO_PIN_SET);
+  HAL_GPIO_WritePin(pdma_context->psda_port, pdma_context->sda_pin, GPIO_PIN_SET);
+  gpio.Pin = pdma_context->scl_pin;
+  HAL_GPIO_Init(pdma_context->pscl_port, &gpio);
+  gpio.Pin = pdma_context->sda_pin;
+  HAL_GPIO_Init(pdma_context->psda_port, &gpio);
+
+  for (uint8_t i = 0; i < 9U; i++) {
+    if (HAL_GPIO_ReadPin(pdma_context->psda_port, pdma_context->sda_pin) == GPIO_PIN_SET)
+      break;
+    HAL_GPIO_WritePin(pdma_context->pscl_port, pdma_context->scl_pin, GPIO_PIN_RESET);
+    i2c_half_clock(pdma_context);
+    HAL_GPIO_WritePin(pdma_context->pscl_port, pdma_context->scl_pin, GPIO_PIN_SET);
+    i2c_half_clock(pdma_context);
+  }
+
+  /* STOP condition */
+  HAL_GPIO_WritePin(pdma_context->pscl_port, pdma_context->scl_pin, GPIO_PIN_RESET);
+  i2c_half_clock(pdma_context);
+  HAL_GPIO_WritePin(pdma_context->psda_port, pdma_context->sda_pin, GPIO_PIN_RESET);
+  i2c_half_clock(pdma_context);
+  HAL_GPIO_WritePin(pdma_context->pscl_port, pdma_context->scl_pin, GPIO_PIN_SET);
+  i2c_half_clock(pdma_context);
+  HAL_GPIO_WritePin(pdma_context->psda_port, pdma_context->sda_pin, GPIO_PIN_SET);
+  i2c_half_clock(pdma_context);
+}
+
+/**
+ * @brief Recover an I2C peripheral and its bus
+ * @note The DMA transfer in flight is aborted and the peripheral is software reset, which clears
+ * a BUSY flag latched by a glitch (STM32F1 errata). The bus is cleared if the recovery pins are
+ * set, then the HAL re-initializes the peripheral through HAL_I2C_MspInit.
+ * @param bus: I2C peripheral handle (I2C_HandleTypeDef)
  * @retval mpu6050_status_t
  */
-mpu6050_status_t i2c_reg_write(uint16_t slave_address, uint8_t reg_address, uint8_t *pdata) {
-  if (HAL_I2C_Mem_Write(&hi2c1, slave_address, reg_address, sizeof(uint8_t), pdata, sizeof(uint8_t),
-                        I2C_WRITE_TIMEOUT) != HAL_OK)
+mpu6050_status_t i2c_recover(void *bus) {
+  I2C_HandleTypeDef *hi2c = bus;
+  i2c_dma_context_t *pdma_context = i2c_dma_context(hi2c);
+  if (pdma_context == NULL)
+    return MPU6050_ERROR;
+  if (hi2c->hdmarx != NULL)
+    HAL_DMA_Abort(hi2c->hdmarx);
+  if (hi2c->hdmatx != NULL)
+    HAL_DMA_Abort(hi2c->hdmatx);
+  hi2c->Instance->CR1 |= I2C_CR1_SWRST;
+  hi2c->Instance->CR1 &= ~I2C_CR1_SWRST;
+  HAL_I2C_DeInit(hi2c);
+  if (pdma_context->pscl_port != NULL)
+    i2c_bus_clear(pdma_context);
+  if (HAL_I2C_Init(hi2c) != HAL_OK)
     return MPU6050_ERROR;
   return MPU6050_OK;
 }
 
 /**
- * @brief I2C non-blocking read through DMA
- * @param slave_address: I2C slave address
- * @param reg_address: Addres of register to write
- * @param pdata: Pointer to buffer with value to write
- * @param data_amount: Amount of data to write
+ * @brief Clock speed of an I2C peripheral
+ * @param bus: I2C peripheral handle (I2C_HandleTypeDef)
+ * @retval Clock speed in Hz
+ */
+uint32_t i2c_speed_hz(void *bus) { return ((I2C_HandleTypeDef *)bus)->Init.ClockSpeed; }
+
+/**
+ * @brief Completion of the transaction in flight of an I2C peripheral
+ * @param hi2c: I2C peripheral handle
+ * @param status: Completion status
+ */
+static void i2c_dma_complete(I2C_HandleTypeDef *hi2c, mpu6050_status_t status) {
+  i2c_dma_context_t *pdma_context = i2c_dma_context(hi2c);
+  if (pdma_context == NULL || !pdma_context->queue.busy)
+    return;
+  i2c_queue_complete(&pdma_context->queue, status);
+}
+
+/**
+ * @brief I2C Rx completed callback
+ */
+void HAL_I2C_MemRxCpltCallback(I2C_HandleTypeDef *hi2c) { i2c_dma_complete(hi2c, MPU6050_OK); }
+
+/**
+ * @brief I2C Tx completed callback
+ */
+void HAL_I2C_MemTxCpltCallback(I2C_HandleTypeDef *hi2c) { i2c_dma_complete(hi2c, MPU6050_OK); }
+
+/**
+ * @brief I2C error callback
+ * @note The HAL error code is mapped to the driver status, acknowledge failure first since a NACK
+ * may also flag a stop or bus error on the way out.
+ */
+void HAL_I2C_ErrorCallback(I2C_HandleTypeDef *hi2c) {
+  uint32_t error = HAL_I2C_GetError(hi2c);
+  mpu6050_status_t status = MPU6050_ERROR;
+  if (error & HAL_I2C_ERROR_AF)
+    status = MPU6050_ERROR_NACK;
+  else if (error & HAL_I2C_ERROR_TIMEOUT)
+    status = MPU6050_ERROR_TIMEOUT;
+  else if (error & (HAL_I2C_ERROR_BERR | HAL_I2C_ERROR_ARLO))
+    status = MPU6050_ERROR_BUS;
+  else if (error & (HAL_I2C_ERROR_OVR | HAL_I2C_ERROR_DMA))
+    status = MPU6050_ERROR_OVERRUN;
+  i2c_dma_complete(hi2c, status);
+}
+
+/**
+ * @brief Attach an EXTI line to a device INT pin
+ * @note The EXTI line itself is configured by the HAL. The context is given to
+ * mpu6050_int_callback on every interrupt of the line.
+ * @param bus: I2C peripheral handle (I2C_HandleTypeDef), unused
+ * @param int_line: EXTI GPIO pin (GPIO_PIN_x)
+ * @param pcontext: Context of the interrupt, MPU6050 handle
  * @retval mpu6050_status_t
  */
-mpu6050_status_t i2c_read_dma(uint16_t slave_address, uint8_t reg_address, uint8_t *pdata,
-                              uint16_t data_amount) {
-  if (HAL_I2C_Mem_Read_DMA(&hi2c1, slave_address, reg_address, sizeof(uint8_t), pdata,
-                           data_amount) != HAL_OK)
+mpu6050_status_t i2c_int_attach(void *bus, uint32_t int_line, void *pcontext) {
+  (void)bus;
+  if (int_line == 0)
     return MPU6050_ERROR;
+  i2c_int_context_t *pfree = NULL;
+  for (uint8_t i = 0; i < I2C_MAX_INT_LINES; i++) {
+    if (int_contexts[i].gpio_pin == int_line)
+      return MPU6050_ERROR;
+    if (int_contexts[i].gpio_pin == 0 && pfree == NULL)
+      pfree = &int_contexts[i];
+  }
+  if (pfree == NULL)
+    return MPU6050_ERROR;
+  pfree->pcontext = pcontext;
+  pfree->gpio_pin = int_line;
   return MPU6050_OK;
 }
 
 /**
- * @brief I2C Rx completed callback
+ * @brief Detach an EXTI line from a device INT pin
+ * @param bus: I2C peripheral handle (I2C_HandleTypeDef), unused
+ * @param int_line: EXTI GPIO pin (GPIO_PIN_x)
+ * @retval mpu6050_status_t
+ */
+mpu6050_status_t i2c_int_detach(void *bus, uint32_t int_line) {
+  (void)bus;
+  for (uint8_t i = 0; i < I2C_MAX_INT_LINES; i++) {
+    if (int_contexts[i].gpio_pin == int_line) {
+      int_contexts[i].gpio_pin = 0;
+      return MPU6050_OK;
+    }
+  }
+  return MPU6050_ERROR;
+}
+
+#ifndef I2C_NO_EXTI_CALLBACK
+/**
+ * @brief EXTI line detection callback
+ * @note Define I2C_NO_EXTI_CALLBACK if the application owns this callback, and call
+ * mpu6050_int_callback from it.
+ */
+void HAL_GPIO_EXTI_Callback(uint16_t GPIO_Pin) {
+  for (uint8_t i = 0; i < I2C_MAX_INT_LINES; i++) {
+    if (int_contexts[i].gpio_pin == GPIO_Pin) {
+      mpu6050_int_callback(int_contexts[i].pcontext);
+      return;
+    }
+  }
+}
+#endif
+
+/**
+ * @brief Timestamp from the DWT cycle counter
+ * @note The counter is enabled on first use and extended to 64 bits, a timestamp must be taken
+ * at least once per counter period (59 s at 72 MHz, 25 s at 168 MHz).
+ * @param bus: I2C peripheral handle (I2C_HandleTypeDef), unused
+ * @retval Time in ns
  */
-void HAL_I2C_MemRxCpltCallback(I2C_HandleTypeDef *hi2c) { mpu6050_rxcallback(); }
+uint64_t i2c_timestamp_ns(void *bus) {
+  (void)bus;
+  if (!(DWT->CTRL & DWT_CTRL_CYCCNTENA_Msk)) {
+    CoreDebug->DEMCR |= CoreDebug_DEMCR_TRCENA_Msk;
+    DWT->CYCCNT = 0;
+    DWT->CTRL |= DWT_CTRL_CYCCNTENA_Msk;
+  }
+
+  uint32_t primask = __get_PRIMASK();
+  __disable_irq();
+  uint32_t cycles = DWT->CYCCNT;
+  if (cycles < dwt_last_cycles)
+    dwt_wraps += 1ULL << 32;
+  dwt_last_cycles = cycles;
+  uint64_t total = dwt_wraps | cycles;
+  __set_PRIMASK(primask);
+
+  uint32_t clock = SystemCoreClock;
+  return (total / clock) * 1000000000ULL + ((total % clock) * 1000000000ULL) / clock;
+}
@@ -0,0 +1,514 @@
+/**
+ ******************************************************************************
+ * @file           : port_i2c_linux.c
+ * @author         : Gonzalo Gabriel Fernandez
+ * @brief          : MPU6050 Driver I2C port for Linux i2c-dev
+ ******************************************************************************
+ * @attention
+ *
+ * MPU6050 Driver I2C port for Linux i2c-dev (/dev/i2c-N).
+ * Register reads are a combined write and repeated start read with a single
+ * I2C_RDWR ioctl. Queued transactions are served by a worker thread per bus.
+ *
+ ******************************************************************************
+ */
+
+#define _GNU_SOURCE
+
+#include <assert.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <linux/gpio.h>
+#include <linux/i2c-dev.h>
+#include <poll.h>
+#include <string.h>
+#include <sys/ioctl.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "mpu6050.h"
+#include "port_i2c.h"
+#include "port_i2c_linux.h"
+
+/**
+ * @brief Linux 7-bit address from the 8-bit address used by the driver
+ */
+#define I2C_LINUX_ADDRESS(slave_address) ((slave_address) >> 1)
+
+/**
+ * @brief Submit messages as one combined transaction
+ * @param pbus: Pointer to bus handle
+ * @param pmsgs: Pointer to messages
+ * @param nmsgs: Amount of messages
+ * @retval mpu6050_status_t, detailed from the adapter error code
+ */
+static mpu6050_status_t i2c_linux_transfer(i2c_linux_bus_t *pbus, struct i2c_msg *pmsgs,
+                                           uint16_t nmsgs) {
+  struct i2c_rdwr_ioctl_data rdwr = {.msgs = pmsgs, .nmsgs = nmsgs};
+  if (ioctl(pbus->fd, I2C_RDWR, &rdwr) == (int)nmsgs)
+    return MPU6050_OK;
+  /* Error codes of the i2c-dev adapters, see Documentation/i2c/fault-codes */
+  switch (errno) {
+  case ENXIO:
+  case EREMOTEIO:
+    return MPU6050_ERROR_NACK;
+  case ETIMEDOUT:
+    return MPU6050_ERROR_TIMEOUT;
+  case EAGAIN:
+  case EPROTO:
+    return MPU6050_ERROR_BUS;
+  case EOVERFLOW:
+    return MPU6050_ERROR_OVERRUN;
+  case EBUSY:
+    return MPU6050_ERROR_BUSY;
+  default:
+    return MPU6050_ERROR;
+  }
+}
+
+/**
+ * @brief Register read as a write of the register address and a repeated start read
+ * @param pbus: Pointer to bus handle
+ * @param slave_address: I2C slave address
+ * @param reg_address: Address of first register to read
+ * @param pdata: Pointer to buffer where the data received is stored
+ * @param data_amount: Amount of data to read
+ * @retval mpu6050_status_t
+ */
+static mpu6050_status_t i2c_linux_read(i2c_linux_bus_t *pbus, uint16_t slave_address,
+                                       uint8_t reg_address, uint8_t *pdata, uint16_t data_amount) {
+  struct i2c_msg msgs[2] = {
+      {.addr = I2C_LINUX_ADDRESS(slave_address), .flags = 0, .len = 1, .buf = &reg_address},
+      {.addr = I2C_LINUX_ADDRESS(slave_address), .flags = I2C_M_RD, .len = data_amount,
+       .buf = pdata},
+  };
+  return i2c_linux_transfer(pbus, msgs, 2);
+}
+
+/**
+ * @brief Register write of the register address and data in a single message
+ * @param pbus: Pointer to bus handle
+ * @param slave_address: I2C slave address
+ * @param reg_address: Address of first register to write
+ * @param pdata: Pointer to data to write
+ * @param data_amount: Amount of data to write
+ * @retval mpu6050_status_t
+ */
+static mpu6050_status_t i2c_linux_write(i2c_linux_bus_t *pbus, uint16_t slave_address,
+                                        uint8_t reg_address, const uint8_t *pdata,
+                                        uint16_t data_amount) {
+  if (data_amount > I2C_LINUX_WRITE_MAX)
+    return MPU6050_ERROR;
+  pbus->write_buffer[0] = reg_address;
+  memcpy(&pbus->write_buffer[1], pdata, data_amount);
+  struct i2c_msg msg = {.addr = I2C_LINUX_ADDRESS(slave_address), .flags = 0,
+                        .len = (uint16_t)(data_amount + 1U), .buf = pbus->write_buffer};
+  return i2c_linux_transfer(pbus, &msg, 1);
+}
+
+/**
+ * @brief Queued transactions worker
+ * @note Completion is reported to the bus queue from the worker thread. The lock is released
+ * before, so the queue can start the next transaction and the callbacks can submit new ones. A
+ * transaction aborted by a bus recovery is not reported, the queue completes it.
+ * @param parg: Pointer to bus handle
+ */
+static void *i2c_linux_worker(void *parg) {
+  i2c_linux_bus_t *pbus = parg;
+  pthread_mutex_lock(&pbus->lock);
+  while (pbus->running) {
+    if (!pbus->pending) {
+      pthread_cond_wait(&pbus->cond, &pbus->lock);
+      continue;
+    }
+    i2c_transaction_t request = pbus->request;
+    pthread_mutex_unlock(&pbus->lock);
+
+    mpu6050_status_t status;
+    if (request.op == I2C_QUEUE_WRITE)
+      status = i2c_linux_write(pbus, request.slave_address, request.reg_address, request.pdata,
+                               request.data_amount);
+    else
+      status = i2c_linux_read(pbus, request.slave_address, request.reg_address, request.pdata,
+                              request.data_amount);
+
+    pthread_mutex_lock(&pbus->lock);
+    pbus->pending = false;
+    bool aborted = pbus->aborted;
+    pbus->aborted = false;
+    pbus->completing = !aborted;
+    pthread_mutex_unlock(&pbus->lock);
+    if (!aborted)
+      i2c_queue_complete(&pbus->queue, status);
+    pthread_mutex_lock(&pbus->lock);
+    pbus->completing = false;
+    pthread_cond_broadcast(&pbus->done_cond);
+  }
+  pthread_mutex_unlock(&pbus->lock);
+  return NULL;
+}
+
+/**
+ * @brief INT line event waiter
+ * @note Every edge of the line calls mpu6050_int_callback from the waiter thread. The poll
+ * timeout bounds the time to notice a detach.
+ * @param parg: Pointer to INT line
+ */
+static void *i2c_linux_int_waiter(void *parg) {
+  i2c_linux_int_t *pint = parg;
+  struct pollfd pfd = {.fd = pint->fd, .events = POLLIN};
+  while (pint->running) {
+    if (poll(&pfd, 1, 100) <= 0)
+      continue;
+    struct gpioevent_data event;
+    if (read(pint->fd, &event, sizeof(event)) != sizeof(event))
+      continue;
+    mpu6050_int_callback(pint->pcontext);
+  }
+  return NULL;
+}
+
+/**
+ * @brief I2C init function
+ * @note Opens the i2c-dev device and starts the queued transactions worker. Calling it again for
+ * an initialized bus does nothing.
+ * @param bus: Bus handle (i2c_linux_bus_t) with the device path set
+ * @retval mpu6050_status_t
+ */
+mpu6050_status_t i2c_init(void *bus) {
+  i2c_linux_bus_t *pbus = bus;
+  assert(pbus);
+  assert(pbus->device);
+  if (pbus->running)
+    return MPU6050_OK;
+
+  pbus->fd = open(pbus->device, O_RDWR);
+  if (pbus->fd < 0)
+    return MPU6050_ERROR;
+  /* I2C_TIMEOUT is in 10 ms units and applies to the whole adapter */
+  if (pbus->adapter_timeout_ms != 0 &&
+      ioctl(pbus->fd, I2C_TIMEOUT, (unsigned long)(pbus->adapter_timeout_ms + 9U) / 10U) < 0) {
+    close(pbus->fd);
+    return MPU6050_ERROR;
+  }
+  pbus->pending = false;
+  pbus->completing = false;
+  pbus->aborted = false;
+  pbus->running = true;
+  pthread_mutex_init(&pbus->lock, NULL);
+  pthread_cond_init(&pbus->cond, NULL);
+  pthread_condattr_t attr;
+  pthread_condattr_init(&attr);
+  pthread_condattr_setclock(&attr, CLOCK_MONOTONIC);
+  pthread_cond_init(&pbus->done_cond, &attr);
+  pthread_condattr_destroy(&attr);
+  i2c_queue_init(&pbus->queue, pbus);
+  if (pthread_create(&pbus->worker, NULL, i2c_linux_worker, pbus) != 0) {
+    pbus->running = false;
+    close(pbus->fd);
+    return MPU6050_ERROR;
+  }
+  return MPU6050_OK;
+}
+
+/**
+ * @brief I2C deinit function
+ * @note Stops the worker once the transaction in flight completes and closes the device. Waiting
+ * transactions are not started.
+ * @param pbus: Pointer to bus handle
+ * @retval mpu6050_status_t
+ */
+mpu6050_status_t i2c_linux_deinit(i2c_linux_bus_t *pbus) {
+  assert(pbus);
+  if (!pbus->running)
+    return MPU6050_ERROR;
+  pthread_mutex_lock(&pbus->lock);
+  pbus->running = false;
+  pthread_cond_signal(&pbus->cond);
+  pthread_mutex_unlock(&pbus->lock);
+  pthread_join(pbus->worker, NULL);
+  pthread_cond_destroy(&pbus->done_cond);
+  pthread_cond_destroy(&pbus->cond);
+  pthread_mutex_destroy(&pbus->lock);
+  close(pbus->fd);
+  return MPU6050_OK;
+}
+
+/**
+ * @brief I2C non-blocking transaction start through the bus worker
+ * @note Completion is reported to the bus queue from the worker thread.
+ * @param bus: Bus handle (i2c_linux_bus_t)
+ * @param ptransaction: Pointer to transaction
+ * @retval mpu6050_status_t
+ */
+mpu6050_status_t i2c_start(void *bus, const i2c_transaction_t *ptransaction) {
+  i2c_linux_bus_t *pbus = bus;
+  pthread_mutex_lock(&pbus->lock);
+  if (!pbus->running || pbus->pending) {
+    mpu6050_status_t status = pbus->running ? MPU6050_ERROR_BUSY : MPU6050_ERROR;
+    pthread_mutex_unlock(&pbus->lock);
+    return status;
+  }
+  pbus->request = *ptransaction;
+  pbus->pending = true;
+  pthread_cond_signal(&pbus->cond);
+  pthread_mutex_unlock(&pbus->lock);
+  return MPU6050_OK;
+}
+
+/**
+ * @brief Transaction queue of a bus
+ * @param bus: Bus handle (i2c_linux_bus_t)
+ * @retval Pointer to queue, NULL if the bus is not initialized
+ */
+i2c_queue_t *i2c_get_queue(void *bus) {
+  i2c_linux_bus_t *pbus = bus;
+  if (!pbus->running)
+    return NULL;
+  return &pbus->queue;
+}
+
+/**
+ * @brief Lock the queue of a bus
+ * @param bus: Bus handle (i2c_linux_bus_t)
+ */
+void i2c_lock(void *bus) {
+  i2c_linux_bus_t *pbus = bus;
+  pthread_mutex_lock(&pbus->lock);
+}
+
+/**
+ * @brief Unlock the queue of a bus
+ * @param bus: Bus handle (i2c_linux_bus_t)
+ */
+void i2c_unlock(void *bus) {
+  i2c_linux_bus_t *pbus = bus;
+  pthread_mutex_unlock(&pbus->lock);
+}
+
+/**
+ * @brief Wait for a transaction completion
+ * @note The completion flag is set by the callback from the worker, which then signals the
+ * waiters under the lock, so no completion is missed.
+ * @param bus: Bus handle (i2c_linux_bus_t)
+ * @param pdone: Pointer to completion flag
+ * @param timeout_us: Time limit of the wait
+ * @retval mpu6050_status_t, MPU6050_ERROR_TIMEOUT if the time limit expired
+ */
+mpu6050_status_t i2c_wait(void *bus, volatile bool *pdone, uint32_t timeout_us) {
+  i2c_linux_bus_t *pbus = bus;
+  struct timespec deadline;
+  clock_gettime(CLOCK_MONOTONIC, &deadline);
+  uint64_t nsec = (uint64_t)deadline.tv_nsec + (uint64_t)timeout_us * 1000U;
+  deadline.tv_sec += (time_t)(nsec / 1000000000U);
+  deadline.tv_nsec = (long)(nsec % 1000000000U);
+
+  mpu6050_status_t status = MPU6050_OK;
+  pthread_mutex_lock(&pbus->lock);
+  while (!*pdone) {
+    if (pthread_cond_timedwait(&pbus->done_cond, &pbus->lock, &deadline) == ETIMEDOUT) {
+      status = *pdone ? MPU6050_OK : MPU6050_ERROR_TIMEOUT;
+      break;
+    }
+  }
+  pthread_mutex_unlock(&pbus->lock);
+  return status;
+}
+
+/**
+ * @brief Recover a bus
+ * @note The ioctl in flight cannot be cancelled, its transaction is marked aborted and waited
+ * for, bounded by the adapter timeout. Clocking out a stuck slave is left to the adapter driver,
+ * the I2C core runs its bus recovery on timeouts. Must not be called from a completion callback.
+ * @param bus: Bus handle (i2c_linux_bus_t)
+ * @retval mpu6050_status_t
+ */
+mpu6050_status_t i2c_recover(void *bus) {
+  i2c_linux_bus_t *pbus = bus;
+  if (!pbus->running)
+    return MPU6050_ERROR;
+  pthread_mutex_lock(&pbus->lock);
+  if (pbus->pending)
+    pbus->aborted = true;
+  while (pbus->pending || pbus->completing)
+    pthread_cond_wait(&pbus->done_cond, &pbus->lock);
+  pthread_mutex_unlock(&pbus->lock);
+  return MPU6050_OK;
+}
+
+/**
+ * @brief Clock speed of a bus
+ * @param bus: Bus handle (i2c_linux_bus_t)
+ * @retval Clock speed in Hz, as set in the handle
+ */
+uint32_t i2c_speed_hz(void *bus) {
+  i2c_linux_bus_t *pbus = bus;
+  return (pbus->speed_hz != 0) ? pbus->speed_hz : I2C_LINUX_DEFAULT_SPEED;
+}
+
+/**
+ * @brief Initialize an empty batch
+ * @param pbatch: Pointer to batch
+ */
+void i2c_linux_batch_init(i2c_linux_batch_t *pbatch) {
+  assert(pbatch);
+  pbatch->nmsgs = 0;
+  pbatch->pool_used = 0;
+}
+
+/**
+ * @brief Append a register read to a batch
+ * @param pbatch: Pointer to batch
+ * @param slave_address: I2C slave address
+ * @param reg_address: Addres of first register to read
+ * @param pdata: Pointer to buffer where the data received will be stored on submit
+ * @param data_amount: Amount of data to read
+ * @retval mpu6050_status_t
+ */
+mpu6050_status_t i2c_linux_batch_read(i2c_linux_batch_t *pbatch, uint16_t slave_address,
+                                      uint8_t reg_address, uint8_t *pdata, uint16_t data_amount) {
+  assert(pbatch);
+  if (pbatch->nmsgs + 2U > I2C_LINUX_BATCH_MAX_MSGS)
+    return MPU6050_ERROR;
+  if (pbatch->pool_used + 1U > I2C_LINUX_BATCH_POOL_SIZE)
+    return MPU6050_ERROR;
+
+  uint8_t *preg = &pbatch->pool[pbatch->pool_used++];
+  *preg = reg_address;
+  pbatch->msgs[pbatch->nmsgs++] = (struct i2c_msg){
+      .addr = I2C_LINUX_ADDRESS(slave_address), .flags = 0, .len = 1, .buf = preg};
+  pbatch->msgs[pbatch->nmsgs++] = (struct i2c_msg){
+      .addr = I2C_LINUX_ADDRESS(slave_address), .flags = I2C_M_RD, .len = data_amount,
+      .buf = pdata};
+  return MPU6050_OK;
+}
+
+/**
+ * @brief Append a register write to a batch
+ * @note Data is copied into the batch, consecutive registers are written in burst mode.
+ * @param pbatch: Pointer to batch
+ * @param slave_address: I2C slave address
+ * @param reg_address: Addres of first register to write
+ * @param pdata: Pointer to buffer with values to write
+ * @param data_amount: Amount of data to write
+ * @retval mpu6050_status_t
+ */
+mpu6050_status_t i2c_linux_batch_write(i2c_linux_batch_t *pbatch, uint16_t slave_address,
+                                       uint8_t reg_address, const uint8_t *pdata,
+                                       uint16_t data_amount) {
+  assert(pbatch);
+  if (pbatch->nmsgs + 1U > I2C_LINUX_BATCH_MAX_MSGS)
+    return MPU6050_ERROR;
+  if (pbatch->pool_used + 1U + data_amount > I2C_LINUX_BATCH_POOL_SIZE)
+    return MPU6050_ERROR;
+
+  uint8_t *pbuffer = &pbatch->pool[pbatch->pool_used];
+  pbuffer[0] = reg_address;
+  memcpy(&pbuffer[1], pdata, data_amount);
+  pbatch->pool_used += 1 + data_amount;
+  pbatch->msgs[pbatch->nmsgs++] = (struct i2c_msg){.addr = I2C_LINUX_ADDRESS(slave_address),
+                                                   .flags = 0,
+                                                   .len = 1 + data_amount,
+                                                   .buf = pbuffer};
+  return MPU6050_OK;
+}
+
+/**
+ * @brief Submit a batch as one combined transaction
+ * @note The batch is emptied after submit, whatever the result.
+ * @param pbus: Pointer to bus handle
+ * @param pbatch: Pointer to batch
+ * @retval mpu6050_status_t
+ */
+mpu6050_status_t i2c_linux_batch_submit(i2c_linux_bus_t *pbus, i2c_linux_batch_t *pbatch) {
+  assert(pbus);
+  assert(pbatch);
+  if (pbatch->nmsgs == 0)
+    return MPU6050_OK;
+  mpu6050_status_t status = i2c_linux_transfer(pbus, pbatch->msgs, pbatch->nmsgs);
+  i2c_linux_batch_init(pbatch);
+  return status;
+}
+
+/**
+ * @brief Attach a GPIO line to a device INT pin
+ * @note A line event is requested on the bus GPIO chip, on the active edge of the INT pin.
+ * @param bus: Bus handle (i2c_linux_bus_t) with the GPIO chip path set
+ * @param int_line: GPIO line offset on the chip
+ * @param pcontext: Context of the interrupt, MPU6050 handle
+ * @retval mpu6050_status_t
+ */
+mpu6050_status_t i2c_int_attach(void *bus, uint32_t int_line, void *pcontext) {
+  i2c_linux_bus_t *pbus = bus;
+  assert(pbus);
+  if (pbus->gpiochip == NULL)
+    return MPU6050_ERROR;
+  i2c_linux_int_t *pint = NULL;
+  for (uint8_t i = 0; i < I2C_LINUX_MAX_INT_LINES; i++) {
+    if (pbus->ints[i].running && pbus->ints[i].line == int_line)
+      return MPU6050_ERROR;
+    if (!pbus->ints[i].running && pint == NULL)
+      pint = &pbus->ints[i];
+  }
+  if (pint == NULL)
+    return MPU6050_ERROR;
+
+  int chip_fd = open(pbus->gpiochip, O_RDONLY);
+  if (chip_fd < 0)
+    return MPU6050_ERROR;
+  struct gpioevent_request request = {
+      .lineoffset = int_line,
+      .handleflags = GPIOHANDLE_REQUEST_INPUT,
+      .eventflags = pbus->int_active_low ? GPIOEVENT_REQUEST_FALLING_EDGE
+                                         : GPIOEVENT_REQUEST_RISING_EDGE,
+  };
+  strncpy(request.consumer_label, "mpu6050", sizeof(request.consumer_label) - 1);
+  int status = ioctl(chip_fd, GPIO_GET_LINEEVENT_IOCTL, &request);
+  close(chip_fd);
+  if (status < 0)
+    return MPU6050_ERROR;
+
+  pint->line = int_line;
+  pint->fd = request.fd;
+  pint->pcontext = pcontext;
+  pint->running = true;
+  if (pthread_create(&pint->thread, NULL, i2c_linux_int_waiter, pint) != 0) {
+    pint->running = false;
+    close(pint->fd);
+    return MPU6050_ERROR;
+  }
+  return MPU6050_OK;
+}
+
+/**
+ * @brief Detach a GPIO line from a device INT pin
+ * @param bus: Bus handle (i2c_linux_bus_t)
+ * @param int_line: GPIO line offset on the chip
+ * @retval mpu6050_status_t
+ */
+mpu6050_status_t i2c_int_detach(void *bus, uint32_t int_line) {
+  i2c_linux_bus_t *pbus = bus;
+  assert(pbus);
+  for (uint8_t i = 0; i < I2C_LINUX_MAX_INT_LINES; i++) {
+    i2c_linux_int_t *pint = &pbus->ints[i];
+    if (pint->running && pint->line == int_line) {
+      pint->running = false;
+      pthread_join(pint->thread, NULL);
+      close(pint->fd);
+      return MPU6050_OK;
+    }
+  }
+  return MPU6050_ERROR;
+}
+
+/**
+ * @brief Timestamp from the raw monotonic clock, not slewed by NTP
+ * @param bus: Bus handle (i2c_linux_bus_t), unused
+ * @retval Time in ns
+ */
+uint64_t i2c_timestamp_ns(void *bus) {
+  struct timespec now;
+  (void)bus;
+  clock_gettime(CLOCK_MONOTONIC_RAW, &now);
+  return (uint64_t)now.tv_sec * 1000000000ULL + (uint64_t)now.tv_nsec;
+}
@@ -0,0 +1,374 @@
+/**
+ ******************************************************************************
+ * @file           : port_i2c_queue.c
+ * @author         : Gonzalo Gabriel Fernandez
+ * @brief          : MPU6050 Driver I2C transaction queue
+ ******************************************************************************
+ * @attention
+ *
+ * Hardware independant part of the I2C port. The port starts transactions
+ * with i2c_start and reports their completion with i2c_queue_complete, the
+ * queue picks the next transaction and the blocking API waits on it.
+ *
+ ******************************************************************************
+ */
+
+#include "port_i2c_queue.h"
+#include "port_i2c.h"
+
+#include <assert.h>
+#include <stddef.h>
+
+/**
+ * @brief Blocking transaction completion
+ */
+typedef struct {
+  volatile bool done;      /*!< Transaction completed */
+  mpu6050_status_t status; /*!< Completion status */
+
+} i2c_queue_waiter_t;
+
+/**
+ * @brief Move the highest priority waiting transaction in flight
+ * @note Called with the bus locked. The start count tells a recovery which transaction it
+ * aborted.
+ * @param pqueue: Pointer to queue
+ * @retval true if a transaction was moved, false if the queue is empty
+ */
+static bool i2c_queue_pop(i2c_queue_t *pqueue) {
+  for (uint8_t priority = 0; priority < I2C_QUEUE_PRIOS; priority++) {
+    if (pqueue->count[priority] == 0)
+      continue;
+    pqueue->current = pqueue->slots[priority][pqueue->head[priority]];
+    pqueue->head[priority] = (uint8_t)((pqueue->head[priority] + 1U) % I2C_QUEUE_SIZE);
+    pqueue->count[priority]--;
+    pqueue->busy = true;
+    pqueue->started++;
+    pqueue->started_ns = i2c_timestamp_ns(pqueue->bus);
+    return true;
+  }
+  pqueue->busy = false;
+  return false;
+}
+
+/**
+ * @brief Completion of a blocking transaction
+ * @param pcontext: Pointer to waiter
+ * @param status: Completion status
+ */
+static void i2c_queue_wake(void *pcontext, mpu6050_status_t status) {
+  i2c_queue_waiter_t *pwaiter = pcontext;
+  pwaiter->status = status;
+  pwaiter->done = true;
+}
+
+/**
+ * @brief Timeout of the transaction in flight
+ * @param pqueue: Pointer to queue
+ * @param pstarted: Pointer where the start count of the transaction is stored
+ * @param pdeadline_ns: Pointer where the time it times out is stored
+ * @retval true if a transaction is in flight
+ */
+static bool i2c_queue_deadline(i2c_queue_t *pqueue, uint32_t *pstarted, uint64_t *pdeadline_ns) {
+  i2c_lock(pqueue->bus);
+  bool busy = pqueue->busy;
+  uint64_t started_ns = pqueue->started_ns;
+  uint16_t data_amount = pqueue->current.data_amount;
+  *pstarted = pqueue->started;
+  i2c_unlock(pqueue->bus);
+  if (busy)
+    *pdeadline_ns = started_ns + (uint64_t)i2c_timeout_us(pqueue->bus, data_amount) * 1000U;
+  return busy;
+}
+
+/**
+ * @brief Recover the bus and abort a transaction in flight
+ * @note The port guarantees that the transaction recovered is not completed by the hardware
+ * anymore, it is completed here with a timeout unless it completed during the recovery.
+ * @param pqueue: Pointer to queue
+ * @param started: Start count of the transaction to abort
+ * @retval mpu6050_status_t of the port recovery
+ */
+static mpu6050_status_t i2c_queue_abort(i2c_queue_t *pqueue, uint32_t started) {
+  uint64_t start_ns = i2c_timestamp_ns(pqueue->bus);
+  mpu6050_status_t status = i2c_recover(pqueue->bus);
+  uint32_t recovery_ns = (uint32_t)(i2c_timestamp_ns(pqueue->bus) - start_ns);
+
+  i2c_lock(pqueue->bus);
+  pqueue->recoveries++;
+  pqueue->recovery_ns += recovery_ns;
+  if (recovery_ns > pqueue->recovery_max_ns)
+    pqueue->recovery_max_ns = recovery_ns;
+  bool aborted = pqueue->busy && (pqueue->started == started);
+  if (aborted)
+    pqueue->timeouts++;
+  i2c_unlock(pqueue->bus);
+
+  if (aborted)
+    i2c_queue_complete(pqueue, MPU6050_ERROR_TIMEOUT);
+  return status;
+}
+
+/**
+ * @brief Blocking transaction through the queue
+ * @note Must not be called from a completion callback, or from an interrupt that preempts the
+ * completion interrupt of the bus. A transaction in flight that overruns its timeout, this one
+ * or one ahead of it, is aborted with a bus recovery.
+ * @param bus: Bus handle
+ * @param op: Transaction direction
+ * @param slave_address: I2C slave address
+ * @param reg_address: First register
+ * @param pdata: Data buffer
+ * @param data_amount: Amount of data
+ * @retval mpu6050_status_t
+ */
+static mpu6050_status_t i2c_queue_transfer(void *bus, i2c_queue_op_t op, uint16_t slave_address,
+                                           uint8_t reg_address, uint8_t *pdata,
+                                           uint16_t data_amount) {
+  i2c_queue_waiter_t waiter = {.done = false, .status = MPU6050_ERROR};
+  i2c_transaction_t transaction = {
+      .op = op,
+      .priority = I2C_QUEUE_PRIO_HOUSEKEEPING,
+      .slave_address = slave_address,
+      .reg_address = reg_address,
+      .pdata = pdata,
+      .data_amount = data_amount,
+      .callback = i2c_queue_wake,
+      .pcontext = &waiter,
+  };
+  mpu6050_status_t status = i2c_queue_submit(bus, &transaction);
+  if (status != MPU6050_OK)
+    return status;
+
+  /* Waits are bounded by the timeout of the transaction in flight, which may not be this one */
+  i2c_queue_t *pqueue = i2c_get_queue(bus);
+  while (!waiter.done) {
+    uint32_t started;
+    uint64_t now_ns = i2c_timestamp_ns(bus);
+    uint64_t deadline_ns = now_ns + I2C_TIMEOUT_SLACK_US * 1000U;
+    if (i2c_queue_deadline(pqueue, &started, &deadline_ns) && now_ns >= deadline_ns) {
+      i2c_queue_abort(pqueue, started);
+      continue;
+    }
+    i2c_wait(bus, &waiter.done, (uint32_t)((deadline_ns - now_ns) / 1000U) + 1U);
+  }
+  return waiter.status;
+}
+
+/**
+ * @brief Initialize the transaction queue of a bus
+ * @note Called by the port from i2c_init, or from the bus init of the port.
+ * @param pqueue: Pointer to queue
+ * @param bus: Bus handle
+ */
+void i2c_queue_init(i2c_queue_t *pqueue, void *bus) {
+  assert(pqueue);
+  for (uint8_t priority = 0; priority < I2C_QUEUE_PRIOS; priority++) {
+    pqueue->head[priority] = 0;
+    pqueue->count[priority] = 0;
+  }
+  pqueue->bus = bus;
+  pqueue->busy = false;
+  pqueue->completed = 0;
+  pqueue->errors = 0;
+  pqueue->rejected = 0;
+  pqueue->started = 0;
+  pqueue->started_ns = 0;
+  pqueue->timeouts = 0;
+  pqueue->recoveries = 0;
+  pqueue->recovery_ns = 0;
+  pqueue->recovery_max_ns = 0;
+}
+
+/**
+ * @brief Queue a transaction
+ * @note Started right away if the bus is idle. A transaction that fails to start at submit
+ * returns an error without calling its callback. The copy is stamped with the port time.
+ * @param bus: Bus handle
+ * @param ptransaction: Pointer to transaction, copied into the queue
+ * @retval mpu6050_status_t, MPU6050_ERROR_BUSY if the queue is full, the start status if the
+ * transaction could not start
+ */
+mpu6050_status_t i2c_queue_submit(void *bus, const i2c_transaction_t *ptransaction) {
+  assert(ptransaction);
+  i2c_queue_t *pqueue = i2c_get_queue(bus);
+  if ((pqueue == NULL) || (ptransaction->priority >= I2C_QUEUE_PRIOS))
+    return MPU6050_ERROR;
+
+  uint8_t priority = ptransaction->priority;
+  uint64_t submitted_ns = i2c_timestamp_ns(bus);
+  i2c_lock(bus);
+  if (pqueue->count[priority] == I2C_QUEUE_SIZE) {
+    pqueue->rejected++;
+    i2c_unlock(bus);
+    return MPU6050_ERROR_BUSY;
+  }
+  uint8_t index = (uint8_t)((pqueue->head[priority] + pqueue->count[priority]) % I2C_QUEUE_SIZE);
+  pqueue->slots[priority][index] = *ptransaction;
+  pqueue->slots[priority][index].submitted_ns = submitted_ns;
+  pqueue->count[priority]++;
+  /* An idle queue is empty, so the transaction popped is the one submitted */
+  bool start = !pqueue->busy && i2c_queue_pop(pqueue);
+  i2c_unlock(bus);
+
+  mpu6050_status_t status = start ? i2c_start(bus, &pqueue->current) : MPU6050_OK;
+  if (status != MPU6050_OK) {
+    i2c_lock(bus);
+    pqueue->errors++;
+    start = i2c_queue_pop(pqueue);
+    i2c_unlock(bus);
+    mpu6050_status_t next_status = start ? i2c_start(bus, &pqueue->current) : MPU6050_OK;
+    if (next_status != MPU6050_OK)
+      i2c_queue_complete(pqueue, next_status);
+  }
+  return status;
+}
+
+/**
+ * @brief Completion of the transaction in flight
+ * @note Called by the port from the completion or error interrupt, or from its worker. The next
+ * transaction is started before the callback of the completed one, so the bus does not idle
+ * while the callback runs. Transactions that fail to start complete with the start status.
+ * @param pqueue: Pointer to queue
+ * @param status: Completion status
+ */
+void i2c_queue_complete(i2c_queue_t *pqueue, mpu6050_status_t status) {
+  assert(pqueue);
+  for (;;) {
+    i2c_transaction_t done = pqueue->current;
+    i2c_lock(pqueue->bus);
+    if (status == MPU6050_OK)
+      pqueue->completed++;
+    else
+      pqueue->errors++;
+    bool next = i2c_queue_pop(pqueue);
+    i2c_unlock(pqueue->bus);
+
+    mpu6050_status_t next_status = next ? i2c_start(pqueue->bus, &pqueue->current) : MPU6050_OK;
+    if (done.callback != NULL)
+      done.callback(done.pcontext, status);
+    if (next_status == MPU6050_OK)
+      return;
+    status = next_status;
+  }
+}
+
+/**
+ * @brief Check for an idle bus
+ * @param bus: Bus handle
+ * @retval true if no transaction is in flight or waiting
+ */
+bool i2c_queue_is_idle(void *bus) {
+  i2c_queue_t *pqueue = i2c_get_queue(bus);
+  return (pqueue == NULL) || !pqueue->busy;
+}
+
+/**
+ * @brief Timeout of a transaction
+ * @note I2C_TIMEOUT_MARGIN times the transfer time at the bus speed, address, register address
+ * and repeated start address included, plus I2C_TIMEOUT_SLACK_US.
+ * @param bus: Bus handle
+ * @param data_amount: Amount of data of the transaction
+ * @retval Timeout in us
+ */
+uint32_t i2c_timeout_us(void *bus, uint16_t data_amount) {
+  uint32_t clocks = 9U * (3U + data_amount) + 3U;
+  uint32_t transfer_us = (uint32_t)((uint64_t)clocks * 1000000U / i2c_speed_hz(bus)) + 1U;
+  return I2C_TIMEOUT_MARGIN * transfer_us + I2C_TIMEOUT_SLACK_US;
+}
+
+/**
+ * @brief Watchdog of the transaction in flight
+ * @note Blocking transactions check on their own. Call it periodically from the main loop when
+ * only non-blocking reads run, so a stuck read completes with MPU6050_ERROR_TIMEOUT.
+ * @param bus: Bus handle
+ * @retval true if the transaction in flight overran its timeout and the bus was recovered
+ */
+bool i2c_queue_check(void *bus) {
+  i2c_queue_t *pqueue = i2c_get_queue(bus);
+  uint32_t started;
+  uint64_t deadline_ns;
+  if (pqueue == NULL || !i2c_queue_deadline(pqueue, &started, &deadline_ns))
+    return false;
+  if (i2c_timestamp_ns(bus) < deadline_ns)
+    return false;
+  i2c_queue_abort(pqueue, started);
+  return true;
+}
+
+/**
+ * @brief Recover the bus
+ * @note A transaction in flight is aborted and completes with MPU6050_ERROR_TIMEOUT. Must not be
+ * called from a completion callback.
+ * @param bus: Bus handle
+ * @retval mpu6050_status_t of the port recovery
+ */
+mpu6050_status_t i2c_queue_recover(void *bus) {
+  i2c_queue_t *pqueue = i2c_get_queue(bus);
+  if (pqueue == NULL)
+    return MPU6050_ERROR;
+  uint32_t started;
+  uint64_t deadline_ns;
+  i2c_queue_deadline(pqueue, &started, &deadline_ns);
+  return i2c_queue_abort(pqueue, started);
+}
+
+/**
+ * @brief I2C read register
+ * @param bus: Bus handle
+ * @param slave_address: I2C slave address
+ * @param reg_address: Address of register to read
+ * @param pdata: Pointer to buffer where the register value will be stored
+ * @retval mpu6050_status_t
+ */
+mpu6050_status_t i2c_reg_read(void *bus, uint16_t slave_address, uint8_t reg_address,
+                              uint8_t *pdata) {
+  return i2c_queue_transfer(bus, I2C_QUEUE_READ, slave_address, reg_address, pdata,
+                            sizeof(uint8_t));
+}
+
+/**
+ * @brief I2C burst read
+ * @note Read multiple registers in burst mode with I2C
+ * @param bus: Bus handle
+ * @param slave_address: I2C slave address
+ * @param reg_address: Addres of first register to read
+ * @param pdata: Pointer to buffer where the data received is stored
+ * @param data_amount: Amount of data to read
+ * @retval mpu6050_status_t
+ */
+mpu6050_status_t i2c_burst_read(void *bus, uint16_t slave_address, uint8_t reg_address,
+                                uint8_t *pdata, uint16_t data_amont) {
+  return i2c_queue_transfer(bus, I2C_QUEUE_READ, slave_address, reg_address, pdata, data_amont);
+}
+
+/**
+ * @brief I2C write register
+ * @param bus: Bus handle
+ * @param slave_address: I2C slave address
+ * @param reg_address: Addres of register to write
+ * @param pdata: Pointer to buffer with value to write
+ * @retval mpu6050_status_t
+ */
+mpu6050_status_t i2c_reg_write(void *bus, uint16_t slave_address, uint8_t reg_address,
+                               uint8_t *pdata) {
+  return i2c_queue_transfer(bus, I2C_QUEUE_WRITE, slave_address, reg_address, pdata,
+                            sizeof(uint8_t));
+}
+
+/**
+ * @brief I2C burst write
+ * @note Write multiple registers in burst mode with I2C, a single transaction from the first
+ * register on
+ * @param bus: Bus handle
+ * @param slave_address: I2C slave address
+ * @param reg_address: Address of first register to write
+ * @param pdata: Pointer to buffer with values to write
+ * @param data_amount: Amount of data to write
+ * @retval mpu6050_status_t
+ */
+mpu6050_status_t i2c_burst_write(void *bus, uint16_t slave_address, uint8_t reg_address,
+                                 uint8_t *pdata, uint16_t data_amount) {
+  return i2c_queue_transfer(bus, I2C_QUEUE_WRITE, slave_address, reg_address, pdata,
+                            data_amount);
+}
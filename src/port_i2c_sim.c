@@ -0,0 +1,1126 @@
+/**
+ ******************************************************************************
+ * @file           : port_i2c_sim.c
+ * @author         : Gonzalo Gabriel Fernandez
+ * @brief          : MPU6050 Driver simulated I2C port
+ ******************************************************************************
+ * @attention
+ *
+ * MPU6050 Driver I2C port for host builds, with in-process simulated devices.
+ * Queued transactions complete, and start the next queued one, from
+ * i2c_sim_run. Blocking transactions run the simulation until their own
+ * completion. DATA_RDY and motion interrupts of wired INT pins are also
+ * delivered from i2c_sim_run, a latched INT pin raises no new interrupt until
+ * it is cleared. The auxiliary I2C master runs on every sample.
+ * In real-time mode the simulated time follows the host clock: the simulation
+ * sleeps until the host clock reaches it and idle time passes with the host
+ * clock, so a bus is as busy as a real one for the thread driving it.
+ *
+ ******************************************************************************
+ */
+
+#define _POSIX_C_SOURCE 200112L
+
+#include <assert.h>
+#include <errno.h>
+#include <math.h>
+#include <stddef.h>
+#include <string.h>
+#include <time.h>
+
+#include "mpu6050.h"
+#include "port_i2c.h"
+#include "port_i2c_sim.h"
+
+#define I2C_SIM_PI 3.14159265358979f
+
+/**
+ * @brief Simulated device on a bus
+ * @param pbus: Pointer to simulated bus
+ * @param slave_address: 8-bit I2C slave address used by the driver
+ * @retval Pointer to device, NULL if no device answers the address
+ */
+static i2c_sim_device_t *i2c_sim_find(i2c_sim_bus_t *pbus, uint16_t slave_address) {
+  for (uint8_t i = 0; i < pbus->count; i++) {
+    if (pbus->pdevices[i]->address == (slave_address >> 1))
+      return pbus->pdevices[i];
+  }
+  return NULL;
+}
+
+/**
+ * @brief Device acknowledging an address
+ * @note A device does not acknowledge until its reset completes.
+ * @param pbus: Pointer to simulated bus
+ * @param slave_address: 8-bit I2C slave address used by the driver
+ * @retval Pointer to device, NULL if no device acknowledges the address
+ */
+static i2c_sim_device_t *i2c_sim_find_ack(i2c_sim_bus_t *pbus, uint16_t slave_address) {
+  i2c_sim_device_t *pdev = i2c_sim_find(pbus, slave_address);
+  if (pdev == NULL || pbus->now_ns < pdev->reset_done_ns)
+    return NULL;
+  return pdev;
+}
+
+/**
+ * @brief Aux sensor reached from the bus through a device in bypass mode
+ * @param pbus: Pointer to simulated bus
+ * @param slave_address: 8-bit I2C slave address used by the driver
+ * @retval Pointer to aux sensor, NULL if no sensor answers the address
+ */
+static i2c_sim_aux_t *i2c_sim_find_bypass(i2c_sim_bus_t *pbus, uint16_t slave_address) {
+  for (uint8_t i = 0; i < pbus->count; i++) {
+    i2c_sim_device_t *pdev = pbus->pdevices[i];
+    if (!(pdev->regs[MPU6050_INT_PIN_CFG] & (1U << MPU6050_BYPASS_EN_OFFSET)) ||
+        (pdev->regs[MPU6050_USER_CTRL] & (1U << MPU6050_I2C_MST_EN)))
+      continue;
+    for (uint8_t j = 0; j < pdev->aux_count; j++) {
+      if (pdev->paux[j]->address == (slave_address >> 1))
+        return pdev->paux[j];
+    }
+  }
+  return NULL;
+}
+
+/**
+ * @brief Reset the register file to its power-on values
+ * @param pdev: Pointer to simulated device
+ */
+static void i2c_sim_device_reset(i2c_sim_device_t *pdev) {
+  memset(pdev->regs, 0, sizeof(pdev->regs));
+  pdev->regs[MPU6050_WHO_AM_I] = MPU6050_WHO_AM_I_DEFAULT;
+  pdev->regs[MPU6050_PWR_MGMT_1] = 1U << MPU6050_PWR1_SLEEP_OFFSET;
+  pdev->fifo_head = 0;
+  pdev->fifo_count = 0;
+  pdev->int_held = false;
+}
+
+/**
+ * @brief Push a byte into the FIFO, the oldest byte is lost when the FIFO is full
+ * @param pdev: Pointer to simulated device
+ * @param value: Byte to push
+ */
+static void i2c_sim_fifo_push(i2c_sim_device_t *pdev, uint8_t value) {
+  if (pdev->fifo_count == MPU6050_FIFO_SIZE) {
+    pdev->fifo_head = (pdev->fifo_head + 1U) % MPU6050_FIFO_SIZE;
+    pdev->fifo_count--;
+    pdev->fifo_bytes_lost++;
+    pdev->regs[MPU6050_INT_STATUS] |= 1U << MPU6050_INT_FIFO_OFLOW_OFFSET;
+  }
+  pdev->fifo[(pdev->fifo_head + pdev->fifo_count) % MPU6050_FIFO_SIZE] = value;
+  pdev->fifo_count++;
+}
+
+/**
+ * @brief Pop a byte from the FIFO
+ * @param pdev: Pointer to simulated device
+ * @retval Oldest byte, 0 if the FIFO is empty
+ */
+static uint8_t i2c_sim_fifo_pop(i2c_sim_device_t *pdev) {
+  if (pdev->fifo_count == 0)
+    return 0;
+  uint8_t value = pdev->fifo[pdev->fifo_head];
+  pdev->fifo_head = (pdev->fifo_head + 1U) % MPU6050_FIFO_SIZE;
+  pdev->fifo_count--;
+  return value;
+}
+
+/**
+ * @brief Offset register contribution to a channel
+ * @note Accel offsets are +-16g full scale counts with bit 0 reserved, gyro offsets +-1000 dps.
+ * @param pdev: Pointer to simulated device
+ * @param channel: Output channel
+ * @retval Offset in output counts at the current full scale
+ */
+static float i2c_sim_offset(const i2c_sim_device_t *pdev, uint8_t channel) {
+  if (channel < I2C_SIM_TEMP) {
+    uint8_t reg = MPU6050_XA_OFFS_H + 2 * channel;
+    int16_t offset = (int16_t)(((uint16_t)pdev->regs[reg] << 8) | (pdev->regs[reg + 1] & 0xFEU));
+    uint8_t fs = (pdev->regs[MPU6050_ACCEL_CONFIG] >> MPU6050_ACCEL_FS_SEL_OFFSET) & 0b11;
+    return (float)offset * 8.0f / (float)(1U << fs);
+  }
+  if (channel > I2C_SIM_TEMP) {
+    uint8_t reg = MPU6050_XG_OFFS_USRH + 2 * (channel - I2C_SIM_GYRO_X);
+    int16_t offset = (int16_t)(((uint16_t)pdev->regs[reg] << 8) | pdev->regs[reg + 1]);
+    uint8_t fs = (pdev->regs[MPU6050_GYRO_CONFIG] >> MPU6050_GYRO_FS_SEL_OFFSET) & 0b11;
+    return (float)offset * 4.0f / (float)(1U << fs);
+  }
+  return 0.0f;
+}
+
+/**
+ * @brief Check whether a channel is measuring
+ * @note Axes in standby and a disabled temperature sensor keep their last output.
+ * @param pdev: Pointer to simulated device
+ * @param channel: Output channel
+ * @retval true if the channel is updated by new samples
+ */
+static bool i2c_sim_channel_enabled(const i2c_sim_device_t *pdev, uint8_t channel) {
+  if (channel == I2C_SIM_TEMP)
+    return !(pdev->regs[MPU6050_PWR_MGMT_1] & (1U << MPU6050_PWR1_TEMP_DIS_OFFSET));
+  uint8_t stby_offset = (channel < I2C_SIM_TEMP)
+                            ? MPU6050_PWR2_STBY_XA_OFFSET - channel
+                            : MPU6050_PWR2_STBY_XG_OFFSET - (channel - I2C_SIM_GYRO_X);
+  return !(pdev->regs[MPU6050_PWR_MGMT_2] & (1U << stby_offset));
+}
+
+/**
+ * @brief Sample period of a device
+ * @note In cycle mode the accel is sampled at the LP_WAKE_CTRL rate, otherwise at the sample rate.
+ * The internal oscillator error, clock_ppm, scales both.
+ * @param pdev: Pointer to simulated device
+ * @retval Period in ns
+ */
+static uint64_t i2c_sim_period_ns(const i2c_sim_device_t *pdev) {
+  static const uint64_t wake_period_ns[] = {800000000ULL, 200000000ULL, 50000000ULL, 25000000ULL};
+  uint64_t period_ns = 1000000000ULL / i2c_sim_sample_rate(pdev);
+  if (pdev->regs[MPU6050_PWR_MGMT_1] & (1U << MPU6050_PWR1_CYCLE_OFFSET))
+    period_ns = wake_period_ns[pdev->regs[MPU6050_PWR_MGMT_2] >> MPU6050_PWR2_LP_WAKE_CTRL_OFFSET];
+  return period_ns * 1000000U / (uint64_t)(1000000 + pdev->clock_ppm);
+}
+
+/**
+ * @brief Motion detection on a new sample
+ * @note The high pass filter is modeled as the change from the previous sample. Motion is raised
+ * once an accel axis stays over MOT_THR for MOT_DUR.
+ * @param pdev: Pointer to simulated device
+ */
+static void i2c_sim_motion(i2c_sim_device_t *pdev) {
+  uint8_t fs = (pdev->regs[MPU6050_ACCEL_CONFIG] >> MPU6050_ACCEL_FS_SEL_OFFSET) & 0b11;
+  int32_t threshold = (int32_t)(pdev->regs[MPU6050_MOT_THR] * MPU6050_MOT_THR_MG_PER_LSB *
+                                (16384U >> fs) / 1000U);
+  /* The first sample has no previous one to compare with */
+  bool over = false;
+  bool first = (pdev->samples <= 1U);
+  for (uint8_t axis = 0; axis < 3; axis++) {
+    int16_t value = (int16_t)(((uint16_t)pdev->regs[MPU6050_ACCEL_XOUT_H + 2 * axis] << 8) |
+                              pdev->regs[MPU6050_ACCEL_XOUT_H + 2 * axis + 1]);
+    int32_t change = (int32_t)value - pdev->motion_ref[axis];
+    if (!first && (change > threshold || change < -threshold))
+      over = true;
+    pdev->motion_ref[axis] = value;
+  }
+
+  if (!over) {
+    pdev->motion_ms = 0;
+    return;
+  }
+  pdev->motion_ms += (uint32_t)(i2c_sim_period_ns(pdev) / 1000000U);
+  if (pdev->motion_ms >= pdev->regs[MPU6050_MOT_DUR]) {
+    pdev->regs[MPU6050_INT_STATUS] |= 1U << MPU6050_INT_MOT_OFFSET;
+    pdev->int_raised |= 1U << MPU6050_INT_MOT_OFFSET;
+  }
+}
+
+/**
+ * @brief Aux sensor behind a device
+ * @param pdev: Pointer to simulated device
+ * @param address: 7-bit I2C slave address
+ * @retval Pointer to aux sensor, NULL if no sensor answers the address
+ */
+static i2c_sim_aux_t *i2c_sim_aux_find(const i2c_sim_device_t *pdev, uint8_t address) {
+  for (uint8_t i = 0; i < pdev->aux_count; i++) {
+    if (pdev->paux[i]->address == address)
+      return pdev->paux[i];
+  }
+  return NULL;
+}
+
+/**
+ * @brief Transfer with an aux sensor
+ * @param paux: Pointer to aux sensor
+ * @param reg_address: Address of first register
+ * @param pdata: Pointer to data
+ * @param data_amount: Amount of data
+ * @param write: Write the registers instead of reading them
+ */
+static void i2c_sim_aux_transfer(i2c_sim_aux_t *paux, uint8_t reg_address, uint8_t *pdata,
+                                 uint16_t data_amount, bool write) {
+  for (uint16_t i = 0; i < data_amount; i++) {
+    if (write)
+      paux->regs[(uint8_t)(reg_address + i)] = pdata[i];
+    else
+      pdata[i] = paux->regs[(uint8_t)(reg_address + i)];
+  }
+  if (write)
+    paux->writes++;
+  else
+    paux->reads++;
+}
+
+/**
+ * @brief Auxiliary I2C master transfers of a sample
+ * @note Slaves 0 to 3 load their data into the external sensor registers in slave order, a
+ * nacked slave keeps its previous data. A pending slave 4 transfer is done once.
+ * @param pdev: Pointer to simulated device
+ */
+static void i2c_sim_aux_master(i2c_sim_device_t *pdev) {
+  uint8_t ext_offset = 0;
+  for (uint8_t slave = 0; slave < MPU6050_I2C_SLAVES; slave++) {
+    uint8_t ctrl = pdev->regs[MPU6050_I2C_SLV0_CTRL + 3U * slave];
+    if (!(ctrl & (1U << MPU6050_I2C_SLV_EN_OFFSET)))
+      continue;
+    uint8_t addr = pdev->regs[MPU6050_I2C_SLV0_ADDR + 3U * slave];
+    uint8_t reg = pdev->regs[MPU6050_I2C_SLV0_REG + 3U * slave];
+    uint8_t length = ctrl & MPU6050_I2C_SLV_LEN_MASK;
+    bool read = addr & (1U << MPU6050_I2C_SLV_RW_OFFSET);
+    i2c_sim_aux_t *paux = i2c_sim_aux_find(pdev, addr & 0x7FU);
+    if (paux == NULL)
+      pdev->regs[MPU6050_I2C_MST_STATUS] |= 1U << slave;
+    if (!read) {
+      if (paux != NULL)
+        i2c_sim_aux_transfer(paux, reg, &pdev->regs[MPU6050_I2C_SLV0_DO + slave], 1, true);
+      continue;
+    }
+    if (ext_offset + length > MPU6050_EXT_SENS_DATA_LEN)
+      length = MPU6050_EXT_SENS_DATA_LEN - ext_offset;
+    uint8_t *pext = &pdev->regs[MPU6050_EXT_SENS_DATA_00 + ext_offset];
+    ext_offset += length;
+    if (paux == NULL)
+      continue;
+    i2c_sim_aux_transfer(paux, reg, pext, length, false);
+    if (ctrl & (1U << MPU6050_I2C_SLV_BYTE_SW_OFFSET)) {
+      for (uint8_t i = 0; i + 1U < length; i += 2) {
+        uint8_t swap = pext[i];
+        pext[i] = pext[i + 1U];
+        pext[i + 1U] = swap;
+      }
+    }
+  }
+
+  uint8_t ctrl = pdev->regs[MPU6050_I2C_SLV4_CTRL];
+  if (!(ctrl & (1U << MPU6050_I2C_SLV_EN_OFFSET)))
+    return;
+  pdev->regs[MPU6050_I2C_SLV4_CTRL] = ctrl & ~(1U << MPU6050_I2C_SLV_EN_OFFSET);
+  uint8_t addr = pdev->regs[MPU6050_I2C_SLV4_ADDR];
+  i2c_sim_aux_t *paux = i2c_sim_aux_find(pdev, addr & 0x7FU);
+  if (paux == NULL) {
+    pdev->regs[MPU6050_I2C_MST_STATUS] |= 1U << MPU6050_I2C_SLV4_NACK_OFFSET;
+    return;
+  }
+  if (addr & (1U << MPU6050_I2C_SLV_RW_OFFSET))
+    i2c_sim_aux_transfer(paux, pdev->regs[MPU6050_I2C_SLV4_REG],
+                         &pdev->regs[MPU6050_I2C_SLV4_DI], 1, false);
+  else
+    i2c_sim_aux_transfer(paux, pdev->regs[MPU6050_I2C_SLV4_REG],
+                         &pdev->regs[MPU6050_I2C_SLV4_DO], 1, true);
+  pdev->regs[MPU6050_I2C_MST_STATUS] |= 1U << MPU6050_I2C_SLV4_DONE_OFFSET;
+}
+
+/**
+ * @brief Load a new sample into the output registers and the FIFO
+ * @param pdev: Pointer to simulated device
+ * @param time_ns: Sample time
+ */
+static void i2c_sim_sample(i2c_sim_device_t *pdev, uint64_t time_ns) {
+  float t = (float)((double)time_ns * 1e-9);
+  for (uint8_t channel = 0; channel < I2C_SIM_CHANNELS; channel++) {
+    if (!i2c_sim_channel_enabled(pdev, channel))
+      continue;
+    const i2c_sim_signal_t *psignal = &pdev->signals[channel];
+    float value =
+        psignal->offset + psignal->amplitude * sinf(2.0f * I2C_SIM_PI * psignal->frequency * t);
+    value += i2c_sim_offset(pdev, channel);
+    if (value > INT16_MAX)
+      value = INT16_MAX;
+    if (value < INT16_MIN)
+      value = INT16_MIN;
+    uint16_t raw = (uint16_t)(int16_t)value;
+    pdev->regs[MPU6050_ACCEL_XOUT_H + 2 * channel] = raw >> 8;
+    pdev->regs[MPU6050_ACCEL_XOUT_H + 2 * channel + 1] = raw & 0xFFU;
+  }
+  pdev->regs[MPU6050_INT_STATUS] |= 1U << MPU6050_INT_DATA_RDY_OFFSET;
+  pdev->int_raised |= 1U << MPU6050_INT_DATA_RDY_OFFSET;
+  pdev->samples++;
+  i2c_sim_motion(pdev);
+  if (pdev->regs[MPU6050_USER_CTRL] & (1U << MPU6050_I2C_MST_EN))
+    i2c_sim_aux_master(pdev);
+
+  if (!(pdev->regs[MPU6050_USER_CTRL] & (1U << MPU6050_USER_CTRL_FIFO_EN_OFFSET)))
+    return;
+
+  /* FIFO frames are ordered by register address */
+  uint8_t fifo_en = pdev->regs[MPU6050_FIFO_EN];
+  if (fifo_en & (1U << MPU6050_ACCEL_FIFO_EN_OFFSET)) {
+    for (uint8_t i = 0; i < 6; i++)
+      i2c_sim_fifo_push(pdev, pdev->regs[MPU6050_ACCEL_XOUT_H + i]);
+  }
+  if (fifo_en & (1U << MPU6050_TEMP_FIFO_EN_OFFSET)) {
+    for (uint8_t i = 0; i < 2; i++)
+      i2c_sim_fifo_push(pdev, pdev->regs[MPU6050_TEMP_OUT_H + i]);
+  }
+  for (uint8_t axis = 0; axis < 3; axis++) {
+    if (fifo_en & (1U << (MPU6050_XG_FIFO_EN_OFFSET - axis))) {
+      for (uint8_t i = 0; i < 2; i++)
+        i2c_sim_fifo_push(pdev, pdev->regs[MPU6050_GYRO_XOUT_H + 2 * axis + i]);
+    }
+  }
+  uint8_t ext_offset = 0;
+  for (uint8_t slave = 0; slave < MPU6050_I2C_SLAVES - 1U; slave++) {
+    uint8_t ctrl = pdev->regs[MPU6050_I2C_SLV0_CTRL + 3U * slave];
+    if (!(ctrl & (1U << MPU6050_I2C_SLV_EN_OFFSET)) ||
+        !(pdev->regs[MPU6050_I2C_SLV0_ADDR + 3U * slave] & (1U << MPU6050_I2C_SLV_RW_OFFSET)))
+      continue;
+    uint8_t length = ctrl & MPU6050_I2C_SLV_LEN_MASK;
+    if (fifo_en & (1U << (MPU6050_SLV0_FIFO_EN_OFFSET + slave))) {
+      for (uint8_t i = 0; i < length; i++)
+        i2c_sim_fifo_push(pdev, pdev->regs[MPU6050_EXT_SENS_DATA_00 + ext_offset + i]);
+    }
+    ext_offset += length;
+  }
+}
+
+/**
+ * @brief Sample rate of a device
+ * @note Gyro output rate is 8 kHz with the DLPF disabled and 1 kHz otherwise, divided by
+ * 1 + SMPLRT_DIV.
+ * @param pdev: Pointer to simulated device
+ * @retval Sample rate in Hz
+ */
+uint32_t i2c_sim_sample_rate(const i2c_sim_device_t *pdev) {
+  uint8_t dlpf_cfg = pdev->regs[MPU6050_CONFIG] & MPU6050_DLPF_CFG_MASK;
+  uint32_t gyro_rate = (dlpf_cfg == 0 || dlpf_cfg == 7) ? MPU6050_GYRO_RATE_DLPF_OFF
+                                                        : MPU6050_GYRO_RATE_DLPF_ON;
+  return gyro_rate / (1U + pdev->regs[MPU6050_SMPLRT_DIV]);
+}
+
+/**
+ * @brief Generate the samples of a device up to a time
+ * @param pdev: Pointer to simulated device
+ * @param now_ns: Current time
+ */
+static void i2c_sim_device_update(i2c_sim_device_t *pdev, uint64_t now_ns) {
+  if (pdev->regs[MPU6050_PWR_MGMT_1] & (1U << MPU6050_PWR1_SLEEP_OFFSET)) {
+    pdev->next_sample_ns = now_ns;
+    return;
+  }
+  uint64_t period_ns = i2c_sim_period_ns(pdev);
+  while (pdev->next_sample_ns <= now_ns) {
+    i2c_sim_sample(pdev, pdev->next_sample_ns);
+    pdev->next_sample_ns += period_ns;
+  }
+}
+
+/**
+ * @brief Read a register of a device, with its read side effects
+ * @param pdev: Pointer to simulated device
+ * @param reg_address: Address of register to read
+ * @retval Register value
+ */
+static uint8_t i2c_sim_reg_read(i2c_sim_device_t *pdev, uint8_t reg_address) {
+  uint8_t value;
+  /* A latched INT pin is released by reading INT_STATUS, or by any read with INT_RD_CLEAR */
+  if (pdev->regs[MPU6050_INT_PIN_CFG] & (1U << MPU6050_INT_RD_CLEAR_OFFSET)) {
+    pdev->int_held = false;
+    if (reg_address != MPU6050_INT_STATUS)
+      pdev->regs[MPU6050_INT_STATUS] = 0;
+  }
+  switch (reg_address) {
+  case MPU6050_FIFO_COUNTH:
+    return pdev->fifo_count >> 8;
+  case MPU6050_FIFO_COUNTL:
+    return pdev->fifo_count & 0xFFU;
+  case MPU6050_FIFO_R_W:
+    return i2c_sim_fifo_pop(pdev);
+  case MPU6050_INT_STATUS:
+    pdev->int_held = false;
+    value = pdev->regs[reg_address];
+    pdev->regs[reg_address] = 0;
+    return value;
+  case MPU6050_I2C_MST_STATUS:
+    value = pdev->regs[reg_address];
+    pdev->regs[reg_address] = 0;
+    return value;
+  default:
+    return pdev->regs[reg_address % I2C_SIM_REGISTERS];
+  }
+}
+
+/**
+ * @brief Write a register of a device, with its write side effects
+ * @param pdev: Pointer to simulated device
+ * @param reg_address: Address of register to write
+ * @param value: Value to write
+ * @param now_ns: Time of the write
+ */
+static void i2c_sim_reg_write(i2c_sim_device_t *pdev, uint8_t reg_address, uint8_t value,
+                              uint64_t now_ns) {
+  switch (reg_address) {
+  case MPU6050_WHO_AM_I:
+  case MPU6050_INT_STATUS:
+  case MPU6050_I2C_MST_STATUS:
+  case MPU6050_FIFO_COUNTH:
+  case MPU6050_FIFO_COUNTL:
+    return;
+  case MPU6050_FIFO_R_W:
+    i2c_sim_fifo_push(pdev, value);
+    return;
+  case MPU6050_USER_CTRL:
+    if (value & (1U << MPU6050_USER_CTRL_FIFO_RESET_OFFSET)) {
+      pdev->fifo_head = 0;
+      pdev->fifo_count = 0;
+      value &= ~(1U << MPU6050_USER_CTRL_FIFO_RESET_OFFSET);
+    }
+    value &= ~(1U << MPU6050_USER_CTRL_I2C_MST_RESET_OFFSET);
+    break;
+  case MPU6050_PWR_MGMT_1:
+    if (value & (1U << MPU6050_PWR1_DEVICE_RESET_OFFSET)) {
+      i2c_sim_device_reset(pdev);
+      pdev->reset_done_ns = now_ns + I2C_SIM_RESET_NS;
+      return;
+    }
+    /* Samples resume after the gyro start-up time */
+    if ((pdev->regs[MPU6050_PWR_MGMT_1] & (1U << MPU6050_PWR1_SLEEP_OFFSET)) &&
+        !(value & (1U << MPU6050_PWR1_SLEEP_OFFSET)))
+      pdev->next_sample_ns = now_ns + I2C_SIM_STARTUP_NS;
+    break;
+  default:
+    break;
+  }
+  pdev->regs[reg_address % I2C_SIM_REGISTERS] = value;
+}
+
+/**
+ * @brief Account a transaction on the bus
+ * @param pbus: Pointer to simulated bus
+ * @param write_bytes: Bytes written, register address included
+ * @param read_bytes: Bytes read
+ * @retval Transaction duration
+ */
+static uint64_t i2c_sim_account(i2c_sim_bus_t *pbus, uint16_t write_bytes, uint16_t read_bytes) {
+  uint64_t duration_ns = i2c_sim_transfer_ns(pbus, write_bytes, read_bytes);
+  pbus->stats.transactions++;
+  pbus->stats.bytes_written += write_bytes;
+  pbus->stats.bytes_read += read_bytes;
+  pbus->stats.busy_ns += duration_ns;
+  return duration_ns;
+}
+
+/**
+ * @brief Blocking register read transaction
+ * @param pbus: Pointer to simulated bus
+ * @param slave_address: I2C slave address
+ * @param reg_address: Address of first register to read
+ * @param pdata: Pointer to buffer where the data received is stored
+ * @param data_amount: Amount of data to read
+ * @retval Pointer to device, NULL if the address was not acknowledged
+ */
+static i2c_sim_device_t *i2c_sim_read(i2c_sim_bus_t *pbus, uint16_t slave_address,
+                                      uint8_t reg_address, uint8_t *pdata, uint16_t data_amount) {
+  i2c_sim_device_t *pdev = i2c_sim_find_ack(pbus, slave_address);
+  if (pdev == NULL) {
+    pbus->stats.naks++;
+    pbus->now_ns += i2c_sim_account(pbus, 0, 0);
+    return NULL;
+  }
+  i2c_sim_device_update(pdev, pbus->now_ns);
+  for (uint16_t i = 0; i < data_amount; i++) {
+    pdata[i] = i2c_sim_reg_read(pdev, reg_address);
+    /* FIFO_R_W does not auto increment, so bursts drain the FIFO */
+    if (reg_address != MPU6050_FIFO_R_W)
+      reg_address++;
+  }
+  return pdev;
+}
+
+/**
+ * @brief Host CPU time of the calling thread
+ * @retval Time in nanoseconds
+ */
+static uint64_t i2c_sim_cpu_ns(void) {
+  struct timespec ts;
+  clock_gettime(CLOCK_THREAD_CPUTIME_ID, &ts);
+  return (uint64_t)ts.tv_sec * 1000000000ULL + (uint64_t)ts.tv_nsec;
+}
+
+/**
+ * @brief Initialize a simulated bus
+ * @param pbus: Pointer to simulated bus
+ * @param speed: Bus clock speed
+ */
+void i2c_sim_bus_init(i2c_sim_bus_t *pbus, i2c_sim_speed_t speed) {
+  assert(pbus);
+  memset(pbus, 0, sizeof(*pbus));
+  pbus->speed_hz = speed;
+  /* Cost of the clock reads around i2c_sim_run, taken out of the driver time */
+  pbus->cpu_clock_ns = UINT64_MAX;
+  for (uint8_t i = 0; i < 32; i++) {
+    uint64_t start_ns = i2c_sim_cpu_ns();
+    uint64_t clock_ns = i2c_sim_cpu_ns() - start_ns;
+    if (clock_ns < pbus->cpu_clock_ns)
+      pbus->cpu_clock_ns = clock_ns;
+  }
+  i2c_queue_init(&pbus->queue, pbus);
+}
+
+/**
+ * @brief Initialize a simulated device with power-on register values
+ * @param pdev: Pointer to simulated device
+ * @param address: 7-bit I2C slave address
+ */
+void i2c_sim_device_init(i2c_sim_device_t *pdev, uint8_t address) {
+  assert(pdev);
+  memset(pdev, 0, sizeof(*pdev));
+  pdev->address = address;
+  i2c_sim_device_reset(pdev);
+}
+
+/**
+ * @brief Attach a simulated device to a bus
+ * @param pbus: Pointer to simulated bus
+ * @param pdev: Pointer to initialized simulated device
+ * @retval mpu6050_status_t
+ */
+mpu6050_status_t i2c_sim_attach(i2c_sim_bus_t *pbus, i2c_sim_device_t *pdev) {
+  assert(pbus);
+  assert(pdev);
+  if (pbus->count >= I2C_SIM_MAX_DEVICES || i2c_sim_find(pbus, pdev->address << 1) != NULL)
+    return MPU6050_ERROR;
+  pdev->next_sample_ns = pbus->now_ns;
+  pbus->pdevices[pbus->count++] = pdev;
+  return MPU6050_OK;
+}
+
+/**
+ * @brief Initialize a simulated aux sensor with cleared registers
+ * @param paux: Pointer to simulated aux sensor
+ * @param address: 7-bit I2C slave address
+ */
+void i2c_sim_aux_init(i2c_sim_aux_t *paux, uint8_t address) {
+  assert(paux);
+  memset(paux, 0, sizeof(*paux));
+  paux->address = address;
+}
+
+/**
+ * @brief Attach a simulated aux sensor to the aux bus of a device
+ * @param pdev: Pointer to simulated device
+ * @param paux: Pointer to initialized simulated aux sensor
+ * @retval mpu6050_status_t
+ */
+mpu6050_status_t i2c_sim_aux_attach(i2c_sim_device_t *pdev, i2c_sim_aux_t *paux) {
+  assert(pdev);
+  assert(paux);
+  if (pdev->aux_count >= I2C_SIM_MAX_AUX || i2c_sim_aux_find(pdev, paux->address) != NULL)
+    return MPU6050_ERROR;
+  pdev->paux[pdev->aux_count++] = paux;
+  return MPU6050_OK;
+}
+
+/**
+ * @brief Configure the signal generator of a channel
+ * @param pdev: Pointer to simulated device
+ * @param channel: Output channel
+ * @param offset: Signal offset in raw counts
+ * @param amplitude: Sine amplitude in raw counts
+ * @param frequency: Sine frequency in Hz
+ */
+void i2c_sim_set_signal(i2c_sim_device_t *pdev, i2c_sim_channel_t channel, float offset,
+                        float amplitude, float frequency) {
+  assert(pdev);
+  assert(channel < I2C_SIM_CHANNELS);
+  pdev->signals[channel] = (i2c_sim_signal_t){offset, amplitude, frequency};
+}
+
+/**
+ * @brief Duration of a transaction on the bus
+ * @note Start, address with ACK and every byte with ACK. Reads add a repeated start and the
+ * address again. Nine clock cycles per byte, one per start, repeated start or stop condition.
+ * @param pbus: Pointer to simulated bus
+ * @param write_bytes: Bytes written, register address included
+ * @param read_bytes: Bytes read
+ * @retval Duration in nanoseconds
+ */
+uint64_t i2c_sim_transfer_ns(const i2c_sim_bus_t *pbus, uint16_t write_bytes,
+                             uint16_t read_bytes) {
+  uint64_t cycles = 1U + 9U + 9U * write_bytes;
+  if (read_bytes > 0)
+    cycles += 1U + 9U + 9U * read_bytes;
+  cycles += 1U;
+  return cycles * 1000000000ULL / pbus->speed_hz;
+}
+
+/**
+ * @brief Device with the earliest DATA_RDY interrupt before a time
+ * @param pbus: Pointer to simulated bus
+ * @param before_ns: Time limit, excluded
+ * @retval Pointer to device, NULL if no interrupt is due
+ */
+static i2c_sim_device_t *i2c_sim_next_int(i2c_sim_bus_t *pbus, uint64_t before_ns) {
+  i2c_sim_device_t *pnext = NULL;
+  for (uint8_t i = 0; i < pbus->count; i++) {
+    i2c_sim_device_t *pdev = pbus->pdevices[i];
+    if (pdev->int_context == NULL)
+      continue;
+    if (!(pdev->regs[MPU6050_INT_ENABLE] &
+          ((1U << MPU6050_INT_DATA_RDY_OFFSET) | (1U << MPU6050_INT_MOT_OFFSET))))
+      continue;
+    if (pdev->regs[MPU6050_PWR_MGMT_1] & (1U << MPU6050_PWR1_SLEEP_OFFSET))
+      continue;
+    if (pdev->next_sample_ns < before_ns) {
+      before_ns = pdev->next_sample_ns;
+      pnext = pdev;
+    }
+  }
+  return pnext;
+}
+
+/**
+ * @brief Sleep until the host clock reaches a simulated time, in real-time mode
+ * @param pbus: Pointer to simulated bus
+ * @param time_ns: Simulated time
+ */
+static void i2c_sim_pace(const i2c_sim_bus_t *pbus, uint64_t time_ns) {
+  if (!pbus->realtime)
+    return;
+  uint64_t host_ns = pbus->realtime_origin_ns + time_ns;
+  struct timespec until = {.tv_sec = (time_t)(host_ns / 1000000000ULL),
+                           .tv_nsec = (long)(host_ns % 1000000000ULL)};
+  while (clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &until, NULL) == EINTR)
+    ;
+}
+
+/**
+ * @brief Let the idle time of the bus pass, in real-time mode
+ * @note The simulated time is moved to the host clock if it is behind, so a transaction takes
+ * its whole duration on the host clock whatever the simulated time spent before.
+ * @param pbus: Pointer to simulated bus
+ */
+static void i2c_sim_idle(i2c_sim_bus_t *pbus) {
+  if (!pbus->realtime || pbus->dma_pending)
+    return;
+  struct timespec now;
+  clock_gettime(CLOCK_MONOTONIC, &now);
+  uint64_t time_ns =
+      (uint64_t)now.tv_sec * 1000000000ULL + (uint64_t)now.tv_nsec - pbus->realtime_origin_ns;
+  if (time_ns > pbus->now_ns)
+    pbus->now_ns = time_ns;
+}
+
+/**
+ * @brief Advance the simulated time
+ * @note Transactions that complete in the interval are reported to the bus queue, and DATA_RDY
+ * and motion interrupts of wired INT pins call mpu6050_int_callback, in time order. Transactions
+ * started from the completions complete in the same call if they fit the interval.
+ * @param pbus: Pointer to simulated bus
+ * @param duration_ns: Time to advance
+ */
+void i2c_sim_run(i2c_sim_bus_t *pbus, uint64_t duration_ns) {
+  assert(pbus);
+  uint64_t run_start_ns = i2c_sim_cpu_ns();
+  uint64_t end_ns = pbus->now_ns + duration_ns;
+  for (;;) {
+    uint64_t dma_ns = (pbus->dma_pending && pbus->dma_done_ns <= end_ns) ? pbus->dma_done_ns
+                                                                         : end_ns + 1U;
+    i2c_sim_device_t *pint_dev = i2c_sim_next_int(pbus, dma_ns);
+    if (pint_dev != NULL) {
+      if (pint_dev->next_sample_ns > pbus->now_ns)
+        pbus->now_ns = pint_dev->next_sample_ns;
+      pint_dev->int_raised = 0;
+      i2c_sim_device_update(pint_dev, pbus->now_ns);
+      if ((pint_dev->int_raised & pint_dev->regs[MPU6050_INT_ENABLE]) && !pint_dev->int_held) {
+        pint_dev->int_held =
+            (pint_dev->regs[MPU6050_INT_PIN_CFG] & (1U << MPU6050_LATCH_INT_EN_OFFSET)) != 0;
+        mpu6050_int_callback(pint_dev->int_context);
+      }
+      continue;
+    }
+    if (dma_ns > end_ns)
+      break;
+
+    i2c_sim_pace(pbus, pbus->dma_done_ns);
+    pbus->now_ns = pbus->dma_done_ns;
+    pbus->dma_pending = false;
+
+    const i2c_transaction_t *pdone = &pbus->queue.current;
+    if (pdone->priority == I2C_QUEUE_PRIO_SAMPLE && pbus->dma_status == MPU6050_OK) {
+      uint64_t latency_us = (pbus->dma_done_ns - pdone->submitted_ns) / 1000U;
+      if (latency_us >= I2C_SIM_LATENCY_BUCKETS)
+        latency_us = I2C_SIM_LATENCY_BUCKETS - 1U;
+      pbus->stats.latency_us[latency_us]++;
+      pbus->stats.sample_reads++;
+    }
+    pbus->stats.completions++;
+
+    uint64_t cpu_start_ns = i2c_sim_cpu_ns();
+    i2c_queue_complete(&pbus->queue, pbus->dma_status);
+    pbus->stats.callback_cpu_ns += i2c_sim_cpu_ns() - cpu_start_ns;
+  }
+  if (end_ns > pbus->now_ns) {
+    i2c_sim_pace(pbus, end_ns);
+    pbus->now_ns = end_ns;
+  }
+  pbus->stats.run_cpu_ns += i2c_sim_cpu_ns() - run_start_ns;
+  pbus->stats.runs++;
+}
+
+/**
+ * @brief Current simulated time
+ * @param pbus: Pointer to simulated bus
+ * @retval Time in nanoseconds
+ */
+uint64_t i2c_sim_now(const i2c_sim_bus_t *pbus) { return pbus->now_ns; }
+
+/**
+ * @brief Pace the simulated time by the host clock
+ * @note Simulated time keeps running from its current value. A bus in real-time mode is meant
+ * to be driven by its own thread, to measure host throughput of several buses in parallel.
+ * @param pbus: Pointer to simulated bus
+ * @param enable: true to sleep until the host clock reaches the simulated time, false to run
+ * as fast as the host
+ */
+void i2c_sim_realtime(i2c_sim_bus_t *pbus, bool enable) {
+  assert(pbus);
+  struct timespec now;
+  clock_gettime(CLOCK_MONOTONIC, &now);
+  pbus->realtime_origin_ns =
+      (uint64_t)now.tv_sec * 1000000000ULL + (uint64_t)now.tv_nsec - pbus->now_ns;
+  pbus->realtime = enable;
+}
+
+/**
+ * @brief Inject a fault every period transactions
+ * @note The first fault hits the period-th transaction started from now. A stuck bus stays stuck
+ * until a bus recovery, whatever the period.
+ * @param pbus: Pointer to simulated bus
+ * @param fault: Fault to inject, I2C_SIM_FAULT_NONE to stop
+ * @param period: Transactions per fault, 1 for every transaction, 0 to stop
+ */
+void i2c_sim_fault_inject(i2c_sim_bus_t *pbus, i2c_sim_fault_t fault, uint32_t period) {
+  assert(pbus);
+  pbus->fault = (period != 0) ? fault : I2C_SIM_FAULT_NONE;
+  pbus->fault_period = (fault != I2C_SIM_FAULT_NONE) ? period : 0;
+  pbus->fault_countdown = pbus->fault_period;
+}
+
+/**
+ * @brief Fault of the transaction being started
+ * @param pbus: Pointer to simulated bus
+ * @retval Fault to apply, I2C_SIM_FAULT_NONE if none
+ */
+static i2c_sim_fault_t i2c_sim_fault_next(i2c_sim_bus_t *pbus) {
+  if (pbus->fault_period == 0 || --pbus->fault_countdown != 0)
+    return I2C_SIM_FAULT_NONE;
+  pbus->fault_countdown = pbus->fault_period;
+  pbus->stats.faults++;
+  return pbus->fault;
+}
+
+/**
+ * @brief I2C init function
+ * @param bus: Simulated bus (i2c_sim_bus_t)
+ * @retval mpu6050_status_t
+ */
+mpu6050_status_t i2c_init(void *bus) {
+  if (bus == NULL)
+    return MPU6050_ERROR;
+  return MPU6050_OK;
+}
+
+/**
+ * @brief I2C non-blocking transaction start, completed by i2c_sim_run
+ * @note Registers are latched, or written, when the transfer starts. Aux sensors of devices in
+ * bypass mode answer on the bus. Injected faults apply to the transactions started.
+ * @param bus: Simulated bus (i2c_sim_bus_t)
+ * @param ptransaction: Pointer to transaction
+ * @retval mpu6050_status_t, MPU6050_ERROR_NACK if the address is not acknowledged
+ */
+mpu6050_status_t i2c_start(void *bus, const i2c_transaction_t *ptransaction) {
+  i2c_sim_bus_t *pbus = bus;
+  if (pbus->dma_pending)
+    return MPU6050_ERROR_BUSY;
+  i2c_sim_idle(pbus);
+
+  pbus->dma_status = MPU6050_OK;
+  i2c_sim_fault_t fault = i2c_sim_fault_next(pbus);
+  if (fault == I2C_SIM_FAULT_STUCK)
+    pbus->stuck = true;
+  if (pbus->stuck) {
+    pbus->stats.transactions++;
+    pbus->dma_start_ns = pbus->now_ns;
+    pbus->dma_done_ns = UINT64_MAX;
+    pbus->dma_pending = true;
+    return MPU6050_OK;
+  }
+  if (fault == I2C_SIM_FAULT_RESET) {
+    i2c_sim_device_t *pdev = i2c_sim_find(pbus, ptransaction->slave_address);
+    if (pdev != NULL)
+      i2c_sim_device_reset(pdev);
+  }
+  if (fault == I2C_SIM_FAULT_NACK || fault == I2C_SIM_FAULT_RESET) {
+    pbus->stats.naks++;
+    pbus->now_ns += i2c_sim_account(pbus, 0, 0);
+    return MPU6050_ERROR_NACK;
+  }
+  if (fault == I2C_SIM_FAULT_BUS)
+    pbus->dma_status = MPU6050_ERROR_BUS;
+
+  uint16_t write_bytes = 1;
+  uint16_t read_bytes = 0;
+  i2c_sim_aux_t *paux = i2c_sim_find_bypass(pbus, ptransaction->slave_address);
+  if (paux != NULL) {
+    bool write = (ptransaction->op == I2C_QUEUE_WRITE);
+    i2c_sim_aux_transfer(paux, ptransaction->reg_address, ptransaction->pdata,
+                         ptransaction->data_amount, write);
+    if (write)
+      write_bytes += ptransaction->data_amount;
+    else
+      read_bytes = ptransaction->data_amount;
+  } else if (ptransaction->op == I2C_QUEUE_WRITE) {
+    i2c_sim_device_t *pdev = i2c_sim_find_ack(pbus, ptransaction->slave_address);
+    if (pdev == NULL) {
+      pbus->stats.naks++;
+      pbus->now_ns += i2c_sim_account(pbus, 0, 0);
+      return MPU6050_ERROR_NACK;
+    }
+    i2c_sim_device_update(pdev, pbus->now_ns);
+    for (uint16_t i = 0; i < ptransaction->data_amount; i++)
+      i2c_sim_reg_write(pdev, (uint8_t)(ptransaction->reg_address + i), ptransaction->pdata[i],
+                        pbus->now_ns);
+    write_bytes += ptransaction->data_amount;
+  } else {
+    if (i2c_sim_read(pbus, ptransaction->slave_address, ptransaction->reg_address,
+                     ptransaction->pdata, ptransaction->data_amount) == NULL)
+      return MPU6050_ERROR_NACK;
+    read_bytes = ptransaction->data_amount;
+  }
+  pbus->dma_start_ns = pbus->now_ns;
+  pbus->dma_done_ns = pbus->now_ns + i2c_sim_account(pbus, write_bytes, read_bytes);
+  pbus->dma_pending = true;
+  return MPU6050_OK;
+}
+
+/**
+ * @brief Transaction queue of a simulated bus
+ * @param bus: Simulated bus (i2c_sim_bus_t)
+ * @retval Pointer to queue
+ */
+i2c_queue_t *i2c_get_queue(void *bus) {
+  i2c_sim_bus_t *pbus = bus;
+  return &pbus->queue;
+}
+
+/**
+ * @brief Lock the queue of a simulated bus, nothing to do as the simulation is single threaded
+ * @param bus: Simulated bus (i2c_sim_bus_t), unused
+ */
+void i2c_lock(void *bus) { (void)bus; }
+
+/**
+ * @brief Unlock the queue of a simulated bus
+ * @param bus: Simulated bus (i2c_sim_bus_t), unused
+ */
+void i2c_unlock(void *bus) { (void)bus; }
+
+/**
+ * @brief Wait for a transaction completion
+ * @note Runs the simulation from completion to completion, interrupts and the completions of
+ * the transactions queued before are delivered on the way.
+ * @param bus: Simulated bus (i2c_sim_bus_t)
+ * @param pdone: Pointer to completion flag
+ * @param timeout_us: Time limit of the wait, simulated time
+ * @retval mpu6050_status_t, MPU6050_ERROR_TIMEOUT if the time limit expired
+ */
+mpu6050_status_t i2c_wait(void *bus, volatile bool *pdone, uint32_t timeout_us) {
+  i2c_sim_bus_t *pbus = bus;
+  uint64_t deadline_ns = pbus->now_ns + (uint64_t)timeout_us * 1000U;
+  while (!*pdone) {
+    if (pbus->now_ns >= deadline_ns)
+      return MPU6050_ERROR_TIMEOUT;
+    uint64_t until_ns = deadline_ns;
+    if (pbus->dma_pending && pbus->dma_done_ns < until_ns)
+      until_ns = pbus->dma_done_ns;
+    i2c_sim_run(pbus, until_ns - pbus->now_ns);
+  }
+  return MPU6050_OK;
+}
+
+/**
+ * @brief Recover the simulated bus
+ * @note Takes the time of nine SCL pulses, a STOP and the peripheral re-initialization. The
+ * transfer in flight is dropped and a stuck slave releases SDA.
+ * @param bus: Simulated bus (i2c_sim_bus_t)
+ * @retval mpu6050_status_t
+ */
+mpu6050_status_t i2c_recover(void *bus) {
+  i2c_sim_bus_t *pbus = bus;
+  uint64_t duration_ns = 10U * 1000000000ULL / pbus->speed_hz + I2C_SIM_REINIT_NS;
+  pbus->dma_pending = false;
+  pbus->stuck = false;
+  pbus->now_ns += duration_ns;
+  pbus->stats.recoveries++;
+  pbus->stats.recovery_ns += duration_ns;
+  return MPU6050_OK;
+}
+
+/**
+ * @brief Clock speed of the simulated bus
+ * @param bus: Simulated bus (i2c_sim_bus_t)
+ * @retval Clock speed in Hz
+ */
+uint32_t i2c_speed_hz(void *bus) { return ((i2c_sim_bus_t *)bus)->speed_hz; }
+
+/**
+ * @brief Clear the bus counters, to start a measurement window
+ * @param pbus: Pointer to simulated bus
+ */
+void i2c_sim_stats_reset(i2c_sim_bus_t *pbus) {
+  assert(pbus);
+  memset(&pbus->stats, 0, sizeof(pbus->stats));
+}
+
+/**
+ * @brief Start timing a driver call
+ * @note The host CPU time until i2c_sim_driver_end goes to the driver counter, less the time in
+ * i2c_sim_run, e.g. a blocking read waiting on the simulation, and the clock reads. The driver
+ * time of completions is in the callback counter.
+ * @param pbus: Pointer to simulated bus of the driver call
+ */
+void i2c_sim_driver_begin(i2c_sim_bus_t *pbus) {
+  assert(pbus);
+  pbus->driver_run_ns = pbus->stats.run_cpu_ns;
+  pbus->driver_runs = pbus->stats.runs;
+  pbus->driver_start_ns = i2c_sim_cpu_ns();
+}
+
+/**
+ * @brief End timing a driver call
+ * @param pbus: Pointer to simulated bus of the driver call
+ */
+void i2c_sim_driver_end(i2c_sim_bus_t *pbus) {
+  assert(pbus);
+  uint64_t elapsed_ns = i2c_sim_cpu_ns() - pbus->driver_start_ns;
+  uint64_t run_ns = pbus->stats.run_cpu_ns - pbus->driver_run_ns;
+  run_ns += (uint64_t)(pbus->stats.runs - pbus->driver_runs + 1U) * pbus->cpu_clock_ns;
+  if (elapsed_ns > run_ns)
+    pbus->stats.driver_cpu_ns += elapsed_ns - run_ns;
+}
+
+/**
+ * @brief Percentile of the sample read latency
+ * @param pbus: Pointer to simulated bus
+ * @param percentile: Percentile, from 0 to 100
+ * @retval Latency in microseconds, 0 if no sample read completed
+ */
+uint32_t i2c_sim_latency_percentile(const i2c_sim_bus_t *pbus, float percentile) {
+  assert(pbus);
+  if (pbus->stats.sample_reads == 0)
+    return 0;
+  uint64_t rank = (uint64_t)ceil((double)percentile / 100.0 * pbus->stats.sample_reads);
+  if (rank == 0)
+    rank = 1;
+  uint64_t accumulated = 0;
+  for (uint32_t bucket = 0; bucket < I2C_SIM_LATENCY_BUCKETS; bucket++) {
+    accumulated += pbus->stats.latency_us[bucket];
+    if (accumulated >= rank)
+      return bucket;
+  }
+  return I2C_SIM_LATENCY_BUCKETS - 1U;
+}
+
+/**
+ * @brief Acquisition report of the window since the last i2c_sim_stats_reset
+ * @param pbus: Pointer to simulated bus
+ * @param mode: Acquisition mode name
+ * @param samples: Samples acquired in the window
+ * @param elapsed_ns: Simulated duration of the window
+ * @param preport: Pointer to report
+ */
+void i2c_sim_report(const i2c_sim_bus_t *pbus, const char *mode, uint32_t samples,
+                    uint64_t elapsed_ns, i2c_sim_report_t *preport) {
+  assert(pbus);
+  assert(preport);
+  const i2c_sim_stats_t *pstats = &pbus->stats;
+  double per_sample = (samples > 0) ? 1.0 / samples : 0.0;
+  preport->mode = mode;
+  preport->samples = samples;
+  preport->samples_per_s = (elapsed_ns > 0) ? samples * 1e9 / (double)elapsed_ns : 0.0;
+  preport->bytes_per_sample = (pstats->bytes_read + pstats->bytes_written) * per_sample;
+  preport->transactions_per_sample = pstats->transactions * per_sample;
+  preport->bus_us_per_sample = pstats->busy_ns * 1e-3 * per_sample;
+  preport->callback_cpu_ns_per_sample = pstats->callback_cpu_ns * per_sample;
+  preport->driver_cpu_ns_per_sample =
+      (pstats->driver_cpu_ns + pstats->callback_cpu_ns) * per_sample;
+  preport->latency_p50_us = i2c_sim_latency_percentile(pbus, 50.0f);
+  preport->latency_p99_us = i2c_sim_latency_percentile(pbus, 99.0f);
+  preport->latency_p999_us = i2c_sim_latency_percentile(pbus, 99.9f);
+}
+
+/**
+ * @brief Write a report as a CSV row
+ * @param pfile: Output file
+ * @param preport: Pointer to report
+ * @param header: Write the header row first
+ */
+void i2c_sim_report_csv(FILE *pfile, const i2c_sim_report_t *preport, bool header) {
+  assert(pfile);
+  assert(preport);
+  if (header)
+    fprintf(pfile, "mode,samples,samples_per_s,bytes_per_sample,transactions_per_sample,"
+                   "bus_us_per_sample,callback_cpu_ns_per_sample,driver_cpu_ns_per_sample,p50_us,"
+                   "p99_us,p999_us\n");
+  fprintf(pfile, "%s,%u,%.1f,%.2f,%.2f,%.2f,%.1f,%.1f,%u,%u,%u\n", preport->mode,
+          preport->samples, preport->samples_per_s, preport->bytes_per_sample,
+          preport->transactions_per_sample, preport->bus_us_per_sample,
+          preport->callback_cpu_ns_per_sample, preport->driver_cpu_ns_per_sample,
+          preport->latency_p50_us, preport->latency_p99_us, preport->latency_p999_us);
+}
+
+/**
+ * @brief Write a report as a JSON object, one per line
+ * @param pfile: Output file
+ * @param preport: Pointer to report
+ */
+void i2c_sim_report_json(FILE *pfile, const i2c_sim_report_t *preport) {
+  assert(pfile);
+  assert(preport);
+  fprintf(pfile,
+          "{\"mode\":\"%s\",\"samples\":%u,\"samples_per_s\":%.1f,\"bytes_per_sample\":%.2f,"
+          "\"transactions_per_sample\":%.2f,\"bus_us_per_sample\":%.2f,"
+          "\"callback_cpu_ns_per_sample\":%.1f,\"driver_cpu_ns_per_sample\":%.1f,"
+          "\"p50_us\":%u,\"p99_us\":%u,\"p999_us\":%u}\n",
+          preport->mode, preport->samples, preport->samples_per_s, preport->bytes_per_sample,
+          preport->transactions_per_sample, preport->bus_us_per_sample,
+          preport->callback_cpu_ns_per_sample, preport->driver_cpu_ns_per_sample,
+          preport->latency_p50_us, preport->latency_p99_us, preport->latency_p999_us);
+}
+
+/**
+ * @brief Wire the INT pin of a simulated device
+ * @param bus: Simulated bus (i2c_sim_bus_t)
+ * @param int_line: 7-bit I2C slave address of the device
+ * @param pcontext: Context of the interrupt, MPU6050 handle
+ * @retval mpu6050_status_t
+ */
+mpu6050_status_t i2c_int_attach(void *bus, uint32_t int_line, void *pcontext) {
+  i2c_sim_device_t *pdev = i2c_sim_find(bus, (uint16_t)(int_line << 1));
+  if (pdev == NULL || pdev->int_context != NULL)
+    return MPU6050_ERROR;
+  pdev->int_context = pcontext;
+  return MPU6050_OK;
+}
+
+/**
+ * @brief Unwire the INT pin of a simulated device
+ * @param bus: Simulated bus (i2c_sim_bus_t)
+ * @param int_line: 7-bit I2C slave address of the device
+ * @retval mpu6050_status_t
+ */
+mpu6050_status_t i2c_int_detach(void *bus, uint32_t int_line) {
+  i2c_sim_device_t *pdev = i2c_sim_find(bus, (uint16_t)(int_line << 1));
+  if (pdev == NULL || pdev->int_context == NULL)
+    return MPU6050_ERROR;
+  pdev->int_context = NULL;
+  return MPU6050_OK;
+}
+
+/**
+ * @brief Timestamp from the simulated clock
+ * @note In real-time mode the idle time of the bus passes first.
+ * @param bus: Simulated bus (i2c_sim_bus_t)
+ * @retval Time in ns
+ */
+uint64_t i2c_timestamp_ns(void *bus) {
+  i2c_sim_idle(bus);
+  return i2c_sim_now(bus);
+}
@@ -0,0 +1,272 @@
+/**
+ ******************************************************************************
+ * @file           : bench_acquisition.c
+ * @author         : Gonzalo Gabriel Fernandez
+ * @brief          : Acquisition modes benchmark on the simulated bus
+ ******************************************************************************
+ * @attention
+ *
+ * Every acquisition mode runs a measurement window on its own simulated bus:
+ * the bus counters are cleared with i2c_sim_stats_reset, the mode acquires
+ * for one second of simulated time, and i2c_sim_report gives the window
+ * figures. Reports go to stdout as CSV, or as JSON lines with --json. The
+ * driver calls of the window are timed with i2c_sim_driver_begin and
+ * i2c_sim_driver_end, their host CPU time is reported with the callbacks.
+ *
+ *   bench_acquisition [--json] [--speed 100|400|1000]
+ *
+ * Simulated time makes the figures but the host CPU time deterministic, so
+ * the output can be diffed across changes to track regressions.
+ *
+ ******************************************************************************
+ */
+
+#include <stdlib.h>
+#include <string.h>
+
+#include "mpu6050_ring.h"
+#include "test.h"
+
+#define BENCH_WINDOW_NS 1000000000ULL /*! Measurement window */
+#define BENCH_POLL_NS 100000U         /*! Main loop period of the non-blocking modes */
+#define BENCH_ODR_DIVIDER 7U          /*! 1 kHz for the modes paced by the device */
+
+/**
+ * @brief Benchmark set-up, a bus with up to two devices
+ */
+typedef struct {
+  i2c_sim_bus_t bus;
+  i2c_sim_device_t dev[2];
+  mpu6050_t imu[2];
+  mpu6050_ring_t ring;
+
+} bench_t;
+
+static i2c_sim_speed_t bench_speed = I2C_SIM_SPEED_400KHZ;
+static bool bench_json;
+static bool bench_failed;
+
+/**
+ * @brief   Bring up a fresh bus with the given amount of devices
+ */
+static void bench_setup(bench_t *pbench, uint8_t devices) {
+  static const mpu6050_i2c_address_t addresses[2] = {MPU6050_I2C_ADDRESS_1,
+                                                     MPU6050_I2C_ADDRESS_2};
+  i2c_sim_bus_init(&pbench->bus, bench_speed);
+  for (uint8_t i = 0; i < devices; i++) {
+    if (test_device_up(&pbench->bus, &pbench->dev[i], &pbench->imu[i], addresses[i]) !=
+        MPU6050_OK)
+      bench_failed = true;
+    i2c_sim_set_signal(&pbench->dev[i], I2C_SIM_ACCEL_Z, 16384, 200, 10);
+  }
+  mpu6050_ring_init(&pbench->ring);
+}
+
+/**
+ * @brief   Start a measurement window
+ * @retval  Simulated time of the window start
+ */
+static uint64_t bench_window_start(bench_t *pbench) {
+  i2c_sim_stats_reset(&pbench->bus);
+  return i2c_sim_now(&pbench->bus);
+}
+
+/**
+ * @brief   Close a measurement window and write its report
+ */
+static void bench_window_end(bench_t *pbench, const char *mode, uint32_t samples, uint64_t start) {
+  i2c_sim_report_t report;
+  static bool header = true;
+  i2c_sim_report(&pbench->bus, mode, samples, i2c_sim_now(&pbench->bus) - start, &report);
+  if (bench_json) {
+    i2c_sim_report_json(stdout, &report);
+  } else {
+    i2c_sim_report_csv(stdout, &report, header);
+    header = false;
+  }
+  if (samples == 0)
+    bench_failed = true;
+}
+
+/**
+ * @brief   Drain the ring, the consumer of the streaming modes
+ */
+static uint32_t bench_ring_drain(mpu6050_ring_t *pring) {
+  const mpu6050_ring_slot_t *pslots;
+  uint32_t count;
+  uint32_t total = 0;
+  while ((count = mpu6050_ring_peek_batch(pring, &pslots)) != 0) {
+    mpu6050_ring_release(pring, count);
+    total += count;
+  }
+  return total;
+}
+
+/**
+ * @brief   Blocking reads of accel, temperature and gyro, three transactions per sample
+ */
+static void bench_blocking_per_sensor(bench_t *pbench) {
+  uint64_t start = bench_window_start(pbench);
+  uint32_t samples = 0;
+  while (i2c_sim_now(&pbench->bus) - start < BENCH_WINDOW_NS) {
+    uint16_t value[3];
+    i2c_sim_driver_begin(&pbench->bus);
+    bool ok = mpu6050_accel_read_raw(&pbench->imu[0], &value[0], &value[1], &value[2]) ==
+                  MPU6050_OK &&
+              mpu6050_temp_read_raw(&pbench->imu[0], &value[0]) == MPU6050_OK &&
+              mpu6050_gyro_read_raw(&pbench->imu[0], &value[0], &value[1], &value[2]) == MPU6050_OK;
+    i2c_sim_driver_end(&pbench->bus);
+    if (!ok)
+      break;
+    samples++;
+  }
+  bench_window_end(pbench, "blocking_per_sensor", samples, start);
+}
+
+/**
+ * @brief   Blocking combined burst reads
+ */
+static void bench_blocking(bench_t *pbench) {
+  uint64_t start = bench_window_start(pbench);
+  uint32_t samples = 0;
+  while (i2c_sim_now(&pbench->bus) - start < BENCH_WINDOW_NS) {
+    mpu6050_sample_t sample;
+    i2c_sim_driver_begin(&pbench->bus);
+    mpu6050_status_t status = mpu6050_read_all_raw(&pbench->imu[0], &sample);
+    i2c_sim_driver_end(&pbench->bus);
+    if (status != MPU6050_OK)
+      break;
+    samples++;
+  }
+  bench_window_end(pbench, "blocking", samples, start);
+}
+
+/**
+ * @brief   Non-blocking combined reads, the main loop polls for data ready
+ */
+static void bench_fetch(bench_t *pbench) {
+  uint64_t start = bench_window_start(pbench);
+  uint32_t samples = 0;
+  while (i2c_sim_now(&pbench->bus) - start < BENCH_WINDOW_NS) {
+    /* The polls are timed as one driver call, the simulation in between is not counted */
+    i2c_sim_driver_begin(&pbench->bus);
+    mpu6050_status_t status = mpu6050_fetch_all(&pbench->imu[0]);
+    while (status == MPU6050_OK && !mpu6050_is_data_ready(&pbench->imu[0]))
+      i2c_sim_run(&pbench->bus, BENCH_POLL_NS / 10U);
+    i2c_sim_driver_end(&pbench->bus);
+    if (status != MPU6050_OK)
+      break;
+    samples++;
+  }
+  bench_window_end(pbench, "fetch", samples, start);
+}
+
+/**
+ * @brief   Continuous DMA reads into the ring, each completion starts the next read
+ */
+static void bench_ring(bench_t *pbench) {
+  uint64_t start = bench_window_start(pbench);
+  uint32_t samples = 0;
+  if (mpu6050_stream_start(&pbench->imu[0], &pbench->ring) == MPU6050_OK) {
+    while (i2c_sim_now(&pbench->bus) - start < BENCH_WINDOW_NS) {
+      i2c_sim_run(&pbench->bus, BENCH_POLL_NS);
+      i2c_sim_driver_begin(&pbench->bus);
+      samples += bench_ring_drain(&pbench->ring);
+      i2c_sim_driver_end(&pbench->bus);
+    }
+    mpu6050_stream_stop(&pbench->imu[0]);
+  }
+  bench_window_end(pbench, "ring", samples, start);
+  i2c_sim_run(&pbench->bus, BENCH_POLL_NS);
+}
+
+/**
+ * @brief   DATA_RDY interrupt driven reads into the ring at 1 kHz
+ */
+static void bench_drdy(bench_t *pbench) {
+  const mpu6050_int_config_t config = {0};
+  mpu6050_t *hmpu = &pbench->imu[0];
+  if (mpu6050_set_sample_divider(hmpu, BENCH_ODR_DIVIDER) != MPU6050_OK ||
+      mpu6050_int_config(hmpu, &config) != MPU6050_OK)
+    bench_failed = true;
+  uint64_t start = bench_window_start(pbench);
+  uint32_t samples = 0;
+  if (mpu6050_drdy_start(hmpu, pbench->dev[0].address, &pbench->ring) == MPU6050_OK) {
+    while (i2c_sim_now(&pbench->bus) - start < BENCH_WINDOW_NS) {
+      i2c_sim_run(&pbench->bus, BENCH_POLL_NS);
+      i2c_sim_driver_begin(&pbench->bus);
+      samples += bench_ring_drain(&pbench->ring);
+      i2c_sim_driver_end(&pbench->bus);
+    }
+    mpu6050_drdy_stop(hmpu);
+  }
+  bench_window_end(pbench, "drdy", samples, start);
+}
+
+/**
+ * @brief   FIFO at 1 kHz drained every 10 ms
+ */
+static void bench_fifo(bench_t *pbench) {
+  static uint8_t buffer[MPU6050_FIFO_SIZE];
+  mpu6050_t *hmpu = &pbench->imu[0];
+  if (mpu6050_set_sample_divider(hmpu, BENCH_ODR_DIVIDER) != MPU6050_OK ||
+      mpu6050_fifo_enable(hmpu, MPU6050_FIFO_SEL_ALL) != MPU6050_OK)
+    bench_failed = true;
+  uint64_t start = bench_window_start(pbench);
+  uint32_t samples = 0;
+  while (i2c_sim_now(&pbench->bus) - start < BENCH_WINDOW_NS) {
+    i2c_sim_run(&pbench->bus, 100U * BENCH_POLL_NS);
+    uint16_t frames;
+    i2c_sim_driver_begin(&pbench->bus);
+    mpu6050_status_t status = mpu6050_fifo_drain(hmpu, buffer, sizeof(buffer), &frames);
+    i2c_sim_driver_end(&pbench->bus);
+    if (status != MPU6050_OK)
+      break;
+    samples += frames;
+  }
+  bench_window_end(pbench, "fifo", samples, start);
+  mpu6050_fifo_disable(hmpu);
+}
+
+/**
+ * @brief   Round-robin scheduler chaining the non-blocking reads of two devices
+ */
+static void bench_scheduler(bench_t *pbench) {
+  static mpu6050_sched_t sched;
+  mpu6050_sched_init(&sched);
+  mpu6050_sched_add(&sched, &pbench->imu[0]);
+  mpu6050_sched_add(&sched, &pbench->imu[1]);
+  uint64_t start = bench_window_start(pbench);
+  uint32_t samples = 0;
+  if (mpu6050_sched_start(&sched) == MPU6050_OK) {
+    i2c_sim_run(&pbench->bus, BENCH_WINDOW_NS);
+    samples = sched.rounds * sched.count;
+    mpu6050_sched_stop(&sched);
+  }
+  bench_window_end(pbench, "scheduler", samples, start);
+  i2c_sim_run(&pbench->bus, BENCH_POLL_NS);
+}
+
+int main(int argc, char **argv) {
+  for (int i = 1; i < argc; i++) {
+    if (strcmp(argv[i], "--json") == 0) {
+      bench_json = true;
+    } else if (strcmp(argv[i], "--speed") == 0 && i + 1 < argc) {
+      bench_speed = (i2c_sim_speed_t)(strtoul(argv[++i], NULL, 10) * 1000U);
+    } else {
+      fprintf(stderr, "usage: %s [--json] [--speed 100|400|1000]\n", argv[0]);
+      return 2;
+    }
+  }
+
+  static void (*const modes[])(bench_t *) = {
+      bench_blocking_per_sensor, bench_blocking, bench_fetch,    bench_ring,
+      bench_drdy,                bench_fifo,     bench_scheduler,
+  };
+  static bench_t bench;
+  for (size_t i = 0; i < sizeof(modes) / sizeof(modes[0]); i++) {
+    bench_setup(&bench, (modes[i] == bench_scheduler) ? 2U : 1U);
+    modes[i](&bench);
+  }
+  return bench_failed;
+}
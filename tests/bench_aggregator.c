@@ -0,0 +1,190 @@
+/**
+ ******************************************************************************
+ * @file           : bench_aggregator.c
+ * @author         : Gonzalo Gabriel Fernandez
+ * @brief          : Multi-bus aggregator scaling benchmark on real-time simulated buses
+ ******************************************************************************
+ * @attention
+ *
+ * 1, 2, 4 and 8 simulated 400 kHz buses with two devices each, paced by the
+ * host clock with i2c_sim_realtime so a thread driving a bus waits on it as
+ * on hardware. Each bus count is read first by one thread walking the
+ * devices, then by the aggregator with one reader thread per bus, its
+ * merged stream consumed by the main thread. Rates go to stdout as CSV.
+ *
+ *   bench_aggregator [--window-ms <ms>]
+ *
+ * Each bus count runs BENCH_RUNS times and keeps its best rates, so a host
+ * scheduling stall in one window does not read as poor scaling. Fails if
+ * the merged stream is out of order, a read fails, or the merged rate of n
+ * buses is under BENCH_SCALING times n times the rate of one bus.
+ *
+ ******************************************************************************
+ */
+
+#define _GNU_SOURCE
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "mpu6050_aggregator.h"
+#include "test.h"
+
+#define BENCH_BUSES 8U
+#define BENCH_WINDOW_MS 1000U          /*! Default measurement window of each run */
+#define BENCH_LATENCY_NS 2000000ULL    /*! Merge latency bound */
+#define BENCH_CONSUMER_SLEEP_NS 100000 /*! Consumer wait with no sample ready */
+#define BENCH_SCALING 0.9              /*! Fraction of linear scaling required */
+#define BENCH_RUNS 3U                  /*! Runs of each bus count, the best one kept */
+
+static i2c_sim_bus_t buses[BENCH_BUSES];
+static i2c_sim_device_t devices[BENCH_BUSES][MPU6050_AGGREGATOR_BUS_DEVICES];
+static mpu6050_t imus[BENCH_BUSES][MPU6050_AGGREGATOR_BUS_DEVICES];
+static mpu6050_ring_t rings[BENCH_BUSES][MPU6050_AGGREGATOR_BUS_DEVICES];
+static mpu6050_aggregator_t agg;
+static bool bench_failed;
+
+/**
+ * @brief   Bring up real-time buses with two devices each
+ */
+static void bench_setup(uint32_t count) {
+  static const mpu6050_i2c_address_t addresses[MPU6050_AGGREGATOR_BUS_DEVICES] = {
+      MPU6050_I2C_ADDRESS_1, MPU6050_I2C_ADDRESS_2};
+  for (uint32_t b = 0; b < count; b++) {
+    i2c_sim_bus_init(&buses[b], I2C_SIM_SPEED_400KHZ);
+    for (uint32_t d = 0; d < MPU6050_AGGREGATOR_BUS_DEVICES; d++) {
+      if (test_device_up(&buses[b], &devices[b][d], &imus[b][d], addresses[d]) != MPU6050_OK)
+        bench_failed = true;
+      mpu6050_ring_init(&rings[b][d]);
+    }
+    i2c_sim_realtime(&buses[b], true);
+  }
+}
+
+/**
+ * @brief   One thread reading every device of every bus in turn
+ * @retval  Samples per second
+ */
+static double bench_serial(uint32_t count, uint64_t window_ns) {
+  bench_setup(count);
+  uint64_t start_ns = mpu6050_aggregator_now_ns();
+  uint64_t elapsed_ns = 0;
+  uint32_t samples = 0;
+  while (elapsed_ns < window_ns) {
+    for (uint32_t b = 0; b < count; b++) {
+      for (uint32_t d = 0; d < MPU6050_AGGREGATOR_BUS_DEVICES; d++) {
+        mpu6050_sample_t sample;
+        if (mpu6050_read_all_raw(&imus[b][d], &sample) != MPU6050_OK)
+          bench_failed = true;
+        samples++;
+      }
+    }
+    elapsed_ns = mpu6050_aggregator_now_ns() - start_ns;
+  }
+  return samples / (elapsed_ns * 1e-9);
+}
+
+/**
+ * @brief Aggregator run figures
+ */
+typedef struct {
+  double rate;             /*!< Merged samples per second */
+  uint32_t drops;          /*!< Samples dropped by full rings */
+  uint32_t late;           /*!< Samples discarded by the merger */
+  uint32_t disorder;       /*!< Merged samples older than the previous one */
+  uint64_t max_latency_ns; /*!< Longest sample time to merge */
+
+} bench_result_t;
+
+/**
+ * @brief   Aggregator with one reader thread per bus, merged by the calling thread
+ */
+static bench_result_t bench_aggregator(uint32_t count, uint64_t window_ns, long cpus) {
+  bench_result_t result = {0};
+  bench_setup(count);
+  mpu6050_aggregator_init(&agg, 0, BENCH_LATENCY_NS);
+  for (uint32_t b = 0; b < count; b++)
+    for (uint32_t d = 0; d < MPU6050_AGGREGATOR_BUS_DEVICES; d++)
+      if (mpu6050_aggregator_add(&agg, &imus[b][d], &rings[b][d], (int)(b % cpus)) != MPU6050_OK)
+        bench_failed = true;
+  if (mpu6050_aggregator_start(&agg) != MPU6050_OK) {
+    bench_failed = true;
+    return result;
+  }
+
+  uint64_t start_ns = mpu6050_aggregator_now_ns();
+  uint64_t now_ns = start_ns;
+  uint64_t last_ns = 0;
+  uint32_t merged = 0;
+  while (now_ns - start_ns < window_ns) {
+    mpu6050_merged_t out;
+    if (mpu6050_aggregator_next(&agg, &out)) {
+      merged++;
+      if (out.timestamp_ns < last_ns)
+        result.disorder++;
+      last_ns = out.timestamp_ns;
+      uint64_t latency_ns = mpu6050_aggregator_now_ns() - out.timestamp_ns;
+      if (latency_ns > result.max_latency_ns)
+        result.max_latency_ns = latency_ns;
+    } else {
+      const struct timespec wait = {0, BENCH_CONSUMER_SLEEP_NS};
+      nanosleep(&wait, NULL);
+    }
+    now_ns = mpu6050_aggregator_now_ns();
+  }
+  mpu6050_aggregator_stop(&agg);
+
+  result.rate = merged / ((now_ns - start_ns) * 1e-9);
+  result.late = agg.merger.late;
+  for (uint32_t b = 0; b < count; b++) {
+    if (agg.buses[b].errors != 0)
+      bench_failed = true;
+    for (uint32_t d = 0; d < MPU6050_AGGREGATOR_BUS_DEVICES; d++)
+      result.drops += rings[b][d].drops;
+  }
+  if (result.disorder != 0)
+    bench_failed = true;
+  return result;
+}
+
+int main(int argc, char **argv) {
+  uint32_t window_ms = BENCH_WINDOW_MS;
+  for (int i = 1; i < argc; i++) {
+    if (strcmp(argv[i], "--window-ms") == 0 && i + 1 < argc) {
+      window_ms = (uint32_t)strtoul(argv[++i], NULL, 10);
+    } else {
+      fprintf(stderr, "usage: %s [--window-ms <ms>]\n", argv[0]);
+      return 2;
+    }
+  }
+  uint64_t window_ns = (uint64_t)window_ms * 1000000U;
+  long cpus = sysconf(_SC_NPROCESSORS_ONLN);
+  if (cpus < 1)
+    cpus = 1;
+
+  printf("buses,serial_per_s,aggregator_per_s,speedup,scaling,drops,late,disorder,"
+         "max_latency_ms\n");
+  double single_rate = 0.0;
+  for (uint32_t count = 1; count <= BENCH_BUSES; count *= 2U) {
+    double serial = 0.0;
+    bench_result_t result = {0};
+    for (uint32_t run = 0; run < BENCH_RUNS; run++) {
+      double serial_run = bench_serial(count, window_ns);
+      if (serial_run > serial)
+        serial = serial_run;
+      bench_result_t result_run = bench_aggregator(count, window_ns, cpus);
+      if (result_run.rate > result.rate)
+        result = result_run;
+    }
+    if (count == 1)
+      single_rate = result.rate;
+    double scaling = result.rate / (single_rate * count);
+    printf("%u,%.0f,%.0f,%.2f,%.2f,%u,%u,%u,%.2f\n", count, serial, result.rate,
+           result.rate / serial, scaling, result.drops, result.late, result.disorder,
+           result.max_latency_ns * 1e-6);
+    if (scaling < BENCH_SCALING)
+      bench_failed = true;
+  }
+  return bench_failed;
+}
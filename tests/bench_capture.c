@@ -0,0 +1,171 @@
+/**
+ ******************************************************************************
+ * @file           : bench_capture.c
+ * @author         : Gonzalo Gabriel Fernandez
+ * @brief          : Binary capture size and decode benchmark against CSV
+ ******************************************************************************
+ * @attention
+ *
+ * Synthetic 1 kHz samples, noisy signals with jittered timestamps, are
+ * written once as a binary capture and once as CSV lines, then decoded back
+ * with mpu6050_capture_next and with strtoull/strtol. Both formats stay in
+ * memory so storage speed is out of the figures. The binary capture must
+ * decode every sample bit for bit, be smaller than CSV and decode faster.
+ * Figures go to stdout as CSV, with the time of a seek.
+ *
+ *   bench_capture [--samples <count>]
+ *
+ ******************************************************************************
+ */
+
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "mpu6050_capture.h"
+#include "test.h"
+
+#define BENCH_SAMPLES 1000000U /*! Default samples, 1000 s at 1 kHz */
+#define BENCH_CSV_LINE_MAX 72U /*! Longest CSV line, 20 digit time and seven int16 */
+#define BENCH_SEEKS 10000U
+
+/**
+ * @brief Capture in memory, the sink context
+ */
+typedef struct {
+  uint8_t *pdata;
+  size_t size;     /*!< Bytes written */
+  size_t capacity; /*!< Bytes allocated */
+
+} bench_storage_t;
+
+/**
+ * @brief   Wall clock time, C11 timespec_get
+ * @retval  Time in ns
+ */
+static double bench_now_ns(void) {
+  struct timespec ts;
+  timespec_get(&ts, TIME_UTC);
+  return ts.tv_sec * 1e9 + ts.tv_nsec;
+}
+
+/**
+ * @brief   Sink appending the blocks to memory
+ */
+static mpu6050_status_t bench_sink(void *pcontext, const uint8_t *pblock, uint16_t size) {
+  bench_storage_t *pstorage = pcontext;
+  if (pstorage->size + size > pstorage->capacity)
+    return MPU6050_ERROR;
+  memcpy(&pstorage->pdata[pstorage->size], pblock, size);
+  pstorage->size += size;
+  return MPU6050_OK;
+}
+
+int main(int argc, char **argv) {
+  uint32_t count = BENCH_SAMPLES;
+  for (int i = 1; i < argc; i++) {
+    if (strcmp(argv[i], "--samples") == 0 && i + 1 < argc) {
+      count = (uint32_t)strtoul(argv[++i], NULL, 10);
+    } else {
+      fprintf(stderr, "usage: %s [--samples <count>]\n", argv[0]);
+      return 2;
+    }
+  }
+  mpu6050_sample_t *psamples = malloc(count * sizeof(*psamples));
+  uint64_t *ptimestamps = malloc(count * sizeof(*ptimestamps));
+  bench_storage_t bin = {.capacity = (size_t)count * 24U + 2U * MPU6050_CAPTURE_BLOCK_SIZE};
+  bin.pdata = malloc(bin.capacity);
+  char *pcsv = malloc((size_t)count * BENCH_CSV_LINE_MAX);
+  if (count == 0 || !psamples || !ptimestamps || !bin.pdata || !pcsv)
+    return 1;
+
+  /* Gravity on Z, a slow swing on every channel, a few LSB of noise, 1 ms +/- 1 us */
+  srand(1);
+  for (uint32_t i = 0; i < count; i++) {
+    uint16_t *pvalue = &psamples[i].accel[0];
+    for (uint32_t c = 0; c < MPU6050_CAPTURE_CHANNELS; c++) {
+      int swing = (int)((i / (10U + c)) % 600U) - 300;
+      swing = (swing < 0) ? -swing : swing;
+      pvalue[c] = (uint16_t)(int16_t)((c == 2 ? 16384 : 0) + swing + rand() % 9 - 4);
+    }
+    ptimestamps[i] = 1000000000ULL + (uint64_t)i * 1000000U + (uint64_t)(rand() % 2000);
+  }
+
+  /* Binary write */
+  static uint8_t block[MPU6050_CAPTURE_BLOCK_SIZE];
+  mpu6050_capture_t cap;
+  const mpu6050_capture_config_t config = {.sample_period_ns = 1000000U};
+  bool failed = mpu6050_capture_init(&cap, block, sizeof(block), bench_sink, &bin) != MPU6050_OK ||
+                mpu6050_capture_start(&cap, &config) != MPU6050_OK;
+  double start = bench_now_ns();
+  for (uint32_t i = 0; i < count; i++)
+    failed |= mpu6050_capture_add(&cap, &psamples[i], ptimestamps[i]) != MPU6050_OK;
+  failed |= mpu6050_capture_flush(&cap) != MPU6050_OK;
+  double bin_write_ns = (bench_now_ns() - start) / count;
+
+  /* CSV write */
+  size_t csv_size = 0;
+  start = bench_now_ns();
+  for (uint32_t i = 0; i < count; i++) {
+    const mpu6050_sample_t *ps = &psamples[i];
+    csv_size += (size_t)snprintf(
+        &pcsv[csv_size], BENCH_CSV_LINE_MAX, "%llu,%d,%d,%d,%d,%d,%d,%d\n",
+        (unsigned long long)ptimestamps[i], raw16(ps->accel[0]), raw16(ps->accel[1]),
+        raw16(ps->accel[2]), raw16(ps->temp), raw16(ps->gyro[0]), raw16(ps->gyro[1]),
+        raw16(ps->gyro[2]));
+  }
+  double csv_write_ns = (bench_now_ns() - start) / count;
+
+  /* Binary decode, in place */
+  mpu6050_capture_reader_t reader;
+  failed |= mpu6050_capture_open(&reader, bin.pdata, bin.size) != MPU6050_OK;
+  uint32_t decoded = 0;
+  uint32_t mismatches = 0;
+  mpu6050_sample_t sample;
+  uint64_t timestamp_ns;
+  start = bench_now_ns();
+  while (mpu6050_capture_next(&reader, &sample, &timestamp_ns)) {
+    mismatches += decoded >= count || memcmp(&sample, &psamples[decoded], sizeof(sample)) != 0 ||
+                  timestamp_ns != ptimestamps[decoded];
+    decoded++;
+  }
+  double bin_decode_ns = (bench_now_ns() - start) / count;
+  failed |= decoded != count || mismatches != 0;
+
+  /* CSV decode */
+  uint32_t parsed = 0;
+  const char *p = pcsv;
+  start = bench_now_ns();
+  while (p < pcsv + csv_size) {
+    char *pend;
+    timestamp_ns = strtoull(p, &pend, 10);
+    uint16_t *pvalue = &sample.accel[0];
+    for (uint32_t c = 0; c < MPU6050_CAPTURE_CHANNELS; c++)
+      pvalue[c] = (uint16_t)(int16_t)strtol(pend + 1, &pend, 10);
+    mismatches += parsed >= count || memcmp(&sample, &psamples[parsed], sizeof(sample)) != 0 ||
+                  timestamp_ns != ptimestamps[parsed];
+    parsed++;
+    p = pend + 1;
+  }
+  double csv_decode_ns = (bench_now_ns() - start) / count;
+  failed |= parsed != count || mismatches != 0;
+
+  /* Seek to spread out times */
+  start = bench_now_ns();
+  for (uint32_t i = 0; i < BENCH_SEEKS; i++)
+    failed |= mpu6050_capture_seek(&reader, ptimestamps[(i * 7919U) % count]) != MPU6050_OK;
+  double seek_ns = (bench_now_ns() - start) / BENCH_SEEKS;
+
+  double bin_bytes = (double)bin.size / count;
+  double csv_bytes = (double)csv_size / count;
+  printf("format,bytes_per_sample,write_ns_per_sample,decode_ns_per_sample,seek_ns\n");
+  printf("binary,%.2f,%.1f,%.1f,%.0f\n", bin_bytes, bin_write_ns, bin_decode_ns, seek_ns);
+  printf("csv,%.2f,%.1f,%.1f,\n", csv_bytes, csv_write_ns, csv_decode_ns);
+  failed |= bin_bytes >= csv_bytes || bin_decode_ns >= csv_decode_ns;
+
+  free(psamples);
+  free(ptimestamps);
+  free(bin.pdata);
+  free(pcsv);
+  return failed;
+}
@@ -0,0 +1,130 @@
+/**
+ ******************************************************************************
+ * @file           : bench_convert.c
+ * @author         : Gonzalo Gabriel Fernandez
+ * @brief          : Conversion kernels throughput benchmark
+ ******************************************************************************
+ * @attention
+ *
+ * Random raw frames are converted to int16 counts, SI floats and Q16.16 in
+ * one call per kernel. The best frames per second over BENCH_RUNS runs goes
+ * to stdout as CSV, with the kernel set of this build: the vector one for
+ * the instruction set, or scalar with MPU6050_CONVERT_NO_SIMD.
+ *
+ *   bench_convert [--frames <count>]
+ *
+ * Fails if the last frame does not convert as raw * scale + offset.
+ *
+ ******************************************************************************
+ */
+
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "mpu6050_convert.h"
+#include "test.h"
+
+#define BENCH_FRAMES 1000000U /*! Default frames per run */
+#define BENCH_RUNS 5U         /*! Runs of each kernel, the best one is kept */
+
+#if defined(MPU6050_CONVERT_NO_SIMD)
+#define BENCH_KERNELS "scalar"
+#elif defined(__AVX2__)
+#define BENCH_KERNELS "avx2"
+#elif defined(__SSE2__)
+#define BENCH_KERNELS "sse2"
+#elif defined(__ARM_NEON)
+#define BENCH_KERNELS "neon"
+#else
+#define BENCH_KERNELS "scalar"
+#endif
+
+/**
+ * @brief Kernel under test
+ */
+typedef enum {
+  BENCH_INT16,
+  BENCH_SI,
+  BENCH_Q16,
+  BENCH_KERNEL_COUNT,
+
+} bench_kernel_t;
+
+static const char *const bench_names[BENCH_KERNEL_COUNT] = {"int16", "si", "q16"};
+
+/**
+ * @brief   Wall clock time in ns
+ */
+static uint64_t bench_now_ns(void) {
+  struct timespec ts;
+  timespec_get(&ts, TIME_UTC);
+  return (uint64_t)ts.tv_sec * 1000000000U + (uint64_t)ts.tv_nsec;
+}
+
+int main(int argc, char **argv) {
+  uint32_t frames = BENCH_FRAMES;
+  for (int i = 1; i < argc; i++) {
+    if (strcmp(argv[i], "--frames") == 0 && i + 1 < argc) {
+      frames = (uint32_t)strtoul(argv[++i], NULL, 10);
+    } else {
+      fprintf(stderr, "usage: %s [--frames <count>]\n", argv[0]);
+      return 2;
+    }
+  }
+#if defined(__AVX2__) && defined(__x86_64__)
+  if (!__builtin_cpu_supports("avx2"))
+    return TEST_SKIP;
+#endif
+  if (frames == 0)
+    frames = BENCH_FRAMES;
+
+  uint8_t *pframes = malloc((size_t)frames * MPU6050_SENSOR_DATA_LEN);
+  int16_t *pvalues = malloc((size_t)frames * MPU6050_CONVERT_CHANNELS * sizeof(int16_t));
+  mpu6050_si_sample_t *psi = malloc((size_t)frames * sizeof(mpu6050_si_sample_t));
+  mpu6050_q16_sample_t *pq16 = malloc((size_t)frames * sizeof(mpu6050_q16_sample_t));
+  if (pframes == NULL || pvalues == NULL || psi == NULL || pq16 == NULL)
+    return 1;
+  srand(6050);
+  for (size_t i = 0; i < (size_t)frames * MPU6050_SENSOR_DATA_LEN; i++)
+    pframes[i] = (uint8_t)rand();
+  mpu6050_convert_scale_t scale;
+  mpu6050_convert_scale(MPU6050_GYRO_CONFIG_2000DPS, MPU6050_ACCEL_CONFIG_4G, &scale);
+
+  printf("kernels,output,frames,mframes_per_s,ns_per_frame\n");
+  for (uint32_t k = 0; k < BENCH_KERNEL_COUNT; k++) {
+    double best_s = 0.0;
+    for (uint32_t run = 0; run < BENCH_RUNS; run++) {
+      uint64_t start_ns = bench_now_ns();
+      if (k == BENCH_INT16)
+        mpu6050_convert_frames_int16(pframes, frames, pvalues);
+      else if (k == BENCH_SI)
+        mpu6050_convert_frames_si(pframes, frames, &scale, psi);
+      else
+        mpu6050_convert_frames_q16(pframes, frames, &scale, pq16);
+      double elapsed_s = (bench_now_ns() - start_ns) * 1e-9;
+      if (run == 0 || elapsed_s < best_s)
+        best_s = elapsed_s;
+    }
+    double rate = frames / best_s;
+    printf("%s,%s,%u,%.1f,%.2f\n", BENCH_KERNELS, bench_names[k], frames, rate * 1e-6,
+           1e9 / rate);
+  }
+
+  /* The last frame, converted by the tail or the last vector block */
+  bool failed = false;
+  const uint8_t *plast = &pframes[(size_t)(frames - 1U) * MPU6050_SENSOR_DATA_LEN];
+  const float *psi_last = (const float *)&psi[frames - 1U];
+  for (uint8_t ch = 0; ch < MPU6050_CONVERT_CHANNELS; ch++) {
+    int16_t raw = (int16_t)((plast[2U * ch] << 8) | plast[2U * ch + 1U]);
+    float expected = (float)raw * scale.scale[ch] + scale.offset[ch];
+    if (pvalues[(size_t)(frames - 1U) * MPU6050_CONVERT_CHANNELS + ch] != raw ||
+        memcmp(&psi_last[ch], &expected, sizeof(expected)) != 0)
+      failed = true;
+  }
+  free(pq16);
+  free(psi);
+  free(pvalues);
+  free(pframes);
+  return failed;
+}
@@ -0,0 +1,93 @@
+/**
+ ******************************************************************************
+ * @file           : bench_decim.c
+ * @author         : Gonzalo Gabriel Fernandez
+ * @brief          : Anti-alias decimation throughput benchmark
+ ******************************************************************************
+ * @attention
+ *
+ * Random samples are decimated by 8 in blocks of BENCH_BLOCK with the 64 and
+ * 128 tap designs, gyro only and all channels. Input samples per second,
+ * and how many 8 kHz streams that is, go to stdout as CSV. The kernel is
+ * the one of this build, define MPU6050_DECIM_NO_SIMD for the scalar one.
+ *
+ *   bench_decim [--samples <count>]
+ *
+ * Fails if a run does not give one output sample per 8 input samples.
+ *
+ ******************************************************************************
+ */
+
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "mpu6050_decim.h"
+#include "test.h"
+
+#define BENCH_SAMPLES 10000000U /*! Default input samples per run */
+#define BENCH_BLOCK 256U        /*! Input samples per call, a FIFO drain */
+#define BENCH_RATIO 8U
+#define BENCH_STREAM_HZ 8000.0 /*! Gyro output rate with the DLPF off */
+
+static mpu6050_sample_t in[BENCH_BLOCK * 64U];
+static mpu6050_sample_t out[BENCH_BLOCK / BENCH_RATIO + 1U];
+static mpu6050_decim_t decim;
+
+/**
+ * @brief   Wall clock time in ns
+ */
+static uint64_t bench_now_ns(void) {
+  struct timespec ts;
+  timespec_get(&ts, TIME_UTC);
+  return (uint64_t)ts.tv_sec * 1000000000U + (uint64_t)ts.tv_nsec;
+}
+
+int main(int argc, char **argv) {
+  uint32_t samples = BENCH_SAMPLES;
+  for (int i = 1; i < argc; i++) {
+    if (strcmp(argv[i], "--samples") == 0 && i + 1 < argc) {
+      samples = (uint32_t)strtoul(argv[++i], NULL, 10);
+    } else {
+      fprintf(stderr, "usage: %s [--samples <count>]\n", argv[0]);
+      return 2;
+    }
+  }
+  samples -= samples % BENCH_BLOCK;
+
+  srand(6050);
+  for (uint32_t n = 0; n < sizeof(in) / sizeof(in[0]); n++)
+    for (uint8_t c = 0; c < 3; c++) {
+      in[n].accel[c] = (uint16_t)rand();
+      in[n].gyro[c] = (uint16_t)rand();
+    }
+
+  static const uint16_t taps[] = {64, 128};
+  static const struct {
+    uint8_t sel;
+    const char *pname;
+  } selections[] = {{MPU6050_DECIM_SEL_GYRO, "gyro"}, {MPU6050_DECIM_SEL_ALL, "all"}};
+  bool failed = false;
+  printf("taps,channels,msamples_per_s,ns_per_sample,streams_8khz\n");
+  for (uint32_t t = 0; t < sizeof(taps) / sizeof(taps[0]); t++) {
+    int16_t coeffs[MPU6050_DECIM_MAX_TAPS];
+    mpu6050_decim_design(coeffs, taps[t], BENCH_RATIO);
+    for (uint32_t s = 0; s < sizeof(selections) / sizeof(selections[0]); s++) {
+      if (mpu6050_decim_init(&decim, BENCH_RATIO, coeffs, taps[t], selections[s].sel) !=
+          MPU6050_OK)
+        return 1;
+      uint32_t produced = 0;
+      uint64_t start_ns = bench_now_ns();
+      for (uint32_t n = 0; n < samples; n += BENCH_BLOCK)
+        produced += mpu6050_decim_process(&decim, &in[n % (sizeof(in) / sizeof(in[0]))],
+                                          BENCH_BLOCK, out);
+      double elapsed_s = (bench_now_ns() - start_ns) * 1e-9;
+      if (produced != samples / BENCH_RATIO)
+        failed = true;
+      double rate = samples / elapsed_s;
+      printf("%u,%s,%.1f,%.2f,%.0f\n", taps[t], selections[s].pname, rate * 1e-6,
+             1e9 / rate, rate / BENCH_STREAM_HZ);
+    }
+  }
+  return failed;
+}
@@ -0,0 +1,140 @@
+/**
+ ******************************************************************************
+ * @file           : bench_fusion.c
+ * @author         : Gonzalo Gabriel Fernandez
+ * @brief          : Orientation fusion cost per update benchmark
+ ******************************************************************************
+ * @attention
+ *
+ * A noisy 1 kHz rotation goes through the Madgwick and Mahony filters, one
+ * mpu6050_fusion_update call per sample and one mpu6050_fusion_update_batch
+ * call for all of them. The best time per update over BENCH_RUNS runs goes
+ * to stdout as CSV, in ns and, on x86, in TSC cycles. The arithmetic is the
+ * one of this build, define MPU6050_FUSION_FIXED for fixed-point.
+ *
+ *   bench_fusion [--samples <count>]
+ *
+ * Fails if single and batch updates end on different quaternions, or the
+ * quaternion is not unit.
+ *
+ ******************************************************************************
+ */
+
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#define BENCH_CYCLES() __rdtsc()
+#else
+#define BENCH_CYCLES() 0ULL
+#endif
+
+#include "mpu6050_fusion.h"
+#include "test.h"
+
+#define BENCH_SAMPLES 100000U /*! Default samples per run */
+#define BENCH_RUNS 10U        /*! Runs of each configuration, the best one is kept */
+#define BENCH_RATE_HZ 1000U
+#define BENCH_ACCEL_1G 16384.0 /*! Counts per g at 2 g full scale */
+
+#ifdef MPU6050_FUSION_FIXED
+#define BENCH_ARITHMETIC "fixed"
+#define BENCH_QUAT(x) ((x) / 1073741824.0) /*! Q2.30 */
+#else
+#define BENCH_ARITHMETIC "float"
+#define BENCH_QUAT(x) ((double)(x))
+#endif
+
+static mpu6050_sample_t samples[BENCH_SAMPLES];
+
+/**
+ * @brief   Wall clock time in ns
+ */
+static uint64_t bench_now_ns(void) {
+  struct timespec ts;
+  timespec_get(&ts, TIME_UTC);
+  return (uint64_t)ts.tv_sec * 1000000000U + (uint64_t)ts.tv_nsec;
+}
+
+/**
+ * @brief   Noise of +-range counts
+ */
+static double bench_noise(double range) { return range * (2.0 * rand() / RAND_MAX - 1.0); }
+
+int main(int argc, char **argv) {
+  uint32_t count = BENCH_SAMPLES;
+  for (int i = 1; i < argc; i++) {
+    if (strcmp(argv[i], "--samples") == 0 && i + 1 < argc) {
+      count = (uint32_t)strtoul(argv[++i], NULL, 10);
+    } else {
+      fprintf(stderr, "usage: %s [--samples <count>]\n", argv[0]);
+      return 2;
+    }
+  }
+  if (count == 0 || count > BENCH_SAMPLES)
+    count = BENCH_SAMPLES;
+
+  /* Roll at 0.5 rad/s, gravity following it, noise on every channel */
+  mpu6050_convert_scale_t scale;
+  mpu6050_convert_scale(MPU6050_GYRO_CONFIG_500DPS, MPU6050_ACCEL_CONFIG_2G, &scale);
+  srand(6050);
+  for (uint32_t n = 0; n < count; n++) {
+    double roll = 0.5 * n / BENCH_RATE_HZ;
+    double accel_y = BENCH_ACCEL_1G * sin(roll) + bench_noise(200.0);
+    double accel_z = BENCH_ACCEL_1G * cos(roll) + bench_noise(200.0);
+    samples[n].accel[0] = (uint16_t)(int16_t)lround(bench_noise(200.0));
+    samples[n].accel[1] = (uint16_t)(int16_t)lround(accel_y);
+    samples[n].accel[2] = (uint16_t)(int16_t)lround(accel_z);
+    samples[n].gyro[0] = (uint16_t)(int16_t)lround(0.5 / scale.scale[4] + bench_noise(20.0));
+    samples[n].gyro[1] = (uint16_t)(int16_t)lround(bench_noise(20.0));
+    samples[n].gyro[2] = (uint16_t)(int16_t)lround(bench_noise(20.0));
+  }
+
+  static const struct {
+    mpu6050_fusion_algo_t algo;
+    const char *pname;
+  } algos[] = {{MPU6050_FUSION_MADGWICK, "madgwick"}, {MPU6050_FUSION_MAHONY, "mahony"}};
+  bool failed = false;
+  printf("arithmetic,algo,call,ns_per_update,cycles_per_update\n");
+  for (uint32_t a = 0; a < sizeof(algos) / sizeof(algos[0]); a++) {
+    mpu6050_fusion_t fusion[2];
+    double best_ns[2] = {0.0, 0.0};
+    double best_cycles[2] = {0.0, 0.0};
+    /* Single and batch runs interleaved, so both see the same host noise */
+    for (uint32_t run = 0; run < BENCH_RUNS; run++) {
+      for (uint32_t batch = 0; batch < 2; batch++) {
+        mpu6050_fusion_init(&fusion[batch], algos[a].algo, &scale, BENCH_RATE_HZ);
+        uint64_t start_ns = bench_now_ns();
+        uint64_t start_cycles = BENCH_CYCLES();
+        if (batch) {
+          mpu6050_fusion_update_batch(&fusion[batch], samples, count);
+        } else {
+          for (uint32_t n = 0; n < count; n++)
+            mpu6050_fusion_update(&fusion[batch], &samples[n]);
+        }
+        double cycles = (double)(BENCH_CYCLES() - start_cycles) / count;
+        double ns = (double)(bench_now_ns() - start_ns) / count;
+        if (run == 0 || ns < best_ns[batch])
+          best_ns[batch] = ns;
+        if (run == 0 || cycles < best_cycles[batch])
+          best_cycles[batch] = cycles;
+      }
+    }
+    printf("%s,%s,single,%.1f,%.0f\n", BENCH_ARITHMETIC, algos[a].pname, best_ns[0],
+           best_cycles[0]);
+    printf("%s,%s,batch,%.1f,%.0f\n", BENCH_ARITHMETIC, algos[a].pname, best_ns[1],
+           best_cycles[1]);
+
+    if (memcmp(fusion[0].q, fusion[1].q, sizeof(fusion[0].q)) != 0)
+      failed = true;
+    double norm = 0.0;
+    for (uint8_t i = 0; i < 4; i++)
+      norm += BENCH_QUAT(fusion[1].q[i]) * BENCH_QUAT(fusion[1].q[i]);
+    if (fabs(sqrt(norm) - 1.0) > 1e-3)
+      failed = true;
+  }
+  return failed;
+}
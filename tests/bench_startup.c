@@ -0,0 +1,119 @@
+/**
+ ******************************************************************************
+ * @file           : bench_startup.c
+ * @author         : Gonzalo Gabriel Fernandez
+ * @brief          : Time to first valid sample benchmark, fixed delays against the init table
+ ******************************************************************************
+ * @attention
+ *
+ * Brings a device up at 100 and 400 kHz two ways. The fixed delay sequence
+ * writes the reset, waits 100 ms, wakes the device and writes the sample
+ * divider, DLPF and full scales one register at a time, then waits 50 ms.
+ * mpu6050_start runs the init table, waiting on the device instead. Both
+ * end on a sample read, which must hold the simulated gravity. Times are
+ * simulated bus time, so the figures are exact. They go to stdout as CSV,
+ * with the transactions of each sequence.
+ *
+ * Fails if a sequence ends without a valid sample, or the init table is not
+ * faster than the fixed delays.
+ *
+ ******************************************************************************
+ */
+
+#include "port_i2c.h"
+#include "test.h"
+
+#define BENCH_RESET_DELAY_NS 100000000ULL /*! Fixed delay after the reset write */
+#define BENCH_START_DELAY_NS 50000000ULL  /*! Fixed delay after the configuration */
+#define BENCH_GRAVITY 16384               /*! Accel Z at 2 g full scale */
+
+static i2c_sim_bus_t bus;
+static i2c_sim_device_t dev;
+static mpu6050_t imu;
+static bool bench_failed;
+
+/**
+ * @brief Sequence figures
+ */
+typedef struct {
+  uint64_t elapsed_ns;   /*!< Time from the first write to the first valid sample */
+  uint32_t transactions; /*!< Bus transactions, the final read included */
+
+} bench_result_t;
+
+/**
+ * @brief   Powered-up device, gravity on Z, handle on it
+ */
+static void bench_setup(i2c_sim_speed_t speed) {
+  i2c_sim_bus_init(&bus, speed);
+  i2c_sim_device_init(&dev, MPU6050_I2C_ADDRESS_1);
+  if (i2c_sim_attach(&bus, &dev) != MPU6050_OK)
+    bench_failed = true;
+  i2c_sim_set_signal(&dev, I2C_SIM_ACCEL_Z, BENCH_GRAVITY, 0, 0);
+  i2c_sim_run(&bus, 1000000U);
+}
+
+/**
+ * @brief   Read the first sample, check it and close the figures
+ */
+static bench_result_t bench_finish(uint64_t start_ns, uint32_t transactions) {
+  mpu6050_sample_t sample;
+  if (mpu6050_read_all_raw(&imu, &sample) != MPU6050_OK ||
+      raw16(sample.accel[2]) != BENCH_GRAVITY)
+    bench_failed = true;
+  bench_result_t result = {i2c_sim_now(&bus) - start_ns, bus.stats.transactions - transactions};
+  return result;
+}
+
+/**
+ * @brief   Reset, fixed delays and one write per register
+ */
+static bench_result_t bench_fixed_delays(i2c_sim_speed_t speed) {
+  bench_setup(speed);
+  uint64_t start_ns = i2c_sim_now(&bus);
+  uint32_t transactions = bus.stats.transactions;
+  uint8_t value = 1U << MPU6050_PWR1_DEVICE_RESET_OFFSET;
+  if (i2c_reg_write(&bus, MPU6050_I2C_ADDRESS_1 << 1, MPU6050_PWR_MGMT_1, &value) != MPU6050_OK)
+    bench_failed = true;
+  i2c_sim_run(&bus, BENCH_RESET_DELAY_NS);
+  if (mpu6050_init(&imu, &bus, MPU6050_I2C_ADDRESS_1) != MPU6050_OK ||
+      mpu6050_reset_pwrmgmt(&imu) != MPU6050_OK ||
+      mpu6050_set_sample_divider(&imu, 0) != MPU6050_OK ||
+      mpu6050_set_dlpf(&imu, MPU6050_DLPF_184HZ) != MPU6050_OK ||
+      mpu6050_gyro_set_fullscale(&imu, MPU6050_GYRO_CONFIG_500DPS) != MPU6050_OK ||
+      mpu6050_accel_set_fullscale(&imu, MPU6050_ACCEL_CONFIG_2G) != MPU6050_OK)
+    bench_failed = true;
+  i2c_sim_run(&bus, BENCH_START_DELAY_NS);
+  return bench_finish(start_ns, transactions);
+}
+
+/**
+ * @brief   mpu6050_start, waits on the device
+ */
+static bench_result_t bench_init_table(i2c_sim_speed_t speed) {
+  bench_setup(speed);
+  if (mpu6050_init(&imu, &bus, MPU6050_I2C_ADDRESS_1) != MPU6050_OK)
+    bench_failed = true;
+  uint64_t start_ns = i2c_sim_now(&bus);
+  uint32_t transactions = bus.stats.transactions;
+  if (mpu6050_start(&imu, MPU6050_GYRO_CONFIG_500DPS, MPU6050_ACCEL_CONFIG_2G,
+                    MPU6050_DLPF_184HZ, 0) != MPU6050_OK)
+    bench_failed = true;
+  return bench_finish(start_ns, transactions);
+}
+
+int main(void) {
+  static const i2c_sim_speed_t speeds[] = {I2C_SIM_SPEED_100KHZ, I2C_SIM_SPEED_400KHZ};
+  printf("speed_khz,sequence,first_sample_ms,transactions\n");
+  for (uint32_t i = 0; i < sizeof(speeds) / sizeof(speeds[0]); i++) {
+    bench_result_t fixed = bench_fixed_delays(speeds[i]);
+    bench_result_t table = bench_init_table(speeds[i]);
+    printf("%u,fixed_delays,%.3f,%u\n", speeds[i] / 1000U, fixed.elapsed_ns * 1e-6,
+           fixed.transactions);
+    printf("%u,init_table,%.3f,%u\n", speeds[i] / 1000U, table.elapsed_ns * 1e-6,
+           table.transactions);
+    if (table.elapsed_ns >= fixed.elapsed_ns)
+      bench_failed = true;
+  }
+  return bench_failed;
+}
@@ -0,0 +1,126 @@
+/**
+ ******************************************************************************
+ * @file           : bench_vibration.c
+ * @author         : Gonzalo Gabriel Fernandez
+ * @brief          : Vibration analyzer cost per window benchmark
+ ******************************************************************************
+ * @attention
+ *
+ * Random accel samples at 1 kHz go through the analyzer with windows every
+ * MPU6050_VIB_FFT_SIZE samples, in three configurations: four Goertzel
+ * targets without FFT, the spectrum alone, and eight bands with four
+ * targets. The best time per window of three axes over BENCH_RUNS runs goes
+ * to stdout as CSV, in ns and, on x86, in TSC cycles, with the bytes of the
+ * features sent per window.
+ *
+ *   bench_vibration [--windows <count>]
+ *
+ * Fails if a run does not analyze one window per MPU6050_VIB_FFT_SIZE
+ * samples.
+ *
+ ******************************************************************************
+ */
+
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#define BENCH_CYCLES() __rdtsc()
+#else
+#define BENCH_CYCLES() 0ULL
+#endif
+
+#include "mpu6050_vibration.h"
+#include "test.h"
+
+#define BENCH_WINDOWS 32U /*! Default windows per run */
+#define BENCH_RUNS 50U    /*! Runs of each configuration, the best one is kept */
+#define BENCH_RATE_HZ 1000.0f
+
+static mpu6050_vib_t vib;
+static mpu6050_sample_t in[BENCH_WINDOWS * MPU6050_VIB_FFT_SIZE];
+static mpu6050_vib_features_t features[BENCH_WINDOWS + 1U];
+
+/**
+ * @brief   Wall clock time in ns
+ */
+static uint64_t bench_now_ns(void) {
+  struct timespec ts;
+  timespec_get(&ts, TIME_UTC);
+  return (uint64_t)ts.tv_sec * 1000000000U + (uint64_t)ts.tv_nsec;
+}
+
+/**
+ * @brief Analyzer configuration
+ */
+typedef struct {
+  const char *pname;
+  uint8_t bands;
+  uint8_t tones;
+  bool spectrum;
+
+} bench_config_t;
+
+int main(int argc, char **argv) {
+  uint32_t windows = BENCH_WINDOWS;
+  for (int i = 1; i < argc; i++) {
+    if (strcmp(argv[i], "--windows") == 0 && i + 1 < argc) {
+      windows = (uint32_t)strtoul(argv[++i], NULL, 10);
+    } else {
+      fprintf(stderr, "usage: %s [--windows <count>]\n", argv[0]);
+      return 2;
+    }
+  }
+  if (windows == 0 || windows > BENCH_WINDOWS)
+    windows = BENCH_WINDOWS;
+  uint32_t samples = windows * MPU6050_VIB_FFT_SIZE;
+
+  srand(6050);
+  for (uint32_t n = 0; n < samples; n++)
+    for (uint8_t c = 0; c < 3; c++)
+      in[n].accel[c] = (uint16_t)rand();
+  mpu6050_convert_scale_t scale;
+  mpu6050_convert_scale(MPU6050_GYRO_CONFIG_250DPS, MPU6050_ACCEL_CONFIG_2G, &scale);
+
+  static const bench_config_t configs[] = {
+      {"goertzel_4", 0, 4, false},
+      {"spectrum", 0, 0, true},
+      {"bands_8_goertzel_4", 8, 4, false},
+  };
+  bool failed = false;
+  printf("config,ns_per_window,cycles_per_window,feature_bytes\n");
+  for (uint32_t c = 0; c < sizeof(configs) / sizeof(configs[0]); c++) {
+    if (mpu6050_vib_init(&vib, &scale, BENCH_RATE_HZ, MPU6050_VIB_FFT_SIZE, configs[c].spectrum) !=
+        MPU6050_OK)
+      return 1;
+    for (uint8_t b = 0; b < configs[c].bands; b++)
+      if (mpu6050_vib_add_band(&vib, 60.0f * b, 60.0f * b + 60.0f) != MPU6050_OK)
+        failed = true;
+    for (uint8_t t = 0; t < configs[c].tones; t++)
+      if (mpu6050_vib_add_tone(&vib, 50.0f + 37.0f * t) != MPU6050_OK)
+        failed = true;
+
+    double best_ns = 0.0;
+    double best_cycles = 0.0;
+    for (uint32_t run = 0; run < BENCH_RUNS; run++) {
+      mpu6050_vib_reset(&vib);
+      uint64_t start_ns = bench_now_ns();
+      uint64_t start_cycles = BENCH_CYCLES();
+      uint32_t analyzed = mpu6050_vib_process(&vib, in, samples, features);
+      double cycles = (double)(BENCH_CYCLES() - start_cycles) / windows;
+      double ns = (double)(bench_now_ns() - start_ns) / windows;
+      if (analyzed != windows)
+        failed = true;
+      if (run == 0 || ns < best_ns)
+        best_ns = ns;
+      if (run == 0 || cycles < best_cycles)
+        best_cycles = cycles;
+    }
+    /* RMS, peak, crest, kurtosis, bands and tones of three axes, as floats */
+    uint32_t bytes = MPU6050_VIB_AXES * (4U + configs[c].bands + configs[c].tones) * 4U;
+    printf("%s,%.0f,%.0f,%u\n", configs[c].pname, best_ns, best_cycles, bytes);
+  }
+  return failed;
+}
@@ -0,0 +1,160 @@
+/**
+ ******************************************************************************
+ * @file           : bench_wrapper.cpp
+ * @author         : Gonzalo Gabriel Fernandez
+ * @brief          : C++17 wrapper read and conversion benchmark against hand-written C
+ ******************************************************************************
+ * @attention
+ *
+ * Mpu6050::convert over a block of raw samples against the same conversion
+ * written by hand in C and built by the C compiler, and Mpu6050::read against
+ * mpu6050_read_all_raw and that conversion, each on its own simulated bus
+ * with the same device. The outputs must match bit for bit, and the best time
+ * of the wrapper must not exceed the best time of the C loop by more than the
+ * host noise margin, so the wrapper costs nothing over plain C. Runs of the
+ * two loops alternate. Times go to stdout as CSV.
+ *
+ *   bench_wrapper [--margin <ratio>]
+ *
+ ******************************************************************************
+ */
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+
+#include "mpu6050.hpp"
+#include "test.h"
+
+#define BENCH_SAMPLES 4096U
+#define BENCH_READS 512U     /*! Blocking reads per run */
+#define BENCH_RUNS 41U       /*! Runs of each loop, the best one is kept */
+#define BENCH_REPEATS 100U   /*! Conversions of the block per run */
+#define BENCH_MARGIN 1.05    /*! Default wrapper to C time ratio allowed, host timing noise */
+
+using Imu = mpu6050::Mpu6050<mpu6050::SimBus, mpu6050::Address::Ad0Low, mpu6050::GyroFs::Dps500,
+                             mpu6050::AccelFs::G4>;
+
+extern "C" void bench_convert_c(const mpu6050_sample_t *praw, float *pout, uint32_t count);
+extern "C" mpu6050_status_t bench_read_c(mpu6050_t *hmpu, float *pout, uint32_t count);
+
+/**
+ * @brief   Convert raw samples with the wrapper
+ */
+__attribute__((noinline)) static void bench_convert_cpp(const mpu6050_sample_t *praw,
+                                                        mpu6050::Sample *pout, uint32_t count) {
+  for (uint32_t i = 0; i < count; i++)
+    pout[i] = Imu::convert(praw[i]);
+}
+
+/**
+ * @brief   Blocking reads with the wrapper
+ * @retval  mpu6050_status_t of the first read that failed
+ */
+__attribute__((noinline)) static mpu6050_status_t bench_read_cpp(Imu &imu, mpu6050::Sample *pout,
+                                                                 uint32_t count) {
+  for (uint32_t i = 0; i < count; i++) {
+    mpu6050_status_t status = imu.read(pout[i]);
+    if (status != MPU6050_OK)
+      return status;
+  }
+  return MPU6050_OK;
+}
+
+/**
+ * @brief   Time of one run of a loop
+ * @retval  ns per sample
+ */
+template <typename Loop>
+static double bench_run(Loop loop, void *pout, uint32_t samples, uint32_t repeats) {
+  auto start = std::chrono::steady_clock::now();
+  for (uint32_t i = 0; i < repeats; i++) {
+    loop();
+    __asm__ volatile("" : : "r"(pout) : "memory");
+  }
+  std::chrono::duration<double, std::nano> elapsed = std::chrono::steady_clock::now() - start;
+  return elapsed.count() / (static_cast<double>(samples) * repeats);
+}
+
+/**
+ * @brief   Simulated bus with one device, a slow rotation on every axis
+ */
+static void bench_bus(i2c_sim_bus_t &bus, i2c_sim_device_t &dev) {
+  i2c_sim_bus_init(&bus, I2C_SIM_SPEED_400KHZ);
+  i2c_sim_device_init(&dev, MPU6050_I2C_ADDRESS_1);
+  for (uint8_t ch = 0; ch < I2C_SIM_CHANNELS; ch++)
+    i2c_sim_set_signal(&dev, static_cast<i2c_sim_channel_t>(ch), 100.0f * ch, 4000.0f, 3.0f);
+  CHECK(i2c_sim_attach(&bus, &dev) == MPU6050_OK);
+}
+
+int main(int argc, char **argv) {
+  double margin = BENCH_MARGIN;
+  for (int i = 1; i < argc; i++) {
+    if (std::strcmp(argv[i], "--margin") == 0 && i + 1 < argc) {
+      margin = std::strtod(argv[++i], nullptr);
+    } else {
+      std::fprintf(stderr, "usage: %s [--margin <ratio>]\n", argv[0]);
+      return 2;
+    }
+  }
+
+  static mpu6050_sample_t raw[BENCH_SAMPLES];
+  static mpu6050::Sample cpp[BENCH_SAMPLES];
+  static float c[BENCH_SAMPLES * 7];
+  for (uint32_t i = 0; i < BENCH_SAMPLES; i++) {
+    raw[i] = mpu6050_sample_t{{static_cast<uint16_t>(i * 7), static_cast<uint16_t>(i),
+                               static_cast<uint16_t>(i * 3)},
+                              static_cast<uint16_t>(i),
+                              {static_cast<uint16_t>(i), static_cast<uint16_t>(i * 5),
+                               static_cast<uint16_t>(i * 11)}};
+  }
+
+  /* The same device behind the wrapper and behind a C handle, each on its own bus */
+  static i2c_sim_bus_t bus[2];
+  static i2c_sim_device_t dev[2];
+  static mpu6050_t hmpu;
+  bench_bus(bus[0], dev[0]);
+  bench_bus(bus[1], dev[1]);
+  Imu imu(bus[0]);
+  CHECK(imu.init() == MPU6050_OK);
+  CHECK(mpu6050_init(&hmpu, &bus[1], Imu::address) == MPU6050_OK);
+  CHECK(mpu6050_reset_pwrmgmt(&hmpu) == MPU6050_OK);
+  CHECK(mpu6050_gyro_set_fullscale(&hmpu, MPU6050_GYRO_CONFIG_500DPS) == MPU6050_OK);
+  CHECK(mpu6050_accel_set_fullscale(&hmpu, MPU6050_ACCEL_CONFIG_4G) == MPU6050_OK);
+  static mpu6050::Sample cpp_read[BENCH_READS];
+  static float c_read[BENCH_READS * 7];
+
+  /* Runs alternate between the loops, so a noisy stretch of the host slows both */
+  double cpp_ns[2] = {0.0, 0.0};
+  double c_ns[2] = {0.0, 0.0};
+  bool read_ok = true;
+  for (uint32_t run = 0; run < BENCH_RUNS; run++) {
+    double ns = bench_run([] { bench_convert_cpp(raw, cpp, BENCH_SAMPLES); }, cpp, BENCH_SAMPLES,
+                          BENCH_REPEATS);
+    if (run == 0 || ns < cpp_ns[0])
+      cpp_ns[0] = ns;
+    ns = bench_run([] { bench_convert_c(raw, c, BENCH_SAMPLES); }, c, BENCH_SAMPLES,
+                   BENCH_REPEATS);
+    if (run == 0 || ns < c_ns[0])
+      c_ns[0] = ns;
+    ns = bench_run([&] { read_ok &= bench_read_cpp(imu, cpp_read, BENCH_READS) == MPU6050_OK; },
+                   cpp_read, BENCH_READS, 1);
+    if (run == 0 || ns < cpp_ns[1])
+      cpp_ns[1] = ns;
+    ns = bench_run([&] { read_ok &= bench_read_c(&hmpu, c_read, BENCH_READS) == MPU6050_OK; },
+                   c_read, BENCH_READS, 1);
+    if (run == 0 || ns < c_ns[1])
+      c_ns[1] = ns;
+  }
+  std::printf("loop,ns_per_sample\nconvert_wrapper,%.3f\nconvert_hand_written_c,%.3f\n"
+              "read_wrapper,%.3f\nread_hand_written_c,%.3f\n",
+              cpp_ns[0], c_ns[0], cpp_ns[1], c_ns[1]);
+
+  CHECK(std::memcmp(cpp, c, sizeof(c)) == 0);
+  CHECK(read_ok);
+  CHECK(std::memcmp(cpp_read, c_read, sizeof(c_read)) == 0);
+  CHECK(cpp_ns[0] <= c_ns[0] * margin);
+  CHECK(cpp_ns[1] <= c_ns[1] * margin);
+  return TEST_RESULT();
+}
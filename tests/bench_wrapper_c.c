@@ -0,0 +1,61 @@
+/**
+ ******************************************************************************
+ * @file           : bench_wrapper_c.c
+ * @author         : Gonzalo Gabriel Fernandez
+ * @brief          : Hand-written C read and conversion, baseline of the C++ wrapper benchmark
+ ******************************************************************************
+ * @attention
+ *
+ * The conversion a C user writes by hand for gyro 500 dps and accel 4 g, the
+ * same float operations as Mpu6050::convert, and the blocking burst read that
+ * feeds it, built by the C compiler with the same options.
+ *
+ ******************************************************************************
+ */
+
+#include "mpu6050.h"
+
+#define BENCH_ACCEL_LSB (4.0f * 9.80665f / 32768.0f)
+#define BENCH_GYRO_LSB (500.0f * 0.017453292519943295f / 32768.0f)
+
+/**
+ * @brief   Convert a raw sample into accel X, Y, Z, temperature, gyro X, Y, Z floats
+ */
+static inline void bench_convert_one(const mpu6050_sample_t *praw, float *psample) {
+  psample[0] = (int16_t)praw->accel[0] * BENCH_ACCEL_LSB;
+  psample[1] = (int16_t)praw->accel[1] * BENCH_ACCEL_LSB;
+  psample[2] = (int16_t)praw->accel[2] * BENCH_ACCEL_LSB;
+  psample[3] = (int16_t)praw->temp * (1.0f / 340.0f) + 36.53f;
+  psample[4] = (int16_t)praw->gyro[0] * BENCH_GYRO_LSB;
+  psample[5] = (int16_t)praw->gyro[1] * BENCH_GYRO_LSB;
+  psample[6] = (int16_t)praw->gyro[2] * BENCH_GYRO_LSB;
+}
+
+/**
+ * @brief   Convert raw samples into accel X, Y, Z, temperature, gyro X, Y, Z floats
+ * @param   praw: Pointer to raw samples
+ * @param   pout: Pointer to buffer where 7 floats per sample will be stored
+ * @param   count: Amount of samples
+ */
+void bench_convert_c(const mpu6050_sample_t *praw, float *pout, uint32_t count) {
+  for (uint32_t i = 0; i < count; i++)
+    bench_convert_one(&praw[i], &pout[7 * i]);
+}
+
+/**
+ * @brief   Blocking burst reads, each converted into 7 floats
+ * @param   hmpu: Pointer to MPU6050 handle
+ * @param   pout: Pointer to buffer where 7 floats per sample will be stored
+ * @param   count: Amount of samples
+ * @retval  mpu6050_status_t of the first read that failed
+ */
+mpu6050_status_t bench_read_c(mpu6050_t *hmpu, float *pout, uint32_t count) {
+  for (uint32_t i = 0; i < count; i++) {
+    mpu6050_sample_t raw;
+    mpu6050_status_t status = mpu6050_read_all_raw(hmpu, &raw);
+    if (status != MPU6050_OK)
+      return status;
+    bench_convert_one(&raw, &pout[7 * i]);
+  }
+  return MPU6050_OK;
+}
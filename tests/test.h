@@ -0,0 +1,73 @@
+/**
+ ******************************************************************************
+ * @file           : test.h
+ * @author         : Gonzalo Gabriel Fernandez
+ * @brief          : MPU6050 host tests helpers
+ ******************************************************************************
+ * @attention
+ *
+ * Checks that report the failing expression and go on, so one run lists
+ * every failure, and the simulated bus set-up shared by the tests. A test
+ * returns TEST_RESULT() from main, non zero if any check failed.
+ *
+ ******************************************************************************
+ */
+
+#ifndef __TEST_H
+#define __TEST_H
+
+#include <stdio.h>
+
+#include "mpu6050.h"
+#include "port_i2c_sim.h"
+
+static unsigned test_failures __attribute__((unused));
+
+#define CHECK(cond)                                                                                \
+  do {                                                                                             \
+    if (!(cond)) {                                                                                 \
+      fprintf(stderr, "%s:%d: check failed: %s\n", __FILE__, __LINE__, #cond);                     \
+      test_failures++;                                                                             \
+    }                                                                                              \
+  } while (0)
+
+#define CHECK_NEAR(value, expected, tolerance)                                                     \
+  do {                                                                                             \
+    double check_value = (value);                                                                  \
+    double check_expected = (expected);                                                            \
+    if (check_value - check_expected > (tolerance) ||                                              \
+        check_expected - check_value > (tolerance)) {                                              \
+      fprintf(stderr, "%s:%d: check failed: %s = %g, expected %g +/- %g\n", __FILE__, __LINE__,    \
+              #value, check_value, check_expected, (double)(tolerance));                           \
+      test_failures++;                                                                             \
+    }                                                                                              \
+  } while (0)
+
+#define TEST_RESULT() (test_failures != 0)
+#define TEST_SKIP 77 /*! Exit status of a test that cannot run on this host */
+
+/**
+ * @brief   Attach a device to a simulated bus, initialize its handle and wake it up
+ * @note    Returns once the device samples, after the gyro start-up time.
+ * @param   pbus: Pointer to initialized simulated bus
+ * @param   pdev: Pointer to simulated device
+ * @param   hmpu: Pointer to MPU6050 handle
+ * @param   address: I2C slave address
+ * @retval  mpu6050_status_t
+ */
+static inline mpu6050_status_t test_device_up(i2c_sim_bus_t *pbus, i2c_sim_device_t *pdev,
+                                              mpu6050_t *hmpu, mpu6050_i2c_address_t address) {
+  i2c_sim_device_init(pdev, (uint8_t)address);
+  if (i2c_sim_attach(pbus, pdev) != MPU6050_OK || mpu6050_init(hmpu, pbus, address) != MPU6050_OK ||
+      mpu6050_reset_pwrmgmt(hmpu) != MPU6050_OK)
+    return MPU6050_ERROR;
+  i2c_sim_run(pbus, I2C_SIM_STARTUP_NS);
+  return MPU6050_OK;
+}
+
+/**
+ * @brief   Signed value of a raw 16-bit measurement
+ */
+static inline int raw16(uint16_t value) { return (int16_t)value; }
+
+#endif /* __TEST_H */
@@ -0,0 +1,141 @@
+/**
+ ******************************************************************************
+ * @file           : test_aux.c
+ * @author         : Gonzalo Gabriel Fernandez
+ * @brief          : Auxiliary I2C master test
+ ******************************************************************************
+ * @attention
+ *
+ * Aux sensors behind the MPU6050 are read in bypass mode, then by the master
+ * with their data in the sample burst and in the FIFO frames, one bus
+ * transaction per sample. Slave 4 register accesses wait for the next
+ * sample, so they complete at the slowest sample rate and in cycle mode, and
+ * time out after a few sample periods when the device does not sample.
+ *
+ ******************************************************************************
+ */
+
+#include <string.h>
+
+#include "port_i2c.h"
+#include "test.h"
+
+#define TEST_MAG_ADDRESS 0x0CU
+#define TEST_BARO_ADDRESS 0x77U
+#define TEST_ABSENT_ADDRESS 0x1EU
+#define TEST_MAG_CNTL 0x0AU
+#define TEST_MAG_DATA 0x03U
+#define TEST_BARO_DATA 0xF7U
+
+/**
+ * @brief   Slave 4 write then read back of an aux register
+ * @retval  Simulated time taken by both accesses
+ */
+static uint64_t test_slv4(i2c_sim_bus_t *pbus, mpu6050_t *hmpu, uint8_t value) {
+  uint64_t start_ns = i2c_sim_now(pbus);
+  uint8_t read_back = 0;
+  CHECK(mpu6050_aux_write(hmpu, TEST_MAG_ADDRESS, TEST_MAG_CNTL, value) == MPU6050_OK);
+  CHECK(mpu6050_aux_read(hmpu, TEST_MAG_ADDRESS, TEST_MAG_CNTL, &read_back) == MPU6050_OK);
+  CHECK(read_back == value);
+  return i2c_sim_now(pbus) - start_ns;
+}
+
+int main(void) {
+  i2c_sim_bus_t bus;
+  i2c_sim_device_t dev;
+  i2c_sim_aux_t mag;
+  i2c_sim_aux_t baro;
+  mpu6050_t imu;
+  i2c_sim_bus_init(&bus, I2C_SIM_SPEED_400KHZ);
+  i2c_sim_aux_init(&mag, TEST_MAG_ADDRESS);
+  i2c_sim_aux_init(&baro, TEST_BARO_ADDRESS);
+  for (uint8_t i = 0; i < 6; i++)
+    mag.regs[TEST_MAG_DATA + i] = 0x10U + i;
+  for (uint8_t i = 0; i < 3; i++)
+    baro.regs[TEST_BARO_DATA + i] = 0xA0U + i;
+  CHECK(test_device_up(&bus, &dev, &imu, MPU6050_I2C_ADDRESS_1) == MPU6050_OK);
+  CHECK(i2c_sim_aux_attach(&dev, &mag) == MPU6050_OK);
+  CHECK(i2c_sim_aux_attach(&dev, &baro) == MPU6050_OK);
+  i2c_sim_set_signal(&dev, I2C_SIM_ACCEL_Z, 16384, 0, 0);
+  CHECK(mpu6050_set_sample_divider(&imu, 9) == MPU6050_OK);
+
+  /* Bypass: the host reaches the aux sensors directly */
+  CHECK(mpu6050_aux_bypass(&imu, true) == MPU6050_OK);
+  uint8_t data[6];
+  CHECK(i2c_burst_read(&bus, TEST_MAG_ADDRESS << 1, TEST_MAG_DATA, data, 6) == MPU6050_OK);
+  CHECK(data[0] == 0x10U && data[5] == 0x15U);
+
+  /* Slave 4 accesses and a NACK from an absent sensor */
+  CHECK(mpu6050_aux_master_enable(&imu, MPU6050_AUX_CLOCK_400KHZ) == MPU6050_OK);
+  test_slv4(&bus, &imu, 0x16U);
+  uint8_t value;
+  CHECK(mpu6050_aux_read(&imu, TEST_ABSENT_ADDRESS, 0x00, &value) != MPU6050_OK);
+
+  /* Sensor data in the sample burst, byte swapped magnetometer */
+  const mpu6050_aux_slave_t slave_mag = {
+      .address = TEST_MAG_ADDRESS, .reg_address = TEST_MAG_DATA, .length = 6, .byte_swap = true};
+  const mpu6050_aux_slave_t slave_baro = {
+      .address = TEST_BARO_ADDRESS, .reg_address = TEST_BARO_DATA, .length = 3};
+  CHECK(mpu6050_aux_slave_config(&imu, 0, &slave_mag) == MPU6050_OK);
+  CHECK(mpu6050_aux_slave_config(&imu, 1, &slave_baro) == MPU6050_OK);
+  CHECK(mpu6050_aux_ext_len(&imu) == 9);
+  CHECK(mpu6050_aux_slave_offset(&imu, 1) == 6);
+  const mpu6050_aux_slave_t slave_big = {.address = TEST_BARO_ADDRESS, .length = 16};
+  CHECK(mpu6050_aux_slave_config(&imu, 2, &slave_big) != MPU6050_OK);
+  static const uint8_t expected[9] = {0x11, 0x10, 0x13, 0x12, 0x15, 0x14, 0xA0, 0xA1, 0xA2};
+  i2c_sim_run(&bus, 20000000U);
+  i2c_sim_stats_reset(&bus);
+  mpu6050_sample_t sample;
+  uint8_t ext[24];
+  for (uint32_t i = 0; i < 10; i++) {
+    CHECK(mpu6050_read_all_ext(&imu, &sample, ext) == MPU6050_OK);
+    i2c_sim_run(&bus, 10000000U);
+  }
+  CHECK(bus.stats.transactions == 10);
+  CHECK(memcmp(ext, expected, sizeof(expected)) == 0);
+  CHECK(raw16(sample.accel[2]) == 16384);
+
+  /* FIFO frames carry the aux data too */
+  CHECK(mpu6050_fifo_enable(&imu, MPU6050_FIFO_SEL_ACCEL | MPU6050_FIFO_SEL_SLV0 |
+                                      MPU6050_FIFO_SEL_SLV1) == MPU6050_OK);
+  CHECK(mpu6050_fifo_frame_size(&imu) == 15);
+  i2c_sim_run(&bus, 50000000U);
+  static uint8_t buffer[1024];
+  uint16_t frames;
+  CHECK(mpu6050_fifo_drain(&imu, buffer, sizeof(buffer), &frames) == MPU6050_OK);
+  CHECK(frames >= 4);
+  memset(ext, 0, sizeof(ext));
+  CHECK(mpu6050_fifo_parse_ext(&imu, &buffer[(frames - 1U) * 15U], ext) == MPU6050_OK);
+  CHECK(memcmp(ext, expected, sizeof(expected)) == 0);
+  CHECK(mpu6050_fifo_disable(&imu) == MPU6050_OK);
+
+  /* Slowest sample rate, about 256 ms per sample */
+  CHECK(mpu6050_set_dlpf(&imu, MPU6050_DLPF_44HZ) == MPU6050_OK);
+  CHECK(mpu6050_set_sample_divider(&imu, 255) == MPU6050_OK);
+  uint64_t elapsed_ns = test_slv4(&bus, &imu, 0x11U);
+  CHECK(elapsed_ns > 256000000U);
+
+  /* Cycle mode at 1.25 Hz, 800 ms per sample */
+  CHECK(mpu6050_cycle_start(&imu, MPU6050_LP_WAKE_1_25HZ) == MPU6050_OK);
+  elapsed_ns = test_slv4(&bus, &imu, 0x12U);
+  CHECK(elapsed_ns > 800000000U);
+  CHECK(mpu6050_cycle_stop(&imu) == MPU6050_OK);
+
+  /* Sleeping device: no sample, the access times out after two sample periods */
+  CHECK(mpu6050_set_sample_divider(&imu, 9) == MPU6050_OK);
+  const mpu6050_init_step_t sleep[] = {
+      MPU6050_INIT_REG(MPU6050_PWR_MGMT_1, 1U << MPU6050_PWR1_SLEEP_OFFSET),
+  };
+  CHECK(mpu6050_init_table(&imu, sleep, 1, MPU6050_INIT_TIMEOUT_US) == MPU6050_OK);
+  uint64_t start_ns = i2c_sim_now(&bus);
+  CHECK(mpu6050_aux_write(&imu, TEST_MAG_ADDRESS, TEST_MAG_CNTL, 0x00) == MPU6050_ERROR_TIMEOUT);
+  elapsed_ns = i2c_sim_now(&bus) - start_ns;
+  CHECK(elapsed_ns >= 20000000U && elapsed_ns < 21000000U);
+  CHECK(mpu6050_reset_pwrmgmt(&imu) == MPU6050_OK);
+
+  /* Back to bypass, the host reaches the sensors again */
+  CHECK(mpu6050_aux_bypass(&imu, true) == MPU6050_OK);
+  CHECK(i2c_reg_read(&bus, TEST_MAG_ADDRESS << 1, TEST_MAG_CNTL, &value) == MPU6050_OK);
+  CHECK(value == 0x12U);
+  return TEST_RESULT();
+}
@@ -0,0 +1,65 @@
+/**
+ ******************************************************************************
+ * @file           : test_burst_read.c
+ * @author         : Gonzalo Gabriel Fernandez
+ * @brief          : Combined burst read test
+ ******************************************************************************
+ * @attention
+ *
+ * A combined read of accel, temperature and gyro is a single 14-byte
+ * transaction, blocking or non-blocking, and decodes every channel of the
+ * same sample.
+ *
+ ******************************************************************************
+ */
+
+#include "test.h"
+
+int main(void) {
+  static const float offsets[I2C_SIM_CHANNELS] = {-1200, 800, 16384, -3000, 25, -130, 4000};
+  i2c_sim_bus_t bus;
+  i2c_sim_device_t dev;
+  mpu6050_t imu;
+  i2c_sim_bus_init(&bus, I2C_SIM_SPEED_400KHZ);
+  CHECK(test_device_up(&bus, &dev, &imu, MPU6050_I2C_ADDRESS_1) == MPU6050_OK);
+  for (uint8_t ch = 0; ch < I2C_SIM_CHANNELS; ch++)
+    i2c_sim_set_signal(&dev, (i2c_sim_channel_t)ch, offsets[ch], 0, 0);
+  i2c_sim_run(&bus, 2000000U);
+
+  /* Blocking: one transaction, 14 data bytes, every channel decoded */
+  mpu6050_sample_t sample;
+  i2c_sim_stats_reset(&bus);
+  CHECK(mpu6050_read_all_raw(&imu, &sample) == MPU6050_OK);
+  CHECK(bus.stats.transactions == 1);
+  CHECK(bus.stats.bytes_read == MPU6050_SENSOR_DATA_LEN);
+  for (uint8_t axis = 0; axis < 3; axis++) {
+    CHECK(raw16(sample.accel[axis]) == (int)offsets[I2C_SIM_ACCEL_X + axis]);
+    CHECK(raw16(sample.gyro[axis]) == (int)offsets[I2C_SIM_GYRO_X + axis]);
+  }
+  CHECK(raw16(sample.temp) == (int)offsets[I2C_SIM_TEMP]);
+
+  /* Non-blocking: one queued transaction per sample as well */
+  const uint32_t reads = 100;
+  i2c_sim_stats_reset(&bus);
+  for (uint32_t i = 0; i < reads; i++) {
+    CHECK(mpu6050_fetch_all(&imu) == MPU6050_OK);
+    i2c_sim_run(&bus, 1000000U);
+    CHECK(mpu6050_is_data_ready(&imu));
+    mpu6050_sample_t fetched;
+    CHECK(mpu6050_read_all_from_buffer(&imu, &fetched) == MPU6050_OK);
+    CHECK(raw16(fetched.accel[2]) == (int)offsets[I2C_SIM_ACCEL_Z]);
+    CHECK(raw16(fetched.gyro[2]) == (int)offsets[I2C_SIM_GYRO_Z]);
+  }
+  CHECK(bus.stats.transactions == reads);
+  CHECK(bus.stats.bytes_read == reads * MPU6050_SENSOR_DATA_LEN);
+
+  /* A changing signal: accel and gyro of a read come from the same sample */
+  i2c_sim_set_signal(&dev, I2C_SIM_ACCEL_X, 0, 10000, 37);
+  i2c_sim_set_signal(&dev, I2C_SIM_GYRO_X, 0, 10000, 37);
+  for (uint32_t i = 0; i < reads; i++) {
+    i2c_sim_run(&bus, 1300000U);
+    CHECK(mpu6050_read_all_raw(&imu, &sample) == MPU6050_OK);
+    CHECK(sample.accel[0] == sample.gyro[0]);
+  }
+  return TEST_RESULT();
+}
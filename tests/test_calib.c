@@ -0,0 +1,119 @@
+/**
+ ******************************************************************************
+ * @file           : test_calib.c
+ * @author         : Gonzalo Gabriel Fernandez
+ * @brief          : Calibration into the offset registers test
+ ******************************************************************************
+ * @attention
+ *
+ * A calibration at rest removes the simulated bias in the device, the blob
+ * holds the offset registers content and restores it after a power cycle.
+ * Each set of three offsets is written in one burst. A blob with a bad
+ * marker or checksum is refused and leaves the registers as they were.
+ *
+ ******************************************************************************
+ */
+
+#include <string.h>
+
+#include "mpu6050_calib.h"
+#include "test.h"
+
+#define TEST_ACCEL_TOLERANCE 16 /*! One offset count with the reserved bit, at 2 g full scale */
+#define TEST_GYRO_TOLERANCE 5   /*! With the 3 count tone on X */
+
+/**
+ * @brief   Simulated bias at rest, 1 g on Z
+ */
+static void test_bias(i2c_sim_device_t *pdev) {
+  i2c_sim_set_signal(pdev, I2C_SIM_ACCEL_X, 300, 0, 0);
+  i2c_sim_set_signal(pdev, I2C_SIM_ACCEL_Y, -200, 0, 0);
+  i2c_sim_set_signal(pdev, I2C_SIM_ACCEL_Z, 16384 + 500, 0, 0);
+  i2c_sim_set_signal(pdev, I2C_SIM_GYRO_X, 40, 3, 50);
+  i2c_sim_set_signal(pdev, I2C_SIM_GYRO_Y, -77, 0, 0);
+  i2c_sim_set_signal(pdev, I2C_SIM_GYRO_Z, 13, 0, 0);
+}
+
+/**
+ * @brief   Check a sample has the bias removed
+ */
+static void test_check_unbiased(const mpu6050_sample_t *psample) {
+  CHECK_NEAR(raw16(psample->accel[0]), 0, TEST_ACCEL_TOLERANCE);
+  CHECK_NEAR(raw16(psample->accel[1]), 0, TEST_ACCEL_TOLERANCE);
+  CHECK_NEAR(raw16(psample->accel[2]), 16384, TEST_ACCEL_TOLERANCE);
+  for (uint8_t axis = 0; axis < 3; axis++)
+    CHECK_NEAR(raw16(psample->gyro[axis]), 0, TEST_GYRO_TOLERANCE);
+}
+
+/**
+ * @brief   Offset registers of a device
+ */
+static void test_read_offsets(const i2c_sim_device_t *pdev, uint8_t reg_address,
+                              int16_t *poffsets) {
+  for (uint8_t axis = 0; axis < 3; axis++)
+    poffsets[axis] = (int16_t)(((uint16_t)pdev->regs[reg_address + 2 * axis] << 8) |
+                               pdev->regs[reg_address + 2 * axis + 1]);
+}
+
+int main(void) {
+  i2c_sim_bus_t bus;
+  i2c_sim_device_t dev;
+  mpu6050_t imu;
+  i2c_sim_bus_init(&bus, I2C_SIM_SPEED_400KHZ);
+  i2c_sim_device_init(&dev, MPU6050_I2C_ADDRESS_1);
+  test_bias(&dev);
+  CHECK(i2c_sim_attach(&bus, &dev) == MPU6050_OK);
+  CHECK(mpu6050_init(&imu, &bus, MPU6050_I2C_ADDRESS_1) == MPU6050_OK);
+  CHECK(mpu6050_reset_pwrmgmt(&imu) == MPU6050_OK);
+  i2c_sim_run(&bus, I2C_SIM_STARTUP_NS);
+
+  /* Calibration at rest: the device removes the bias */
+  mpu6050_calib_acc_t acc;
+  mpu6050_calib_t calib;
+  CHECK(mpu6050_calib_run(&imu, 500, &acc, &calib) == MPU6050_OK);
+  CHECK(acc.count == 500);
+  CHECK_NEAR(acc.mean[0], 300.0, 0.5);
+  CHECK_NEAR(acc.mean[5], 13.0, 0.5);
+  CHECK(calib.magic == MPU6050_CALIB_MAGIC);
+  int16_t offsets[3];
+  test_read_offsets(&dev, MPU6050_XA_OFFS_H, offsets);
+  CHECK(memcmp(offsets, calib.accel_offset, sizeof(offsets)) == 0);
+  test_read_offsets(&dev, MPU6050_XG_OFFS_USRH, offsets);
+  CHECK(memcmp(offsets, calib.gyro_offset, sizeof(offsets)) == 0);
+  i2c_sim_run(&bus, 2000000U);
+  mpu6050_sample_t sample;
+  CHECK(mpu6050_read_all_raw(&imu, &sample) == MPU6050_OK);
+  test_check_unbiased(&sample);
+
+  /* Three offsets, one burst write */
+  i2c_sim_stats_reset(&bus);
+  CHECK(mpu6050_gyro_write_offsets(&imu, calib.gyro_offset) == MPU6050_OK);
+  CHECK(bus.stats.transactions == 1);
+  CHECK(bus.stats.bytes_read == 0);
+
+  /* Power cycle clears the offsets, the blob restores them */
+  i2c_sim_device_init(&dev, MPU6050_I2C_ADDRESS_1);
+  test_bias(&dev);
+  CHECK(mpu6050_shadow_resync(&imu) == MPU6050_OK);
+  CHECK(mpu6050_reset_pwrmgmt(&imu) == MPU6050_OK);
+  i2c_sim_run(&bus, I2C_SIM_STARTUP_NS);
+  CHECK(mpu6050_calib_restore(&imu, &calib) == MPU6050_OK);
+  test_read_offsets(&dev, MPU6050_XG_OFFS_USRH, offsets);
+  CHECK(memcmp(offsets, calib.gyro_offset, sizeof(offsets)) == 0);
+  i2c_sim_run(&bus, 2000000U);
+  CHECK(mpu6050_read_all_raw(&imu, &sample) == MPU6050_OK);
+  test_check_unbiased(&sample);
+
+  /* Corrupt blobs are refused before any write */
+  mpu6050_calib_t corrupt = calib;
+  corrupt.gyro_offset[0]++;
+  i2c_sim_stats_reset(&bus);
+  CHECK(mpu6050_calib_restore(&imu, &corrupt) != MPU6050_OK);
+  corrupt = calib;
+  corrupt.magic = 0;
+  CHECK(mpu6050_calib_restore(&imu, &corrupt) != MPU6050_OK);
+  CHECK(bus.stats.transactions == 0);
+  test_read_offsets(&dev, MPU6050_XG_OFFS_USRH, offsets);
+  CHECK(memcmp(offsets, calib.gyro_offset, sizeof(offsets)) == 0);
+  return TEST_RESULT();
+}
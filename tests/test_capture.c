@@ -0,0 +1,199 @@
+/**
+ ******************************************************************************
+ * @file           : test_capture.c
+ * @author         : Gonzalo Gabriel Fernandez
+ * @brief          : Binary capture writer and reader test
+ ******************************************************************************
+ * @attention
+ *
+ * Samples and timestamps come back from a capture bit for bit, full-scale
+ * jumps and irregular intervals included, the header keeps the device
+ * configuration, seek finds the first sample at or after a time, a corrupt
+ * block is skipped with the rest decoded, and a failing sink counts its
+ * lost blocks. On Linux the same capture is read back through mmap.
+ *
+ ******************************************************************************
+ */
+
+#include <stdlib.h>
+#include <string.h>
+#if defined(__linux__)
+#include <unistd.h>
+#endif
+
+#include "mpu6050_capture.h"
+#include "test.h"
+
+#define TEST_SAMPLES 20000U
+#define TEST_PERIOD_NS 1000000U
+#define TEST_STORAGE_BLOCKS 1024U
+
+/**
+ * @brief Block storage in memory, the sink context
+ */
+typedef struct {
+  uint8_t data[TEST_STORAGE_BLOCKS * MPU6050_CAPTURE_BLOCK_SIZE];
+  size_t size; /*!< Bytes written */
+  bool fail;   /*!< Refuse the blocks, as a full card */
+
+} test_storage_t;
+
+static test_storage_t storage;
+static mpu6050_sample_t samples[TEST_SAMPLES];
+static uint64_t timestamps[TEST_SAMPLES];
+
+/**
+ * @brief   Sink appending the blocks to the storage
+ */
+static mpu6050_status_t test_sink(void *pcontext, const uint8_t *pblock, uint16_t size) {
+  test_storage_t *pstorage = pcontext;
+  CHECK(size == MPU6050_CAPTURE_BLOCK_SIZE);
+  if (pstorage->fail || pstorage->size + size > sizeof(pstorage->data))
+    return MPU6050_ERROR;
+  memcpy(&pstorage->data[pstorage->size], pblock, size);
+  pstorage->size += size;
+  return MPU6050_OK;
+}
+
+/**
+ * @brief   Decode the whole capture and compare it with the samples written
+ * @retval  Samples decoded
+ */
+static uint32_t test_decode(mpu6050_capture_reader_t *preader, uint32_t *pmismatches) {
+  mpu6050_sample_t sample;
+  uint64_t timestamp_ns;
+  uint32_t count = 0;
+  *pmismatches = 0;
+  mpu6050_capture_rewind(preader);
+  while (mpu6050_capture_next(preader, &sample, &timestamp_ns)) {
+    if (count >= TEST_SAMPLES || memcmp(&sample, &samples[count], sizeof(sample)) != 0 ||
+        timestamp_ns != timestamps[count])
+      (*pmismatches)++;
+    count++;
+  }
+  return count;
+}
+
+int main(void) {
+  /* Noisy signals, a full-scale step every 1000 samples, jittered intervals and one gap */
+  srand(1);
+  uint64_t time_ns = 1000000000ULL;
+  for (uint32_t i = 0; i < TEST_SAMPLES; i++) {
+    uint16_t *pvalue = &samples[i].accel[0];
+    for (uint32_t c = 0; c < MPU6050_CAPTURE_CHANNELS; c++)
+      pvalue[c] = (uint16_t)(int16_t)((c == 2 ? 16384 : 0) + (int)(c * 100U) + rand() % 9 - 4);
+    if (i % 1000U == 500U)
+      samples[i].gyro[0] = (i % 2000U == 500U) ? 0x7FFFU : 0x8000U;
+    time_ns += TEST_PERIOD_NS + (uint64_t)(rand() % 2000) - 1000U;
+    if (i == TEST_SAMPLES / 3U)
+      time_ns += 250000000U;
+    timestamps[i] = time_ns;
+  }
+
+  /* Configuration of a device at 500 Hz, ±500 dps and ±4 g */
+  i2c_sim_bus_t bus;
+  i2c_sim_device_t dev;
+  mpu6050_t imu;
+  i2c_sim_bus_init(&bus, I2C_SIM_SPEED_400KHZ);
+  CHECK(test_device_up(&bus, &dev, &imu, MPU6050_I2C_ADDRESS_1) == MPU6050_OK);
+  CHECK(mpu6050_gyro_set_fullscale(&imu, MPU6050_GYRO_CONFIG_500DPS) == MPU6050_OK);
+  CHECK(mpu6050_accel_set_fullscale(&imu, MPU6050_ACCEL_CONFIG_4G) == MPU6050_OK);
+  CHECK(mpu6050_set_dlpf(&imu, MPU6050_DLPF_94HZ) == MPU6050_OK);
+  CHECK(mpu6050_set_sample_divider(&imu, 1) == MPU6050_OK);
+  mpu6050_capture_config_t config;
+  CHECK(mpu6050_capture_config_read(&imu, &config) == MPU6050_OK);
+  CHECK(config.gyro_fs == MPU6050_GYRO_CONFIG_500DPS);
+  CHECK(config.accel_fs == MPU6050_ACCEL_CONFIG_4G);
+  CHECK(config.dlpf == MPU6050_DLPF_94HZ && config.sample_divider == 1);
+  CHECK(config.sample_period_ns == 2000000U);
+  config.source = 42;
+
+  /* Write, fixed-size blocks only */
+  static uint8_t block[MPU6050_CAPTURE_BLOCK_SIZE];
+  mpu6050_capture_t cap;
+  CHECK(mpu6050_capture_init(&cap, block, MPU6050_CAPTURE_SAMPLE_MAX, test_sink, &storage) !=
+        MPU6050_OK);
+  CHECK(mpu6050_capture_init(&cap, block, sizeof(block), test_sink, &storage) == MPU6050_OK);
+  CHECK(mpu6050_capture_start(&cap, &config) == MPU6050_OK);
+  for (uint32_t i = 0; i < TEST_SAMPLES; i++)
+    CHECK(mpu6050_capture_add(&cap, &samples[i], timestamps[i]) == MPU6050_OK);
+  CHECK(mpu6050_capture_flush(&cap) == MPU6050_OK);
+  CHECK(cap.samples == TEST_SAMPLES && cap.blocks_lost == 0);
+  CHECK(storage.size % MPU6050_CAPTURE_BLOCK_SIZE == 0);
+  /* Well under the 22 bytes of a raw sample and its timestamp */
+  CHECK((double)storage.size / TEST_SAMPLES < 12.0);
+
+  /* Read back bit for bit, header included */
+  mpu6050_capture_reader_t reader;
+  CHECK(mpu6050_capture_open(&reader, storage.data, storage.size) == MPU6050_OK);
+  CHECK(memcmp(&reader.config, &config, sizeof(config)) == 0);
+  CHECK(reader.blocks == storage.size / MPU6050_CAPTURE_BLOCK_SIZE - 1U);
+  uint32_t mismatches;
+  CHECK(test_decode(&reader, &mismatches) == TEST_SAMPLES);
+  CHECK(mismatches == 0);
+  CHECK(reader.blocks_bad == 0);
+
+  /* Seek: exact time, just before a sample, in the gap, before the start, past the end */
+  static const uint32_t targets[] = {0, 1, TEST_SAMPLES / 2U, TEST_SAMPLES / 3U + 1U,
+                                     TEST_SAMPLES - 1U};
+  for (uint32_t i = 0; i < sizeof(targets) / sizeof(targets[0]); i++) {
+    uint32_t k = targets[i];
+    mpu6050_sample_t sample;
+    uint64_t timestamp_ns;
+    CHECK(mpu6050_capture_seek(&reader, timestamps[k]) == MPU6050_OK);
+    CHECK(mpu6050_capture_next(&reader, &sample, &timestamp_ns));
+    CHECK(timestamp_ns == timestamps[k] && memcmp(&sample, &samples[k], sizeof(sample)) == 0);
+    CHECK(mpu6050_capture_seek(&reader, timestamps[k] - 1U) == MPU6050_OK);
+    CHECK(mpu6050_capture_next(&reader, &sample, &timestamp_ns));
+    CHECK(timestamp_ns == timestamps[k]);
+  }
+  uint64_t timestamp_ns;
+  mpu6050_sample_t sample;
+  CHECK(mpu6050_capture_seek(&reader, timestamps[TEST_SAMPLES / 3U] + 1000U) == MPU6050_OK);
+  CHECK(mpu6050_capture_next(&reader, &sample, &timestamp_ns));
+  CHECK(timestamp_ns == timestamps[TEST_SAMPLES / 3U + 1U]);
+  CHECK(mpu6050_capture_seek(&reader, 0) == MPU6050_OK);
+  CHECK(mpu6050_capture_next(&reader, &sample, &timestamp_ns));
+  CHECK(timestamp_ns == timestamps[0]);
+  CHECK(mpu6050_capture_seek(&reader, timestamps[TEST_SAMPLES - 1U] + 1U) != MPU6050_OK);
+
+#if defined(__linux__)
+  /* The same capture from a file through mmap */
+  char path[] = "/tmp/test_capture_XXXXXX";
+  int fd = mkstemp(path);
+  CHECK(fd >= 0);
+  if (fd >= 0) {
+    CHECK(write(fd, storage.data, storage.size) == (ssize_t)storage.size);
+    close(fd);
+    mpu6050_capture_reader_t mapped;
+    CHECK(mpu6050_capture_map(&mapped, path) == MPU6050_OK);
+    CHECK(test_decode(&mapped, &mismatches) == TEST_SAMPLES);
+    CHECK(mismatches == 0);
+    mpu6050_capture_unmap(&mapped);
+    unlink(path);
+  }
+  CHECK(mpu6050_capture_map(&reader, "/nonexistent/capture.bin") != MPU6050_OK);
+#endif
+
+  /* A corrupt data block, the eleventh, is skipped and the blocks after it still decode */
+  storage.data[(10U + 1U) * MPU6050_CAPTURE_BLOCK_SIZE + 100U] ^= 0x55U;
+  CHECK(mpu6050_capture_open(&reader, storage.data, storage.size) == MPU6050_OK);
+  uint32_t decoded = test_decode(&reader, &mismatches);
+  CHECK(reader.blocks_bad == 1);
+  CHECK(decoded < TEST_SAMPLES && decoded > TEST_SAMPLES - 100U);
+  CHECK(mismatches > 0);
+
+  /* A bad header is refused */
+  storage.data[0] ^= 0xFFU;
+  CHECK(mpu6050_capture_open(&reader, storage.data, storage.size) != MPU6050_OK);
+
+  /* A failing sink loses blocks and says so */
+  storage.size = 0;
+  storage.fail = true;
+  CHECK(mpu6050_capture_start(&cap, &config) != MPU6050_OK);
+  uint32_t errors = 0;
+  for (uint32_t i = 0; i < 1000U; i++)
+    errors += mpu6050_capture_add(&cap, &samples[i], timestamps[i]) != MPU6050_OK;
+  CHECK(errors > 0 && cap.blocks_lost == errors);
+  return TEST_RESULT();
+}
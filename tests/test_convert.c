@@ -0,0 +1,87 @@
+/**
+ ******************************************************************************
+ * @file           : test_convert.c
+ * @author         : Gonzalo Gabriel Fernandez
+ * @brief          : Conversion kernels test
+ ******************************************************************************
+ * @attention
+ *
+ * The vector kernels convert raw frames and decoded samples bit for bit as
+ * the scalar path, raw * scale + offset in float, over whole blocks and the
+ * tail. Built once per instruction set, with the scalar build as baseline.
+ * Q16.16 values are checked against the exact value in double.
+ *
+ ******************************************************************************
+ */
+
+#include <stdlib.h>
+#include <string.h>
+
+#include "mpu6050_convert.h"
+#include "test.h"
+
+#define TEST_FRAMES 1003U /*! Not a multiple of the vector block, the tail is converted too */
+
+int main(void) {
+#if defined(__AVX2__) && defined(__x86_64__)
+  if (!__builtin_cpu_supports("avx2"))
+    return TEST_SKIP;
+#endif
+  static uint8_t frames[TEST_FRAMES * MPU6050_SENSOR_DATA_LEN];
+  static int16_t values[TEST_FRAMES * MPU6050_CONVERT_CHANNELS];
+  static mpu6050_sample_t samples[TEST_FRAMES];
+  static mpu6050_si_sample_t si[TEST_FRAMES];
+  static mpu6050_si_sample_t si_samples[TEST_FRAMES];
+  static mpu6050_q16_sample_t q16[TEST_FRAMES];
+  static mpu6050_q16_sample_t q16_samples[TEST_FRAMES];
+
+  srand(6050);
+  for (uint32_t i = 0; i < sizeof(frames); i++)
+    frames[i] = (uint8_t)rand();
+  /* Full scale ends */
+  memcpy(frames, "\x7F\xFF\x80\x00\xFF\xFF\x00\x00\x00\x01\x80\x01\x7F\xFE", 14);
+
+  mpu6050_convert_scale_t scale;
+  mpu6050_convert_scale(MPU6050_GYRO_CONFIG_2000DPS, MPU6050_ACCEL_CONFIG_4G, &scale);
+  mpu6050_convert_frames_int16(frames, TEST_FRAMES, values);
+  mpu6050_convert_frames_si(frames, TEST_FRAMES, &scale, si);
+  mpu6050_convert_frames_q16(frames, TEST_FRAMES, &scale, q16);
+  for (uint32_t i = 0; i < TEST_FRAMES; i++)
+    memcpy(&samples[i], &values[i * MPU6050_CONVERT_CHANNELS], sizeof(samples[i]));
+  mpu6050_convert_samples_si(samples, TEST_FRAMES, &scale, si_samples);
+  mpu6050_convert_samples_q16(samples, TEST_FRAMES, &scale, q16_samples);
+
+  uint32_t int16_errors = 0;
+  uint32_t si_errors = 0;
+  double q16_max_error = 0.0;
+  for (uint32_t i = 0; i < TEST_FRAMES; i++) {
+    const float *pfloat = (const float *)&si[i];
+    const int32_t *pfixed = (const int32_t *)&q16[i];
+    for (uint8_t ch = 0; ch < MPU6050_CONVERT_CHANNELS; ch++) {
+      const uint8_t *praw = &frames[i * MPU6050_SENSOR_DATA_LEN + 2U * ch];
+      int16_t raw = (int16_t)((praw[0] << 8) | praw[1]);
+      if (values[i * MPU6050_CONVERT_CHANNELS + ch] != raw)
+        int16_errors++;
+      float expected = (float)raw * scale.scale[ch] + scale.offset[ch];
+      if (memcmp(&pfloat[ch], &expected, sizeof(expected)) != 0)
+        si_errors++;
+      double exact = raw * (double)scale.scale[ch] + scale.offset[ch];
+      double error = pfixed[ch] / 65536.0 - exact;
+      if (error < 0)
+        error = -error;
+      if (error > q16_max_error)
+        q16_max_error = error;
+    }
+  }
+  CHECK(int16_errors == 0);
+  CHECK(si_errors == 0);
+  CHECK(q16_max_error < 2e-5);
+  CHECK(memcmp(si, si_samples, sizeof(si)) == 0);
+  CHECK(memcmp(q16, q16_samples, sizeof(q16)) == 0);
+
+  /* 1 g at 4 g full scale, 1 dps at 2000 dps full scale, 25 Celsius */
+  CHECK_NEAR(8192 * scale.scale[2], 9.80665, 1e-5);
+  CHECK_NEAR(16.384f * scale.scale[4], 0.0174533, 1e-6);
+  CHECK_NEAR((25.0f - 36.53f) * 340.0f * scale.scale[3] + scale.offset[3], 25.0, 1e-4);
+  return TEST_RESULT();
+}
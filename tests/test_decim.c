@@ -0,0 +1,188 @@
+/**
+ ******************************************************************************
+ * @file           : test_decim.c
+ * @author         : Gonzalo Gabriel Fernandez
+ * @brief          : Anti-alias decimation frequency response and bit exactness test
+ ******************************************************************************
+ * @attention
+ *
+ * Tones on gyro X at 8 kHz are decimated by 8 with the 64 and 128 tap
+ * designs. DC passes unchanged, the pass band stays flat, and tones that
+ * keeping one sample in eight would fold into the pass band come out at
+ * least TEST_STOP_DB down. Every output matches a direct form reference
+ * FIR bit for bit, saturation included, whatever the block split. Built
+ * once per instruction set, with the scalar build as baseline.
+ *
+ ******************************************************************************
+ */
+
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "mpu6050_decim.h"
+#include "test.h"
+
+#define TEST_RATE_HZ 8000.0
+#define TEST_RATIO 8U
+#define TEST_TONE_SAMPLES 16384U /*! 2 s of input, 2048 outputs */
+#define TEST_AMPLITUDE 10000.0
+#define TEST_PASS_DB 0.2   /*! Pass band ripple allowed */
+#define TEST_STOP_DB -65.0 /*! Alias attenuation required */
+#define TEST_RANDOM_SAMPLES 20000U
+#define TEST_MAX_BLOCK 77U
+
+/**
+ * @brief Design under test, its flat pass band and its alias free band
+ */
+typedef struct {
+  uint16_t taps;
+  double pass_hz;         /*!< Flat to this frequency */
+  const double *pstop_hz; /*!< Tones folding into the pass band, zero ended */
+
+} test_design_t;
+
+static mpu6050_sample_t in[TEST_RANDOM_SAMPLES];
+static mpu6050_sample_t out[TEST_RANDOM_SAMPLES / TEST_RATIO + 1U];
+static mpu6050_sample_t ref[TEST_RANDOM_SAMPLES / TEST_RATIO + 1U];
+
+/**
+ * @brief   Gain of a gyro X tone through the decimator
+ * @retval  Output RMS over input RMS in dB, once the filter has settled
+ */
+static double test_tone_db(mpu6050_decim_t *pdecim, double freq_hz) {
+  mpu6050_decim_reset(pdecim);
+  memset(in, 0, sizeof(in));
+  double sum = 0.0;
+  uint32_t count = 0;
+  for (uint32_t n = 0; n < TEST_TONE_SAMPLES; n += TEST_RATIO) {
+    /* Odd phase, so no tone is sampled on its zero crossings only */
+    for (uint32_t k = 0; k < TEST_RATIO; k++) {
+      double phase = 2.0 * M_PI * freq_hz * (n + k) / TEST_RATE_HZ + 0.3;
+      double value = freq_hz == 0.0 ? TEST_AMPLITUDE : TEST_AMPLITUDE * cos(phase);
+      in[k].gyro[0] = (uint16_t)(int16_t)lrint(value);
+    }
+    if (mpu6050_decim_process(pdecim, in, TEST_RATIO, out) != 1U)
+      return 0.0;
+    if (n < MPU6050_DECIM_MAX_TAPS)
+      continue;
+    double value = raw16(out[0].gyro[0]);
+    sum += value * value;
+    count++;
+  }
+  double rms = sqrt(sum / count);
+  double in_rms = freq_hz == 0.0 ? TEST_AMPLITUDE : TEST_AMPLITUDE / sqrt(2.0);
+  return 20.0 * log10(rms / in_rms + 1e-12);
+}
+
+/**
+ * @brief   Direct form reference: h[0] on the newest sample, zero history, 64-bit accumulation
+ * @retval  Amount of output samples
+ */
+static uint32_t test_reference(const int16_t *pcoeffs, uint16_t taps, uint8_t ratio, uint8_t sel,
+                               const mpu6050_sample_t *psamples, uint32_t count,
+                               mpu6050_sample_t *pout) {
+  uint32_t produced = 0;
+  for (uint32_t n = ratio - 1U; n < count; n += ratio) {
+    uint16_t value[MPU6050_DECIM_CHANNELS];
+    memcpy(value, &psamples[n], sizeof(value));
+    for (uint8_t ch = 0; ch < MPU6050_DECIM_CHANNELS; ch++) {
+      if (!(sel & (1U << ch)))
+        continue;
+      int64_t acc = 0;
+      for (uint16_t k = 0; k < taps && k <= n; k++) {
+        uint16_t past[MPU6050_DECIM_CHANNELS];
+        memcpy(past, &psamples[n - k], sizeof(past));
+        acc += (int64_t)pcoeffs[k] * (int16_t)past[ch];
+      }
+      acc = (acc + (1 << 14)) >> 15;
+      if (acc > INT16_MAX)
+        acc = INT16_MAX;
+      if (acc < INT16_MIN)
+        acc = INT16_MIN;
+      value[ch] = (uint16_t)(int16_t)acc;
+    }
+    memcpy(&pout[produced++], value, sizeof(value));
+  }
+  return produced;
+}
+
+/**
+ * @brief   Decimate the random input in random blocks and compare with the reference
+ * @retval  Mismatching output samples
+ */
+static uint32_t test_bit_exact(mpu6050_decim_t *pdecim, const int16_t *pcoeffs, uint16_t taps,
+                               uint8_t sel) {
+  CHECK(mpu6050_decim_init(pdecim, TEST_RATIO, pcoeffs, taps, sel) == MPU6050_OK);
+  uint32_t produced = 0;
+  for (uint32_t n = 0; n < TEST_RANDOM_SAMPLES;) {
+    uint32_t block = 1U + (uint32_t)rand() % TEST_MAX_BLOCK;
+    if (block > TEST_RANDOM_SAMPLES - n)
+      block = TEST_RANDOM_SAMPLES - n;
+    produced += mpu6050_decim_process(pdecim, &in[n], block, &out[produced]);
+    n += block;
+  }
+  uint32_t expected =
+      test_reference(pcoeffs, taps, TEST_RATIO, sel, in, TEST_RANDOM_SAMPLES, ref);
+  CHECK(produced == expected);
+  uint32_t mismatches = 0;
+  for (uint32_t i = 0; i < produced && i < expected; i++)
+    if (memcmp(&out[i], &ref[i], sizeof(out[i])) != 0)
+      mismatches++;
+  return mismatches;
+}
+
+int main(void) {
+#if defined(__AVX2__) && defined(__x86_64__)
+  if (!__builtin_cpu_supports("avx2"))
+    return TEST_SKIP;
+#endif
+  static mpu6050_decim_t decim;
+  static const double stop_64[] = {900.0, 1100.0, 1900.0, 2150.0, 3100.0, 3950.0, 0.0};
+  static const double stop_128[] = {700.0, 1300.0, 1670.0, 2700.0, 3950.0, 0.0};
+  static const test_design_t designs[] = {{64, 155.0, stop_64}, {128, 330.0, stop_128}};
+  int16_t coeffs[MPU6050_DECIM_MAX_TAPS];
+
+  /* Frequency response */
+  for (uint32_t d = 0; d < sizeof(designs) / sizeof(designs[0]); d++) {
+    mpu6050_decim_design(coeffs, designs[d].taps, TEST_RATIO);
+    CHECK(mpu6050_decim_init(&decim, TEST_RATIO, coeffs, designs[d].taps,
+                             MPU6050_DECIM_SEL_GYRO) == MPU6050_OK);
+    CHECK_NEAR(test_tone_db(&decim, 0.0), 0.0, 0.01);
+    for (double freq_hz = 25.0; freq_hz <= designs[d].pass_hz; freq_hz += 25.0)
+      CHECK_NEAR(test_tone_db(&decim, freq_hz), 0.0, TEST_PASS_DB);
+    /* Half power near the output Nyquist frequency */
+    CHECK(test_tone_db(&decim, 450.0) > -6.0);
+    for (const double *pstop = designs[d].pstop_hz; *pstop != 0.0; pstop++)
+      CHECK(test_tone_db(&decim, *pstop) < TEST_STOP_DB);
+  }
+
+  /* Bit exact against the reference, odd lengths padded, unselected channels passed through */
+  srand(6050);
+  for (uint32_t n = 0; n < TEST_RANDOM_SAMPLES; n++)
+    for (uint8_t c = 0; c < 3; c++) {
+      in[n].accel[c] = (uint16_t)rand();
+      in[n].gyro[c] = (uint16_t)rand();
+    }
+  mpu6050_decim_design(coeffs, 100, TEST_RATIO);
+  CHECK(test_bit_exact(&decim, coeffs, 100, MPU6050_DECIM_SEL_ALL) == 0);
+  CHECK(test_bit_exact(&decim, coeffs, 100, MPU6050_DECIM_SEL_GYRO) == 0);
+  mpu6050_decim_design(coeffs, MPU6050_DECIM_MAX_TAPS, TEST_RATIO);
+  CHECK(test_bit_exact(&decim, coeffs, MPU6050_DECIM_MAX_TAPS, MPU6050_DECIM_SEL_ACCEL) == 0);
+  /* Gain above unity on full scale input: saturates as the reference */
+  static const int16_t boost[] = {20000, 20000, -3000};
+  CHECK(test_bit_exact(&decim, boost, 3, MPU6050_DECIM_SEL_ALL) == 0);
+
+  /* Reset: same input, same output as a new decimator */
+  mpu6050_sample_t first[TEST_RATIO];
+  mpu6050_decim_reset(&decim);
+  CHECK(mpu6050_decim_process(&decim, in, TEST_RATIO, first) == 1U);
+  CHECK(memcmp(&first[0], &ref[0], sizeof(first[0])) == 0);
+
+  /* Limits */
+  CHECK(mpu6050_decim_init(&decim, 0, coeffs, 64, MPU6050_DECIM_SEL_GYRO) != MPU6050_OK);
+  CHECK(mpu6050_decim_init(&decim, TEST_RATIO, coeffs, 0, MPU6050_DECIM_SEL_GYRO) != MPU6050_OK);
+  CHECK(mpu6050_decim_init(&decim, TEST_RATIO, coeffs, MPU6050_DECIM_MAX_TAPS + 1U,
+                           MPU6050_DECIM_SEL_GYRO) != MPU6050_OK);
+  return TEST_RESULT();
+}
@@ -0,0 +1,132 @@
+/**
+ ******************************************************************************
+ * @file           : test_drdy.c
+ * @author         : Gonzalo Gabriel Fernandez
+ * @brief          : DATA_RDY interrupt driven acquisition test
+ ******************************************************************************
+ * @attention
+ *
+ * Every DATA_RDY edge starts one burst read, so each sample is read once.
+ * A latched INT pin that only INT_STATUS clears would stay asserted after
+ * the first sample and is refused. The other interrupt sources enabled are
+ * kept, whether the shadow is valid or not. The sample read latency runs
+ * from the edge to the end of the burst on an idle bus, blocking reads are
+ * not counted.
+ *
+ ******************************************************************************
+ */
+
+#include "mpu6050_ring.h"
+#include "test.h"
+
+#define TEST_INT_LINE MPU6050_I2C_ADDRESS_1
+
+/**
+ * @brief   Acquire for the given time, draining the ring every millisecond
+ * @retval  Samples received
+ */
+static uint32_t test_acquire(i2c_sim_bus_t *pbus, mpu6050_ring_t *pring, uint32_t ms) {
+  uint32_t received = 0;
+  for (uint32_t i = 0; i < ms; i++) {
+    i2c_sim_run(pbus, 1000000U);
+    mpu6050_sample_t sample;
+    while (mpu6050_ring_pop(pring, &sample))
+      received++;
+  }
+  return received;
+}
+
+int main(void) {
+  i2c_sim_bus_t bus;
+  i2c_sim_device_t dev;
+  mpu6050_t imu;
+  static mpu6050_ring_t ring;
+  i2c_sim_bus_init(&bus, I2C_SIM_SPEED_400KHZ);
+  CHECK(test_device_up(&bus, &dev, &imu, MPU6050_I2C_ADDRESS_1) == MPU6050_OK);
+  CHECK(mpu6050_set_sample_divider(&imu, 7) == MPU6050_OK); /* 1 kHz */
+
+  /* Pulsed INT: one read per sample, timestamps one period apart */
+  mpu6050_int_config_t config = {0};
+  CHECK(mpu6050_int_config(&imu, &config) == MPU6050_OK);
+  mpu6050_ring_init(&ring);
+  CHECK(mpu6050_drdy_start(&imu, TEST_INT_LINE, &ring) == MPU6050_OK);
+  i2c_sim_stats_reset(&bus);
+  uint64_t samples_start = dev.samples;
+  uint32_t received = 0;
+  uint64_t last_ns = 0;
+  uint32_t off_period = 0;
+  for (uint32_t i = 0; i < 500; i++) {
+    i2c_sim_run(&bus, 1000000U);
+    const mpu6050_ring_slot_t *pslots;
+    uint32_t count;
+    while ((count = mpu6050_ring_peek_batch(&ring, &pslots)) != 0) {
+      for (uint32_t k = 0; k < count; k++) {
+        if (received > 0 && pslots[k].timestamp_ns - last_ns != 1000000U)
+          off_period++;
+        last_ns = pslots[k].timestamp_ns;
+        received++;
+      }
+      mpu6050_ring_release(&ring, count);
+    }
+  }
+  CHECK(mpu6050_drdy_stop(&imu) == MPU6050_OK);
+  i2c_sim_run(&bus, 1000000U);
+  mpu6050_sample_t sample;
+  while (mpu6050_ring_pop(&ring, &sample))
+    received++;
+  CHECK(received >= 499 && received <= 501);
+  CHECK(received == imu.drdy_edges);
+  CHECK(imu.drdy_missed == 0);
+  CHECK(off_period == 0);
+  CHECK(bus.stats.transactions == received + 1U); /* and the INT_ENABLE write at stop */
+  CHECK(dev.samples - samples_start >= received);
+  CHECK(!(dev.regs[MPU6050_INT_ENABLE] & MPU6050_INT_DATA_RDY));
+
+  /* Latency from the edge: one burst on an idle bus, whatever the blocking reads */
+  uint32_t burst_us = (uint32_t)(i2c_sim_transfer_ns(&bus, 1, MPU6050_SENSOR_DATA_LEN) / 1000U);
+  CHECK(bus.stats.sample_reads == received);
+  CHECK(mpu6050_read_all_raw(&imu, &sample) == MPU6050_OK);
+  CHECK(bus.stats.sample_reads == received);
+  CHECK(i2c_sim_latency_percentile(&bus, 50.0f) == burst_us);
+  CHECK(i2c_sim_latency_percentile(&bus, 99.9f) == burst_us);
+
+  /* Latched INT cleared only by INT_STATUS: refused, nothing enabled */
+  config.latch = true;
+  CHECK(mpu6050_int_config(&imu, &config) == MPU6050_OK);
+  mpu6050_ring_init(&ring);
+  CHECK(mpu6050_drdy_start(&imu, TEST_INT_LINE, &ring) != MPU6050_OK);
+  CHECK(!(dev.regs[MPU6050_INT_ENABLE] & MPU6050_INT_DATA_RDY));
+  CHECK(dev.int_context == NULL);
+
+  /* Latched INT cleared by any read: the sample burst releases the pin */
+  config.clear_on_read = true;
+  CHECK(mpu6050_int_config(&imu, &config) == MPU6050_OK);
+  CHECK(mpu6050_drdy_start(&imu, TEST_INT_LINE, &ring) == MPU6050_OK);
+  received = test_acquire(&bus, &ring, 200);
+  CHECK(mpu6050_drdy_stop(&imu) == MPU6050_OK);
+  CHECK(received >= 198);
+  CHECK(imu.drdy_missed == 0);
+
+  /* Sources enabled behind a stale shadow are kept at start and stop */
+  config = (mpu6050_int_config_t){0};
+  CHECK(mpu6050_int_config(&imu, &config) == MPU6050_OK);
+  CHECK(mpu6050_int_enable(&imu, MPU6050_INT_FIFO_OFLOW) == MPU6050_OK);
+  imu.shadow.valid = false;
+  imu.shadow.int_enable = 0;
+  CHECK(mpu6050_drdy_start(&imu, TEST_INT_LINE, &ring) == MPU6050_OK);
+  CHECK(dev.regs[MPU6050_INT_ENABLE] == (MPU6050_INT_FIFO_OFLOW | MPU6050_INT_DATA_RDY));
+  received = test_acquire(&bus, &ring, 50);
+  CHECK(mpu6050_drdy_stop(&imu) == MPU6050_OK);
+  CHECK(dev.regs[MPU6050_INT_ENABLE] == MPU6050_INT_FIFO_OFLOW);
+  CHECK(received >= 48);
+
+  /* 8 kHz: a read takes longer than the sample period, the edges in between are missed */
+  CHECK(mpu6050_shadow_resync(&imu) == MPU6050_OK);
+  CHECK(mpu6050_set_sample_divider(&imu, 0) == MPU6050_OK);
+  CHECK(mpu6050_drdy_start(&imu, TEST_INT_LINE, &ring) == MPU6050_OK);
+  received = test_acquire(&bus, &ring, 100);
+  CHECK(mpu6050_drdy_stop(&imu) == MPU6050_OK);
+  CHECK(imu.drdy_missed > 0);
+  CHECK(imu.drdy_edges >= received + imu.drdy_missed);
+  return TEST_RESULT();
+}
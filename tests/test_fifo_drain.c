@@ -0,0 +1,75 @@
+/**
+ ******************************************************************************
+ * @file           : test_fifo_drain.c
+ * @author         : Gonzalo Gabriel Fernandez
+ * @brief          : FIFO drain test
+ ******************************************************************************
+ * @attention
+ *
+ * Every sample loaded into the simulated FIFO is drained once, in a single
+ * burst per drain, and parsed back. An overflow is reported, the FIFO reset
+ * and draining goes on with aligned frames.
+ *
+ ******************************************************************************
+ */
+
+#include "test.h"
+
+#define TEST_BUFFER_SIZE 1024U
+
+int main(void) {
+  i2c_sim_bus_t bus;
+  i2c_sim_device_t dev;
+  mpu6050_t imu;
+  i2c_sim_bus_init(&bus, I2C_SIM_SPEED_400KHZ);
+  CHECK(test_device_up(&bus, &dev, &imu, MPU6050_I2C_ADDRESS_1) == MPU6050_OK);
+  i2c_sim_set_signal(&dev, I2C_SIM_ACCEL_Z, 16384, 0, 0);
+  i2c_sim_set_signal(&dev, I2C_SIM_GYRO_X, -250, 0, 0);
+  CHECK(mpu6050_set_sample_divider(&imu, 7) == MPU6050_OK); /* 1 kHz */
+  CHECK(mpu6050_fifo_enable(&imu, MPU6050_FIFO_SEL_ALL) == MPU6050_OK);
+  CHECK(mpu6050_fifo_frame_size(&imu) == MPU6050_SENSOR_DATA_LEN);
+
+  /* 20 ms between drains plus the drain itself, about 30 frames of 14 bytes fit the buffer */
+  static uint8_t buffer[TEST_BUFFER_SIZE];
+  uint64_t drained = 0;
+  uint64_t samples_start = dev.samples;
+  for (uint32_t k = 0; k < 50; k++) {
+    i2c_sim_run(&bus, 20000000U);
+    i2c_sim_stats_reset(&bus);
+    uint16_t frames;
+    CHECK(mpu6050_fifo_drain(&imu, buffer, sizeof(buffer), &frames) == MPU6050_OK);
+    CHECK(frames >= 20 && frames <= 32);
+    /* INT_STATUS, FIFO_COUNT, then every frame in one burst */
+    CHECK(bus.stats.transactions == 3);
+    CHECK(bus.stats.bytes_read == 1U + 2U + frames * MPU6050_SENSOR_DATA_LEN);
+    for (uint16_t f = 0; f < frames; f++) {
+      mpu6050_sample_t sample;
+      CHECK(mpu6050_fifo_parse_frame(&imu, &buffer[f * MPU6050_SENSOR_DATA_LEN], &sample) ==
+            MPU6050_OK);
+      CHECK(raw16(sample.accel[2]) == 16384);
+      CHECK(raw16(sample.gyro[0]) == -250);
+    }
+    drained += frames;
+  }
+  /* Frames still in the FIFO were sampled during the last drain */
+  CHECK(drained + dev.fifo_count / MPU6050_SENSOR_DATA_LEN == dev.samples - samples_start);
+  CHECK(dev.fifo_bytes_lost == 0);
+  CHECK(mpu6050_fifo_overflow_count(&imu) == 0);
+
+  /* 1024 bytes hold 73 frames, 200 ms overflows the FIFO */
+  i2c_sim_run(&bus, 200000000U);
+  uint16_t frames;
+  CHECK(mpu6050_fifo_drain(&imu, buffer, sizeof(buffer), &frames) != MPU6050_OK);
+  CHECK(dev.fifo_bytes_lost > 0);
+  CHECK(frames == 0);
+  CHECK(mpu6050_fifo_overflow_count(&imu) == 1);
+  i2c_sim_run(&bus, 10000000U);
+  CHECK(mpu6050_fifo_drain(&imu, buffer, sizeof(buffer), &frames) == MPU6050_OK);
+  CHECK(frames >= 9 && frames <= 11);
+  for (uint16_t f = 0; f < frames; f++) {
+    mpu6050_sample_t sample;
+    mpu6050_fifo_parse_frame(&imu, &buffer[f * MPU6050_SENSOR_DATA_LEN], &sample);
+    CHECK(raw16(sample.accel[2]) == 16384);
+  }
+  return TEST_RESULT();
+}
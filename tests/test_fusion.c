@@ -0,0 +1,93 @@
+/**
+ ******************************************************************************
+ * @file           : test_fusion.c
+ * @author         : Gonzalo Gabriel Fernandez
+ * @brief          : Orientation fusion test
+ ******************************************************************************
+ * @attention
+ *
+ * Madgwick and Mahony filters follow a known rotation about X from the gyro,
+ * converge to a static tilt from the accel, keep a unit quaternion and give
+ * no linear acceleration at rest. Built in float and in fixed-point.
+ *
+ ******************************************************************************
+ */
+
+#include <math.h>
+
+#include "mpu6050_fusion.h"
+#include "test.h"
+
+#define TEST_RATE_HZ 1000U
+#define TEST_SAMPLES 10000U
+#define TEST_ACCEL_1G 16384.0 /*! Counts per g at 2 g full scale */
+
+#ifdef MPU6050_FUSION_FIXED
+#define TEST_ANGLE(x) ((x) / 65536.0)     /*! Q16.16 */
+#define TEST_QUAT(x) ((x) / 1073741824.0) /*! Q2.30 */
+#define TEST_LINEAR(x) ((x) / 65536.0)    /*! Q16.16 */
+#else
+#define TEST_ANGLE(x) ((double)(x))
+#define TEST_QUAT(x) ((double)(x))
+#define TEST_LINEAR(x) ((double)(x))
+#endif
+
+static mpu6050_sample_t samples[TEST_SAMPLES];
+
+/**
+ * @brief   Raw count of a value
+ */
+static uint16_t test_raw(double value) { return (uint16_t)(int16_t)lround(value); }
+
+int main(void) {
+  mpu6050_convert_scale_t scale;
+  mpu6050_convert_scale(MPU6050_GYRO_CONFIG_500DPS, MPU6050_ACCEL_CONFIG_2G, &scale);
+
+  for (int algo = MPU6050_FUSION_MADGWICK; algo <= MPU6050_FUSION_MAHONY; algo++) {
+    mpu6050_fusion_t fusion;
+    mpu6050_fusion_output_t out;
+
+    /* Roll about X at 0.5 rad/s for 2 s, then held */
+    double roll = 0.0;
+    for (uint32_t i = 0; i < TEST_SAMPLES; i++) {
+      double rate = (i < 2U * TEST_RATE_HZ) ? 0.5 : 0.0;
+      roll += rate / TEST_RATE_HZ;
+      samples[i] = (mpu6050_sample_t){0};
+      samples[i].accel[1] = test_raw(sin(roll) * TEST_ACCEL_1G);
+      samples[i].accel[2] = test_raw(cos(roll) * TEST_ACCEL_1G);
+      samples[i].gyro[0] = test_raw(rate / scale.scale[4]);
+    }
+    mpu6050_fusion_init(&fusion, (mpu6050_fusion_algo_t)algo, &scale, TEST_RATE_HZ);
+    mpu6050_fusion_update_batch(&fusion, samples, 2U * TEST_RATE_HZ);
+    mpu6050_fusion_output(&fusion, &out);
+    CHECK_NEAR(TEST_ANGLE(out.euler[0]), 1.0, 0.01);
+    CHECK_NEAR(TEST_ANGLE(out.euler[1]), 0.0, 0.01);
+    CHECK_NEAR(TEST_ANGLE(out.euler[2]), 0.0, 0.01);
+    mpu6050_fusion_update_batch(&fusion, &samples[2U * TEST_RATE_HZ],
+                                TEST_SAMPLES - 2U * TEST_RATE_HZ);
+    mpu6050_fusion_output(&fusion, &out);
+    CHECK_NEAR(TEST_ANGLE(out.euler[0]), 1.0, 0.01);
+    double norm = 0.0;
+    for (uint8_t k = 0; k < 4; k++)
+      norm += TEST_QUAT(out.q[k]) * TEST_QUAT(out.q[k]);
+    CHECK_NEAR(norm, 1.0, 1e-3);
+    CHECK_NEAR(TEST_QUAT(out.q[0]), cos(0.5), 1e-3);
+    CHECK_NEAR(TEST_QUAT(out.q[1]), sin(0.5), 1e-3);
+    for (uint8_t axis = 0; axis < 3; axis++)
+      CHECK_NEAR(TEST_LINEAR(out.linear[axis]), 0.0, 0.02);
+
+    /* Static pitch of 0.3 rad, from the identity with the accel only */
+    const double pitch = 0.3;
+    for (uint32_t i = 0; i < TEST_SAMPLES; i++) {
+      samples[i] = (mpu6050_sample_t){0};
+      samples[i].accel[0] = test_raw(-sin(pitch) * TEST_ACCEL_1G);
+      samples[i].accel[2] = test_raw(cos(pitch) * TEST_ACCEL_1G);
+    }
+    mpu6050_fusion_init(&fusion, (mpu6050_fusion_algo_t)algo, &scale, TEST_RATE_HZ);
+    mpu6050_fusion_update_batch(&fusion, samples, TEST_SAMPLES);
+    mpu6050_fusion_output(&fusion, &out);
+    CHECK_NEAR(TEST_ANGLE(out.euler[1]), pitch, 0.01);
+    CHECK_NEAR(TEST_ANGLE(out.euler[0]), 0.0, 0.01);
+  }
+  return TEST_RESULT();
+}
@@ -0,0 +1,109 @@
+/**
+ ******************************************************************************
+ * @file           : test_init_table.c
+ * @author         : Gonzalo Gabriel Fernandez
+ * @brief          : Handle init, burst writes and init table test
+ ******************************************************************************
+ * @attention
+ *
+ * mpu6050_init reads the configuration into the shadow without writing to
+ * the device, and fails when no device answers. Consecutive registers of an
+ * init table go in one burst write, others in their own. mpu6050_start
+ * reaches the first valid sample within the reset and start-up times, with
+ * the shadow loaded and INT_ENABLE as before, and a wait on a device that
+ * never samples expires at the table time limit.
+ *
+ ******************************************************************************
+ */
+
+#include "port_i2c.h"
+#include "test.h"
+
+#define TEST_WAIT_TIMEOUT_US 50000U
+#define TEST_START_SLACK_NS 2000000U /*! Reset and data polls, config writes */
+
+int main(void) {
+  i2c_sim_bus_t bus;
+  i2c_sim_device_t dev;
+  mpu6050_t imu;
+  i2c_sim_bus_init(&bus, I2C_SIM_SPEED_400KHZ);
+
+  /* No device: init fails on the shadow read */
+  CHECK(mpu6050_init(&imu, &bus, MPU6050_I2C_ADDRESS_1) == MPU6050_ERROR);
+  CHECK(bus.stats.naks > 0);
+  CHECK(imu.bus == &bus && imu.address == MPU6050_I2C_ADDRESS_1);
+  CHECK(!imu.shadow.valid);
+
+  /* Device present: four burst reads and no write, the device is left asleep */
+  i2c_sim_device_init(&dev, MPU6050_I2C_ADDRESS_1);
+  CHECK(i2c_sim_attach(&bus, &dev) == MPU6050_OK);
+  i2c_sim_stats_reset(&bus);
+  CHECK(mpu6050_init(&imu, &bus, MPU6050_I2C_ADDRESS_1) == MPU6050_OK);
+  CHECK(bus.stats.transactions == 4);
+  CHECK(bus.stats.bytes_read == 4 + 1 + 2 + 3);
+  CHECK(imu.shadow.valid && imu.i2c_timeout == MPU6050_RETRY_BUDGET_US);
+  CHECK(dev.regs[MPU6050_PWR_MGMT_1] == (1U << MPU6050_PWR1_SLEEP_OFFSET));
+
+  /* Port burst write, one transaction for consecutive registers */
+  uint8_t values[4] = {0x07, 0x03, 0x08, 0x10};
+  i2c_sim_stats_reset(&bus);
+  CHECK(i2c_burst_write(&bus, MPU6050_I2C_ADDRESS_1 << 1, MPU6050_SMPLRT_DIV, values, 4) ==
+        MPU6050_OK);
+  CHECK(bus.stats.transactions == 1 && bus.stats.bytes_written == 5);
+  CHECK(dev.regs[MPU6050_SMPLRT_DIV] == 0x07 && dev.regs[MPU6050_ACCEL_CONFIG] == 0x10);
+  CHECK(mpu6050_shadow_resync(&imu) == MPU6050_OK);
+
+  /* Table writes: a run of consecutive registers is one burst, the rest one write each */
+  const mpu6050_init_step_t writes[] = {
+      MPU6050_INIT_REG(MPU6050_SMPLRT_DIV, 0x01),
+      MPU6050_INIT_REG(MPU6050_CONFIG, 0x02),
+      MPU6050_INIT_REG(MPU6050_GYRO_CONFIG, 0x18),
+      MPU6050_INIT_REG(MPU6050_ACCEL_CONFIG, 0x08),
+      MPU6050_INIT_REG(MPU6050_USER_CTRL, 0x00),
+      MPU6050_INIT_REG(MPU6050_PWR_MGMT_2, 0x00),
+  };
+  i2c_sim_stats_reset(&bus);
+  CHECK(mpu6050_init_table(&imu, writes, 6, MPU6050_INIT_TIMEOUT_US) == MPU6050_OK);
+  CHECK(bus.stats.transactions == 3);
+  CHECK(bus.stats.bytes_written == 5 + 2 + 2);
+  CHECK(dev.regs[MPU6050_SMPLRT_DIV] == 0x01 && dev.regs[MPU6050_CONFIG] == 0x02);
+  CHECK(dev.regs[MPU6050_GYRO_CONFIG] == 0x18 && dev.regs[MPU6050_ACCEL_CONFIG] == 0x08);
+
+  /* A wait for data on a sleeping device expires at the time limit */
+  const mpu6050_init_step_t wait_data[] = {MPU6050_INIT_WAIT(MPU6050_INIT_WAIT_DATA)};
+  uint64_t start_ns = i2c_sim_now(&bus);
+  CHECK(mpu6050_init_table(&imu, wait_data, 1, TEST_WAIT_TIMEOUT_US) == MPU6050_ERROR_TIMEOUT);
+  uint64_t elapsed_ns = i2c_sim_now(&bus) - start_ns;
+  CHECK(elapsed_ns >= TEST_WAIT_TIMEOUT_US * 1000U);
+  CHECK(elapsed_ns < TEST_WAIT_TIMEOUT_US * 1000U + 1000000U);
+  CHECK(dev.regs[MPU6050_INT_ENABLE] == 0);
+
+  /* Start: reset, one config burst, wake-up, first valid sample */
+  i2c_sim_set_signal(&dev, I2C_SIM_ACCEL_Z, 16384, 0, 0);
+  CHECK(mpu6050_int_enable(&imu, MPU6050_INT_MOTION) == MPU6050_OK);
+  start_ns = i2c_sim_now(&bus);
+  CHECK(mpu6050_start(&imu, MPU6050_GYRO_CONFIG_500DPS, MPU6050_ACCEL_CONFIG_2G,
+                      MPU6050_DLPF_184HZ, 0) == MPU6050_OK);
+  elapsed_ns = i2c_sim_now(&bus) - start_ns;
+  CHECK(elapsed_ns >= I2C_SIM_RESET_NS + I2C_SIM_STARTUP_NS);
+  CHECK(elapsed_ns < I2C_SIM_RESET_NS + I2C_SIM_STARTUP_NS + TEST_START_SLACK_NS);
+  mpu6050_sample_t sample;
+  CHECK(mpu6050_read_all_raw(&imu, &sample) == MPU6050_OK);
+  CHECK(raw16(sample.accel[2]) == 16384);
+  CHECK(dev.regs[MPU6050_SMPLRT_DIV] == 0);
+  CHECK(dev.regs[MPU6050_CONFIG] == MPU6050_DLPF_184HZ);
+  CHECK(dev.regs[MPU6050_GYRO_CONFIG] ==
+        (MPU6050_GYRO_CONFIG_500DPS << MPU6050_GYRO_FS_SEL_OFFSET));
+  CHECK(dev.regs[MPU6050_PWR_MGMT_1] == MPU6050_PWR1_CLKSEL_PLL_XGYRO);
+  /* The reset cleared INT_ENABLE, the data wait leaves it so */
+  CHECK(dev.regs[MPU6050_INT_ENABLE] == 0);
+
+  /* Shadow loaded by the table, configuration reads take no transaction */
+  CHECK(imu.shadow.valid);
+  i2c_sim_stats_reset(&bus);
+  uint8_t config;
+  CHECK(mpu6050_gyro_read_config(&imu, &config) == MPU6050_OK);
+  CHECK(config == dev.regs[MPU6050_GYRO_CONFIG]);
+  CHECK(bus.stats.transactions == 0);
+  return TEST_RESULT();
+}
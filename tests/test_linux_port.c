@@ -0,0 +1,329 @@
+/**
+ ******************************************************************************
+ * @file           : test_linux_port.c
+ * @author         : Gonzalo Gabriel Fernandez
+ * @brief          : Linux i2c-dev port test against an in-process fake
+ ******************************************************************************
+ * @attention
+ *
+ * The port is linked with open and ioctl wrapped (-Wl,--wrap), so the
+ * i2c-dev and GPIO chip devices are faked in the test: I2C_RDWR runs its
+ * messages on the register file of a device at 0x68, other addresses NAK,
+ * and a line event request hands out the read end of a pipe, where the test
+ * writes the edges. Every register read must be one ioctl of two messages,
+ * a batch one ioctl of all its messages from the calling thread, and queued
+ * transactions complete from the worker thread. Adapter errno values map to
+ * the detailed status, and a DATA_RDY edge reads the sample from the line
+ * waiter with a CLOCK_MONOTONIC_RAW timestamp.
+ *
+ ******************************************************************************
+ */
+
+#define _GNU_SOURCE
+
+#include <errno.h>
+#include <fcntl.h>
+#include <linux/gpio.h>
+#include <linux/i2c-dev.h>
+#include <pthread.h>
+#include <stdarg.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "port_i2c.h"
+#include "port_i2c_linux.h"
+#include "test.h"
+
+#define TEST_I2C_DEVICE "/dev/i2c-fake"
+#define TEST_GPIOCHIP "/dev/gpiochip-fake"
+#define TEST_INT_LINE 17U
+#define TEST_ADDRESS (MPU6050_I2C_ADDRESS_1 << 1)
+#define TEST_WAIT_MS 1000U /*! Limit of the waits on the worker and line waiter threads */
+
+int __real_open(const char *path, int flags, ...);
+
+/**
+ * @brief Fake adapter, state shared with the port threads
+ */
+typedef struct {
+  pthread_mutex_t lock;
+  uint8_t regs[256];        /*!< Register file of the device at 0x68 */
+  uint8_t pointer;          /*!< Register pointer, auto-incremented */
+  uint32_t ioctls;          /*!< I2C_RDWR ioctls */
+  uint32_t msgs;            /*!< Messages of all I2C_RDWR ioctls */
+  uint32_t last_nmsgs;      /*!< Messages of the last I2C_RDWR ioctl */
+  uint16_t last_flags[64];  /*!< Flags of the messages of the last I2C_RDWR ioctl */
+  pthread_t last_thread;    /*!< Thread of the last I2C_RDWR ioctl */
+  int fail_errno;           /*!< errno of the next I2C_RDWR ioctl, 0 for success */
+  unsigned long timeout;    /*!< Last I2C_TIMEOUT argument */
+  uint32_t line;            /*!< Line offset of the last line event request */
+  uint32_t eventflags;      /*!< Edge of the last line event request */
+  int edge_fd;              /*!< Write end of the line event pipe */
+
+} test_fake_t;
+
+static test_fake_t fake = {.lock = PTHREAD_MUTEX_INITIALIZER, .edge_fd = -1};
+static i2c_linux_bus_t bus;
+static mpu6050_t imu;
+
+/**
+ * @brief Completion of a queued transaction
+ */
+typedef struct {
+  volatile bool done;
+  mpu6050_status_t status;
+  pthread_t thread;
+
+} test_completion_t;
+
+int __wrap_open(const char *path, int flags, ...) {
+  if (strcmp(path, TEST_I2C_DEVICE) == 0 || strcmp(path, TEST_GPIOCHIP) == 0)
+    return __real_open("/dev/null", flags);
+  va_list args;
+  va_start(args, flags);
+  mode_t mode = va_arg(args, mode_t);
+  va_end(args);
+  return __real_open(path, flags, mode);
+}
+
+/**
+ * @brief   I2C_RDWR on the fake device
+ * @retval  Amount of messages, -1 with errno set on failure
+ */
+static int test_rdwr(struct i2c_rdwr_ioctl_data *prdwr) {
+  pthread_mutex_lock(&fake.lock);
+  fake.ioctls++;
+  fake.msgs += prdwr->nmsgs;
+  fake.last_nmsgs = prdwr->nmsgs;
+  fake.last_thread = pthread_self();
+  for (uint32_t i = 0; i < prdwr->nmsgs && i < 64U; i++)
+    fake.last_flags[i] = prdwr->msgs[i].flags;
+  int error = fake.fail_errno;
+  fake.fail_errno = 0;
+  for (uint32_t i = 0; i < prdwr->nmsgs && error == 0; i++) {
+    struct i2c_msg *pmsg = &prdwr->msgs[i];
+    if (pmsg->addr != MPU6050_I2C_ADDRESS_1) {
+      error = ENXIO;
+    } else if (pmsg->flags & I2C_M_RD) {
+      for (uint16_t n = 0; n < pmsg->len; n++)
+        pmsg->buf[n] = fake.regs[fake.pointer++];
+    } else if (pmsg->len > 0) {
+      fake.pointer = pmsg->buf[0];
+      for (uint16_t n = 1; n < pmsg->len; n++)
+        fake.regs[fake.pointer++] = pmsg->buf[n];
+    }
+  }
+  pthread_mutex_unlock(&fake.lock);
+  if (error != 0) {
+    errno = error;
+    return -1;
+  }
+  return (int)prdwr->nmsgs;
+}
+
+int __wrap_ioctl(int fd, unsigned long request, ...) {
+  va_list args;
+  va_start(args, request);
+  void *parg = va_arg(args, void *);
+  va_end(args);
+  (void)fd;
+  if (request == I2C_RDWR)
+    return test_rdwr(parg);
+  if (request == I2C_TIMEOUT) {
+    fake.timeout = (unsigned long)parg;
+    return 0;
+  }
+  if (request == GPIO_GET_LINEEVENT_IOCTL) {
+    struct gpioevent_request *prequest = parg;
+    int fds[2];
+    if (pipe(fds) != 0)
+      return -1;
+    fake.line = prequest->lineoffset;
+    fake.eventflags = prequest->eventflags;
+    fake.edge_fd = fds[1];
+    prequest->fd = fds[0];
+    return 0;
+  }
+  errno = ENOTTY;
+  return -1;
+}
+
+/**
+ * @brief   Raw monotonic clock in ns
+ */
+static uint64_t test_raw_ns(void) {
+  struct timespec now;
+  clock_gettime(CLOCK_MONOTONIC_RAW, &now);
+  return (uint64_t)now.tv_sec * 1000000000ULL + (uint64_t)now.tv_nsec;
+}
+
+/**
+ * @brief   Wait for a flag set by a port thread
+ * @retval  true if set within TEST_WAIT_MS
+ */
+static bool test_wait(volatile bool *pflag) {
+  for (uint32_t ms = 0; ms < TEST_WAIT_MS && !*pflag; ms++)
+    usleep(1000);
+  return *pflag;
+}
+
+/**
+ * @brief   Queued transaction completion, records the calling thread
+ */
+static void test_complete(void *pcontext, mpu6050_status_t status) {
+  test_completion_t *pcompletion = pcontext;
+  pcompletion->status = status;
+  pcompletion->thread = pthread_self();
+  pcompletion->done = true;
+}
+
+/**
+ * @brief   Blocking register read failing with an adapter errno
+ * @retval  Status of the read
+ */
+static mpu6050_status_t test_errno_status(int error) {
+  uint8_t value;
+  pthread_mutex_lock(&fake.lock);
+  fake.fail_errno = error;
+  pthread_mutex_unlock(&fake.lock);
+  return i2c_reg_read(&bus, TEST_ADDRESS, MPU6050_WHO_AM_I, &value);
+}
+
+int main(void) {
+  fake.regs[MPU6050_WHO_AM_I] = MPU6050_I2C_ADDRESS_1;
+  bus.device = TEST_I2C_DEVICE;
+  bus.gpiochip = TEST_GPIOCHIP;
+  bus.adapter_timeout_ms = 25;
+
+  /* Init: adapter timeout in 10 ms units, the shadow read as four combined reads */
+  CHECK(mpu6050_init(&imu, &bus, MPU6050_I2C_ADDRESS_1) == MPU6050_OK);
+  CHECK(fake.timeout == 3U);
+  CHECK(fake.ioctls == 4U && fake.msgs == 8U);
+  CHECK(i2c_speed_hz(&bus) == I2C_LINUX_DEFAULT_SPEED);
+
+  /* One ioctl per register read, register address write and repeated start read */
+  uint8_t value = 0;
+  uint32_t ioctls = fake.ioctls;
+  CHECK(i2c_reg_read(&bus, TEST_ADDRESS, MPU6050_WHO_AM_I, &value) == MPU6050_OK);
+  CHECK(value == MPU6050_I2C_ADDRESS_1);
+  CHECK(fake.ioctls == ioctls + 1U && fake.last_nmsgs == 2U);
+  CHECK(fake.last_flags[0] == 0 && fake.last_flags[1] == I2C_M_RD);
+  CHECK(!pthread_equal(fake.last_thread, pthread_self()));
+  for (uint8_t i = 0; i < MPU6050_SENSOR_DATA_LEN; i++)
+    fake.regs[MPU6050_ACCEL_XOUT_H + i] = (uint8_t)(0x10U + i);
+  mpu6050_sample_t sample;
+  ioctls = fake.ioctls;
+  CHECK(mpu6050_read_all_raw(&imu, &sample) == MPU6050_OK);
+  CHECK(fake.ioctls == ioctls + 1U && fake.last_nmsgs == 2U);
+  CHECK(sample.accel[0] == 0x1011U && sample.gyro[2] == 0x1C1DU);
+
+  /* One ioctl per register write, register address and data in one message */
+  uint8_t data[3] = {0xA1, 0xA2, 0xA3};
+  ioctls = fake.ioctls;
+  CHECK(i2c_burst_write(&bus, TEST_ADDRESS, MPU6050_XG_OFFS_USRH, data, 3) == MPU6050_OK);
+  CHECK(fake.ioctls == ioctls + 1U && fake.last_nmsgs == 1U);
+  CHECK(memcmp(&fake.regs[MPU6050_XG_OFFS_USRH], data, 3) == 0);
+
+  /* Queued transaction: started by the worker, completed from it */
+  test_completion_t completion = {.done = false};
+  i2c_transaction_t transaction = {
+      .op = I2C_QUEUE_READ,
+      .priority = I2C_QUEUE_PRIO_SAMPLE,
+      .slave_address = TEST_ADDRESS,
+      .reg_address = MPU6050_WHO_AM_I,
+      .pdata = &value,
+      .data_amount = 1,
+      .callback = test_complete,
+      .pcontext = &completion,
+  };
+  value = 0;
+  ioctls = fake.ioctls;
+  CHECK(i2c_queue_submit(&bus, &transaction) == MPU6050_OK);
+  CHECK(test_wait(&completion.done));
+  CHECK(completion.status == MPU6050_OK && value == MPU6050_I2C_ADDRESS_1);
+  CHECK(!pthread_equal(completion.thread, pthread_self()));
+  CHECK(pthread_equal(completion.thread, bus.worker));
+  CHECK(fake.ioctls == ioctls + 1U);
+
+  /* Batch: reads and writes packed into one ioctl from the calling thread, then emptied */
+  i2c_linux_batch_t batch;
+  uint8_t accel[6];
+  uint8_t who = 0;
+  uint8_t offsets[2] = {0x12, 0x34};
+  i2c_linux_batch_init(&batch);
+  CHECK(i2c_linux_batch_read(&batch, TEST_ADDRESS, MPU6050_ACCEL_XOUT_H, accel, 6) ==
+        MPU6050_OK);
+  CHECK(i2c_linux_batch_write(&batch, TEST_ADDRESS, MPU6050_XG_OFFS_USRH, offsets, 2) ==
+        MPU6050_OK);
+  CHECK(i2c_linux_batch_read(&batch, TEST_ADDRESS, MPU6050_WHO_AM_I, &who, 1) == MPU6050_OK);
+  CHECK(batch.nmsgs == 5U && batch.pool_used == 5U);
+  ioctls = fake.ioctls;
+  CHECK(i2c_linux_batch_submit(&bus, &batch) == MPU6050_OK);
+  CHECK(fake.ioctls == ioctls + 1U && fake.last_nmsgs == 5U);
+  CHECK(fake.last_flags[0] == 0 && fake.last_flags[1] == I2C_M_RD && fake.last_flags[2] == 0);
+  CHECK(fake.last_flags[3] == 0 && fake.last_flags[4] == I2C_M_RD);
+  CHECK(pthread_equal(fake.last_thread, pthread_self()));
+  CHECK(accel[0] == 0x10U && accel[5] == 0x15U && who == MPU6050_I2C_ADDRESS_1);
+  CHECK(fake.regs[MPU6050_XG_OFFS_USRH] == 0x12U && fake.regs[MPU6050_XG_OFFS_USRH + 1] == 0x34U);
+  CHECK(batch.nmsgs == 0 && batch.pool_used == 0);
+  ioctls = fake.ioctls;
+  CHECK(i2c_linux_batch_submit(&bus, &batch) == MPU6050_OK);
+  CHECK(fake.ioctls == ioctls);
+  /* Limits: message count and pool, the batch is left as it was */
+  for (uint32_t i = 0; i < I2C_LINUX_BATCH_MAX_MSGS / 2U; i++)
+    CHECK(i2c_linux_batch_read(&batch, TEST_ADDRESS, MPU6050_WHO_AM_I, &who, 1) == MPU6050_OK);
+  CHECK(i2c_linux_batch_read(&batch, TEST_ADDRESS, MPU6050_WHO_AM_I, &who, 1) != MPU6050_OK);
+  CHECK(batch.nmsgs == I2C_LINUX_BATCH_MAX_MSGS);
+  i2c_linux_batch_init(&batch);
+  uint8_t large[I2C_LINUX_BATCH_POOL_SIZE] = {0};
+  CHECK(i2c_linux_batch_write(&batch, TEST_ADDRESS, 0, large, sizeof(large)) != MPU6050_OK);
+  CHECK(batch.nmsgs == 0 && batch.pool_used == 0);
+
+  /* Adapter errno to detailed status, through the queue and the worker */
+  CHECK(test_errno_status(ENXIO) == MPU6050_ERROR_NACK);
+  CHECK(test_errno_status(EREMOTEIO) == MPU6050_ERROR_NACK);
+  CHECK(test_errno_status(ETIMEDOUT) == MPU6050_ERROR_TIMEOUT);
+  CHECK(test_errno_status(EAGAIN) == MPU6050_ERROR_BUS);
+  CHECK(test_errno_status(EPROTO) == MPU6050_ERROR_BUS);
+  CHECK(test_errno_status(EOVERFLOW) == MPU6050_ERROR_OVERRUN);
+  CHECK(test_errno_status(EBUSY) == MPU6050_ERROR_BUSY);
+  CHECK(test_errno_status(EIO) == MPU6050_ERROR);
+  CHECK(i2c_reg_read(&bus, MPU6050_I2C_ADDRESS_2 << 1, MPU6050_WHO_AM_I, &value) ==
+        MPU6050_ERROR_NACK);
+  CHECK(test_errno_status(0) == MPU6050_OK);
+
+  /* DATA_RDY: an edge on the line event reads the sample from the waiter, timestamped from the
+     raw monotonic clock */
+  bus.int_active_low = true;
+  CHECK(mpu6050_drdy_start(&imu, TEST_INT_LINE, NULL) == MPU6050_OK);
+  CHECK(fake.line == TEST_INT_LINE && fake.eventflags == GPIOEVENT_REQUEST_FALLING_EDGE);
+  CHECK(fake.regs[MPU6050_INT_ENABLE] & MPU6050_INT_DATA_RDY);
+  CHECK(i2c_int_attach(&bus, TEST_INT_LINE, &imu) != MPU6050_OK);
+  fake.regs[MPU6050_ACCEL_XOUT_H] = 0x7F;
+  imu.data_ready = false;
+  ioctls = fake.ioctls;
+  uint64_t before_ns = test_raw_ns();
+  struct gpioevent_data event = {.timestamp = before_ns, .id = GPIOEVENT_EVENT_FALLING_EDGE};
+  CHECK(write(fake.edge_fd, &event, sizeof(event)) == sizeof(event));
+  CHECK(test_wait(&imu.data_ready));
+  uint64_t after_ns = test_raw_ns();
+  CHECK(imu.drdy_edges == 1U && imu.drdy_missed == 0);
+  CHECK(fake.ioctls == ioctls + 1U && fake.last_nmsgs == 2U);
+  CHECK(mpu6050_read_all_from_buffer(&imu, &sample) == MPU6050_OK);
+  CHECK(sample.accel[0] == 0x7F11U);
+  CHECK(imu.timestamp_ns >= before_ns && imu.timestamp_ns <= after_ns);
+  uint64_t port_ns = i2c_timestamp_ns(&bus);
+  CHECK(port_ns >= after_ns && port_ns <= test_raw_ns());
+  CHECK(mpu6050_drdy_stop(&imu) == MPU6050_OK);
+  CHECK(!(fake.regs[MPU6050_INT_ENABLE] & MPU6050_INT_DATA_RDY));
+  close(fake.edge_fd);
+  CHECK(i2c_int_attach(&bus, TEST_INT_LINE, &imu) == MPU6050_OK);
+  CHECK(i2c_int_detach(&bus, TEST_INT_LINE) == MPU6050_OK);
+  CHECK(i2c_int_detach(&bus, TEST_INT_LINE) != MPU6050_OK);
+  close(fake.edge_fd);
+
+  CHECK(i2c_linux_deinit(&bus) == MPU6050_OK);
+  CHECK(i2c_linux_deinit(&bus) != MPU6050_OK);
+  return TEST_RESULT();
+}
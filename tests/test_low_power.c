@@ -0,0 +1,175 @@
+/**
+ ******************************************************************************
+ * @file           : test_low_power.c
+ * @author         : Gonzalo Gabriel Fernandez
+ * @brief          : Low power cycle mode and motion wake-up test
+ ******************************************************************************
+ * @attention
+ *
+ * Cycle mode samples at the wake-up rate and stopping it puts back the clock
+ * source and the axis standby in place before. Motion wake-up takes no bus
+ * transaction while idle, signals a shake, and gives back the DATA_RDY
+ * interrupt it removed. With a latched INT pin every consumed event releases
+ * the pin, so later motion still interrupts.
+ *
+ * Bus transactions per idle hour are measured over TEST_IDLE_NS of
+ * simulated time in each mode, scaled to an hour and written to stdout as
+ * CSV: polling and DATA_RDY at 100 Hz, cycle mode with DATA_RDY at every
+ * wake-up rate, and motion wake-up. Each is one sample read per period, none
+ * for motion wake-up.
+ *
+ ******************************************************************************
+ */
+
+#include "test.h"
+
+#define TEST_INT_LINE MPU6050_I2C_ADDRESS_1
+#define TEST_PWR1_PLL_XGYRO 0x01U /*! CLKSEL PLL with X gyro reference */
+#define TEST_IDLE_NS 40000000000ULL /*! Simulated time of each idle measurement */
+#define TEST_HOUR_NS 3600000000000ULL
+#define TEST_POLL_HZ 100U
+
+/**
+ * @brief   Shake the device along X, over any motion threshold
+ */
+static void test_shake(i2c_sim_device_t *pdev, bool shake) {
+  i2c_sim_set_signal(pdev, I2C_SIM_ACCEL_X, 0, shake ? 4000 : 0, 1.0f);
+}
+
+/**
+ * @brief   Transactions of an idle window scaled to an hour, written as a CSV row and checked
+ * @param   pbus: Pointer to simulated bus, statistics reset at the window start
+ * @param   pname: Mode name
+ * @param   rate_hz: Expected sample reads per second
+ */
+static void test_idle_hour(const i2c_sim_bus_t *pbus, const char *pname, double rate_hz) {
+  double expected = rate_hz * (TEST_IDLE_NS * 1e-9);
+  CHECK_NEAR(pbus->stats.transactions, expected, 1.0);
+  printf("%s,%.0f\n", pname, (double)pbus->stats.transactions * TEST_HOUR_NS / TEST_IDLE_NS);
+}
+
+int main(void) {
+  i2c_sim_bus_t bus;
+  i2c_sim_device_t dev;
+  mpu6050_t imu;
+  i2c_sim_bus_init(&bus, I2C_SIM_SPEED_400KHZ);
+  CHECK(test_device_up(&bus, &dev, &imu, MPU6050_I2C_ADDRESS_1) == MPU6050_OK);
+  i2c_sim_set_signal(&dev, I2C_SIM_ACCEL_Z, 16384, 0, 0);
+  const mpu6050_init_step_t steps[] = {
+      MPU6050_INIT_REG(MPU6050_PWR_MGMT_1, TEST_PWR1_PLL_XGYRO),
+  };
+  CHECK(mpu6050_init_table(&imu, steps, 1, MPU6050_INIT_TIMEOUT_US) == MPU6050_OK);
+  CHECK(mpu6050_set_standby(&imu, MPU6050_STBY_ZA) == MPU6050_OK);
+
+  /* Cycle mode at 5 Hz: accel only, internal oscillator */
+  CHECK(mpu6050_cycle_start(&imu, MPU6050_LP_WAKE_5HZ) == MPU6050_OK);
+  CHECK(dev.regs[MPU6050_PWR_MGMT_1] ==
+        ((1U << MPU6050_PWR1_CYCLE_OFFSET) | (1U << MPU6050_PWR1_TEMP_DIS_OFFSET)));
+  CHECK(dev.regs[MPU6050_PWR_MGMT_2] ==
+        ((MPU6050_LP_WAKE_5HZ << MPU6050_PWR2_LP_WAKE_CTRL_OFFSET) | MPU6050_STBY_GYRO));
+  CHECK(mpu6050_cycle_start(&imu, MPU6050_LP_WAKE_5HZ) != MPU6050_OK);
+  /* Device updates are lazy, a read brings the sample count up to date */
+  mpu6050_sample_t sample;
+  CHECK(mpu6050_read_all_raw(&imu, &sample) == MPU6050_OK);
+  uint64_t samples_start = dev.samples;
+  i2c_sim_run(&bus, 10000000000ULL);
+  CHECK(mpu6050_read_all_raw(&imu, &sample) == MPU6050_OK);
+  CHECK(dev.samples - samples_start >= 49 && dev.samples - samples_start <= 51);
+  CHECK(sample.gyro[0] == 0 && sample.temp == 0);
+
+  /* Stop restores the power configuration from before the start */
+  CHECK(mpu6050_cycle_stop(&imu) == MPU6050_OK);
+  CHECK(dev.regs[MPU6050_PWR_MGMT_1] == TEST_PWR1_PLL_XGYRO);
+  CHECK(dev.regs[MPU6050_PWR_MGMT_2] == MPU6050_STBY_ZA);
+  i2c_sim_stats_reset(&bus);
+  CHECK(mpu6050_cycle_stop(&imu) == MPU6050_OK);
+  CHECK(bus.stats.transactions == 0);
+
+  /* Motion wake-up, pulsed INT: idle without bus traffic, DATA_RDY given back at stop */
+  mpu6050_int_config_t config = {0};
+  CHECK(mpu6050_int_config(&imu, &config) == MPU6050_OK);
+  CHECK(mpu6050_int_enable(&imu, MPU6050_INT_DATA_RDY) == MPU6050_OK);
+  CHECK(mpu6050_motion_config(&imu, 100, 1) == MPU6050_OK);
+  CHECK(mpu6050_motion_wake_start(&imu, TEST_INT_LINE, MPU6050_LP_WAKE_5HZ) == MPU6050_OK);
+  CHECK(dev.regs[MPU6050_INT_ENABLE] == MPU6050_INT_MOTION);
+  i2c_sim_stats_reset(&bus);
+  i2c_sim_run(&bus, 60000000000ULL);
+  CHECK(bus.stats.transactions == 0);
+  CHECK(!mpu6050_is_motion_detected(&imu));
+  test_shake(&dev, true);
+  i2c_sim_run(&bus, 2000000000ULL);
+  CHECK(imu.motion_events > 1);
+  CHECK(mpu6050_is_motion_detected(&imu));
+  CHECK(bus.stats.transactions == 0);
+  CHECK(mpu6050_motion_wake_stop(&imu) == MPU6050_OK);
+  CHECK(dev.regs[MPU6050_INT_ENABLE] == MPU6050_INT_DATA_RDY);
+  CHECK(dev.regs[MPU6050_PWR_MGMT_1] == TEST_PWR1_PLL_XGYRO);
+  CHECK(dev.regs[MPU6050_PWR_MGMT_2] == MPU6050_STBY_ZA);
+
+  /* Latched INT: held until the event is consumed, then motion interrupts again */
+  test_shake(&dev, false);
+  config.latch = true;
+  CHECK(mpu6050_int_config(&imu, &config) == MPU6050_OK);
+  CHECK(mpu6050_int_enable(&imu, 0) == MPU6050_OK);
+  CHECK(mpu6050_motion_wake_start(&imu, TEST_INT_LINE, MPU6050_LP_WAKE_5HZ) == MPU6050_OK);
+  i2c_sim_run(&bus, 1000000000ULL);
+  test_shake(&dev, true);
+  i2c_sim_run(&bus, 2000000000ULL);
+  CHECK(imu.motion_events == 1);
+  CHECK(dev.int_held);
+  i2c_sim_stats_reset(&bus);
+  CHECK(mpu6050_is_motion_detected(&imu));
+  CHECK(bus.stats.transactions == 1);
+  CHECK(!dev.int_held);
+  i2c_sim_run(&bus, 2000000000ULL);
+  CHECK(imu.motion_events == 2);
+  CHECK(mpu6050_is_motion_detected(&imu));
+  CHECK(mpu6050_motion_wake_stop(&imu) == MPU6050_OK);
+  CHECK(dev.regs[MPU6050_INT_ENABLE] == 0);
+
+  /* Transactions per idle hour */
+  test_shake(&dev, false);
+  config.latch = false;
+  CHECK(mpu6050_int_config(&imu, &config) == MPU6050_OK);
+  CHECK(mpu6050_set_odr(&imu, TEST_POLL_HZ, 0.0f, NULL) == MPU6050_OK);
+  printf("mode,transactions_per_hour\n");
+  i2c_sim_stats_reset(&bus);
+  uint64_t start_ns = i2c_sim_now(&bus);
+  for (uint64_t t = 0; t < TEST_IDLE_NS; t += 1000000000ULL / TEST_POLL_HZ) {
+    i2c_sim_run(&bus, start_ns + t - i2c_sim_now(&bus));
+    CHECK(mpu6050_read_all_raw(&imu, &sample) == MPU6050_OK);
+  }
+  test_idle_hour(&bus, "polling_100hz", TEST_POLL_HZ);
+
+  CHECK(mpu6050_drdy_start(&imu, TEST_INT_LINE, NULL) == MPU6050_OK);
+  i2c_sim_stats_reset(&bus);
+  i2c_sim_run(&bus, TEST_IDLE_NS);
+  test_idle_hour(&bus, "drdy_100hz", TEST_POLL_HZ);
+  CHECK(mpu6050_drdy_stop(&imu) == MPU6050_OK);
+
+  static const struct {
+    mpu6050_lp_wake_t rate;
+    double rate_hz;
+    const char *pname;
+  } wakes[] = {{MPU6050_LP_WAKE_1_25HZ, 1.25, "cycle_drdy_1.25hz"},
+               {MPU6050_LP_WAKE_5HZ, 5.0, "cycle_drdy_5hz"},
+               {MPU6050_LP_WAKE_20HZ, 20.0, "cycle_drdy_20hz"},
+               {MPU6050_LP_WAKE_40HZ, 40.0, "cycle_drdy_40hz"}};
+  for (uint32_t w = 0; w < sizeof(wakes) / sizeof(wakes[0]); w++) {
+    CHECK(mpu6050_cycle_start(&imu, wakes[w].rate) == MPU6050_OK);
+    CHECK(mpu6050_drdy_start(&imu, TEST_INT_LINE, NULL) == MPU6050_OK);
+    i2c_sim_stats_reset(&bus);
+    i2c_sim_run(&bus, TEST_IDLE_NS);
+    test_idle_hour(&bus, wakes[w].pname, wakes[w].rate_hz);
+    CHECK(mpu6050_drdy_stop(&imu) == MPU6050_OK);
+    CHECK(mpu6050_cycle_stop(&imu) == MPU6050_OK);
+  }
+
+  CHECK(mpu6050_int_enable(&imu, 0) == MPU6050_OK);
+  CHECK(mpu6050_motion_wake_start(&imu, TEST_INT_LINE, MPU6050_LP_WAKE_1_25HZ) == MPU6050_OK);
+  i2c_sim_stats_reset(&bus);
+  i2c_sim_run(&bus, TEST_IDLE_NS);
+  test_idle_hour(&bus, "motion_wake", 0.0);
+  CHECK(mpu6050_motion_wake_stop(&imu) == MPU6050_OK);
+  return TEST_RESULT();
+}
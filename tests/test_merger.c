@@ -0,0 +1,121 @@
+/**
+ ******************************************************************************
+ * @file           : test_merger.c
+ * @author         : Gonzalo Gabriel Fernandez
+ * @brief          : Time-ordered merge of sample rings test
+ ******************************************************************************
+ * @attention
+ *
+ * The merger emits the oldest head sample once every ring holds one, or
+ * once it reaches the latency bound with a ring empty. A sample of a ring
+ * that stalled beyond the bound comes after newer ones and is discarded as
+ * late. Interleaved streams with random arrival come out fully ordered and
+ * complete.
+ *
+ ******************************************************************************
+ */
+
+#include <stdlib.h>
+
+#include "mpu6050_aggregator.h"
+#include "test.h"
+
+#define TEST_STREAMS 3U
+#define TEST_LATENCY_NS 100U
+#define TEST_RANDOM_SAMPLES 30000U
+
+static mpu6050_ring_t rings[TEST_STREAMS];
+
+/**
+ * @brief   Push a sample into a ring, the sample value is its timestamp
+ */
+static void test_push(uint8_t stream, uint64_t timestamp_ns) {
+  mpu6050_ring_slot_t *pslot = mpu6050_ring_acquire(&rings[stream]);
+  CHECK(pslot != NULL);
+  if (pslot == NULL)
+    return;
+  pslot->timestamp_ns = timestamp_ns;
+  pslot->sample.accel[0] = (uint16_t)timestamp_ns;
+  mpu6050_ring_commit(&rings[stream]);
+}
+
+int main(void) {
+  mpu6050_merger_t merger;
+  mpu6050_merged_t out;
+  mpu6050_merger_init(&merger, TEST_LATENCY_NS);
+  for (uint8_t i = 0; i < TEST_STREAMS; i++) {
+    mpu6050_ring_init(&rings[i]);
+    CHECK(mpu6050_merger_add(&merger, &rings[i]) == MPU6050_OK);
+  }
+  CHECK(!mpu6050_merger_next(&merger, 0, &out));
+
+  /* Held while a ring is empty and the oldest sample is within the bound */
+  test_push(0, 10);
+  test_push(1, 5);
+  CHECK(!mpu6050_merger_next(&merger, 50, &out));
+  test_push(2, 7);
+  CHECK(mpu6050_merger_next(&merger, 50, &out));
+  CHECK(out.timestamp_ns == 5 && out.stream == 1 && out.sample.accel[0] == 5);
+
+  /* Ring 1 empty again: emitted at the bound only */
+  CHECK(!mpu6050_merger_next(&merger, 7 + TEST_LATENCY_NS - 1U, &out));
+  CHECK(mpu6050_merger_next(&merger, 7 + TEST_LATENCY_NS, &out));
+  CHECK(out.timestamp_ns == 7 && out.stream == 2);
+  CHECK(mpu6050_merger_next(&merger, 10 + TEST_LATENCY_NS, &out));
+  CHECK(out.timestamp_ns == 10 && out.stream == 0);
+
+  /* Ring 1 stalled past the bound: its old sample is late and discarded */
+  test_push(1, 8);
+  test_push(0, 20);
+  test_push(2, 30);
+  CHECK(mpu6050_merger_next(&merger, 200, &out));
+  CHECK(out.timestamp_ns == 20 && out.stream == 0);
+  CHECK(merger.late == 1 && merger.merged == 4);
+  CHECK(mpu6050_merger_next(&merger, 200, &out) && out.timestamp_ns == 30);
+  CHECK(!mpu6050_merger_next(&merger, 1000, &out));
+
+  /* Too many rings */
+  mpu6050_merger_t full;
+  mpu6050_merger_init(&full, TEST_LATENCY_NS);
+  for (uint32_t i = 0; i < MPU6050_MERGER_MAX_STREAMS; i++)
+    CHECK(mpu6050_merger_add(&full, &rings[0]) == MPU6050_OK);
+  CHECK(mpu6050_merger_add(&full, &rings[0]) != MPU6050_OK);
+
+  /* Random arrival, every ring fed in order: one ordered stream, nothing late */
+  mpu6050_merger_init(&merger, UINT64_MAX / 2U);
+  for (uint8_t i = 0; i < TEST_STREAMS; i++) {
+    mpu6050_ring_init(&rings[i]);
+    CHECK(mpu6050_merger_add(&merger, &rings[i]) == MPU6050_OK);
+  }
+  srand(1);
+  uint64_t next_ns[TEST_STREAMS] = {1, 2, 3};
+  uint32_t pushed = 0;
+  uint32_t merged = 0;
+  uint32_t disorder = 0;
+  uint64_t last_ns = 0;
+  while (pushed < TEST_RANDOM_SAMPLES) {
+    /* A full ring waits for the empty ones, nothing is forced out by the bound */
+    uint8_t stream = (uint8_t)(rand() % TEST_STREAMS);
+    if (rings[stream].head - rings[stream].tail == MPU6050_RING_SIZE)
+      continue;
+    test_push(stream, next_ns[stream]);
+    next_ns[stream] += 1U + (uint64_t)(rand() % 50);
+    pushed++;
+    while (mpu6050_merger_next(&merger, 0, &out)) {
+      if (out.timestamp_ns < last_ns)
+        disorder++;
+      last_ns = out.timestamp_ns;
+      merged++;
+    }
+  }
+  /* End of the streams: the rest goes out once past the bound */
+  while (mpu6050_merger_next(&merger, UINT64_MAX, &out)) {
+    if (out.timestamp_ns < last_ns)
+      disorder++;
+    last_ns = out.timestamp_ns;
+    merged++;
+  }
+  CHECK(disorder == 0 && merger.late == 0);
+  CHECK(merged == pushed);
+  return TEST_RESULT();
+}
@@ -0,0 +1,131 @@
+/**
+ ******************************************************************************
+ * @file           : test_multi_device.c
+ * @author         : Gonzalo Gabriel Fernandez
+ * @brief          : Several devices on several buses test
+ ******************************************************************************
+ * @attention
+ *
+ * Two devices at both slave addresses on one bus and a third one on a second
+ * bus are driven through their own handles. Configuration and samples of a
+ * device never reach another one, and the round-robin scheduler reads every
+ * device of a bus in turn. Eight devices, two on each of four 400 kHz buses
+ * with a scheduler per bus, keep every bus busy back to back, and their
+ * aggregate rate goes to stdout as CSV.
+ *
+ ******************************************************************************
+ */
+
+#include "test.h"
+
+#define TEST_BUSES 4U
+#define TEST_WINDOW_NS 100000000U /*! Scheduler run of every bus */
+
+static i2c_sim_bus_t buses[TEST_BUSES];
+static i2c_sim_device_t devices[TEST_BUSES][2];
+static mpu6050_t imus[TEST_BUSES][2];
+static mpu6050_sched_t scheds[TEST_BUSES];
+
+int main(void) {
+  i2c_sim_bus_t bus1;
+  i2c_sim_bus_t bus2;
+  i2c_sim_device_t dev[3];
+  mpu6050_t imu[3];
+  i2c_sim_bus_init(&bus1, I2C_SIM_SPEED_400KHZ);
+  i2c_sim_bus_init(&bus2, I2C_SIM_SPEED_100KHZ);
+  CHECK(test_device_up(&bus1, &dev[0], &imu[0], MPU6050_I2C_ADDRESS_1) == MPU6050_OK);
+  CHECK(test_device_up(&bus1, &dev[1], &imu[1], MPU6050_I2C_ADDRESS_2) == MPU6050_OK);
+  CHECK(test_device_up(&bus2, &dev[2], &imu[2], MPU6050_I2C_ADDRESS_1) == MPU6050_OK);
+  for (uint8_t i = 0; i < 3; i++) {
+    i2c_sim_set_signal(&dev[i], I2C_SIM_ACCEL_X, 1000.0f * (i + 1), 0, 0);
+    i2c_sim_set_signal(&dev[i], I2C_SIM_GYRO_Z, -100.0f * (i + 1), 0, 0);
+    CHECK(mpu6050_sanity_check(&imu[i]) == MPU6050_OK);
+  }
+
+  /* No device on the second address of bus 2 */
+  mpu6050_t absent;
+  CHECK(mpu6050_init(&absent, &bus2, MPU6050_I2C_ADDRESS_2) != MPU6050_OK);
+
+  /* Configuration goes to its own device only */
+  CHECK(mpu6050_gyro_set_fullscale(&imu[1], MPU6050_GYRO_CONFIG_2000DPS) == MPU6050_OK);
+  CHECK(dev[1].regs[MPU6050_GYRO_CONFIG] != 0);
+  CHECK(dev[0].regs[MPU6050_GYRO_CONFIG] == 0);
+  CHECK(dev[2].regs[MPU6050_GYRO_CONFIG] == 0);
+
+  i2c_sim_run(&bus1, 2000000U);
+  i2c_sim_run(&bus2, 2000000U);
+  for (uint8_t i = 0; i < 3; i++) {
+    mpu6050_sample_t sample;
+    CHECK(mpu6050_read_all_raw(&imu[i], &sample) == MPU6050_OK);
+    CHECK(raw16(sample.accel[0]) == 1000 * (i + 1));
+    CHECK(raw16(sample.gyro[2]) == -100 * (i + 1));
+  }
+
+  /* Non-blocking reads of both devices of bus 1 chained by the scheduler */
+  static mpu6050_sched_t sched;
+  mpu6050_sched_init(&sched);
+  CHECK(mpu6050_sched_add(&sched, &imu[0]) == MPU6050_OK);
+  CHECK(mpu6050_sched_add(&sched, &imu[1]) == MPU6050_OK);
+  CHECK(mpu6050_sched_add(&sched, &imu[1]) != MPU6050_OK);
+  CHECK(mpu6050_sched_add(&sched, &imu[2]) != MPU6050_OK); /* other bus */
+  i2c_sim_stats_reset(&bus1);
+  i2c_sim_stats_reset(&bus2);
+  CHECK(mpu6050_sched_start(&sched) == MPU6050_OK);
+  i2c_sim_run(&bus1, 100000000U);
+  mpu6050_sched_stop(&sched);
+  i2c_sim_run(&bus1, 1000000U);
+  CHECK(sched.rounds > 100);
+  /* Back to back sample reads, one per device and round */
+  CHECK(bus1.stats.transactions >= 2U * sched.rounds);
+  CHECK(bus1.stats.transactions <= 2U * sched.rounds + 2U);
+  CHECK(bus2.stats.transactions == 0);
+  for (uint8_t i = 0; i < 2; i++) {
+    mpu6050_sample_t sample;
+    CHECK(mpu6050_read_all_from_buffer(&imu[i], &sample) == MPU6050_OK);
+    CHECK(raw16(sample.accel[0]) == 1000 * (i + 1));
+  }
+
+  /* Eight devices, four buses of two, one scheduler per bus */
+  static const mpu6050_i2c_address_t addresses[2] = {MPU6050_I2C_ADDRESS_1,
+                                                     MPU6050_I2C_ADDRESS_2};
+  uint32_t total = 0;
+  i2c_sim_report_t report;
+  for (uint32_t b = 0; b < TEST_BUSES; b++) {
+    i2c_sim_bus_init(&buses[b], I2C_SIM_SPEED_400KHZ);
+    mpu6050_sched_init(&scheds[b]);
+    for (uint32_t d = 0; d < 2; d++) {
+      CHECK(test_device_up(&buses[b], &devices[b][d], &imus[b][d], addresses[d]) == MPU6050_OK);
+      i2c_sim_set_signal(&devices[b][d], I2C_SIM_ACCEL_X, 100.0f * (2U * b + d + 1U), 0, 0);
+      CHECK(mpu6050_sched_add(&scheds[b], &imus[b][d]) == MPU6050_OK);
+    }
+    i2c_sim_stats_reset(&buses[b]);
+    CHECK(mpu6050_sched_start(&scheds[b]) == MPU6050_OK);
+  }
+  /* Buses run in turn, each on its own simulated clock */
+  for (uint32_t b = 0; b < TEST_BUSES; b++) {
+    uint64_t start_ns = i2c_sim_now(&buses[b]);
+    i2c_sim_run(&buses[b], TEST_WINDOW_NS);
+    mpu6050_sched_stop(&scheds[b]);
+    uint64_t elapsed_ns = i2c_sim_now(&buses[b]) - start_ns;
+    uint32_t samples = 2U * scheds[b].rounds;
+    total += samples;
+    /* Back to back: the bus idles at most one transfer in the whole window */
+    uint64_t transfer_ns = i2c_sim_transfer_ns(&buses[b], 1, MPU6050_SENSOR_DATA_LEN);
+    CHECK(buses[b].stats.busy_ns + transfer_ns >= elapsed_ns);
+    CHECK(samples >= elapsed_ns / transfer_ns - 1U);
+    i2c_sim_run(&buses[b], 1000000U);
+    for (uint32_t d = 0; d < 2; d++) {
+      mpu6050_sample_t sample;
+      CHECK(mpu6050_read_all_from_buffer(&imus[b][d], &sample) == MPU6050_OK);
+      CHECK(raw16(sample.accel[0]) == (int)(100U * (2U * b + d + 1U)));
+    }
+    i2c_sim_report(&buses[b], "sched_bus", samples, elapsed_ns, &report);
+    i2c_sim_report_csv(stdout, &report, b == 0);
+  }
+  i2c_sim_report(&buses[0], "sched_8_devices", total, TEST_WINDOW_NS, &report);
+  printf("devices,buses,samples_per_s\n8,%u,%.0f\n", TEST_BUSES, report.samples_per_s);
+  /* Four buses add up, each one as many samples as 14 byte reads fit back to back */
+  double bus_rate = 1e9 / i2c_sim_transfer_ns(&buses[0], 1, MPU6050_SENSOR_DATA_LEN);
+  CHECK(report.samples_per_s >= TEST_BUSES * bus_rate * 0.99);
+  return TEST_RESULT();
+}
@@ -0,0 +1,143 @@
+/**
+ ******************************************************************************
+ * @file           : test_plan.c
+ * @author         : Gonzalo Gabriel Fernandez
+ * @brief          : Bus budget planner and output data rate selection test
+ ******************************************************************************
+ * @attention
+ *
+ * The SCL cycles the planner gives per sample are the cost of the same
+ * transactions on the simulated bus, per sensor, burst and FIFO drains, and
+ * the bus time measured for blocking reads. Occupancy drops from per-sensor
+ * to burst to FIFO, configurations over the occupancy limit or with a FIFO
+ * batch over 1024 bytes are rejected with the highest rate that fits.
+ * mpu6050_set_odr writes the divider and DLPF read back from the simulated
+ * registers, for automatic and explicit bandwidths.
+ *
+ ******************************************************************************
+ */
+
+#include "mpu6050_plan.h"
+#include "test.h"
+
+#define TEST_CYCLE_NS (1000000000U / I2C_SIM_SPEED_400KHZ) /*! SCL cycle at 400 kHz */
+
+static i2c_sim_bus_t bus;
+static i2c_sim_device_t dev;
+static mpu6050_t imu;
+
+/**
+ * @brief   SCL cycles of a register read on the simulated bus
+ */
+static uint32_t test_read_bits(uint16_t data_amount) {
+  return (uint32_t)(i2c_sim_transfer_ns(&bus, 1, data_amount) / TEST_CYCLE_NS);
+}
+
+/**
+ * @brief   Plan of one device at 400 kHz
+ * @retval  mpu6050_status_t of mpu6050_plan
+ */
+static mpu6050_status_t test_plan(mpu6050_plan_mode_t mode, float odr_hz, uint16_t fifo_batch,
+                                  mpu6050_plan_t *pplan) {
+  mpu6050_plan_config_t config = {
+      .bus_hz = I2C_SIM_SPEED_400KHZ,
+      .mode = mode,
+      .devices = 1,
+      .odr_hz = odr_hz,
+      .fifo_sel = MPU6050_FIFO_SEL_ACCEL | MPU6050_FIFO_SEL_GYRO,
+      .fifo_batch = fifo_batch,
+  };
+  return mpu6050_plan(&config, pplan);
+}
+
+/**
+ * @brief   Set an output data rate and check the registers written
+ */
+static void test_odr(float odr_hz, float bandwidth_hz, mpu6050_dlpf_t dlpf, uint8_t divider,
+                     float achieved_hz) {
+  float rate_hz = 0.0f;
+  CHECK(mpu6050_set_odr(&imu, odr_hz, bandwidth_hz, &rate_hz) == MPU6050_OK);
+  CHECK((dev.regs[MPU6050_CONFIG] & MPU6050_DLPF_CFG_MASK) == dlpf);
+  CHECK(dev.regs[MPU6050_SMPLRT_DIV] == divider);
+  CHECK_NEAR(rate_hz, achieved_hz, 1e-3);
+}
+
+int main(void) {
+  i2c_sim_bus_init(&bus, I2C_SIM_SPEED_400KHZ);
+  CHECK(test_device_up(&bus, &dev, &imu, MPU6050_I2C_ADDRESS_1) == MPU6050_OK);
+
+  /* SCL cycles per sample: the simulated cost of the transactions of each mode */
+  mpu6050_plan_t per_sensor;
+  mpu6050_plan_t burst;
+  mpu6050_plan_t fifo;
+  CHECK(test_plan(MPU6050_PLAN_PER_SENSOR, 100.0f, 0, &per_sensor) == MPU6050_OK);
+  CHECK(test_plan(MPU6050_PLAN_BURST, 100.0f, 0, &burst) == MPU6050_OK);
+  CHECK(test_plan(MPU6050_PLAN_FIFO, 100.0f, 40, &fifo) == MPU6050_OK);
+  CHECK(per_sensor.bits_per_sample == test_read_bits(6) + test_read_bits(2) + test_read_bits(6));
+  CHECK(burst.bits_per_sample == test_read_bits(MPU6050_SENSOR_DATA_LEN));
+  uint32_t drain_bits = test_read_bits(1) + test_read_bits(2) + test_read_bits(12U * 40U);
+  CHECK(fifo.bits_per_sample == (drain_bits + 39U) / 40U);
+  CHECK_NEAR(burst.bus_us_per_sample, burst.bits_per_sample * TEST_CYCLE_NS * 1e-3, 1e-3);
+
+  /* Blocking reads take the planned bus time */
+  uint16_t x, y, z, temp;
+  i2c_sim_stats_reset(&bus);
+  CHECK(mpu6050_accel_read_raw(&imu, &x, &y, &z) == MPU6050_OK);
+  CHECK(mpu6050_temp_read_raw(&imu, &temp) == MPU6050_OK);
+  CHECK(mpu6050_gyro_read_raw(&imu, &x, &y, &z) == MPU6050_OK);
+  CHECK(bus.stats.transactions == 3U);
+  CHECK(bus.stats.busy_ns == (uint64_t)per_sensor.bits_per_sample * TEST_CYCLE_NS);
+  mpu6050_sample_t sample;
+  i2c_sim_stats_reset(&bus);
+  CHECK(mpu6050_read_all_raw(&imu, &sample) == MPU6050_OK);
+  CHECK(bus.stats.busy_ns == (uint64_t)burst.bits_per_sample * TEST_CYCLE_NS);
+
+  /* Occupancy and transactions: per-sensor over burst over FIFO */
+  CHECK(per_sensor.occupancy > burst.occupancy && burst.occupancy > fifo.occupancy);
+  CHECK_NEAR(burst.occupancy, burst.bits_per_sample * 100.0 / I2C_SIM_SPEED_400KHZ, 1e-6);
+  CHECK_NEAR(per_sensor.transactions_per_s, 300.0, 1e-3);
+  CHECK_NEAR(burst.transactions_per_s, 100.0, 1e-3);
+  CHECK_NEAR(fifo.transactions_per_s, 300.0 / 40.0, 1e-3);
+
+  /* Over the occupancy limit: rejected, with the highest rate that fits */
+  mpu6050_plan_t plan;
+  CHECK(test_plan(MPU6050_PLAN_BURST, 4000.0f, 0, &plan) != MPU6050_OK);
+  CHECK(plan.occupancy > 0.8f);
+  CHECK_NEAR(plan.max_odr_hz, 0.8 * I2C_SIM_SPEED_400KHZ / plan.bits_per_sample, 1e-2);
+  CHECK(test_plan(MPU6050_PLAN_BURST, plan.max_odr_hz * 0.99f, 0, &plan) == MPU6050_OK);
+  mpu6050_plan_config_t config = {
+      .bus_hz = I2C_SIM_SPEED_400KHZ,
+      .mode = MPU6050_PLAN_PER_SENSOR,
+      .devices = 4,
+      .odr_hz = 500.0f,
+      .max_occupancy = 0.5f,
+  };
+  CHECK(mpu6050_plan(&config, &plan) != MPU6050_OK);
+  CHECK_NEAR(plan.max_odr_hz, 0.5 * I2C_SIM_SPEED_400KHZ / (4.0 * plan.bits_per_sample), 1e-2);
+  CHECK_NEAR(plan.transactions_per_s, 3.0 * 4.0 * 500.0, 1e-2);
+
+  /* FIFO batch over 1024 bytes: rejected even within the occupancy limit */
+  CHECK(test_plan(MPU6050_PLAN_FIFO, 100.0f, MPU6050_FIFO_SIZE / 12U, &plan) == MPU6050_OK);
+  CHECK(test_plan(MPU6050_PLAN_FIFO, 100.0f, MPU6050_FIFO_SIZE / 12U + 1U, &plan) !=
+        MPU6050_OK);
+  CHECK(plan.occupancy < 0.8f);
+  CHECK_NEAR(plan.max_odr_hz, 0.8 * I2C_SIM_SPEED_400KHZ / plan.bits_per_sample, 1e-2);
+
+  /* Invalid configurations */
+  CHECK(test_plan(MPU6050_PLAN_BURST, 0.0f, 0, &plan) != MPU6050_OK);
+  CHECK(test_plan(MPU6050_PLAN_FIFO, 100.0f, 0, &plan) != MPU6050_OK);
+  config.devices = 0;
+  CHECK(mpu6050_plan(&config, &plan) != MPU6050_OK);
+
+  /* Output data rate: 1 kHz and 8 kHz run the gyro at 8 kHz with the DLPF off, 200 Hz takes
+     the widest filter below its Nyquist frequency, an explicit bandwidth the narrowest that
+     keeps it */
+  test_odr(1000.0f, 0.0f, MPU6050_DLPF_260HZ, 7, 1000.0f);
+  test_odr(200.0f, 0.0f, MPU6050_DLPF_94HZ, 4, 200.0f);
+  test_odr(8000.0f, 0.0f, MPU6050_DLPF_260HZ, 0, 8000.0f);
+  test_odr(100.0f, 40.0f, MPU6050_DLPF_44HZ, 9, 100.0f);
+  test_odr(1000.0f, 180.0f, MPU6050_DLPF_184HZ, 0, 1000.0f);
+  test_odr(3.0f, 0.0f, MPU6050_DLPF_5HZ, 255, 1000.0f / 256.0f);
+  CHECK(mpu6050_set_odr(&imu, 0.0f, 0.0f, NULL) != MPU6050_OK);
+  return TEST_RESULT();
+}
@@ -0,0 +1,116 @@
+/**
+ ******************************************************************************
+ * @file           : test_queue.c
+ * @author         : Gonzalo Gabriel Fernandez
+ * @brief          : I2C transaction queue test
+ ******************************************************************************
+ * @attention
+ *
+ * Queued transactions go back to back: each one starts when the previous
+ * one completes, with no idle gap on the bus. Sample reads submitted behind
+ * housekeeping transactions go ahead of them. Blocking register accesses
+ * share the bus with a running stream.
+ *
+ ******************************************************************************
+ */
+
+#include "mpu6050_ring.h"
+#include "port_i2c.h"
+#include "test.h"
+
+#define TEST_TRANSFERS 8U
+
+/**
+ * @brief Completion record of a queued transaction
+ */
+typedef struct {
+  uint32_t index;         /*!< Submit order */
+  uint64_t done_ns;       /*!< Completion time */
+  bool next_started;      /*!< A transaction was in flight at the callback */
+  uint64_t next_start_ns; /*!< Start time of the transaction in flight */
+
+} test_completion_t;
+
+static i2c_sim_bus_t bus;
+static test_completion_t completions[TEST_TRANSFERS];
+static uint32_t completed;
+
+/**
+ * @brief   Completion callback, records the time and the transaction started after it
+ */
+static void test_callback(void *pcontext, mpu6050_status_t status) {
+  CHECK(status == MPU6050_OK);
+  completions[completed] = (test_completion_t){
+      .index = (uint32_t)(uintptr_t)pcontext,
+      .done_ns = i2c_sim_now(&bus),
+      .next_started = bus.dma_pending,
+      .next_start_ns = bus.dma_start_ns,
+  };
+  completed++;
+}
+
+int main(void) {
+  i2c_sim_device_t dev1;
+  i2c_sim_device_t dev2;
+  i2c_sim_bus_init(&bus, I2C_SIM_SPEED_400KHZ);
+  i2c_sim_device_init(&dev1, MPU6050_I2C_ADDRESS_1);
+  i2c_sim_device_init(&dev2, MPU6050_I2C_ADDRESS_2);
+  CHECK(i2c_sim_attach(&bus, &dev1) == MPU6050_OK);
+  CHECK(i2c_sim_attach(&bus, &dev2) == MPU6050_OK);
+
+  /* Mixed reads and writes, odd ones are sample reads */
+  static uint8_t buffers[TEST_TRANSFERS][MPU6050_SENSOR_DATA_LEN];
+  uint8_t divider = 0;
+  uint64_t expected_ns = 0;
+  uint64_t submit_ns = i2c_sim_now(&bus);
+  for (uint32_t i = 0; i < TEST_TRANSFERS; i++) {
+    bool write = (i % 3U) == 0;
+    i2c_transaction_t transaction = {
+        .op = write ? I2C_QUEUE_WRITE : I2C_QUEUE_READ,
+        .priority = (i % 2U) ? I2C_QUEUE_PRIO_SAMPLE : I2C_QUEUE_PRIO_HOUSEKEEPING,
+        .slave_address = ((i % 2U) ? MPU6050_I2C_ADDRESS_1 : MPU6050_I2C_ADDRESS_2) << 1,
+        .reg_address = write ? MPU6050_SMPLRT_DIV : MPU6050_ACCEL_XOUT_H,
+        .pdata = write ? &divider : buffers[i],
+        .data_amount = write ? 1 : MPU6050_SENSOR_DATA_LEN,
+        .callback = test_callback,
+        .pcontext = (void *)(uintptr_t)i,
+    };
+    CHECK(i2c_queue_submit(&bus, &transaction) == MPU6050_OK);
+    expected_ns += write ? i2c_sim_transfer_ns(&bus, 2, 0)
+                         : i2c_sim_transfer_ns(&bus, 1, MPU6050_SENSOR_DATA_LEN);
+  }
+  i2c_sim_run(&bus, 10000000U);
+  CHECK(completed == TEST_TRANSFERS);
+
+  /* The first one starts on submit, the sample reads overtake the housekeeping ones */
+  static const uint32_t order[TEST_TRANSFERS] = {0, 1, 3, 5, 7, 2, 4, 6};
+  for (uint32_t i = 0; i < TEST_TRANSFERS; i++)
+    CHECK(completions[i].index == order[i]);
+
+  /* Zero idle gap: every start is the previous completion */
+  for (uint32_t i = 0; i + 1U < TEST_TRANSFERS; i++) {
+    CHECK(completions[i].next_started);
+    CHECK(completions[i].next_start_ns == completions[i].done_ns);
+  }
+  CHECK(!completions[TEST_TRANSFERS - 1U].next_started);
+  CHECK(completions[TEST_TRANSFERS - 1U].done_ns - submit_ns == expected_ns);
+  CHECK(bus.stats.busy_ns == expected_ns);
+
+  /* Blocking accesses in between the stream reads */
+  mpu6050_t imu;
+  static mpu6050_ring_t ring;
+  CHECK(mpu6050_init(&imu, &bus, MPU6050_I2C_ADDRESS_1) == MPU6050_OK);
+  mpu6050_ring_init(&ring);
+  CHECK(mpu6050_stream_start(&imu, &ring) == MPU6050_OK);
+  i2c_sim_run(&bus, 5000000U);
+  CHECK(mpu6050_set_sample_divider(&imu, 9) == MPU6050_OK);
+  CHECK(i2c_reg_read(&bus, MPU6050_I2C_ADDRESS_1 << 1, MPU6050_SMPLRT_DIV, &divider) ==
+        MPU6050_OK);
+  CHECK(divider == 9);
+  i2c_sim_run(&bus, 5000000U);
+  CHECK(mpu6050_is_streaming(&imu));
+  CHECK(mpu6050_ring_count(&ring) > 0);
+  CHECK(bus.queue.errors == 0);
+  mpu6050_stream_stop(&imu);
+  return TEST_RESULT();
+}
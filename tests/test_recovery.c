@@ -0,0 +1,185 @@
+/**
+ ******************************************************************************
+ * @file           : test_recovery.c
+ * @author         : Gonzalo Gabriel Fernandez
+ * @brief          : Transaction timeouts, bus recovery and bounded retries test
+ ******************************************************************************
+ * @attention
+ *
+ * A 1 kHz loop of sample reads runs with every kind of injected fault: NACK,
+ * bus error, a slave holding SDA and a device brown-out. No read fails, the
+ * device configuration survives, the data is right but for the start-up
+ * time of a browned-out device, and the worst loop latency stays within a
+ * few milliseconds. A bus that never recovers fails the read within the
+ * retry budget and one more attempt. DATA_RDY acquisition watched by
+ * i2c_queue_check accounts for every interrupt and goes on.
+ *
+ ******************************************************************************
+ */
+
+#include "port_i2c.h"
+#include "test.h"
+
+#define TEST_LOOPS 5000U
+#define TEST_LOOP_NS 1000000U  /*! 1 kHz control loop */
+#define TEST_WORST_NS 2500000U /*! Worst loop latency allowed at 400 kHz */
+#define TEST_DATA_DIVIDER 0x00U
+#define TEST_INT_LINE MPU6050_I2C_ADDRESS_1
+
+/**
+ * @brief Fault injection scenario
+ */
+typedef struct {
+  i2c_sim_fault_t fault; /*!< Fault injected */
+  uint32_t period;       /*!< Every period-th transaction faults */
+
+} test_scenario_t;
+
+/**
+ * @brief Control loop outcome
+ */
+typedef struct {
+  uint64_t worst_ns; /*!< Worst loop latency */
+  uint32_t bad;      /*!< Successful reads with wrong data */
+
+} test_result_t;
+
+/**
+ * @brief   Bring up a device sampling at 1 kHz, gravity on Z
+ */
+static void test_setup(i2c_sim_bus_t *pbus, i2c_sim_device_t *pdev, mpu6050_t *hmpu,
+                       i2c_sim_speed_t speed) {
+  i2c_sim_bus_init(pbus, speed);
+  CHECK(test_device_up(pbus, pdev, hmpu, MPU6050_I2C_ADDRESS_1) == MPU6050_OK);
+  i2c_sim_set_signal(pdev, I2C_SIM_ACCEL_Z, 16384, 0, 0);
+  CHECK(mpu6050_set_dlpf(hmpu, MPU6050_DLPF_44HZ) == MPU6050_OK);
+  CHECK(mpu6050_set_sample_divider(hmpu, TEST_DATA_DIVIDER) == MPU6050_OK);
+  mpu6050_recovery_reset(hmpu);
+}
+
+/**
+ * @brief   Control loop under a fault scenario
+ * @retval  Worst loop latency and wrong data reads
+ */
+static test_result_t test_loop(i2c_sim_bus_t *pbus, i2c_sim_device_t *pdev, mpu6050_t *hmpu,
+                               const test_scenario_t *pscenario) {
+  test_result_t result = {0};
+  uint32_t failures = 0;
+  i2c_sim_fault_inject(pbus, pscenario->fault, pscenario->period);
+  for (uint32_t i = 0; i < TEST_LOOPS; i++) {
+    uint64_t start_ns = i2c_sim_now(pbus);
+    mpu6050_sample_t sample;
+    mpu6050_status_t status = mpu6050_read_all_raw(hmpu, &sample);
+    uint64_t elapsed_ns = i2c_sim_now(pbus) - start_ns;
+    if (elapsed_ns > result.worst_ns)
+      result.worst_ns = elapsed_ns;
+    if (status != MPU6050_OK)
+      failures++;
+    else if (raw16(sample.accel[2]) != 16384)
+      result.bad++;
+    if (elapsed_ns < TEST_LOOP_NS)
+      i2c_sim_run(pbus, TEST_LOOP_NS - elapsed_ns);
+  }
+  i2c_sim_fault_inject(pbus, I2C_SIM_FAULT_NONE, 0);
+  CHECK(failures == 0);
+  CHECK(pbus->stats.faults >= TEST_LOOPS / pscenario->period);
+
+  /* Configuration as before, device awake */
+  CHECK(pdev->regs[MPU6050_SMPLRT_DIV] == TEST_DATA_DIVIDER);
+  CHECK((pdev->regs[MPU6050_CONFIG] & MPU6050_DLPF_CFG_MASK) == MPU6050_DLPF_44HZ);
+  CHECK((pdev->regs[MPU6050_PWR_MGMT_1] & (1U << MPU6050_PWR1_SLEEP_OFFSET)) == 0);
+  return result;
+}
+
+int main(void) {
+  i2c_sim_bus_t bus;
+  i2c_sim_device_t dev;
+  mpu6050_t imu;
+
+  /* Timeouts follow the transfer length and the bus speed */
+  i2c_sim_bus_init(&bus, I2C_SIM_SPEED_400KHZ);
+  uint32_t short_us = i2c_timeout_us(&bus, 1);
+  uint32_t long_us = i2c_timeout_us(&bus, MPU6050_SENSOR_DATA_LEN);
+  CHECK(long_us > short_us);
+  CHECK(long_us >= I2C_TIMEOUT_MARGIN * i2c_sim_transfer_ns(&bus, 2, MPU6050_SENSOR_DATA_LEN) /
+                       1000U);
+  CHECK(long_us < 1000U);
+  i2c_sim_bus_init(&bus, I2C_SIM_SPEED_100KHZ);
+  CHECK(i2c_timeout_us(&bus, MPU6050_SENSOR_DATA_LEN) > long_us);
+
+  /* Every fault kind at 400 kHz, each one recovered by its own path */
+  static const test_scenario_t scenarios[] = {
+      {I2C_SIM_FAULT_NONE, TEST_LOOPS + 1U}, {I2C_SIM_FAULT_NACK, 97},
+      {I2C_SIM_FAULT_BUS, 89},               {I2C_SIM_FAULT_STUCK, 101},
+      {I2C_SIM_FAULT_RESET, 503},            {I2C_SIM_FAULT_STUCK, 2},
+  };
+  for (uint32_t i = 0; i < sizeof(scenarios) / sizeof(scenarios[0]); i++) {
+    test_setup(&bus, &dev, &imu, I2C_SIM_SPEED_400KHZ);
+    test_result_t result = test_loop(&bus, &dev, &imu, &scenarios[i]);
+    CHECK(result.worst_ns < TEST_WORST_NS);
+    if (scenarios[i].fault != I2C_SIM_FAULT_RESET)
+      CHECK(result.bad == 0);
+    mpu6050_recovery_t recovery;
+    mpu6050_recovery_read(&imu, &recovery);
+    CHECK(recovery.failures == 0);
+    CHECK(recovery.max_ns < TEST_WORST_NS);
+    switch (scenarios[i].fault) {
+    case I2C_SIM_FAULT_NONE:
+      CHECK(recovery.retries == 0);
+      CHECK(result.worst_ns == i2c_sim_transfer_ns(&bus, 1, MPU6050_SENSOR_DATA_LEN));
+      break;
+    case I2C_SIM_FAULT_BUS:
+      CHECK(recovery.recoveries == bus.stats.faults);
+      break;
+    case I2C_SIM_FAULT_STUCK:
+      CHECK(bus.queue.timeouts == bus.stats.faults && bus.queue.recoveries == bus.stats.faults);
+      break;
+    case I2C_SIM_FAULT_RESET:
+      /* Configuration written back, zero data until the first sample after the start-up */
+      CHECK(recovery.restores == bus.stats.faults);
+      CHECK(result.bad <= bus.stats.faults * (I2C_SIM_STARTUP_NS / TEST_LOOP_NS + 1U));
+      break;
+    default:
+      CHECK(recovery.retries == bus.stats.faults);
+      break;
+    }
+  }
+
+  /* A bus that stays stuck fails the read within the retry budget, not a 100 ms stall: the
+     first attempt, attempts started within the budget, each one its timeout and recovery */
+  test_setup(&bus, &dev, &imu, I2C_SIM_SPEED_400KHZ);
+  i2c_sim_fault_inject(&bus, I2C_SIM_FAULT_STUCK, 1);
+  uint64_t start_ns = i2c_sim_now(&bus);
+  mpu6050_sample_t sample;
+  CHECK(mpu6050_read_all_raw(&imu, &sample) != MPU6050_OK);
+  uint64_t attempt_ns = (uint64_t)i2c_timeout_us(&bus, MPU6050_SENSOR_DATA_LEN) * 1000U;
+  CHECK(i2c_sim_now(&bus) - start_ns < MPU6050_RETRY_BUDGET_US * 1000U + 2U * attempt_ns +
+                                           100000U);
+  mpu6050_recovery_t recovery;
+  mpu6050_recovery_read(&imu, &recovery);
+  CHECK(recovery.failures == 1);
+  i2c_sim_fault_inject(&bus, I2C_SIM_FAULT_NONE, 0);
+  CHECK(mpu6050_recover(&imu) == MPU6050_OK);
+  CHECK(mpu6050_read_all_raw(&imu, &sample) == MPU6050_OK);
+
+  /* DATA_RDY watched by the queue check: a stuck read times out and the interrupt during it
+     is missed, every other interrupt is read */
+  test_setup(&bus, &dev, &imu, I2C_SIM_SPEED_400KHZ);
+  mpu6050_int_config_t config = {0};
+  CHECK(mpu6050_int_config(&imu, &config) == MPU6050_OK);
+  CHECK(mpu6050_drdy_start(&imu, TEST_INT_LINE, NULL) == MPU6050_OK);
+  i2c_sim_fault_inject(&bus, I2C_SIM_FAULT_STUCK, 50);
+  uint32_t completed = bus.queue.completed;
+  for (uint32_t i = 0; i < 1000U; i++) {
+    i2c_sim_run(&bus, TEST_LOOP_NS);
+    i2c_queue_check(&bus);
+  }
+  i2c_sim_fault_inject(&bus, I2C_SIM_FAULT_NONE, 0);
+  CHECK(bus.queue.timeouts > 0 && bus.queue.timeouts == bus.queue.recoveries);
+  CHECK(imu.drdy_missed == bus.queue.timeouts);
+  uint32_t read = bus.queue.completed - completed;
+  CHECK(read + bus.queue.timeouts + imu.drdy_missed + 1U >= imu.drdy_edges);
+  CHECK(read >= 1000U - 2U * bus.queue.timeouts - 1U);
+  CHECK(mpu6050_drdy_stop(&imu) == MPU6050_OK);
+  return TEST_RESULT();
+}
@@ -0,0 +1,129 @@
+/**
+ ******************************************************************************
+ * @file           : test_ring_stress.c
+ * @author         : Gonzalo Gabriel Fernandez
+ * @brief          : Sample ring producer/consumer stress test
+ ******************************************************************************
+ * @attention
+ *
+ * A producer thread publishes numbered samples as fast as it can, dropping
+ * them when the ring is full as the DMA completion does, and a consumer
+ * thread drains the ring in batches. Every sample received must be whole and
+ * in order, and the gaps in the numbering must add up to the samples the ring
+ * reports as dropped. Then the same accounting is checked for a device
+ * streaming on the simulated bus.
+ *
+ ******************************************************************************
+ */
+
+#include <pthread.h>
+#include <sched.h>
+
+#include "mpu6050_ring.h"
+#include "test.h"
+
+#define TEST_SAMPLES 1000000U
+
+static mpu6050_ring_t ring;
+static volatile bool producer_done;
+
+/**
+ * @brief   Producer thread, the sequence number goes into every channel and the timestamp
+ */
+static void *test_producer(void *parg) {
+  (void)parg;
+  for (uint32_t seq = 0; seq < TEST_SAMPLES; seq++) {
+    /* Bursts of samples, so the consumer gets to run on a single core as well */
+    if ((seq & 0x7U) == 0)
+      sched_yield();
+    mpu6050_ring_slot_t *pslot = mpu6050_ring_acquire(&ring);
+    if (pslot == NULL) {
+      mpu6050_ring_drop(&ring);
+      continue;
+    }
+    pslot->timestamp_ns = seq;
+    for (uint8_t axis = 0; axis < 3; axis++) {
+      pslot->sample.accel[axis] = (uint16_t)seq;
+      pslot->sample.gyro[axis] = (uint16_t)(seq >> 16);
+    }
+    pslot->sample.temp = (uint16_t)~seq;
+    mpu6050_ring_commit(&ring);
+  }
+  __atomic_store_n(&producer_done, true, __ATOMIC_RELEASE);
+  return NULL;
+}
+
+int main(void) {
+  mpu6050_ring_init(&ring);
+  pthread_t producer;
+  CHECK(pthread_create(&producer, NULL, test_producer, NULL) == 0);
+
+  uint64_t received = 0;
+  uint64_t lost = 0;
+  uint64_t next = 0;
+  uint32_t batches = 0;
+  for (;;) {
+    bool done = __atomic_load_n(&producer_done, __ATOMIC_ACQUIRE);
+    const mpu6050_ring_slot_t *pslots;
+    uint32_t count = mpu6050_ring_peek_batch(&ring, &pslots);
+    if (count == 0) {
+      if (done && mpu6050_ring_count(&ring) == 0)
+        break;
+      sched_yield();
+      continue;
+    }
+    for (uint32_t i = 0; i < count; i++) {
+      uint32_t seq = (uint32_t)pslots[i].timestamp_ns;
+      CHECK(seq >= next);
+      lost += seq - next;
+      next = (uint64_t)seq + 1U;
+      for (uint8_t axis = 0; axis < 3; axis++) {
+        CHECK(pslots[i].sample.accel[axis] == (uint16_t)seq);
+        CHECK(pslots[i].sample.gyro[axis] == (uint16_t)(seq >> 16));
+      }
+      CHECK(pslots[i].sample.temp == (uint16_t)~seq);
+    }
+    received += count;
+    mpu6050_ring_release(&ring, count);
+    /* A consumer that falls behind now and then, the producer overruns the ring */
+    if ((++batches & 0xFFU) == 0)
+      for (uint8_t stall = 0; stall < 8U; stall++)
+        sched_yield();
+  }
+  pthread_join(producer, NULL);
+
+  lost += TEST_SAMPLES - next;
+  CHECK(received + ring.drops == TEST_SAMPLES);
+  CHECK(lost == ring.drops);
+  CHECK(ring.overruns == ring.drops);
+  CHECK(received > 0 && ring.drops > 0);
+  printf("ring: %llu received, %u dropped\n", (unsigned long long)received, ring.drops);
+
+  /* Streaming device: samples read are received or dropped, one overrun per drop */
+  i2c_sim_bus_t bus;
+  i2c_sim_device_t dev;
+  mpu6050_t imu;
+  i2c_sim_bus_init(&bus, I2C_SIM_SPEED_400KHZ);
+  CHECK(test_device_up(&bus, &dev, &imu, MPU6050_I2C_ADDRESS_1) == MPU6050_OK);
+  mpu6050_ring_init(&ring);
+  uint32_t completed_start = bus.queue.completed;
+  CHECK(mpu6050_stream_start(&imu, &ring) == MPU6050_OK);
+  received = 0;
+  for (uint32_t k = 0; k < 2000; k++) {
+    /* Drained every 100 us, or every 10 ms to overrun the ring */
+    i2c_sim_run(&bus, (k % 200 < 150) ? 100000U : 10000000U);
+    mpu6050_sample_t sample;
+    while (mpu6050_ring_pop(&ring, &sample))
+      received++;
+  }
+  mpu6050_stream_stop(&imu);
+  i2c_sim_run(&bus, 1000000U);
+  CHECK(!mpu6050_is_streaming(&imu));
+  mpu6050_sample_t sample;
+  while (mpu6050_ring_pop(&ring, &sample))
+    received++;
+  CHECK(ring.drops > 0);
+  CHECK(ring.overruns == ring.drops);
+  CHECK(received + ring.drops == bus.queue.completed - completed_start);
+  return TEST_RESULT();
+}
@@ -0,0 +1,81 @@
+/**
+ ******************************************************************************
+ * @file           : test_shadow.c
+ * @author         : Gonzalo Gabriel Fernandez
+ * @brief          : Configuration registers shadow test
+ ******************************************************************************
+ * @attention
+ *
+ * With the shadow valid, configuration reads take no bus transaction and a
+ * read-modify-write setter is a single write. A device reset invalidates the
+ * shadow and reads go to the bus until it is resynchronized.
+ *
+ ******************************************************************************
+ */
+
+#include "test.h"
+
+int main(void) {
+  i2c_sim_bus_t bus;
+  i2c_sim_device_t dev;
+  mpu6050_t imu;
+  i2c_sim_bus_init(&bus, I2C_SIM_SPEED_400KHZ);
+  CHECK(test_device_up(&bus, &dev, &imu, MPU6050_I2C_ADDRESS_1) == MPU6050_OK);
+  CHECK(imu.shadow.valid);
+
+  /* Reads served from memory */
+  uint8_t config;
+  uint8_t pwrmgmt[2];
+  i2c_sim_stats_reset(&bus);
+  CHECK(mpu6050_gyro_read_config(&imu, &config) == MPU6050_OK);
+  CHECK(mpu6050_accel_read_config(&imu, &config) == MPU6050_OK);
+  CHECK(mpu6050_read_pwrmgmt(&imu, pwrmgmt) == MPU6050_OK);
+  CHECK(bus.stats.transactions == 0);
+
+  /* Read-modify-write setters are one write each */
+  CHECK(mpu6050_gyro_set_fullscale(&imu, MPU6050_GYRO_CONFIG_2000DPS) == MPU6050_OK);
+  CHECK(mpu6050_accel_set_fullscale(&imu, MPU6050_ACCEL_CONFIG_8G) == MPU6050_OK);
+  CHECK(mpu6050_set_dlpf(&imu, MPU6050_DLPF_44HZ) == MPU6050_OK);
+  CHECK(bus.stats.transactions == 3);
+  CHECK(bus.stats.bytes_read == 0);
+  CHECK(dev.regs[MPU6050_GYRO_CONFIG] ==
+        (MPU6050_GYRO_CONFIG_2000DPS << MPU6050_GYRO_FS_SEL_OFFSET));
+  CHECK(dev.regs[MPU6050_ACCEL_CONFIG] ==
+        (MPU6050_ACCEL_CONFIG_8G << MPU6050_ACCEL_FS_SEL_OFFSET));
+  CHECK(imu.shadow.gyro_config == dev.regs[MPU6050_GYRO_CONFIG]);
+  CHECK(imu.shadow.accel_config == dev.regs[MPU6050_ACCEL_CONFIG]);
+  CHECK(imu.shadow.config == dev.regs[MPU6050_CONFIG]);
+
+  /* Read back from the shadow matches the device */
+  i2c_sim_stats_reset(&bus);
+  CHECK(mpu6050_gyro_read_config(&imu, &config) == MPU6050_OK);
+  CHECK(config == dev.regs[MPU6050_GYRO_CONFIG]);
+  CHECK(bus.stats.transactions == 0);
+
+  /* Output registers are never shadowed */
+  mpu6050_sample_t sample;
+  CHECK(mpu6050_read_all_raw(&imu, &sample) == MPU6050_OK);
+  CHECK(bus.stats.transactions == 1);
+
+  /* A device reset invalidates the shadow, reads go to the bus again */
+  const mpu6050_init_step_t steps[] = {
+      MPU6050_INIT_REG(MPU6050_PWR_MGMT_1, 1U << MPU6050_PWR1_DEVICE_RESET_OFFSET),
+  };
+  CHECK(mpu6050_init_table(&imu, steps, 1, MPU6050_INIT_TIMEOUT_US) == MPU6050_OK);
+  CHECK(!imu.shadow.valid);
+  i2c_sim_run(&bus, I2C_SIM_RESET_NS);
+  i2c_sim_stats_reset(&bus);
+  CHECK(mpu6050_gyro_read_config(&imu, &config) == MPU6050_OK);
+  CHECK(config == 0);
+  CHECK(bus.stats.transactions == 1);
+
+  /* Resync: four bursts, then reads from memory again */
+  i2c_sim_stats_reset(&bus);
+  CHECK(mpu6050_shadow_resync(&imu) == MPU6050_OK);
+  CHECK(imu.shadow.valid);
+  CHECK(bus.stats.transactions == 4);
+  i2c_sim_stats_reset(&bus);
+  CHECK(mpu6050_gyro_read_config(&imu, &config) == MPU6050_OK);
+  CHECK(bus.stats.transactions == 0);
+  return TEST_RESULT();
+}
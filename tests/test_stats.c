@@ -0,0 +1,156 @@
+/**
+ ******************************************************************************
+ * @file           : test_stats.c
+ * @author         : Gonzalo Gabriel Fernandez
+ * @brief          : Transaction statistics test, driver built with MPU6050_STATS
+ ******************************************************************************
+ * @attention
+ *
+ * Transactions and bytes are counted by kind, shadow hits apart, failures
+ * by their detailed status, and latencies land in the histogram bucket of
+ * their bus time, or of the ticks of a custom counter. Snapshots taken by
+ * another thread while the driver updates are always consistent.
+ *
+ ******************************************************************************
+ */
+
+#include <pthread.h>
+
+#include "test.h"
+
+#ifndef MPU6050_STATS
+#error "test_stats needs the driver built with MPU6050_STATS"
+#endif
+
+#define TEST_READS 10U
+#define TEST_CONCURRENT_READS 200000U
+#define TEST_COUNTER_STEP 7U
+
+static uint32_t counter_ticks;
+static mpu6050_t imu;
+static volatile bool writer_done;
+
+/**
+ * @brief   Custom latency counter, a fixed step per call
+ */
+static uint32_t test_counter(void) { return counter_ticks += TEST_COUNTER_STEP; }
+
+/**
+ * @brief   Histogram total of a transaction kind
+ */
+static uint32_t test_histogram_total(const mpu6050_stats_t *pstats, mpu6050_xfer_kind_t kind) {
+  uint32_t total = 0;
+  for (uint32_t i = 0; i < MPU6050_STATS_BUCKETS; i++)
+    total += pstats->latency[kind][i];
+  return total;
+}
+
+/**
+ * @brief   Snapshot reader, checks every snapshot against the invariants of the burst reads
+ * @note    Counts the inconsistent snapshots in the uint32_t given as argument.
+ */
+static void *test_snapshot_reader(void *parg) {
+  uint32_t *pinconsistent = parg;
+  uint32_t last = 0;
+  while (!writer_done) {
+    mpu6050_stats_t stats;
+    CHECK(mpu6050_stats_snapshot(&imu, &stats) == MPU6050_OK);
+    uint32_t transactions = stats.transactions[MPU6050_XFER_BURST_READ];
+    if (stats.bytes[MPU6050_XFER_BURST_READ] != transactions * MPU6050_SENSOR_DATA_LEN ||
+        test_histogram_total(&stats, MPU6050_XFER_BURST_READ) != transactions ||
+        transactions < last)
+      (*pinconsistent)++;
+    last = transactions;
+  }
+  return NULL;
+}
+
+int main(void) {
+  i2c_sim_bus_t bus;
+  i2c_sim_device_t dev;
+  i2c_sim_bus_init(&bus, I2C_SIM_SPEED_400KHZ);
+  CHECK(test_device_up(&bus, &dev, &imu, MPU6050_I2C_ADDRESS_1) == MPU6050_OK);
+  mpu6050_stats_t stats;
+  mpu6050_stats_reset(&imu);
+  CHECK(mpu6050_stats_snapshot(&imu, &stats) == MPU6050_OK);
+  CHECK(stats.transactions[MPU6050_XFER_BURST_READ] == 0 && stats.shadow_hits == 0);
+
+  /* One transaction of each kind per call, latency in ns of port time */
+  mpu6050_sample_t sample;
+  for (uint32_t i = 0; i < TEST_READS; i++)
+    CHECK(mpu6050_read_all_raw(&imu, &sample) == MPU6050_OK);
+  CHECK(mpu6050_set_sample_divider(&imu, 9) == MPU6050_OK);
+  uint8_t config;
+  CHECK(mpu6050_gyro_read_config(&imu, &config) == MPU6050_OK);
+  uint8_t status;
+  CHECK(mpu6050_int_read_status(&imu, &status) == MPU6050_OK);
+  CHECK(mpu6050_fetch_all(&imu) == MPU6050_OK);
+  i2c_sim_run(&bus, 1000000U);
+  CHECK(mpu6050_is_data_ready(&imu));
+  CHECK(mpu6050_stats_snapshot(&imu, &stats) == MPU6050_OK);
+  CHECK(stats.transactions[MPU6050_XFER_BURST_READ] == TEST_READS);
+  CHECK(stats.bytes[MPU6050_XFER_BURST_READ] == TEST_READS * MPU6050_SENSOR_DATA_LEN);
+  CHECK(stats.transactions[MPU6050_XFER_REG_WRITE] == 1);
+  CHECK(stats.bytes[MPU6050_XFER_REG_WRITE] == 1);
+  CHECK(stats.transactions[MPU6050_XFER_REG_READ] == 1);
+  CHECK(stats.bytes[MPU6050_XFER_REG_READ] == 1);
+  CHECK(stats.shadow_hits == 1);
+  CHECK(stats.transactions[MPU6050_XFER_NONBLOCKING] == 1);
+  CHECK(stats.bytes[MPU6050_XFER_NONBLOCKING] == MPU6050_SENSOR_DATA_LEN);
+  for (uint32_t e = 0; e < MPU6050_STATUS_CODES; e++)
+    CHECK(stats.errors[e] == 0);
+
+  /* A burst read takes its transfer time, the percentiles land in its log2 bucket */
+  uint32_t burst_ns = (uint32_t)i2c_sim_transfer_ns(&bus, 1, MPU6050_SENSOR_DATA_LEN);
+  CHECK(stats.latency_max[MPU6050_XFER_BURST_READ] == burst_ns);
+  CHECK(test_histogram_total(&stats, MPU6050_XFER_BURST_READ) == TEST_READS);
+  CHECK(stats.latency[MPU6050_XFER_BURST_READ][32 - __builtin_clz(burst_ns)] == TEST_READS);
+  CHECK(mpu6050_stats_percentile(&stats, MPU6050_XFER_BURST_READ, 50) == burst_ns);
+  CHECK(mpu6050_stats_percentile(&stats, MPU6050_XFER_BURST_READ, 99) == burst_ns);
+  CHECK(stats.latency_max[MPU6050_XFER_NONBLOCKING] == burst_ns);
+  CHECK(mpu6050_stats_percentile(&stats, MPU6050_XFER_REG_READ, 50) ==
+        (uint32_t)i2c_sim_transfer_ns(&bus, 1, 1));
+
+  /* Custom counter: every transaction takes one step of ticks */
+  mpu6050_stats_set_counter(&imu, test_counter);
+  mpu6050_stats_reset(&imu);
+  for (uint32_t i = 0; i < TEST_READS; i++)
+    CHECK(mpu6050_read_all_raw(&imu, &sample) == MPU6050_OK);
+  CHECK(mpu6050_stats_snapshot(&imu, &stats) == MPU6050_OK);
+  CHECK(stats.latency_max[MPU6050_XFER_BURST_READ] == TEST_COUNTER_STEP);
+  CHECK(stats.latency[MPU6050_XFER_BURST_READ][3] == TEST_READS);
+  CHECK(mpu6050_stats_percentile(&stats, MPU6050_XFER_BURST_READ, 50) == TEST_COUNTER_STEP);
+  mpu6050_stats_set_counter(&imu, NULL);
+
+  /* Failures count by their detailed port status, without bytes or latency */
+  mpu6050_stats_reset(&imu);
+  i2c_sim_fault_inject(&bus, I2C_SIM_FAULT_BUS, 1);
+  CHECK(mpu6050_read_all_raw(&imu, &sample) != MPU6050_OK);
+  i2c_sim_fault_inject(&bus, I2C_SIM_FAULT_NONE, 0);
+  CHECK(mpu6050_stats_snapshot(&imu, &stats) == MPU6050_OK);
+  CHECK(stats.transactions[MPU6050_XFER_BURST_READ] == 1);
+  CHECK(stats.errors[MPU6050_ERROR_BUS] >= 1);
+  CHECK(stats.bytes[MPU6050_XFER_BURST_READ] == 0);
+  CHECK(test_histogram_total(&stats, MPU6050_XFER_BURST_READ) == 0);
+  CHECK(mpu6050_stats_percentile(&stats, MPU6050_XFER_BURST_READ, 50) == 0);
+  mpu6050_t absent;
+  CHECK(mpu6050_init(&absent, &bus, MPU6050_I2C_ADDRESS_2) != MPU6050_OK);
+  CHECK(mpu6050_stats_snapshot(&absent, &stats) == MPU6050_OK);
+  CHECK(stats.errors[MPU6050_ERROR_NACK] == stats.transactions[MPU6050_XFER_BURST_READ]);
+  CHECK(stats.errors[MPU6050_ERROR_NACK] >= 1);
+
+  /* Snapshots from another thread while the driver updates */
+  CHECK(mpu6050_read_all_raw(&imu, &sample) == MPU6050_OK);
+  mpu6050_stats_reset(&imu);
+  uint32_t inconsistent = 0;
+  pthread_t reader;
+  CHECK(pthread_create(&reader, NULL, test_snapshot_reader, &inconsistent) == 0);
+  for (uint32_t i = 0; i < TEST_CONCURRENT_READS; i++)
+    CHECK(mpu6050_read_all_raw(&imu, &sample) == MPU6050_OK);
+  writer_done = true;
+  CHECK(pthread_join(reader, NULL) == 0);
+  CHECK(inconsistent == 0);
+  CHECK(mpu6050_stats_snapshot(&imu, &stats) == MPU6050_OK);
+  CHECK(stats.transactions[MPU6050_XFER_BURST_READ] == TEST_CONCURRENT_READS);
+  return TEST_RESULT();
+}
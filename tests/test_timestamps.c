@@ -0,0 +1,103 @@
+/**
+ ******************************************************************************
+ * @file           : test_timestamps.c
+ * @author         : Gonzalo Gabriel Fernandez
+ * @brief          : Sample timestamps and FIFO frame times test
+ ******************************************************************************
+ * @attention
+ *
+ * DATA_RDY samples carry the time of their interrupt, one period apart, and
+ * the interval statistics see no jitter. With the device clock off its
+ * nominal rate, the FIFO frame period is estimated from the drains and the
+ * back-computed frame times stay within one period of the real ones, plus
+ * the register reads before the drain time is taken.
+ *
+ ******************************************************************************
+ */
+
+#include "mpu6050_ring.h"
+#include "test.h"
+
+#define TEST_INT_LINE MPU6050_I2C_ADDRESS_1
+#define TEST_CLOCK_PPM 5000 /*! Device clock 0.5 % fast, within the oscillator tolerance */
+#define TEST_DRAINS 400U
+#define TEST_COUNT_READ_NS 200000U /*! INT_STATUS and FIFO count reads before the drain time */
+
+int main(void) {
+  i2c_sim_bus_t bus;
+  i2c_sim_device_t dev;
+  mpu6050_t imu;
+  static mpu6050_ring_t ring;
+  i2c_sim_bus_init(&bus, I2C_SIM_SPEED_400KHZ);
+  CHECK(test_device_up(&bus, &dev, &imu, MPU6050_I2C_ADDRESS_1) == MPU6050_OK);
+
+  /* DATA_RDY at 500 Hz: interrupt times, exact interval */
+  CHECK(mpu6050_set_odr(&imu, 500, 0, NULL) == MPU6050_OK);
+  mpu6050_int_config_t config = {0};
+  CHECK(mpu6050_int_config(&imu, &config) == MPU6050_OK);
+  mpu6050_ring_init(&ring);
+  mpu6050_timing_reset(&imu);
+  CHECK(mpu6050_drdy_start(&imu, TEST_INT_LINE, &ring) == MPU6050_OK);
+  uint32_t received = 0;
+  uint32_t off_period = 0;
+  uint64_t last_ns = 0;
+  for (uint32_t i = 0; i < 200; i++) {
+    i2c_sim_run(&bus, 5000000U);
+    const mpu6050_ring_slot_t *pslots;
+    uint32_t count;
+    while ((count = mpu6050_ring_peek_batch(&ring, &pslots)) != 0) {
+      for (uint32_t k = 0; k < count; k++) {
+        if (received > 0 && pslots[k].timestamp_ns - last_ns != 2000000U)
+          off_period++;
+        last_ns = pslots[k].timestamp_ns;
+        received++;
+      }
+      mpu6050_ring_release(&ring, count);
+    }
+  }
+  CHECK(mpu6050_drdy_stop(&imu) == MPU6050_OK);
+  CHECK(received >= 499);
+  CHECK(off_period == 0);
+  CHECK(mpu6050_read_timestamp(&imu) == last_ns);
+  mpu6050_timing_t timing;
+  mpu6050_timing_read(&imu, &timing);
+  CHECK(timing.samples == received);
+  CHECK(timing.mean_ns == 2000000U);
+  CHECK(timing.jitter_ns == 0);
+  CHECK(timing.min_ns == 2000000U && timing.max_ns == 2000000U);
+  mpu6050_timing_reset(&imu);
+  mpu6050_timing_read(&imu, &timing);
+  CHECK(timing.samples == 0);
+
+  /* FIFO at 1 kHz nominal, fast device clock, drains at irregular intervals */
+  dev.clock_ppm = TEST_CLOCK_PPM;
+  CHECK(mpu6050_set_odr(&imu, 1000, 0, NULL) == MPU6050_OK);
+  CHECK(mpu6050_fifo_enable(&imu, MPU6050_FIFO_SEL_ALL) == MPU6050_OK);
+  CHECK(mpu6050_fifo_period_ns(&imu) == 1000000U);
+  const uint64_t period_ns = 1000000ULL * 1000000U / (1000000U + TEST_CLOCK_PPM);
+  const uint64_t first_ns = dev.next_sample_ns;
+  static uint8_t buffer[1024];
+  uint64_t timestamps[sizeof(buffer) / 14];
+  uint32_t frames_total = 0;
+  uint64_t max_error_ns = 0;
+  for (uint32_t i = 0; i < TEST_DRAINS; i++) {
+    i2c_sim_run(&bus, 7300000U + (i % 5) * 100000U);
+    uint16_t frames;
+    CHECK(mpu6050_fifo_drain(&imu, buffer, sizeof(buffer), &frames) == MPU6050_OK);
+    CHECK(mpu6050_fifo_timestamps(&imu, frames, timestamps) == MPU6050_OK);
+    /* Frame times are checked once the period is estimated */
+    for (uint16_t k = 0; i >= TEST_DRAINS / 4 && k < frames; k++) {
+      uint64_t true_ns = first_ns + (uint64_t)(frames_total + k) * period_ns;
+      uint64_t error_ns = (timestamps[k] > true_ns) ? timestamps[k] - true_ns
+                                                    : true_ns - timestamps[k];
+      if (error_ns > max_error_ns)
+        max_error_ns = error_ns;
+    }
+    frames_total += frames;
+  }
+  CHECK_NEAR(frames_total, (double)(i2c_sim_now(&bus) - first_ns) / period_ns, 4.0);
+  CHECK_NEAR(mpu6050_fifo_period_ns(&imu), (double)period_ns, period_ns / 10000.0);
+  CHECK(max_error_ns < period_ns + TEST_COUNT_READ_NS);
+  CHECK(mpu6050_fifo_timestamps(&imu, imu.fifo_clock.backlog + 1U, timestamps) != MPU6050_OK);
+  return TEST_RESULT();
+}
@@ -0,0 +1,189 @@
+/**
+ ******************************************************************************
+ * @file           : test_vibration.c
+ * @author         : Gonzalo Gabriel Fernandez
+ * @brief          : Vibration analyzer tone amplitude and feature test
+ ******************************************************************************
+ * @attention
+ *
+ * A sine on accel X, on an FFT bin and between bins, over gravity on Y with
+ * Gaussian noise and a single shock on Z. The Goertzel amplitude at the tone
+ * is the sine amplitude, the spectrum matches a direct DFT in double, the
+ * band around the tone holds its RMS, and RMS, peak, crest factor and
+ * kurtosis take their closed form values for a sine, noise and an impulse.
+ * Windows come every hop samples, the same by block or sample by sample.
+ *
+ ******************************************************************************
+ */
+
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "mpu6050_vibration.h"
+#include "test.h"
+
+#define TEST_RATE_HZ 1000.0f
+#define TEST_HOP 128U
+#define TEST_SAMPLES 8192U
+#define TEST_AMPLITUDE 2000.0 /*! Sine amplitude in LSB */
+#define TEST_NOISE 800.0      /*! Noise standard deviation in LSB */
+#define TEST_SHOCK 12000      /*! Shock height in LSB */
+#define TEST_GRAVITY 16384
+#define TEST_WINDOWS ((TEST_SAMPLES - MPU6050_VIB_FFT_SIZE) / TEST_HOP + 1U)
+
+static mpu6050_vib_t vib;
+static mpu6050_sample_t in[TEST_SAMPLES];
+static mpu6050_vib_features_t features[TEST_WINDOWS];
+static mpu6050_vib_features_t pushed[TEST_WINDOWS];
+
+/**
+ * @brief   Gaussian noise, Box-Muller on rand
+ */
+static double test_gaussian(void) {
+  double u = (rand() + 1.0) / (RAND_MAX + 2.0);
+  double v = (rand() + 1.0) / (RAND_MAX + 2.0);
+  return sqrt(-2.0 * log(u)) * cos(2.0 * M_PI * v);
+}
+
+/**
+ * @brief   Direct DFT amplitude of accel X in the window ending at sample end, Hann window
+ */
+static double test_dft_amplitude(uint32_t end, uint32_t bin, double scale) {
+  uint32_t start = end - MPU6050_VIB_FFT_SIZE;
+  double mean = 0.0;
+  for (uint32_t n = 0; n < MPU6050_VIB_FFT_SIZE; n++)
+    mean += raw16(in[start + n].accel[0]);
+  mean /= MPU6050_VIB_FFT_SIZE;
+  double re = 0.0;
+  double im = 0.0;
+  double window_sum = 0.0;
+  for (uint32_t n = 0; n < MPU6050_VIB_FFT_SIZE; n++) {
+    double w = 0.5 - 0.5 * cos(2.0 * M_PI * n / MPU6050_VIB_FFT_SIZE);
+    double x = (raw16(in[start + n].accel[0]) - mean) * w * scale;
+    window_sum += w;
+    re += x * cos(2.0 * M_PI * bin * n / MPU6050_VIB_FFT_SIZE);
+    im -= x * sin(2.0 * M_PI * bin * n / MPU6050_VIB_FFT_SIZE);
+  }
+  double amplitude = 2.0 * sqrt(re * re + im * im) / window_sum;
+  return (bin == 0 || bin == MPU6050_VIB_FFT_SIZE / 2U) ? amplitude * 0.5 : amplitude;
+}
+
+int main(void) {
+  mpu6050_convert_scale_t scale;
+  mpu6050_convert_scale(MPU6050_GYRO_CONFIG_250DPS, MPU6050_ACCEL_CONFIG_2G, &scale);
+  const double lsb = scale.scale[0];
+  const double amplitude = TEST_AMPLITUDE * lsb;
+  const double resolution = TEST_RATE_HZ / MPU6050_VIB_FFT_SIZE;
+  static const double tones_hz[] = {32.0 * TEST_RATE_HZ / MPU6050_VIB_FFT_SIZE, 133.3};
+
+  for (uint32_t t = 0; t < sizeof(tones_hz) / sizeof(tones_hz[0]); t++) {
+    CHECK(mpu6050_vib_init(&vib, &scale, TEST_RATE_HZ, TEST_HOP, true) == MPU6050_OK);
+    CHECK(mpu6050_vib_add_band(&vib, 100.0f, 170.0f) == MPU6050_OK);
+    CHECK(mpu6050_vib_add_band(&vib, 0.0f, 500.0f) == MPU6050_OK);
+    CHECK(mpu6050_vib_add_tone(&vib, (float)tones_hz[t]) == MPU6050_OK);
+    CHECK(mpu6050_vib_add_tone(&vib, 300.0f) == MPU6050_OK);
+
+    srand(6050);
+    for (uint32_t n = 0; n < TEST_SAMPLES; n++) {
+      double phase = 2.0 * M_PI * tones_hz[t] * n / TEST_RATE_HZ + 0.4;
+      in[n].accel[0] = (uint16_t)(int16_t)lrint(TEST_AMPLITUDE * sin(phase));
+      in[n].accel[1] = (uint16_t)(int16_t)lrint(TEST_GRAVITY + TEST_NOISE * test_gaussian());
+      /* One shock in the last window only */
+      in[n].accel[2] = (uint16_t)(n == TEST_SAMPLES - 100U ? TEST_SHOCK : 0);
+    }
+    uint32_t windows = mpu6050_vib_process(&vib, in, TEST_SAMPLES, features);
+    CHECK(windows == TEST_WINDOWS);
+    for (uint32_t w = 0; w < windows; w++)
+      CHECK(features[w].window == w);
+
+    /* Sine on X: Goertzel amplitude at the tone, nothing at 300 Hz */
+    const mpu6050_vib_axis_t *px = &features[windows - 1U].axis[0];
+    CHECK_NEAR(px->tones[0], amplitude, amplitude * 0.002);
+    CHECK(px->tones[1] < amplitude * 0.001);
+    CHECK_NEAR(px->rms, amplitude / sqrt(2.0), amplitude * 0.005);
+    /* The peak is the largest sample, 125 Hz at 1 kHz never samples the crest of the sine */
+    double peak = 0.0;
+    double mean = 0.0;
+    for (uint32_t n = TEST_SAMPLES - MPU6050_VIB_FFT_SIZE; n < TEST_SAMPLES; n++)
+      mean += raw16(in[n].accel[0]) / (double)MPU6050_VIB_FFT_SIZE;
+    for (uint32_t n = TEST_SAMPLES - MPU6050_VIB_FFT_SIZE; n < TEST_SAMPLES; n++)
+      peak = fmax(peak, fabs(raw16(in[n].accel[0]) - mean) * lsb);
+    CHECK_NEAR(px->peak, peak, amplitude * 1e-4);
+    CHECK(peak > amplitude * 0.9 && peak <= amplitude * 1.001);
+    CHECK_NEAR(px->crest, px->peak / px->rms, 1e-4);
+    CHECK_NEAR(px->kurtosis, 1.5, 0.02);
+    CHECK_NEAR(px->bands[0], amplitude / sqrt(2.0), amplitude * 0.01);
+    CHECK_NEAR(px->bands[1], px->rms, amplitude * 0.01);
+
+    /* Spectrum against the direct DFT on every bin, the tone bin at the amplitude less the
+       Hann scalloping loss, at most 1.42 dB between bins */
+    double max_error = 0.0;
+    for (uint32_t k = 0; k < MPU6050_VIB_BINS; k++) {
+      double error = fabs(vib.spectrum[0][k] - test_dft_amplitude(TEST_SAMPLES, k, lsb));
+      if (error > max_error)
+        max_error = error;
+    }
+    CHECK(max_error < amplitude * 1e-4);
+    uint32_t bin = (uint32_t)lrint(tones_hz[t] / resolution);
+    CHECK(vib.spectrum[0][bin] <= amplitude * 1.001);
+    CHECK(vib.spectrum[0][bin] >= amplitude * pow(10.0, -1.43 / 20.0));
+    if (t == 0)
+      CHECK_NEAR(vib.spectrum[0][bin], amplitude, amplitude * 0.001);
+
+    /* Gaussian noise on Y: gravity removed, kurtosis 3 over the windows */
+    double rms = 0.0;
+    double kurtosis = 0.0;
+    for (uint32_t w = 0; w < windows; w++) {
+      rms += features[w].axis[1].rms;
+      kurtosis += features[w].axis[1].kurtosis;
+    }
+    CHECK_NEAR(rms / windows, TEST_NOISE * lsb, TEST_NOISE * lsb * 0.03);
+    CHECK_NEAR(kurtosis / windows, 3.0, 0.15);
+    CHECK_NEAR(features[windows - 1U].axis[1].bands[1], features[windows - 1U].axis[1].rms,
+               TEST_NOISE * lsb * 0.15);
+
+    /* Shock on Z: crest sqrt(N - 1), kurtosis (N^2 - 3N + 3) / (N - 1); flat windows give 0 */
+    const double n = MPU6050_VIB_FFT_SIZE;
+    const mpu6050_vib_axis_t *pz = &features[windows - 1U].axis[2];
+    CHECK_NEAR(pz->crest, sqrt(n - 1.0), 0.01);
+    CHECK_NEAR(pz->kurtosis, (n * n - 3.0 * n + 3.0) / (n - 1.0), 0.1);
+    CHECK_NEAR(pz->peak, TEST_SHOCK * lsb * (n - 1.0) / n, 1e-3);
+    CHECK(features[0].axis[2].rms == 0.0f && features[0].axis[2].crest == 0.0f);
+    CHECK(features[0].axis[2].kurtosis == 0.0f);
+  }
+
+  /* Sample by sample gives the same windows as the block */
+  mpu6050_vib_features_t last = features[TEST_WINDOWS - 1U];
+  mpu6050_vib_reset(&vib);
+  vib.windows = 0;
+  uint32_t count = 0;
+  for (uint32_t n = 0; n < TEST_SAMPLES; n++)
+    if (mpu6050_vib_push(&vib, in[n].accel[0], in[n].accel[1], in[n].accel[2], &pushed[count]))
+      count++;
+  CHECK(count == TEST_WINDOWS);
+  CHECK(memcmp(&pushed[count - 1U], &last, sizeof(last)) == 0);
+
+  /* After a reset a full window is needed again */
+  mpu6050_vib_reset(&vib);
+  mpu6050_vib_features_t out;
+  CHECK(mpu6050_vib_process(&vib, in, MPU6050_VIB_FFT_SIZE - 1U, &out) == 0);
+  CHECK(mpu6050_vib_process(&vib, in, 1, &out) == 1);
+
+  /* Limits */
+  CHECK(mpu6050_vib_init(&vib, &scale, TEST_RATE_HZ, 0, false) != MPU6050_OK);
+  CHECK(mpu6050_vib_init(&vib, &scale, TEST_RATE_HZ, MPU6050_VIB_FFT_SIZE + 1U, false) !=
+        MPU6050_OK);
+  CHECK(mpu6050_vib_init(&vib, &scale, 0.0f, TEST_HOP, false) != MPU6050_OK);
+  CHECK(mpu6050_vib_init(&vib, &scale, TEST_RATE_HZ, TEST_HOP, false) == MPU6050_OK);
+  CHECK(mpu6050_vib_add_band(&vib, 100.0f, 600.0f) != MPU6050_OK);
+  CHECK(mpu6050_vib_add_band(&vib, 1.0f, 2.0f) != MPU6050_OK);
+  CHECK(mpu6050_vib_add_tone(&vib, 500.0f) != MPU6050_OK);
+  for (uint32_t i = 0; i < MPU6050_VIB_MAX_BANDS; i++)
+    CHECK(mpu6050_vib_add_band(&vib, 10.0f, 20.0f) == MPU6050_OK);
+  CHECK(mpu6050_vib_add_band(&vib, 10.0f, 20.0f) != MPU6050_OK);
+  for (uint32_t i = 0; i < MPU6050_VIB_MAX_TONES; i++)
+    CHECK(mpu6050_vib_add_tone(&vib, 50.0f) == MPU6050_OK);
+  CHECK(mpu6050_vib_add_tone(&vib, 50.0f) != MPU6050_OK);
+  return TEST_RESULT();
+}
@@ -0,0 +1,98 @@
+/**
+ ******************************************************************************
+ * @file           : test_wrapper.cpp
+ * @author         : Gonzalo Gabriel Fernandez
+ * @brief          : C++17 wrapper test
+ ******************************************************************************
+ * @attention
+ *
+ * Register values and scale factors are compile-time constants, init wakes
+ * the device with the configured full scales, samples convert as the C
+ * formula, and every call returns the status of the C driver unchanged.
+ *
+ ******************************************************************************
+ */
+
+#include <cstring>
+
+#include "mpu6050.hpp"
+#include "test.h"
+
+using Imu = mpu6050::Mpu6050<mpu6050::SimBus, mpu6050::Address::Ad0Low, mpu6050::GyroFs::Dps500,
+                             mpu6050::AccelFs::G4>;
+
+static_assert(Imu::gyro_config == (MPU6050_GYRO_CONFIG_500DPS << MPU6050_GYRO_FS_SEL_OFFSET), "");
+static_assert(Imu::accel_config == (MPU6050_ACCEL_CONFIG_4G << MPU6050_ACCEL_FS_SEL_OFFSET), "");
+static_assert(Imu::convert(mpu6050_sample_t{{8192, 0, 0}, 0, {0, 0, 0}}).accel[0]() ==
+                  mpu6050::kStandardGravity,
+              "1 g at 4 g full scale");
+static_assert(sizeof(mpu6050::Sample) == 7 * sizeof(float), "Sample is a plain float array");
+
+/**
+ * @brief   Check a converted sample against the C formula, bit for bit
+ */
+static void test_check_convert(const mpu6050_sample_t &raw, const mpu6050::Sample &sample) {
+  const float accel = 4.0f * 9.80665f / 32768.0f;
+  const float gyro = 500.0f * 0.017453292519943295f / 32768.0f;
+  const float expected[7] = {
+      static_cast<int16_t>(raw.accel[0]) * accel,
+      static_cast<int16_t>(raw.accel[1]) * accel,
+      static_cast<int16_t>(raw.accel[2]) * accel,
+      static_cast<int16_t>(raw.temp) * (1.0f / 340.0f) + 36.53f,
+      static_cast<int16_t>(raw.gyro[0]) * gyro,
+      static_cast<int16_t>(raw.gyro[1]) * gyro,
+      static_cast<int16_t>(raw.gyro[2]) * gyro,
+  };
+  CHECK(std::memcmp(&sample, expected, sizeof(expected)) == 0);
+}
+
+int main() {
+  i2c_sim_bus_t bus;
+  i2c_sim_device_t dev;
+  i2c_sim_bus_init(&bus, I2C_SIM_SPEED_400KHZ);
+  i2c_sim_device_init(&dev, MPU6050_I2C_ADDRESS_1);
+  i2c_sim_set_signal(&dev, I2C_SIM_ACCEL_Z, 8192, 0, 0);
+  i2c_sim_set_signal(&dev, I2C_SIM_GYRO_Y, -655, 0, 0);
+  CHECK(i2c_sim_attach(&bus, &dev) == MPU6050_OK);
+
+  /* Init wakes the device with the compile-time full scales */
+  Imu imu(bus);
+  CHECK(imu.init() == MPU6050_OK);
+  CHECK(dev.regs[MPU6050_PWR_MGMT_1] == 0);
+  CHECK(dev.regs[MPU6050_GYRO_CONFIG] == Imu::gyro_config);
+  CHECK(dev.regs[MPU6050_ACCEL_CONFIG] == Imu::accel_config);
+  i2c_sim_run(&bus, I2C_SIM_STARTUP_NS);
+
+  /* Blocking and non-blocking reads convert as the C formula */
+  mpu6050::Sample sample;
+  mpu6050_sample_t raw;
+  CHECK(imu.read(sample) == MPU6050_OK);
+  CHECK(mpu6050_read_all_raw(imu.handle(), &raw) == MPU6050_OK);
+  test_check_convert(raw, sample);
+  CHECK_NEAR(sample.accel[2](), 9.80665, 1e-5);
+  CHECK(imu.fetch() == MPU6050_OK);
+  while (!imu.is_data_ready())
+    i2c_sim_run(&bus, 10000U);
+  CHECK(imu.read_from_buffer(sample) == MPU6050_OK);
+  CHECK(mpu6050_read_all_from_buffer(imu.handle(), &raw) == MPU6050_OK);
+  test_check_convert(raw, sample);
+
+  /* Failures return the C status, the sample is left as it was */
+  i2c_sim_fault_inject(&bus, I2C_SIM_FAULT_NACK, 1);
+  mpu6050::Sample kept = sample;
+  mpu6050_status_t status = mpu6050_read_all_raw(imu.handle(), &raw);
+  CHECK(status != MPU6050_OK);
+  CHECK(imu.read(sample) == status);
+  CHECK(std::memcmp(&sample, &kept, sizeof(sample)) == 0);
+  i2c_sim_fault_inject(&bus, I2C_SIM_FAULT_NONE, 0);
+
+  /* No device at the address: init returns what the C init returns */
+  i2c_sim_bus_t empty;
+  i2c_sim_bus_init(&empty, I2C_SIM_SPEED_400KHZ);
+  mpu6050_t handle;
+  status = mpu6050_init(&handle, &empty, Imu::address);
+  CHECK(status != MPU6050_OK);
+  Imu absent(empty);
+  CHECK(absent.init() == status);
+  return TEST_RESULT();
+}